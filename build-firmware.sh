@@ -16,6 +16,11 @@ echo "==> Output dir:      $OUTPUT_DIR"
 
 mkdir -p "$OUTPUT_DIR"
 
+# Host tool that packs compressed (.glz) and delta (.gld) OTA images
+OTA_PACK="$FIRMWARE_DIR/.pio/ota-pack"
+mkdir -p "$FIRMWARE_DIR/.pio"
+c++ -std=c++11 -O2 -I"$FIRMWARE_DIR/include" "$FIRMWARE_DIR/tools/ota-pack/ota_pack.cpp" -o "$OTA_PACK"
+
 build_env() {
     local env="$1"
     local label="$2"
@@ -24,8 +29,18 @@ build_env() {
     (cd "$FIRMWARE_DIR" && pio run -e "$env")
     local src="$FIRMWARE_DIR/.pio/build/$env/firmware.bin"
     local dst="$OUTPUT_DIR/${label}.bin"
+    # The previously published build becomes the base for a delta, which
+    # devices still running it can apply instead of the full image
+    rm -f "$OUTPUT_DIR/${label}.gld" "$OUTPUT_DIR/${label}.base.bin"
+    if [ -f "$dst" ] && ! cmp -s "$src" "$dst"; then
+        cp "$dst" "$OUTPUT_DIR/${label}.base.bin"
+    fi
     cp "$src" "$dst"
     echo "    Copied: $dst"
+    "$OTA_PACK" compress "$dst" "$OUTPUT_DIR/${label}.glz"
+    if [ -f "$OUTPUT_DIR/${label}.base.bin" ]; then
+        "$OTA_PACK" delta "$OUTPUT_DIR/${label}.base.bin" "$dst" "$OUTPUT_DIR/${label}.gld"
+    fi
 }
 
 case "$TARGET" in
@@ -45,6 +60,22 @@ esac
 VERSION="$(cd "$FIRMWARE_DIR" && git describe --tags --always --dirty 2>/dev/null || echo "unknown")"
 BUILD_DATE="$(date -u +"%Y-%m-%dT%H:%M:%SZ")"
 
+# Devices verify the download against this digest before switching partitions
+sha256_of() {
+    local file="$OUTPUT_DIR/$1"
+    if [ -f "$file" ]; then
+        sha256sum "$file" | cut -d' ' -f1
+    fi
+}
+SHA_SEEED="$(sha256_of firmware-seeed.bin)"
+SHA_DEVKIT="$(sha256_of firmware-devkit.bin)"
+SHA_SEEED_GLZ="$(sha256_of firmware-seeed.glz)"
+SHA_DEVKIT_GLZ="$(sha256_of firmware-devkit.glz)"
+SHA_SEEED_GLD="$(sha256_of firmware-seeed.gld)"
+SHA_DEVKIT_GLD="$(sha256_of firmware-devkit.gld)"
+BASE_SEEED="$(sha256_of firmware-seeed.base.bin)"
+BASE_DEVKIT="$(sha256_of firmware-devkit.base.bin)"
+
 cat > "$OUTPUT_DIR/manifest.json" <<EOF
 {
   "version": "$VERSION",
@@ -52,6 +83,18 @@ cat > "$OUTPUT_DIR/manifest.json" <<EOF
   "boards": {
     "seeed_xiao_esp32c3": "firmware/firmware-seeed.bin",
     "esp32-c3-devkitm-1": "firmware/firmware-devkit.bin"
+  },
+  "sha256": {
+    "seeed_xiao_esp32c3": "$SHA_SEEED",
+    "esp32-c3-devkitm-1": "$SHA_DEVKIT"
+  },
+  "compressed": {
+    "seeed_xiao_esp32c3": { "path": "firmware/firmware-seeed.glz", "sha256": "$SHA_SEEED_GLZ" },
+    "esp32-c3-devkitm-1": { "path": "firmware/firmware-devkit.glz", "sha256": "$SHA_DEVKIT_GLZ" }
+  },
+  "delta": {
+    "seeed_xiao_esp32c3": { "path": "firmware/firmware-seeed.gld", "sha256": "$SHA_SEEED_GLD", "base_sha256": "$BASE_SEEED" },
+    "esp32-c3-devkitm-1": { "path": "firmware/firmware-devkit.gld", "sha256": "$SHA_DEVKIT_GLD", "base_sha256": "$BASE_DEVKIT" }
   }
 }
 EOF
@@ -4,13 +4,16 @@
 #include "Arduino.h"
 #include <map>
 #include <functional>
+#include "StallWatchdog.h"
 
 class CommandRegistry {
 private:
     std::map<String, std::function<void(const String&)>> handlers;
+    bool scheduled;
+    uint32_t scheduledAt;
     
 public:
-    CommandRegistry() {}
+    CommandRegistry() : scheduled(false), scheduledAt(0) {}
     
     // Register a command handler
     void registerCommand(const String& name, std::function<void(const String&)> handler) {
@@ -22,6 +25,8 @@ public:
     // Execute a command with parameters
     bool executeCommand(const String& command, const String& parameters) {
         if (handlers.count(command)) {
+            // Named in the stall record if this handler or what follows hangs
+            stallWatchdog.noteCommand(command.c_str());
             try {
                 handlers[command](parameters);
                 Serial.print("Executed command: ");
@@ -45,6 +50,24 @@ public:
         }
     }
     
+    // Execute a command on behalf of a cue that was due at `at` (millis()).
+    // Handlers that start something time-based can read the due time with
+    // getScheduledAt() and align to it rather than to when they ran.
+    bool executeCommandAt(const String& command, const String& parameters, uint32_t at) {
+        scheduled = true;
+        scheduledAt = at;
+        bool result = executeCommand(command, parameters);
+        scheduled = false;
+        return result;
+    }
+
+    // True while a scheduled command runs; `at` is when it was due
+    bool getScheduledAt(uint32_t& at) const {
+        if (!scheduled) return false;
+        at = scheduledAt;
+        return true;
+    }
+    
     // Check if a command is registered
     bool hasCommand(const String& command) const {
         return handlers.count(command) > 0;
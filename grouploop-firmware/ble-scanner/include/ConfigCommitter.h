@@ -0,0 +1,117 @@
+#ifndef CONFIG_COMMITTER_H
+#define CONFIG_COMMITTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Batches configuration writes to NVS.
+//
+// Opening the namespace and writing a key each cost flash time, so setters
+// only mark their key dirty. The dirty keys are written together, in one
+// open of the namespace, once the configuration has been left alone for
+// `debounceMs` (but no later than `maxDelayMs` after the first change, so a
+// steady trickle of changes still reaches flash). Changes made between
+// begin() and commit() are written when the outermost commit() returns,
+// not debounced.
+//
+// Prefs is Preferences on the device and a fake in the host tests; the
+// caller writes the values, through the callback given to update(),
+// commit() and flush(): writeKey(prefs, key).
+template <typename Prefs, size_t KeyCount>
+class BasicConfigCommitter {
+public:
+    static_assert(KeyCount <= 32, "dirty keys are a 32-bit mask");
+
+    struct Stats {
+        uint32_t commits;       // namespace opened and dirty keys written
+        uint32_t keysWritten;
+        uint32_t failures;      // namespace would not open; keys kept dirty
+    };
+
+    BasicConfigCommitter(Prefs& prefs, const char* nameSpace, uint32_t debounceMs, uint32_t maxDelayMs)
+        : prefs(prefs), nameSpace(nameSpace), debounceMs(debounceMs), maxDelayMs(maxDelayMs),
+          dirty(0), lastWritten(0), depth(0), firstChangeAt(0), lastChangeAt(0), stats{0, 0, 0} {}
+
+    void markDirty(size_t key, uint32_t now) {
+        if (key >= KeyCount) return;
+        if (!dirty) firstChangeAt = now;
+        lastChangeAt = now;
+        dirty |= (uint32_t)1 << key;
+    }
+
+    bool isDirty() const { return dirty != 0; }
+    bool isDirty(size_t key) const { return key < KeyCount && (dirty & ((uint32_t)1 << key)); }
+    bool inTransaction() const { return depth > 0; }
+
+    // Hold writes until the matching commit(); nests
+    void begin() { depth++; }
+
+    // Ends a begin(); the outermost one writes what changed since. False
+    // if the write failed (the keys stay dirty and are retried later).
+    template <typename WriteKey>
+    bool commit(uint32_t now, WriteKey writeKey) {
+        if (depth > 0) depth--;
+        if (depth > 0 || !dirty) return true;
+        return write(now, writeKey);
+    }
+
+    // Time the debounced write is due; only meaningful while dirty
+    uint32_t dueAt() const {
+        uint32_t quiet = lastChangeAt + debounceMs;
+        uint32_t latest = firstChangeAt + maxDelayMs;
+        return (int32_t)(quiet - latest) < 0 ? quiet : latest;
+    }
+
+    // Background commit: writes the dirty keys once they are due
+    template <typename WriteKey>
+    bool update(uint32_t now, WriteKey writeKey) {
+        if (!dirty || depth > 0 || (int32_t)(now - dueAt()) < 0) return false;
+        return write(now, writeKey);
+    }
+
+    // Write the dirty keys now, e.g. before a restart
+    template <typename WriteKey>
+    bool flush(uint32_t now, WriteKey writeKey) {
+        if (!dirty) return true;
+        return write(now, writeKey);
+    }
+
+    const Stats& getStats() const { return stats; }
+
+    // Keys of the last batch written, bit per key
+    uint32_t getLastWritten() const { return lastWritten; }
+
+private:
+    Prefs& prefs;
+    const char* nameSpace;
+    uint32_t debounceMs;
+    uint32_t maxDelayMs;
+    uint32_t dirty;
+    uint32_t lastWritten;
+    uint8_t depth;
+    uint32_t firstChangeAt;
+    uint32_t lastChangeAt;
+    Stats stats;
+
+    template <typename WriteKey>
+    bool write(uint32_t now, WriteKey& writeKey) {
+        if (!prefs.begin(nameSpace, false)) {
+            // Try again after another quiet period
+            stats.failures++;
+            firstChangeAt = lastChangeAt = now;
+            return false;
+        }
+        for (size_t key = 0; key < KeyCount; key++) {
+            if (!(dirty & ((uint32_t)1 << key))) continue;
+            writeKey(prefs, key);
+            stats.keysWritten++;
+        }
+        prefs.end();
+        lastWritten = dirty;
+        dirty = 0;
+        stats.commits++;
+        return true;
+    }
+};
+
+#endif // CONFIG_COMMITTER_H
@@ -0,0 +1,120 @@
+#ifndef CONFIG_PATCH_H
+#define CONFIG_PATCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Binary configuration update, the compact alternative to partial JSON in
+// `config_set:<hex>` and the payload of a provisioning CONFIG frame
+// (ProvisionProtocol.h). Only the settings it lists change.
+//
+// Binary format (hex-encoded in config_set):
+//
+//   u8  version            1
+//   then 1 or more records:
+//     u8 setting           index of the setting (Configuration::Setting)
+//     u8 length            bytes of value that follow
+//     value                strings: the characters, no terminator
+//                          numbers: int32, little-endian (length 4)
+//
+// Setting the socket URL (2) to "ws://a:5003": 01 02 0b 77 73 3a 2f 2f 61
+// 3a 35 30 30 33.
+
+struct ConfigPatchRecord {
+    uint8_t setting;
+    uint8_t length;
+    const uint8_t* value;
+
+    int32_t asInt() const {
+        return (int32_t)((uint32_t)value[0] | ((uint32_t)value[1] << 8) | ((uint32_t)value[2] << 16) |
+                         ((uint32_t)value[3] << 24));
+    }
+};
+
+template <size_t MaxBytes>
+class BasicConfigPatch {
+public:
+    static constexpr uint8_t VERSION = 1;
+
+    BasicConfigPatch() : length(0), records(0) {}
+
+    // Checks the framing; the values are checked as they are applied
+    bool loadHex(const char* hex, const char*& error) {
+        length = 0;
+        records = 0;
+        size_t digits = hex ? strlen(hex) : 0;
+        if (digits % 2) return fail(error, "odd number of hex digits");
+        if (digits / 2 > MaxBytes) return fail(error, "too long");
+        for (size_t i = 0; i < digits / 2; i++) {
+            int hi = digit(hex[2 * i]);
+            int lo = digit(hex[2 * i + 1]);
+            if (hi < 0 || lo < 0) return fail(error, "invalid hex digit");
+            bytes[i] = (uint8_t)((hi << 4) | lo);
+        }
+        return check(digits / 2, error);
+    }
+
+    // Same format, as raw bytes (the provisioning protocol's CONFIG frame)
+    bool load(const uint8_t* data, size_t size, const char*& error) {
+        length = 0;
+        records = 0;
+        if (size > MaxBytes) return fail(error, "too long");
+        if (size) memcpy(bytes, data, size);
+        return check(size, error);
+    }
+
+    size_t size() const { return records; }
+
+    // Records in order: for (size_t at = 0; patch.next(at, record);)
+    bool next(size_t& at, ConfigPatchRecord& record) const {
+        if (at == 0) at = 1;
+        if (at + 2 > length) return false;
+        record.setting = bytes[at];
+        record.length = bytes[at + 1];
+        record.value = &bytes[at + 2];
+        at += 2 + record.length;
+        return true;
+    }
+
+private:
+    uint8_t bytes[MaxBytes];
+    size_t length;
+    size_t records;
+
+    bool check(size_t size, const char*& error) {
+        if (size < 3) return fail(error, "truncated");
+        if (bytes[0] != VERSION) return fail(error, "unsupported version");
+        size_t at = 1;
+        size_t count = 0;
+        while (at < size) {
+            if (at + 2 > size) return fail(error, "truncated record");
+            at += 2 + bytes[at + 1];
+            if (at > size) return fail(error, "truncated value");
+            count++;
+        }
+        length = size;
+        records = count;
+        return true;
+    }
+
+    static bool fail(const char*& error, const char* message) {
+        error = message;
+        return false;
+    }
+
+    static int digit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+};
+
+#if defined(ARDUINO)
+#include "config.h"
+
+typedef BasicConfigPatch<CONFIG_PATCH_MAX_BYTES> ConfigPatch;
+#endif
+
+#endif // CONFIG_PATCH_H
@@ -0,0 +1,131 @@
+#ifndef CONFIG_SCHEMA_H
+#define CONFIG_SCHEMA_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "PublishLimits.h"
+
+// The persisted settings, one line each. Everything that handles settings
+// one by one (the Setting enum, getters and setters, NVS, JSON, the binary
+// ConfigPatch records, printing) is generated from or loops over this
+// table, so a new setting is one more line here.
+//
+//   X(ID, TYPE, Accessor, "jsonName", "nvs_key", "Label", default, min, max, flags)
+//
+// TYPE is STRING or INT. min and max clamp INT values and are ignored for
+// strings. Flags: CONFIG_RESTART for settings read only at boot,
+// CONFIG_SECRET for values config_get masks. Settings keep their index
+// (Setting, the ConfigPatch setting byte and the CONFIG_CHANGED bit), so
+// append new ones at the end. NVS keys are at most 15 characters.
+#define CONFIG_SETTINGS(X) \
+    X(WIFI_SSID,          STRING, WifiSSID,          "wifiSSID",          "wifi_ssid",     "WiFi SSID",          "IOT",               0, 0, 0) \
+    X(WIFI_PASSWORD,      STRING, WifiPassword,      "wifiPassword",      "wifi_pass",     "WiFi Password",      "!HVAIOT!",          0, 0, CONFIG_SECRET) \
+    X(SOCKET_SERVER_URL,  STRING, SocketServerURL,   "socketServerURL",   "socket_url",    "Socket Server URL",  "ws://feib.nl:5003", 0, 0, 0) \
+    X(LED_PIN,            INT,    LEDPin,            "LEDPin",            "led_pin",       "LED Pin",            3,                   0, 48, CONFIG_RESTART) \
+    X(MOTOR_PIN,          INT,    MotorPin,          "motorPin",          "motor_pin",     "Motor Pin",          2,                   0, 48, CONFIG_RESTART) \
+    X(DEVICE_NAME_PREFIX, STRING, DeviceNamePrefix,  "deviceNamePrefix",  "device_prefix", "Device Name Prefix", "HitloopScanner",    0, 0, 0) \
+    X(BEACON_NE,          STRING, BeaconNE,          "beaconNE",          "beacon_ne",     "Beacon NE",          "64:e8:33:84:43:9a", 0, 0, 0) \
+    X(BEACON_NW,          STRING, BeaconNW,          "beaconNW",          "beacon_nw",     "Beacon NW",          "64:e8:33:87:0d:62", 0, 0, 0) \
+    X(BEACON_SE,          STRING, BeaconSE,          "beaconSE",          "beacon_se",     "Beacon SE",          "98:3d:ae:aa:16:8a", 0, 0, 0) \
+    X(BEACON_SW,          STRING, BeaconSW,          "beaconSW",          "beacon_sw",     "Beacon SW",          "98:3d:ae:ab:b2:7a", 0, 0, 0) \
+    X(PUBLISH_INTERVAL,   INT,    PublishIntervalMs, "publishIntervalMs", "publish_ms",    "Publish Interval ms", 50, PUBLISH_MIN_INTERVAL_MS, PUBLISH_MAX_INTERVAL_MS, 0) \
+    X(DEVICE_LABEL,       STRING, DeviceLabel,       "deviceLabel",       "device_label",  "Device Label",       "",                  0, 0, 0)
+
+enum class ConfigType : uint8_t {
+    STRING,
+    INT
+};
+
+enum ConfigFlags : uint8_t {
+    CONFIG_RESTART = 1 << 0,
+    CONFIG_SECRET = 1 << 1
+};
+
+// One row of the table; all of it constant, so it stays in flash
+struct ConfigSettingInfo {
+    const char* name;
+    const char* key;
+    const char* label;
+    ConfigType type;
+    const char* defaultText;    // STRING
+    int32_t defaultNumber;      // INT
+    int32_t min;
+    int32_t max;
+    uint8_t flags;
+
+    int32_t clamp(int32_t value) const { return value < min ? min : (value > max ? max : value); }
+};
+
+#define CONFIG_DEFAULT_STRING(value) value, 0
+#define CONFIG_DEFAULT_INT(value) nullptr, value
+
+struct ConfigSchema {
+    enum Setting {
+#define CONFIG_ENUM(ID, TYPE, Accessor, name, key, label, def, min, max, flags) SETTING_##ID,
+        CONFIG_SETTINGS(CONFIG_ENUM)
+#undef CONFIG_ENUM
+        SETTING_COUNT
+    };
+
+    static constexpr ConfigSettingInfo SETTINGS[SETTING_COUNT] = {
+#define CONFIG_ROW(ID, TYPE, Accessor, name, key, label, def, min, max, flags) \
+        {name, key, label, ConfigType::TYPE, CONFIG_DEFAULT_##TYPE(def), min, max, flags},
+        CONFIG_SETTINGS(CONFIG_ROW)
+#undef CONFIG_ROW
+    };
+
+    // JSON name of a setting, "" if there is no such setting
+    static const char* settingName(size_t setting) {
+        return setting < SETTING_COUNT ? SETTINGS[setting].name : "";
+    }
+
+    // Setting by JSON name, SETTING_COUNT if there is none
+    static size_t find(const char* name) {
+        for (size_t i = 0; i < SETTING_COUNT; i++) {
+            if (strcmp(SETTINGS[i].name, name) == 0) return i;
+        }
+        return SETTING_COUNT;
+    }
+};
+
+// Settings of one type
+constexpr size_t configCount(ConfigType type) {
+    size_t n = 0;
+    for (size_t i = 0; i < ConfigSchema::SETTING_COUNT; i++) {
+        if (ConfigSchema::SETTINGS[i].type == type) n++;
+    }
+    return n;
+}
+
+// Where a setting's value lives in the array of its type
+constexpr size_t configSlot(size_t setting) {
+    size_t slot = 0;
+    for (size_t i = 0; i < setting; i++) {
+        if (ConfigSchema::SETTINGS[i].type == ConfigSchema::SETTINGS[setting].type) slot++;
+    }
+    return slot;
+}
+
+// Bit per setting that has `flag`
+constexpr uint32_t configMask(uint8_t flag) {
+    uint32_t bits = 0;
+    for (size_t i = 0; i < ConfigSchema::SETTING_COUNT; i++) {
+        if (ConfigSchema::SETTINGS[i].flags & flag) bits |= (uint32_t)1 << i;
+    }
+    return bits;
+}
+
+constexpr bool configKeysFit() {
+    for (size_t i = 0; i < ConfigSchema::SETTING_COUNT; i++) {
+        size_t length = 0;
+        while (ConfigSchema::SETTINGS[i].key[length]) length++;
+        if (length > 15) return false;
+    }
+    return true;
+}
+
+static_assert(ConfigSchema::SETTING_COUNT <= 32, "CONFIG_CHANGED and the committer use a bit per setting");
+static_assert(configKeysFit(), "NVS keys are at most 15 characters");
+
+#endif // CONFIG_SCHEMA_H
@@ -4,56 +4,54 @@
 #include "Arduino.h"
 #include <ArduinoJson.h>
 #include <Preferences.h>
+#include "EventBus.h"
+#include "ConfigSchema.h"
+#include "ConfigCommitter.h"
+#include "ConfigPatch.h"
+#include "config.h"
+
+// Device settings, persisted in NVS. The settings themselves are listed in
+// ConfigSchema.h; this class keeps their values and handles every one of
+// them the same way, through the schema table.
+class Configuration : public ConfigSchema {
+public:
+    typedef BasicConfigCommitter<Preferences, SETTING_COUNT> Committer;
+
+    // Settings that only take effect after a restart (the LED and motor
+    // pins are claimed when their processes are constructed); the rest are
+    // picked up live through CONFIG_CHANGED
+    static constexpr uint32_t RESTART_SETTINGS = configMask(CONFIG_RESTART);
+
+private:
+    static constexpr const char* NVS_NAMESPACE = "config";
+
+    // Values by type, each setting at its configSlot()
+    String strings[configCount(ConfigType::STRING)];
+    int32_t numbers[configCount(ConfigType::INT)];
 
-class Configuration {
-private:    
-    // Device-specific configuration variables
-    String wifiSSID;
-    String wifiPassword;
-    String socketServerURL;
-    int LEDPin;
-    int motorPin;
-    String deviceNamePrefix;
-    
-    // Beacon identifiers for the four cardinal directions
-    String beaconNE;
-    String beaconNW;
-    String beaconSE;
-    String beaconSW;
-    
     // Preferences object for NVS storage
     Preferences preferences;
-    
-    // Default values
-    static const String DEFAULT_WIFI_SSID;
-    static const String DEFAULT_WIFI_PASSWORD;
-    static const String DEFAULT_SOCKET_SERVER_URL;
-    static const int DEFAULT_LED_PIN;
-    static const int DEFAULT_MOTOR_PIN;
-    static const String DEFAULT_DEVICE_NAME_PREFIX;
-    static const String DEFAULT_BEACON_NE;
-    static const String DEFAULT_BEACON_NW;
-    static const String DEFAULT_BEACON_SE;
-    static const String DEFAULT_BEACON_SW;
-    
-    // NVS key names
-    static const char* NVS_NAMESPACE;
-    static const char* KEY_WIFI_SSID;
-    static const char* KEY_WIFI_PASSWORD;
-    static const char* KEY_SOCKET_SERVER_URL;
-    static const char* KEY_LED_PIN;
-    static const char* KEY_MOTOR_PIN;
-    static const char* KEY_DEVICE_NAME_PREFIX;
-    static const char* KEY_BEACON_NE;
-    static const char* KEY_BEACON_NW;
-    static const char* KEY_BEACON_SE;
-    static const char* KEY_BEACON_SW;
+
+    // Changed settings, written to NVS in batches
+    Committer committer;
+
+    // Settings changed since the last CONFIG_CHANGED, bit per Setting
+    uint32_t unannounced;
+    uint32_t lastChanged;
+    uint32_t announcements;
+
+    struct Writer {
+        Configuration* configuration;
+        void operator()(Preferences& prefs, size_t setting) const { configuration->writeSetting(prefs, setting); }
+    };
 
 public:
 
     // Private constructor for singleton pattern
-    Configuration() {}
-        
+    Configuration()
+        : committer(preferences, NVS_NAMESPACE, CONFIG_COMMIT_DEBOUNCE_MS, CONFIG_COMMIT_MAX_DELAY_MS),
+          unannounced(0), lastChanged(0), announcements(0) {}
+
     // Initialize configuration from NVS or defaults
     void initialize() {
         // Open preferences namespace
@@ -62,246 +60,237 @@ public:
             loadDefaults();
             return;
         }
-        
+
         // Load values from NVS, use defaults if not found
-        wifiSSID = preferences.getString(KEY_WIFI_SSID, DEFAULT_WIFI_SSID);
-        wifiPassword = preferences.getString(KEY_WIFI_PASSWORD, DEFAULT_WIFI_PASSWORD);
-        socketServerURL = preferences.getString(KEY_SOCKET_SERVER_URL, DEFAULT_SOCKET_SERVER_URL);
-        LEDPin = preferences.getInt(KEY_LED_PIN, DEFAULT_LED_PIN);
-        motorPin = preferences.getInt(KEY_MOTOR_PIN, DEFAULT_MOTOR_PIN);
-        deviceNamePrefix = preferences.getString(KEY_DEVICE_NAME_PREFIX, DEFAULT_DEVICE_NAME_PREFIX);
-        beaconNE = preferences.getString(KEY_BEACON_NE, DEFAULT_BEACON_NE);
-        beaconNW = preferences.getString(KEY_BEACON_NW, DEFAULT_BEACON_NW);
-        beaconSE = preferences.getString(KEY_BEACON_SE, DEFAULT_BEACON_SE);
-        beaconSW = preferences.getString(KEY_BEACON_SW, DEFAULT_BEACON_SW);
-        
+        for (size_t setting = 0; setting < SETTING_COUNT; setting++) {
+            const ConfigSettingInfo& info = SETTINGS[setting];
+            if (info.type == ConfigType::STRING) {
+                text(setting) = preferences.getString(info.key, info.defaultText);
+            } else {
+                number(setting) = preferences.getInt(info.key, info.defaultNumber);
+            }
+        }
+
         preferences.end();
-        
+
         Serial.println("Configuration loaded from NVS");
     }
-    
+
     // Load default values
     void loadDefaults() {
-        wifiSSID = DEFAULT_WIFI_SSID;
-        wifiPassword = DEFAULT_WIFI_PASSWORD;
-        socketServerURL = DEFAULT_SOCKET_SERVER_URL;
-        LEDPin = DEFAULT_LED_PIN;
-        motorPin = DEFAULT_MOTOR_PIN;
-        deviceNamePrefix = DEFAULT_DEVICE_NAME_PREFIX;
-        beaconNE = DEFAULT_BEACON_NE;
-        beaconNW = DEFAULT_BEACON_NW;
-        beaconSE = DEFAULT_BEACON_SE;
-        beaconSW = DEFAULT_BEACON_SW;
+        for (size_t setting = 0; setting < SETTING_COUNT; setting++) {
+            const ConfigSettingInfo& info = SETTINGS[setting];
+            if (info.type == ConfigType::STRING) {
+                text(setting) = info.defaultText;
+            } else {
+                number(setting) = info.defaultNumber;
+            }
+        }
         Serial.println("Configuration loaded with default values");
     }
-    
-    // Save current configuration to NVS
+
+    // Batch the setters that follow into one write at commit(), e.g.
+    // begin(); setBeaconNE(...); ...; setBeaconSW(...); commit();
+    void begin() {
+        committer.begin();
+    }
+
+    // Ends a begin(); the outermost one writes the changed settings now
+    bool commit() {
+        Committer::Stats before = committer.getStats();
+        return announce(before, committer.commit(millis(), Writer{this}));
+    }
+
+    // Background commit; changes outside a transaction are written once
+    // the configuration has been quiet for CONFIG_COMMIT_DEBOUNCE_MS
+    void update() {
+        Committer::Stats before = committer.getStats();
+        announce(before, committer.update(millis(), Writer{this}));
+    }
+
+    // Write pending changes now, e.g. before a restart
     bool save() {
-        if (!preferences.begin(NVS_NAMESPACE, false)) {
-            Serial.println("Failed to open preferences for saving");
-            return false;
-        }
-        
-        preferences.putString(KEY_WIFI_SSID, wifiSSID);
-        preferences.putString(KEY_WIFI_PASSWORD, wifiPassword);
-        preferences.putString(KEY_SOCKET_SERVER_URL, socketServerURL);
-        preferences.putInt(KEY_LED_PIN, LEDPin);
-        preferences.putInt(KEY_MOTOR_PIN, motorPin);
-        preferences.putString(KEY_DEVICE_NAME_PREFIX, deviceNamePrefix);
-        preferences.putString(KEY_BEACON_NE, beaconNE);
-        preferences.putString(KEY_BEACON_NW, beaconNW);
-        preferences.putString(KEY_BEACON_SE, beaconSE);
-        preferences.putString(KEY_BEACON_SW, beaconSW);
-        
-        preferences.end();
-        
-        Serial.println("Configuration saved to NVS");
-        return true;
+        Committer::Stats before = committer.getStats();
+        return announce(before, committer.flush(millis(), Writer{this}));
     }
-    
-    // Parse configuration from JSON string
+
+    bool hasUnsavedChanges() const { return committer.isDirty(); }
+    // Settings of the last CONFIG_CHANGED, bit per Setting, and how many
+    // have been published; they are live whether or not NVS took them
+    uint32_t getLastChanged() const { return lastChanged; }
+    uint32_t getAnnouncements() const { return announcements; }
+    const Committer::Stats& getCommitStats() const { return committer.getStats(); }
+
+    // Parse configuration from JSON string; settings it leaves out keep
+    // their values
     bool parseFromJSON(const String& jsonString) {
         JsonDocument doc;
         DeserializationError error = deserializeJson(doc, jsonString);
-        
+
         if (error) {
             Serial.print("JSON parsing failed: ");
             Serial.println(error.c_str());
             return false;
         }
-        
+
         // Parse each configuration value if present
-        if (doc["wifiSSID"].is<String>()) {
-            wifiSSID = doc["wifiSSID"].as<String>();
-        }
-        
-        if (doc["wifiPassword"].is<String>()) {
-            wifiPassword = doc["wifiPassword"].as<String>();
-        }
-        
-        if (doc["socketServerURL"].is<String>()) {
-            socketServerURL = doc["socketServerURL"].as<String>();
-        }
-        
-        if (doc["LEDPin"].is<int>()) {
-            LEDPin = doc["LEDPin"].as<int>();
-        }
-        
-        if (doc["motorPin"].is<int>()) {
-            motorPin = doc["motorPin"].as<int>();
-        }
-        
-        if (doc["deviceNamePrefix"].is<String>()) {
-            deviceNamePrefix = doc["deviceNamePrefix"].as<String>();
-        }
-        
-        if (doc["beaconNE"].is<String>()) {
-            beaconNE = doc["beaconNE"].as<String>();
-        }
-        
-        if (doc["beaconNW"].is<String>()) {
-            beaconNW = doc["beaconNW"].as<String>();
+        begin();
+        for (size_t setting = 0; setting < SETTING_COUNT; setting++) {
+            JsonVariant value = doc[SETTINGS[setting].name];
+            if (SETTINGS[setting].type == ConfigType::STRING) {
+                if (value.is<const char*>()) setText(setting, value.as<const char*>());
+            } else {
+                if (value.is<int>()) setNumber(setting, value.as<int>());
+            }
         }
-        
-        if (doc["beaconSE"].is<String>()) {
-            beaconSE = doc["beaconSE"].as<String>();
-        }
-        
-        if (doc["beaconSW"].is<String>()) {
-            beaconSW = doc["beaconSW"].as<String>();
-        }
-        
-        // Save the updated configuration to NVS
-        save();
-        
+
+        // Write what changed to NVS in one go
+        commit();
+
         return true;
     }
-    
-    // Getter methods
-    const String& getWifiSSID() const { return wifiSSID; }
-    const String& getWifiPassword() const { return wifiPassword; }
-    const String& getSocketServerURL() const { return socketServerURL; }
-    int getLEDPin() const { return LEDPin; }
-    int getMotorPin() const { return motorPin; }
-    const String& getDeviceNamePrefix() const { return deviceNamePrefix; }
-    const String& getBeaconNE() const { return beaconNE; }
-    const String& getBeaconNW() const { return beaconNW; }
-    const String& getBeaconSE() const { return beaconSE; }
-    const String& getBeaconSW() const { return beaconSW; }
-    
-    // Setter methods (for runtime configuration changes)
-    void setWifiSSID(const String& ssid) { 
-        wifiSSID = ssid; 
-        save();
-    }
-    void setWifiPassword(const String& password) { 
-        wifiPassword = password; 
-        save();
-    }
-    void setSocketServerURL(const String& url) { 
-        socketServerURL = url; 
-        save();
-    }
-    void setLEDPin(int pin) { 
-        LEDPin = pin; 
-        save();
-    }
-    void setMotorPin(int pin) { 
-        motorPin = pin; 
-        save();
-    }
-    void setDeviceNamePrefix(const String& prefix) { 
-        deviceNamePrefix = prefix; 
-        save();
-    }
-    void setBeaconNE(const String& beaconId) { 
-        beaconNE = beaconId; 
-        save();
+
+    // Whether a record of a binary update (ConfigPatch.h) names a setting
+    // and carries a value of its type
+    static bool acceptsPatchRecord(const ConfigPatchRecord& record) {
+        if (record.setting >= SETTING_COUNT) return false;
+        if (SETTINGS[record.setting].type == ConfigType::INT) return record.length == 4;
+        return memchr(record.value, 0, record.length) == nullptr;
     }
-    void setBeaconNW(const String& beaconId) { 
-        beaconNW = beaconId; 
-        save();
+
+    // Apply one record of a binary update; false if it is not accepted
+    bool applyPatchRecord(const ConfigPatchRecord& record) {
+        if (!acceptsPatchRecord(record)) return false;
+        if (SETTINGS[record.setting].type == ConfigType::INT) {
+            setNumber(record.setting, record.asInt());
+            return true;
+        }
+        String value;
+        value.reserve(record.length);
+        for (size_t i = 0; i < record.length; i++) {
+            value += (char)record.value[i];
+        }
+        setText(record.setting, value);
+        return true;
     }
-    void setBeaconSE(const String& beaconId) { 
-        beaconSE = beaconId; 
-        save();
+
+    // Getter and setter methods, getWifiSSID()/setWifiSSID() and so on,
+    // one pair per row of CONFIG_SETTINGS. A changed value is written to
+    // NVS in the next batch, see update() and commit().
+#define CONFIG_ACCESSORS_STRING(ID, Accessor) \
+    const String& get##Accessor() const { return strings[configSlot(SETTING_##ID)]; } \
+    void set##Accessor(const String& value) { setText(SETTING_##ID, value); }
+#define CONFIG_ACCESSORS_INT(ID, Accessor) \
+    int get##Accessor() const { return numbers[configSlot(SETTING_##ID)]; } \
+    void set##Accessor(int value) { setNumber(SETTING_##ID, value); }
+#define CONFIG_ACCESSORS(ID, TYPE, Accessor, name, key, label, def, min, max, flags) \
+    CONFIG_ACCESSORS_##TYPE(ID, Accessor)
+    CONFIG_SETTINGS(CONFIG_ACCESSORS)
+#undef CONFIG_ACCESSORS
+#undef CONFIG_ACCESSORS_INT
+#undef CONFIG_ACCESSORS_STRING
+
+    // Any setting by index
+    void setText(size_t setting, const String& value) {
+        if (text(setting) == value) return;
+        text(setting) = value;
+        changed(setting);
     }
-    void setBeaconSW(const String& beaconId) { 
-        beaconSW = beaconId; 
-        save();
+
+    void setNumber(size_t setting, int32_t value) {
+        value = SETTINGS[setting].clamp(value);
+        if (number(setting) == value) return;
+        number(setting) = value;
+        changed(setting);
     }
-    
-    // Generate JSON string from current configuration
-    String toJSON() const {
+
+    // Generate JSON string from current configuration; without secrets
+    // the WiFi password only shows whether one is set
+    String toJSON(bool includeSecrets = true) const {
         JsonDocument doc;
-        
-        doc["wifiSSID"] = wifiSSID;
-        doc["wifiPassword"] = wifiPassword;
-        doc["socketServerURL"] = socketServerURL;
-        doc["LEDPin"] = LEDPin;
-        doc["motorPin"] = motorPin;
-        doc["deviceNamePrefix"] = deviceNamePrefix;
-        doc["beaconNE"] = beaconNE;
-        doc["beaconNW"] = beaconNW;
-        doc["beaconSE"] = beaconSE;
-        doc["beaconSW"] = beaconSW;
-        
+
+        for (size_t setting = 0; setting < SETTING_COUNT; setting++) {
+            const ConfigSettingInfo& info = SETTINGS[setting];
+            if (info.type == ConfigType::INT) {
+                doc[info.name] = number(setting);
+            } else if (includeSecrets || !(info.flags & CONFIG_SECRET)) {
+                doc[info.name] = text(setting);
+            } else {
+                doc[info.name] = text(setting).length() > 0 ? "***" : "";
+            }
+        }
+
         String output;
         serializeJson(doc, output);
         return output;
     }
-    
+
     // Print current configuration to Serial
     void printConfiguration() const {
         Serial.println("=== Configuration ===");
-        Serial.print("WiFi SSID: ");
-        Serial.println(wifiSSID);
-        Serial.print("WiFi Password: ");
-        Serial.println(wifiPassword);
-        Serial.print("Socket Server URL: ");
-        Serial.println(socketServerURL);
-        Serial.print("LED Pin: ");
-        Serial.println(LEDPin);
-        Serial.print("Motor Pin: ");
-        Serial.println(motorPin);
-        Serial.print("Device Name Prefix: ");
-        Serial.println(deviceNamePrefix);
-        Serial.print("Beacon NE: ");
-        Serial.println(beaconNE);
-        Serial.print("Beacon NW: ");
-        Serial.println(beaconNW);
-        Serial.print("Beacon SE: ");
-        Serial.println(beaconSE);
-        Serial.print("Beacon SW: ");
-        Serial.println(beaconSW);
+        for (size_t setting = 0; setting < SETTING_COUNT; setting++) {
+            Serial.print(SETTINGS[setting].label);
+            Serial.print(": ");
+            if (SETTINGS[setting].type == ConfigType::STRING) {
+                Serial.println(text(setting));
+            } else {
+                Serial.println(number(setting));
+            }
+        }
         Serial.println("====================");
     }
-};
 
-// Define default values
-const String Configuration::DEFAULT_WIFI_SSID = "IOT";
-const String Configuration::DEFAULT_WIFI_PASSWORD = "!HVAIOT!";
-const String Configuration::DEFAULT_SOCKET_SERVER_URL = "ws://feib.nl:5003";
-const int Configuration::DEFAULT_LED_PIN = 3;
-const int Configuration::DEFAULT_MOTOR_PIN = 2;
-const String Configuration::DEFAULT_DEVICE_NAME_PREFIX = "HitloopScanner";
-const String Configuration::DEFAULT_BEACON_NE = "64:e8:33:84:43:9a";
-const String Configuration::DEFAULT_BEACON_NW = "64:e8:33:87:0d:62";
-const String Configuration::DEFAULT_BEACON_SE = "98:3d:ae:aa:16:8a";
-const String Configuration::DEFAULT_BEACON_SW = "98:3d:ae:ab:b2:7a";
-
-// Define NVS key names
-const char* Configuration::NVS_NAMESPACE = "config";
-const char* Configuration::KEY_WIFI_SSID = "wifi_ssid";
-const char* Configuration::KEY_WIFI_PASSWORD = "wifi_pass";
-const char* Configuration::KEY_SOCKET_SERVER_URL = "socket_url";
-const char* Configuration::KEY_LED_PIN = "led_pin";
-const char* Configuration::KEY_MOTOR_PIN = "motor_pin";
-const char* Configuration::KEY_DEVICE_NAME_PREFIX = "device_prefix";
-const char* Configuration::KEY_BEACON_NE = "beacon_ne";
-const char* Configuration::KEY_BEACON_NW = "beacon_nw";
-const char* Configuration::KEY_BEACON_SE = "beacon_se";
-const char* Configuration::KEY_BEACON_SW = "beacon_sw";
+private:
+    String& text(size_t setting) { return strings[slotOf(setting)]; }
+    const String& text(size_t setting) const { return strings[slotOf(setting)]; }
+    int32_t& number(size_t setting) { return numbers[slotOf(setting)]; }
+    int32_t number(size_t setting) const { return numbers[slotOf(setting)]; }
+
+    // configSlot() for a setting only known at run time, from a table the
+    // compiler fills in
+    static size_t slotOf(size_t setting) {
+        static constexpr uint8_t slots[SETTING_COUNT] = {
+#define CONFIG_SLOT(ID, TYPE, Accessor, name, key, label, def, min, max, flags) configSlot(SETTING_##ID),
+            CONFIG_SETTINGS(CONFIG_SLOT)
+#undef CONFIG_SLOT
+        };
+        return slots[setting];
+    }
+
+    void writeSetting(Preferences& prefs, size_t setting) {
+        if (SETTINGS[setting].type == ConfigType::STRING) {
+            prefs.putString(SETTINGS[setting].key, text(setting));
+        } else {
+            prefs.putInt(SETTINGS[setting].key, number(setting));
+        }
+    }
+
+    void changed(size_t setting) {
+        unannounced |= (uint32_t)1 << setting;
+        committer.markDirty(setting, millis());
+    }
+
+    // Once the committer has tried to write a batch (stats were `before`),
+    // publishes the settings changed since the last announcement. The new
+    // values are live either way; a failed write stays dirty and is retried.
+    bool announce(const Committer::Stats& before, bool ok) {
+        const Committer::Stats& after = committer.getStats();
+        if (after.commits != before.commits) {
+            Serial.println("Configuration saved to NVS");
+        } else if (after.failures != before.failures) {
+            Serial.println("Failed to open preferences for saving");
+        } else {
+            return ok;
+        }
+        if (unannounced) {
+            lastChanged = unannounced;
+            unannounced = 0;
+            announcements++;
+            eventBus.publish(EventType::CONFIG_CHANGED, lastChanged);
+        }
+        return ok;
+    }
+};
 
 extern Configuration configuration;
 
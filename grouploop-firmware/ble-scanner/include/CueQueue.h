@@ -0,0 +1,86 @@
+#ifndef CUE_QUEUE_H
+#define CUE_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Commands waiting for their time: a binary min-heap ordered by due time,
+// with cues due at the same time kept in arrival order. Times are compared
+// as differences, so the order holds across the 32-bit wrap as long as no
+// two cues are more than ~24 days apart.
+template <size_t Capacity, size_t TextSize>
+class BasicCueQueue {
+private:
+    struct Cue {
+        uint32_t at;
+        uint32_t sequence;
+        char text[TextSize];
+    };
+
+    Cue heap[Capacity];
+    size_t count;
+    uint32_t nextSequence;
+
+    static bool earlier(const Cue& a, const Cue& b) {
+        int32_t d = (int32_t)(a.at - b.at);
+        if (d != 0) return d < 0;
+        return (int32_t)(a.sequence - b.sequence) < 0;
+    }
+
+    void swap(size_t i, size_t j) {
+        Cue tmp = heap[i];
+        heap[i] = heap[j];
+        heap[j] = tmp;
+    }
+
+public:
+    BasicCueQueue() : count(0), nextSequence(0) {}
+
+    // False when the queue is full or the command does not fit
+    bool push(uint32_t at, const char* text) {
+        size_t length = strlen(text);
+        if (count >= Capacity || length >= TextSize) return false;
+        size_t i = count++;
+        heap[i].at = at;
+        heap[i].sequence = nextSequence++;
+        memcpy(heap[i].text, text, length + 1);
+        while (i > 0) {
+            size_t parent = (i - 1) / 2;
+            if (!earlier(heap[i], heap[parent])) break;
+            swap(i, parent);
+            i = parent;
+        }
+        return true;
+    }
+
+    // Removes the earliest cue if it is due at `now`, copying its command
+    // (TextSize bytes at most) and due time out
+    bool popDue(uint32_t now, uint32_t& at, char* text) {
+        if (count == 0 || (int32_t)(now - heap[0].at) < 0) return false;
+        at = heap[0].at;
+        memcpy(text, heap[0].text, strlen(heap[0].text) + 1);
+        heap[0] = heap[--count];
+        size_t i = 0;
+        for (;;) {
+            size_t smallest = i;
+            size_t left = 2 * i + 1;
+            size_t right = left + 1;
+            if (left < count && earlier(heap[left], heap[smallest])) smallest = left;
+            if (right < count && earlier(heap[right], heap[smallest])) smallest = right;
+            if (smallest == i) break;
+            swap(i, smallest);
+            i = smallest;
+        }
+        return true;
+    }
+
+    // Due time of the earliest cue; only meaningful when !empty()
+    uint32_t nextAt() const { return count ? heap[0].at : 0; }
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+    void clear() { count = 0; }
+};
+
+#endif // CUE_QUEUE_H
@@ -0,0 +1,145 @@
+#ifndef ENERGY_MODEL_H
+#define ENERGY_MODEL_H
+
+#include <stdint.h>
+#include "PowerPolicy.h"
+
+// Current draw of the board's parts in mA at 3.3 V. Defaults are rough
+// ESP32-C3 datasheet figures plus the LED and IMU at their usual load;
+// adjust them from measurements rather than trusting them blindly.
+struct EnergyParams {
+    float cpuActiveBaseMa;      // active current = base + perMHz * clock
+    float cpuActivePerMHzMa;
+    float cpuIdleBaseMa;        // waiting in vTaskDelay (WAITI), same shape
+    float cpuIdlePerMHzMa;
+    float radioRxMa;            // receiver on (always, without modem sleep)
+    float radioTxMa;
+    float peripheralsMa;        // IMU, LED driver idle, regulator quiescent
+    uint16_t beaconRxMs;        // radio on per beacon wake
+    uint16_t txMs;              // radio on to send one frame and get the ACK
+    uint16_t wakeTailMs;        // extra radio time when a send wakes the modem by itself
+    uint16_t frameCpuMs;        // CPU time to build and send a frame
+    uint16_t backgroundCpuPerMille; // CPU duty of everything else (IMU, LEDs, BLE)
+
+    EnergyParams()
+        : cpuActiveBaseMa(9.0f), cpuActivePerMHzMa(0.0875f),
+          cpuIdleBaseMa(6.0f), cpuIdlePerMHzMa(0.05f),
+          radioRxMa(84.0f), radioTxMa(250.0f), peripheralsMa(3.0f),
+          beaconRxMs(3), txMs(2), wakeTailMs(4), frameCpuMs(1), backgroundCpuPerMille(150) {}
+};
+
+// The access point and the traffic around the device
+struct EnergyConditions {
+    uint16_t beaconIntervalMs;
+    uint8_t dtimPeriod;
+    uint16_t publishIntervalMs; // the setting, for profiles that do not align frames
+
+    EnergyConditions() : beaconIntervalMs(102), dtimPeriod(1), publishIntervalMs(50) {}
+};
+
+struct EnergyReport {
+    float averageMa;
+    uint32_t durationMs;
+    uint32_t radioOnMs;
+    uint32_t radioWakes;        // times the radio came out of modem sleep
+    uint32_t frames;
+
+    float hoursOn(float batteryMah) const {
+        return averageMa > 0 ? batteryMah / averageMa : 0;
+    }
+    float framesPerSecond() const {
+        return durationMs ? frames * 1000.0f / durationMs : 0;
+    }
+};
+
+// Simulates a power profile in 1 ms steps: beacon wakes, frame sends
+// (riding on a wake or waking the modem on their own), CPU active and idle
+// time at the profile's clocks. Cheap enough to run on the device for the
+// `power` command as well as in host tests.
+class EnergyModel {
+private:
+    EnergyParams params;
+    EnergyConditions conditions;
+
+public:
+    EnergyModel(const EnergyParams& aParams = EnergyParams(), const EnergyConditions& aConditions = EnergyConditions())
+        : params(aParams), conditions(aConditions) {}
+
+    void setConditions(const EnergyConditions& c) { conditions = c; }
+    const EnergyConditions& getConditions() const { return conditions; }
+
+    EnergyReport simulate(const PowerProfile& profile, uint32_t durationMs) const {
+        const bool sleeps = profile.modemSleep != ModemSleep::NONE;
+        const uint32_t wakeInterval = radioWakeIntervalMs(profile, conditions.beaconIntervalMs, conditions.dtimPeriod);
+        // Unaligned sends land at an arbitrary phase relative to the beacons
+        const uint32_t sendPhase = wakeInterval / 3 + 1;
+
+        double chargeMaMs = 0;
+        EnergyReport report = EnergyReport();
+        report.durationMs = durationMs;
+
+        uint32_t radioUntil = 0;    // radio stays on before this time (ms)
+        uint32_t txUntil = 0;
+        uint32_t cpuBusyUntil = 0;
+        uint32_t wakeCount = 0;
+        uint32_t backgroundAccumulator = 0;
+
+        for (uint32_t t = 0; t < durationMs; t++) {
+            bool beacon = sleeps && (t % wakeInterval) == 0;
+            if (beacon) {
+                if (t >= radioUntil) report.radioWakes++;
+                if (t + params.beaconRxMs > radioUntil) radioUntil = t + params.beaconRxMs;
+                wakeCount++;
+            }
+
+            bool send;
+            if (profile.publishWakes > 0 && sleeps) {
+                send = beacon && (wakeCount - 1) % profile.publishWakes == 0;
+            } else if (profile.publishWakes > 0) {
+                send = (t % (wakeInterval * profile.publishWakes)) == 0;
+            } else {
+                uint32_t interval = conditions.publishIntervalMs ? conditions.publishIntervalMs : 50;
+                send = (t % interval) == sendPhase % interval;
+            }
+            if (send) {
+                report.frames++;
+                if (sleeps && t >= radioUntil) {
+                    // Nothing else woke the radio: pay for the wake and tail too
+                    report.radioWakes++;
+                    radioUntil = t + params.txMs + params.wakeTailMs;
+                } else if (t + params.txMs > radioUntil) {
+                    radioUntil = t + params.txMs;
+                }
+                txUntil = t + params.txMs;
+                cpuBusyUntil = t + params.frameCpuMs;
+            }
+
+            // Background CPU work spread evenly over time
+            backgroundAccumulator += params.backgroundCpuPerMille;
+            bool background = backgroundAccumulator >= 1000;
+            if (background) backgroundAccumulator -= 1000;
+
+            bool cpuActive = background || t < cpuBusyUntil;
+            float ma = params.peripheralsMa;
+            ma += cpuActive ? params.cpuActiveBaseMa + params.cpuActivePerMHzMa * profile.cpuMHz
+                            : params.cpuIdleBaseMa + params.cpuIdlePerMHzMa * profile.idleCpuMHz;
+            bool radioOn = !sleeps || t < radioUntil;
+            if (t < txUntil) {
+                ma += params.radioTxMa;
+            } else if (radioOn) {
+                ma += params.radioRxMa;
+            }
+            if (radioOn || t < txUntil) report.radioOnMs++;
+            chargeMaMs += ma;
+        }
+
+        report.averageMa = durationMs ? (float)(chargeMaMs / durationMs) : 0;
+        return report;
+    }
+
+    float estimateMa(PowerMode mode, uint32_t durationMs = 10000) const {
+        return simulate(powerProfileFor(mode), durationMs).averageMa;
+    }
+};
+
+#endif // ENERGY_MODEL_H
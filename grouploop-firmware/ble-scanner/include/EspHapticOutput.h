@@ -0,0 +1,39 @@
+#ifndef ESP_HAPTIC_OUTPUT_H
+#define ESP_HAPTIC_OUTPUT_H
+
+#include "Arduino.h"
+#include <esp_arduino_version.h>
+#include "config.h"
+#include "HapticEngine.h"
+
+// Motor drive from an LEDC channel. The peripheral generates the PWM at
+// HAPTIC_PWM_FREQ on its own; setDuty() is one register write.
+class EspLedcHapticOutput : public HapticOutput {
+private:
+    static const uint8_t RESOLUTION_BITS = 8;
+
+    int pin;
+    uint8_t channel;
+
+public:
+    explicit EspLedcHapticOutput(int aPin, uint8_t aChannel = HAPTIC_LEDC_CHANNEL) : pin(aPin), channel(aChannel) {}
+
+    void begin() override {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+        ledcAttachChannel(pin, HAPTIC_PWM_FREQ, RESOLUTION_BITS, channel);
+#else
+        ledcSetup(channel, HAPTIC_PWM_FREQ, RESOLUTION_BITS);
+        ledcAttachPin(pin, channel);
+#endif
+    }
+
+    void setDuty(uint8_t duty) override {
+#if ESP_ARDUINO_VERSION_MAJOR >= 3
+        ledcWrite(pin, duty);
+#else
+        ledcWrite(channel, duty);
+#endif
+    }
+};
+
+#endif // ESP_HAPTIC_OUTPUT_H
@@ -0,0 +1,128 @@
+#ifndef ESP_OTA_TRANSPORT_H
+#define ESP_OTA_TRANSPORT_H
+
+#include "Arduino.h"
+#include <HTTPClient.h>
+#include <Update.h>
+#include <WiFiClient.h>
+#include <WiFiClientSecure.h>
+#include <esp_ota_ops.h>
+#include <esp_partition.h>
+#include "config.h"
+#include "OtaEngine.h"
+#include "OtaImageDecoder.h"
+
+// OtaSource over HTTPClient. open() blocks only for the connect and the
+// response headers (bounded by OTA_HTTP_TIMEOUT_MS); the body is then read
+// from whatever has already arrived in the socket buffer.
+class HttpOtaSource : public OtaSource {
+private:
+    HTTPClient http;
+    WiFiClient plainClient;
+    WiFiClientSecure secureClient;
+    String url;
+    uint32_t size;
+    bool isOpen;
+
+public:
+    HttpOtaSource() : size(0), isOpen(false) {}
+
+    void setUrl(const String& anUrl) { url = anUrl; }
+
+    int32_t open(uint32_t offset) override {
+        close();
+        WiFiClient* client = &plainClient;
+        if (url.startsWith("https://")) {
+            secureClient.setInsecure(); // accept self-signed certs
+            client = &secureClient;
+        }
+        http.setConnectTimeout(OTA_HTTP_TIMEOUT_MS);
+        http.setTimeout(OTA_HTTP_TIMEOUT_MS);
+        if (!http.begin(*client, url)) return -1;
+        if (offset > 0) {
+            http.addHeader("Range", String("bytes=") + String(offset) + "-");
+        }
+        isOpen = true;
+
+        int code = http.GET();
+        int length = http.getSize();
+        if (length <= 0) {
+            close();
+            return -1;
+        }
+        if (code == HTTP_CODE_PARTIAL_CONTENT && offset > 0) {
+            size = offset + (uint32_t)length;
+            return (int32_t)offset;
+        }
+        if (code == HTTP_CODE_OK) {
+            size = (uint32_t)length;
+            return 0;
+        }
+        close();
+        return -1;
+    }
+
+    uint32_t totalSize() const override { return size; }
+
+    int32_t read(uint8_t* buffer, size_t max) override {
+        if (!isOpen) return -1;
+        WiFiClient* stream = http.getStreamPtr();
+        if (!stream) return -1;
+        int available = stream->available();
+        if (available > 0) {
+            size_t n = (size_t)available < max ? (size_t)available : max;
+            return stream->read(buffer, n);
+        }
+        return http.connected() ? 0 : -1;
+    }
+
+    void close() override {
+        if (isOpen) {
+            http.end();
+            isOpen = false;
+        }
+    }
+};
+
+// OtaFlashWriter over the Arduino Update library, which writes the next
+// OTA slot from partitions_ota.csv and switches the boot partition on end().
+class UpdateFlashWriter : public OtaFlashWriter {
+public:
+    bool begin(uint32_t size) override {
+        return Update.begin(size, U_FLASH);
+    }
+
+    bool write(const uint8_t* data, size_t length) override {
+        return Update.write(const_cast<uint8_t*>(data), length) == length;
+    }
+
+    bool commit() override {
+        return Update.end();
+    }
+
+    void abort() override {
+        Update.abort();
+    }
+};
+
+// The partition we are running from, as the base for delta images. Update
+// always writes the other slot, so this stays intact during the download.
+class RunningPartitionReader : public OtaBaseReader {
+private:
+    const esp_partition_t* partition;
+
+public:
+    RunningPartitionReader() : partition(nullptr) {}
+
+    uint32_t size() const override {
+        const esp_partition_t* running = partition ? partition : esp_ota_get_running_partition();
+        return running ? running->size : 0;
+    }
+
+    bool read(uint32_t offset, uint8_t* buffer, size_t length) override {
+        if (!partition) partition = esp_ota_get_running_partition();
+        return partition && esp_partition_read(partition, offset, buffer, length) == ESP_OK;
+    }
+};
+
+#endif // ESP_OTA_TRANSPORT_H
@@ -0,0 +1,89 @@
+#ifndef ESP_PIXEL_OUTPUT_H
+#define ESP_PIXEL_OUTPUT_H
+
+#include "Arduino.h"
+#include <Adafruit_NeoPixel.h>
+#include <esp_idf_version.h>
+#include "config.h"
+#include "PixelFrame.h"
+
+// Blocking output through Adafruit_NeoPixel: show() holds interrupts off
+// for the whole frame (about 30 us per pixel).
+class NeoPixelOutput : public PixelOutput {
+private:
+    Adafruit_NeoPixel strip;
+
+public:
+    explicit NeoPixelOutput(int pin) : strip(LED_COUNT, pin, NEO_GRB + NEO_KHZ800) {}
+
+    void begin() override {
+        strip.begin();
+        strip.setBrightness(255);   // PixelFrame scales
+    }
+
+    void write(const uint8_t* grb, size_t length) override {
+        for (size_t i = 0; i + 2 < length; i += 3) {
+            strip.setPixelColor(i / 3, grb[i + 1], grb[i], grb[i + 2]);
+        }
+        strip.show();
+    }
+};
+
+#if LED_RMT_OUTPUT && (!defined(ESP_IDF_VERSION_MAJOR) || ESP_IDF_VERSION_MAJOR < 5)
+#include <driver/rmt.h>
+
+// WS2812 output on an RMT channel. write() converts the frame into RMT
+// items and starts the transfer; the peripheral clocks the bits out (and
+// the driver refills its memory block from `items` by interrupt) while the
+// CPU carries on, with interrupts enabled throughout.
+class EspRmtPixelOutput : public PixelOutput {
+private:
+    // 80 MHz APB / 2: 25 ns ticks
+    static const uint8_t CLOCK_DIVIDER = 2;
+    static const uint16_t T0H = 16, T0L = 34;   // 0.40 / 0.85 us
+    static const uint16_t T1H = 32, T1L = 18;   // 0.80 / 0.45 us
+
+    int pin;
+    rmt_channel_t channel;
+    bool ready;
+    rmt_item32_t items[LED_COUNT * 24];
+
+public:
+    explicit EspRmtPixelOutput(int aPin, rmt_channel_t aChannel = (rmt_channel_t)LED_RMT_CHANNEL)
+        : pin(aPin), channel(aChannel), ready(false) {}
+
+    void begin() override {
+        rmt_config_t config = RMT_DEFAULT_CONFIG_TX((gpio_num_t)pin, channel);
+        config.clk_div = CLOCK_DIVIDER;
+        ready = rmt_config(&config) == ESP_OK && rmt_driver_install(channel, 0, 0) == ESP_OK;
+        if (!ready) Serial.println("LED: RMT setup failed");
+    }
+
+    void write(const uint8_t* grb, size_t length) override {
+        if (!ready) return;
+        size_t count = 0;
+        for (size_t i = 0; i < length && count + 8 <= sizeof(items) / sizeof(items[0]); i++) {
+            for (uint8_t bit = 0x80; bit; bit >>= 1) {
+                bool one = grb[i] & bit;
+                items[count].level0 = 1;
+                items[count].duration0 = one ? T1H : T0H;
+                items[count].level1 = 0;
+                items[count].duration1 = one ? T1L : T0L;
+                count++;
+            }
+        }
+        rmt_write_items(channel, items, count, false);
+    }
+
+    bool busy() override {
+        return ready && rmt_wait_tx_done(channel, 0) == ESP_ERR_TIMEOUT;
+    }
+};
+
+typedef EspRmtPixelOutput LedPixelOutput;
+#else
+// IDF 5 replaced the RMT driver the async path is written against
+typedef NeoPixelOutput LedPixelOutput;
+#endif
+
+#endif // ESP_PIXEL_OUTPUT_H
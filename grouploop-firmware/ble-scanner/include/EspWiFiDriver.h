@@ -0,0 +1,87 @@
+#ifndef ESP_WIFI_DRIVER_H
+#define ESP_WIFI_DRIVER_H
+
+#include "Arduino.h"
+#include <WiFi.h>
+#include "WiFiConnector.h"
+#include "SpscQueue.h"
+
+// WiFiDriver on top of the Arduino-ESP32 WiFi API. Scans and joins are
+// started asynchronously; completion arrives through WiFi.onEvent() on the
+// system event task and is queued for the process that owns the connector.
+class EspWiFiDriver : public WiFiDriver {
+private:
+    SpscQueue<WiFiDriverEvent, 8> events;
+    bool listening;
+
+public:
+    EspWiFiDriver() : listening(false) {}
+
+    void begin() {
+        if (listening) return;
+        listening = true;
+        WiFi.onEvent([this](WiFiEvent_t event, WiFiEventInfo_t info) {
+            switch (event) {
+                case ARDUINO_EVENT_WIFI_SCAN_DONE:
+                    events.push(WiFiDriverEvent::SCAN_DONE);
+                    break;
+                case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+                    events.push(WiFiDriverEvent::ASSOCIATED);
+                    break;
+                case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+                    events.push(WiFiDriverEvent::GOT_IP);
+                    break;
+                case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+                case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+                    events.push(WiFiDriverEvent::DISCONNECTED);
+                    break;
+                default:
+                    break;
+            }
+        });
+    }
+
+    // Next queued event, from the consumer context only
+    bool poll(WiFiDriverEvent& event) {
+        return events.pop(event);
+    }
+
+    bool startScan() override {
+        WiFi.scanDelete();
+        int16_t result = WiFi.scanNetworks(true /* async */);
+        return result == WIFI_SCAN_RUNNING || result >= 0;
+    }
+
+    bool findBestNetwork(const char* ssid, WiFiNetwork& network) override {
+        int16_t count = WiFi.scanComplete();
+        int best = -1;
+        for (int16_t i = 0; i < count; i++) {
+            if (WiFi.SSID(i) != ssid) continue;
+            if (best < 0 || WiFi.RSSI(i) > WiFi.RSSI(best)) best = i;
+        }
+        if (best >= 0) {
+            memcpy(network.bssid, WiFi.BSSID(best), sizeof(network.bssid));
+            network.channel = WiFi.channel(best);
+            network.rssi = WiFi.RSSI(best);
+        }
+        WiFi.scanDelete();
+        return best >= 0;
+    }
+
+    void associate(const char* ssid, const char* password, const WiFiNetwork& network) override {
+        if (network.ip != 0) {
+            // Reuse the cached lease and skip the DHCP round trips
+            WiFi.config(IPAddress(network.ip), IPAddress(network.gateway),
+                        IPAddress(network.subnet), IPAddress(network.dns));
+        } else {
+            WiFi.config(IPAddress((uint32_t)0), IPAddress((uint32_t)0), IPAddress((uint32_t)0));
+        }
+        WiFi.begin(ssid, password, network.channel, network.bssid, true);
+    }
+
+    void disconnect() override {
+        WiFi.disconnect();
+    }
+};
+
+#endif // ESP_WIFI_DRIVER_H
@@ -0,0 +1,132 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#if defined(ARDUINO)
+#include "freertos/FreeRTOS.h"
+#include "config.h"
+#endif
+
+// Things that happen rarely but that several processes care about
+enum class EventType : uint8_t {
+    WIFI_UP,
+    WIFI_DOWN,
+    TAP,
+    CONFIG_CHANGED,
+    OTA_STARTED
+};
+
+struct Event {
+    EventType type;
+    uint32_t value;     // event-specific payload, 0 if unused
+};
+
+typedef void (*EventHandler)(const Event& event, void* context);
+
+// Lock policy for single-context use (host tests)
+struct NoEventLock {
+    static void enter() {}
+    static void exit() {}
+};
+
+// Allocation-free publish/subscribe bus.
+//
+// publish() only queues the event, so it is cheap and safe to call from any
+// task (Lock guards the queue). dispatch() delivers queued events to the
+// subscribers of each type, in publish order, from the context that calls it
+// (the main loop), outside the lock. When the queue is full new events are
+// dropped and counted.
+template <size_t MaxSubscribers, size_t QueueSize, typename Lock = NoEventLock>
+class BasicEventBus {
+private:
+    struct Subscriber {
+        EventType type;
+        EventHandler handler;
+        void* context;
+    };
+
+    Subscriber subscribers[MaxSubscribers];
+    size_t subscriberCount;
+
+    Event queue[QueueSize];
+    size_t head;
+    size_t count;
+    uint32_t dropped;
+
+public:
+    BasicEventBus() : subscriberCount(0), head(0), count(0), dropped(0) {}
+
+    // Register during setup; there is no unsubscribe
+    bool subscribe(EventType type, EventHandler handler, void* context = nullptr) {
+        if (!handler || subscriberCount >= MaxSubscribers) return false;
+        subscribers[subscriberCount++] = Subscriber{type, handler, context};
+        return true;
+    }
+
+    bool publish(EventType type, uint32_t value = 0) {
+        bool queued = false;
+        Lock::enter();
+        if (count < QueueSize) {
+            queue[(head + count) % QueueSize] = Event{type, value};
+            count++;
+            queued = true;
+        } else {
+            dropped++;
+        }
+        Lock::exit();
+        return queued;
+    }
+
+    // Deliver all queued events. Returns the number of events delivered.
+    size_t dispatch() {
+        size_t delivered = 0;
+        Event event;
+        while (pop(event)) {
+            for (size_t i = 0; i < subscriberCount; i++) {
+                if (subscribers[i].type == event.type) {
+                    subscribers[i].handler(event, subscribers[i].context);
+                }
+            }
+            delivered++;
+        }
+        return delivered;
+    }
+
+    size_t pending() const { return count; }
+    size_t getSubscriberCount() const { return subscriberCount; }
+    uint32_t getDropped() const { return dropped; }
+
+private:
+    bool pop(Event& event) {
+        bool popped = false;
+        Lock::enter();
+        if (count > 0) {
+            event = queue[head];
+            head = (head + 1) % QueueSize;
+            count--;
+            popped = true;
+        }
+        Lock::exit();
+        return popped;
+    }
+};
+
+#if defined(ARDUINO)
+// Short critical section: the IMU task publishes while loop() dispatches
+struct CriticalSectionEventLock {
+    static portMUX_TYPE& mux() {
+        static portMUX_TYPE lock = portMUX_INITIALIZER_UNLOCKED;
+        return lock;
+    }
+    static void enter() { portENTER_CRITICAL(&mux()); }
+    static void exit() { portEXIT_CRITICAL(&mux()); }
+};
+
+typedef BasicEventBus<EVENT_MAX_SUBSCRIBERS, EVENT_QUEUE_SIZE, CriticalSectionEventLock> EventBus;
+
+// Global event bus instance
+extern EventBus eventBus;
+#endif
+
+#endif // EVENT_BUS_H
@@ -0,0 +1,264 @@
+#ifndef HAPTIC_ENGINE_H
+#define HAPTIC_ENGINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "HapticWaveform.h"
+
+// Where the motor drive goes: a PWM duty, 0 = off, 255 = full. The
+// peripheral behind it generates the PWM; the engine only changes the duty.
+class HapticOutput {
+public:
+    virtual ~HapticOutput() {}
+    virtual void begin() {}
+    virtual void setDuty(uint8_t duty) = 0;
+};
+
+// Higher priorities interrupt lower ones
+enum class HapticPriority : uint8_t {
+    BACKGROUND = 0,     // the selected vibration behavior
+    NORMAL,             // commands and reaction programs
+    ALERT
+};
+
+// One vibration: ramps up to `level` over attackMs, holds it for sustainMs,
+// ramps down over decayMs and stays off for gapMs, `repeats` times
+// (FOREVER = until stopped or interrupted). With `segments` set it plays
+// those instead (a cached waveform, see HapticWaveform.h), scaled by
+// `level`, followed by gapMs.
+struct HapticPattern {
+    static const uint8_t FOREVER = 0;
+
+    uint8_t level;
+    uint16_t attackMs;
+    uint16_t sustainMs;
+    uint16_t decayMs;
+    uint16_t gapMs;
+    uint8_t repeats;
+    HapticPriority priority;
+    const HapticSegment* segments;
+    uint8_t segmentCount;
+
+    uint32_t periodMs() const {
+        if (!segments) return (uint32_t)attackMs + sustainMs + decayMs + gapMs;
+        uint32_t total = gapMs;
+        for (uint8_t i = 0; i < segmentCount; i++) total += segments[i].ms;
+        return total;
+    }
+    bool loops() const { return repeats == FOREVER; }
+
+    // Full drive for `ms`, no ramps
+    static HapticPattern buzz(uint8_t level, uint16_t ms, HapticPriority priority = HapticPriority::NORMAL) {
+        return HapticPattern{level, 0, ms, 0, 0, 1, priority, nullptr, 0};
+    }
+
+    static HapticPattern waveform(const HapticSegment* segments, uint8_t count, uint8_t repeats,
+                                  HapticPriority priority, uint8_t level = 255) {
+        return HapticPattern{level, 0, 0, 0, 0, repeats, priority, segments, count};
+    }
+};
+
+struct HapticStats {
+    uint32_t played;        // patterns started
+    uint32_t interrupted;   // stopped early by a higher priority
+    uint32_t dropped;       // turned away or pushed out of a full queue
+};
+
+// Plays HapticPatterns on a HapticOutput without blocking. update() sets
+// the duty for the current time and says when it next has to run: at the
+// next segment boundary, or every rampStepMs during a ramp. Every edge is
+// computed from when the pattern started, so a late update never shifts the
+// ones after it, and a queued pattern starts exactly when the one before it
+// ends. A pattern of higher priority interrupts the one playing, and so does
+// one of the same priority when the one playing loops forever; the loop
+// goes back into the queue and resumes afterwards. Others wait in the
+// queue, highest priority first, in order within a priority.
+template <size_t QueueSize>
+class BasicHapticEngine {
+public:
+    static const uint32_t IDLE_MS = 1000;   // update() interval with nothing to play
+
+    BasicHapticEngine(HapticOutput& anOutput, uint16_t aRampStepMs)
+        : output(anOutput), rampStepMs(aRampStepMs ? aRampStepMs : 1), playing(false), current(), period(0), startedAt(0),
+          queueLength(0), duty(0) {
+        stats = HapticStats{0, 0, 0};
+    }
+
+    void begin() {
+        output.begin();
+        output.setDuty(0);
+        duty = 0;
+    }
+
+    // Plays `pattern` from `now` if it outranks the one playing, or queues
+    // it. False when it was turned away: empty, or the queue is full of
+    // patterns that rank at least as high.
+    bool play(const HapticPattern& pattern, uint32_t now) {
+        if (pattern.level == 0 || pattern.periodMs() == 0) return false;
+        if (playing && !outranks(pattern, current)) return enqueue(pattern);
+        if (playing) interrupt(pattern);
+        start(pattern, now);
+        return true;
+    }
+
+    // Motor off, queue cleared
+    void stop() {
+        playing = false;
+        queueLength = 0;
+        setDuty(0);
+    }
+
+    // Drops whatever plays or waits with these segments, e.g. before the
+    // waveform cache reuses their slot
+    void forget(const HapticSegment* segments) {
+        if (!segments) return;
+        size_t kept = 0;
+        for (size_t i = 0; i < queueLength; i++) {
+            if (queue[i].segments != segments) queue[kept++] = queue[i];
+        }
+        queueLength = kept;
+        if (playing && current.segments == segments) {
+            playing = false;
+            setDuty(0);
+        }
+    }
+
+    // Drives the output for time `now`; returns when to call it next
+    uint32_t update(uint32_t now) {
+        while (true) {
+            if (!playing) {
+                if (queueLength == 0) {
+                    setDuty(0);
+                    return now + IDLE_MS;
+                }
+                start(dequeue(), now);
+            }
+            if (current.loops()) {
+                if (queueLength == 0 || !outranks(queue[0], current)) break;
+                // Something queued behind the loop while it waited its turn
+                HapticPattern next = dequeue();
+                interrupt(next);
+                start(next, now);
+                continue;
+            }
+            uint32_t elapsed = now - startedAt;
+            if (elapsed < period * current.repeats) break;
+            // Done: the next one starts where this one ended
+            uint32_t endedAt = startedAt + period * current.repeats;
+            playing = false;
+            if (queueLength > 0) start(dequeue(), endedAt);
+        }
+
+        uint32_t phase = (now - startedAt) % period;
+        uint32_t nextChange;
+        if (current.segments) {
+            uint32_t waveformEnd = period - current.gapMs;
+            if (phase < waveformEnd) {
+                uint8_t level = hapticSegmentsSample(current.segments, current.segmentCount, phase, rampStepMs, nextChange);
+                setDuty((uint8_t)((level * (current.level + 1)) >> 8));
+            } else {
+                setDuty(0);
+                nextChange = period - phase;
+            }
+            return now + nextChange;
+        }
+        uint32_t attackEnd = current.attackMs;
+        uint32_t sustainEnd = attackEnd + current.sustainMs;
+        uint32_t decayEnd = sustainEnd + current.decayMs;
+        if (phase < attackEnd) {
+            setDuty((uint8_t)((uint32_t)current.level * phase / current.attackMs));
+            nextChange = rampStep(attackEnd - phase);
+        } else if (phase < sustainEnd) {
+            setDuty(current.level);
+            nextChange = sustainEnd - phase;
+        } else if (phase < decayEnd) {
+            setDuty((uint8_t)((uint32_t)current.level * (decayEnd - phase) / current.decayMs));
+            nextChange = rampStep(decayEnd - phase);
+        } else {
+            setDuty(0);
+            nextChange = period - phase;
+        }
+        return now + nextChange;
+    }
+
+    bool isPlaying() const { return playing; }
+    const HapticPattern& getCurrent() const { return current; }
+    size_t getQueued() const { return queueLength; }
+    uint8_t getDuty() const { return duty; }
+    const HapticStats& getStats() const { return stats; }
+
+private:
+    HapticOutput& output;
+    uint16_t rampStepMs;
+    bool playing;
+    HapticPattern current;
+    uint32_t period;            // of current
+    uint32_t startedAt;
+    HapticPattern queue[QueueSize];
+    size_t queueLength;
+    uint8_t duty;
+    HapticStats stats;
+
+    // A loop also yields to anything of its own priority, so it cannot
+    // starve the patterns queued behind it
+    static bool outranks(const HapticPattern& pattern, const HapticPattern& playing) {
+        return pattern.priority > playing.priority ||
+               (pattern.priority == playing.priority && playing.loops());
+    }
+
+    // A loop resumes after whatever interrupted it, unless that is a loop
+    // of its own priority, which replaces it
+    void interrupt(const HapticPattern& by) {
+        stats.interrupted++;
+        if (current.loops() && !(by.loops() && by.priority == current.priority)) enqueue(current);
+    }
+
+    void start(const HapticPattern& pattern, uint32_t at) {
+        current = pattern;
+        period = pattern.periodMs();
+        startedAt = at;
+        playing = true;
+        stats.played++;
+    }
+
+    uint32_t rampStep(uint32_t remaining) const {
+        return remaining < rampStepMs ? remaining : rampStepMs;
+    }
+
+    void setDuty(uint8_t value) {
+        if (value == duty) return;
+        duty = value;
+        output.setDuty(value);
+    }
+
+    // Behind everything of its own or higher priority
+    bool enqueue(const HapticPattern& pattern) {
+        size_t at = 0;
+        while (at < queueLength && queue[at].priority >= pattern.priority) at++;
+        if (queueLength == QueueSize) {
+            // Full: the last (lowest) entry makes room if this one goes before it
+            stats.dropped++;
+            if (at >= QueueSize) return false;
+            queueLength--;
+        }
+        for (size_t i = queueLength; i > at; i--) queue[i] = queue[i - 1];
+        queue[at] = pattern;
+        queueLength++;
+        return true;
+    }
+
+    HapticPattern dequeue() {
+        HapticPattern next = queue[0];
+        for (size_t i = 1; i < queueLength; i++) queue[i - 1] = queue[i];
+        queueLength--;
+        return next;
+    }
+};
+
+#if defined(ARDUINO)
+#include "config.h"
+
+typedef BasicHapticEngine<HAPTIC_QUEUE_SIZE> HapticEngine;
+#endif
+
+#endif // HAPTIC_ENGINE_H
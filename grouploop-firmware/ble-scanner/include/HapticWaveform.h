@@ -0,0 +1,217 @@
+#ifndef HAPTIC_WAVEFORM_H
+#define HAPTIC_WAVEFORM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Haptic waveform, uploaded once into a cache slot by id and then played
+// with a one-byte trigger (`haptic_wave:<id>:<hex>`, then `hw:<id>`).
+//
+// Binary format (sent hex-encoded):
+//
+//   u8  version            1
+//   u8  stepMs             1..255, the rate segments are counted in
+//   u8  repeats            times to play; 0 = until interrupted
+//   u8  priority           0 background, 1 normal, 2 alert
+//   then 1..MaxSegments segments, 2 bytes each:
+//     u8 level             motor duty 0..255
+//     u8 steps             bits 0-6: length in steps, 1..127
+//                          bit 7: ramp to `level` from the previous level
+//                          (0 before the first segment), else jump to it
+//
+// A heartbeat at 10 ms steps: ff 82, ff 03, 00 83, 00 0a, c0 82, c0 02,
+// 00 86, 00 48 (16 bytes for 1 s).
+
+struct HapticSegment {
+    uint16_t ms;
+    uint8_t level;
+    bool ramp;
+};
+
+// Duty at `phase` ms into a list of segments, and how long until it next
+// changes: the end of a hold, or `rampStepMs` into a ramp
+inline uint8_t hapticSegmentsSample(const HapticSegment* segments, uint8_t count, uint32_t phase,
+                                    uint32_t rampStepMs, uint32_t& nextChange) {
+    uint8_t from = 0;
+    uint32_t start = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        const HapticSegment& segment = segments[i];
+        uint32_t end = start + segment.ms;
+        if (phase < end) {
+            uint32_t remaining = end - phase;
+            if (!segment.ramp) {
+                nextChange = remaining;
+                return segment.level;
+            }
+            nextChange = remaining < rampStepMs ? remaining : rampStepMs;
+            int32_t delta = (int32_t)segment.level - from;
+            return (uint8_t)(from + delta * (int32_t)(phase - start) / (int32_t)segment.ms);
+        }
+        from = segment.level;
+        start = end;
+    }
+    nextChange = 1;
+    return 0;
+}
+
+template <size_t MaxSegments>
+struct BasicHapticWaveform {
+    static const uint8_t VERSION = 1;
+    static const size_t HEADER_SIZE = 4;
+    static const uint8_t RAMP = 0x80;
+
+    uint8_t id;
+    uint8_t stepMs;
+    uint8_t repeats;
+    uint8_t priority;
+    uint8_t segmentCount;
+    uint32_t durationMs;
+    HapticSegment segments[MaxSegments];
+
+    BasicHapticWaveform() : id(0), stepMs(0), repeats(0), priority(0), segmentCount(0), durationMs(0) {}
+
+    bool isLoaded() const { return segmentCount > 0; }
+
+    // Hex-encoded format above; on failure returns false with a reason
+    bool loadHex(const char* hex, const char*& error) {
+        segmentCount = 0;
+        durationMs = 0;
+        size_t length = hex ? strlen(hex) : 0;
+        if (length % 2) return fail(error, "odd number of hex digits");
+        size_t bytes = length / 2;
+        if (bytes < HEADER_SIZE + 2) return fail(error, "truncated");
+        if ((bytes - HEADER_SIZE) % 2) return fail(error, "truncated segment");
+        if ((bytes - HEADER_SIZE) / 2 > MaxSegments) return fail(error, "too many segments");
+
+        uint8_t header[HEADER_SIZE];
+        for (size_t i = 0; i < HEADER_SIZE; i++) {
+            if (!byteAt(hex, i, header[i])) return fail(error, "invalid hex digit");
+        }
+        if (header[0] != VERSION) return fail(error, "unsupported version");
+        if (header[1] == 0) return fail(error, "zero step");
+        if (header[3] > 2) return fail(error, "unknown priority");
+
+        uint8_t count = (uint8_t)((bytes - HEADER_SIZE) / 2);
+        uint32_t total = 0;
+        bool audible = false;
+        for (uint8_t i = 0; i < count; i++) {
+            uint8_t level, steps;
+            if (!byteAt(hex, HEADER_SIZE + 2 * i, level) || !byteAt(hex, HEADER_SIZE + 2 * i + 1, steps)) {
+                return fail(error, "invalid hex digit");
+            }
+            if ((steps & ~RAMP) == 0) return fail(error, "empty segment");
+            segments[i].level = level;
+            segments[i].ramp = (steps & RAMP) != 0;
+            segments[i].ms = (uint16_t)((steps & ~RAMP) * header[1]);
+            total += segments[i].ms;
+            if (level) audible = true;
+        }
+        if (!audible) return fail(error, "silent");
+
+        stepMs = header[1];
+        repeats = header[2];
+        priority = header[3];
+        segmentCount = count;
+        durationMs = total;
+        return true;
+    }
+
+private:
+    static bool fail(const char*& error, const char* message) {
+        error = message;
+        return false;
+    }
+
+    static int digit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    static bool byteAt(const char* hex, size_t index, uint8_t& value) {
+        int hi = digit(hex[2 * index]);
+        int lo = digit(hex[2 * index + 1]);
+        if (hi < 0 || lo < 0) return false;
+        value = (uint8_t)((hi << 4) | lo);
+        return true;
+    }
+};
+
+// A few waveforms by id. Uploading an id that is not cached takes a free
+// slot, or the least recently played one.
+template <size_t Slots, size_t MaxSegments>
+class BasicHapticWaveformCache {
+public:
+    typedef BasicHapticWaveform<MaxSegments> Waveform;
+
+    BasicHapticWaveformCache() : clock(0) {
+        for (size_t i = 0; i < Slots; i++) lastUsed[i] = 0;
+    }
+
+    // The slot an upload of `id` goes into (still holding what it replaces)
+    Waveform& slotFor(uint8_t id) {
+        Waveform* cached = find(id);
+        if (cached) return *cached;
+        size_t oldest = 0;
+        for (size_t i = 0; i < Slots; i++) {
+            if (!slots[i].isLoaded()) return slots[i];
+            if (lastUsed[i] < lastUsed[oldest]) oldest = i;
+        }
+        return slots[oldest];
+    }
+
+    // Parses into a scratch waveform first, so a rejected upload leaves
+    // the cache alone; `replaced` is the slot it went into
+    bool load(uint8_t id, const char* hex, const char*& error, Waveform*& replaced) {
+        Waveform parsed;
+        if (!parsed.loadHex(hex, error)) return false;
+        parsed.id = id;
+        replaced = &slotFor(id);
+        *replaced = parsed;
+        touch(*replaced);
+        return true;
+    }
+
+    Waveform* find(uint8_t id) {
+        for (size_t i = 0; i < Slots; i++) {
+            if (slots[i].isLoaded() && slots[i].id == id) return &slots[i];
+        }
+        return nullptr;
+    }
+
+    // find(), counting as a use for eviction
+    Waveform* use(uint8_t id) {
+        Waveform* waveform = find(id);
+        if (waveform) touch(*waveform);
+        return waveform;
+    }
+
+    size_t size() const {
+        size_t count = 0;
+        for (size_t i = 0; i < Slots; i++) {
+            if (slots[i].isLoaded()) count++;
+        }
+        return count;
+    }
+
+    static size_t capacity() { return Slots; }
+
+private:
+    Waveform slots[Slots];
+    uint32_t lastUsed[Slots];
+    uint32_t clock;
+
+    void touch(const Waveform& waveform) {
+        lastUsed[&waveform - slots] = ++clock;
+    }
+};
+
+#if defined(ARDUINO)
+#include "config.h"
+
+typedef BasicHapticWaveformCache<HAPTIC_WAVEFORM_SLOTS, HAPTIC_WAVEFORM_MAX_SEGMENTS> HapticWaveformCache;
+#endif
+
+#endif // HAPTIC_WAVEFORM_H
@@ -0,0 +1,75 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Fixed-bucket histogram for timing samples (CPU cycles, microseconds, ...).
+// Two buckets per power of two cover the full uint32_t range in 64 counters,
+// so percentiles are reported as the upper bound of their bucket
+// (within ~50%) without storing individual samples.
+class LatencyHistogram {
+public:
+    static const uint8_t BUCKETS = 64;
+
+private:
+    uint32_t buckets[BUCKETS];
+    uint32_t count;
+    uint32_t max;
+    uint64_t total;
+
+public:
+    LatencyHistogram() { reset(); }
+
+    void reset() {
+        memset(buckets, 0, sizeof(buckets));
+        count = 0;
+        max = 0;
+        total = 0;
+    }
+
+    void record(uint32_t value) {
+        buckets[bucketFor(value)]++;
+        count++;
+        total += value;
+        if (value > max) max = value;
+    }
+
+    uint32_t getCount() const { return count; }
+    uint32_t getMax() const { return max; }
+    uint64_t getTotal() const { return total; }
+    uint32_t getMean() const { return count ? (uint32_t)(total / count) : 0; }
+
+    // Upper bound of the bucket holding the given percentile (0-100)
+    uint32_t percentile(uint8_t pct) const {
+        if (count == 0) return 0;
+        uint32_t target = (uint32_t)(((uint64_t)count * pct + 99) / 100);
+        if (target == 0) target = 1;
+        uint32_t seen = 0;
+        for (uint8_t b = 0; b < BUCKETS; b++) {
+            seen += buckets[b];
+            if (seen >= target) {
+                uint32_t bound = bucketUpperBound(b);
+                return bound < max ? bound : max;
+            }
+        }
+        return max;
+    }
+
+    static uint8_t bucketFor(uint32_t value) {
+        if (value < 2) return (uint8_t)value;
+        uint8_t msb = 31 - __builtin_clz(value);
+        uint8_t half = (value >> (msb - 1)) & 1;
+        return msb * 2 + half;
+    }
+
+    static uint32_t bucketUpperBound(uint8_t bucket) {
+        if (bucket < 2) return bucket;
+        uint8_t msb = bucket / 2;
+        uint32_t width = 1UL << (msb - 1);
+        uint32_t lower = (1UL << msb) | ((bucket & 1) ? width : 0);
+        return lower + (width - 1);
+    }
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,242 @@
+#ifndef LED_COMPOSITOR_H
+#define LED_COMPOSITOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "LedMath.h"
+
+// How a layer combines with what is below it, per channel, before opacity
+enum class BlendMode : uint8_t {
+    NORMAL = 0,     // replace
+    ADD,            // sum, saturating: flashes on top of anything
+    MULTIPLY,       // darken by the layer's color
+    SCREEN,         // lighten by the layer's color
+    LIGHTEN,        // the brighter of the two
+    COUNT
+};
+
+inline const char* blendModeName(BlendMode mode) {
+    switch (mode) {
+        case BlendMode::ADD: return "add";
+        case BlendMode::MULTIPLY: return "multiply";
+        case BlendMode::SCREEN: return "screen";
+        case BlendMode::LIGHTEN: return "lighten";
+        case BlendMode::NORMAL:
+        default: return "normal";
+    }
+}
+
+inline bool parseBlendMode(const char* name, BlendMode& mode) {
+    for (uint8_t i = 0; i < (uint8_t)BlendMode::COUNT; i++) {
+        if (strcmp(name, blendModeName((BlendMode)i)) == 0) {
+            mode = (BlendMode)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// What a behavior draws into: the drawing calls of PixelFrame without an
+// output. show() only marks that a new frame was drawn.
+template <size_t Count>
+class BasicLedCanvas {
+private:
+    uint32_t pixels[Count];
+    bool drawn;
+
+public:
+    BasicLedCanvas() : drawn(true) { memset(pixels, 0, sizeof(pixels)); }
+
+    uint16_t numPixels() const { return (uint16_t)Count; }
+
+    void setPixelColor(uint16_t index, uint32_t color) {
+        if (index < Count) pixels[index] = color & 0xFFFFFF;
+    }
+    uint32_t getPixelColor(uint16_t index) const {
+        return index < Count ? pixels[index] : 0;
+    }
+    void fill(uint32_t color) {
+        for (size_t i = 0; i < Count; i++) pixels[i] = color & 0xFFFFFF;
+    }
+    void clear() { fill(0); }
+    void show() { drawn = true; }
+
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+        return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+    }
+
+    const uint32_t* data() const { return pixels; }
+
+    // True once per show() since the last call
+    bool takeDrawn() {
+        bool was = drawn;
+        drawn = false;
+        return was;
+    }
+};
+
+// Stacks a fixed number of canvases into one frame. Layer 0 is the base
+// and always shows; the others are switched on with an opacity, a blend
+// mode and optionally a lifetime, fading out over its last `fadeMs`, after
+// which they switch themselves off. All integer maths.
+template <size_t Count, size_t Layers>
+class BasicLedCompositor {
+public:
+    typedef BasicLedCanvas<Count> Canvas;
+
+private:
+    struct Layer {
+        Canvas canvas;
+        bool active;
+        uint8_t opacity;
+        BlendMode mode;
+        uint32_t startedAt;
+        uint32_t lifetimeMs;    // 0 = until cleared
+        uint32_t fadeMs;
+    };
+
+    Layer layers[Layers];
+    bool layersChanged;         // a layer was switched or is fading
+
+    static uint8_t blendChannel(BlendMode mode, uint8_t below, uint8_t above, uint8_t opacity) {
+        uint8_t target;
+        switch (mode) {
+            case BlendMode::ADD: {
+                uint16_t sum = below + ledScale8(above, opacity);
+                return sum > 255 ? 255 : (uint8_t)sum;
+            }
+            case BlendMode::MULTIPLY:
+                target = ledScale8(below, above);
+                break;
+            case BlendMode::SCREEN:
+                target = 255 - ledScale8(255 - below, 255 - above);
+                break;
+            case BlendMode::LIGHTEN:
+                target = above > below ? above : below;
+                break;
+            case BlendMode::NORMAL:
+            default:
+                target = above;
+                break;
+        }
+        // below + (target - below) * opacity, exact at 0 and 255
+        int16_t delta = (int16_t)target - below;
+        return (uint8_t)(below + ((delta * (int16_t)(opacity + 1)) >> 8));
+    }
+
+    static uint32_t blendPixel(BlendMode mode, uint32_t below, uint32_t above, uint8_t opacity) {
+        uint32_t out = 0;
+        for (uint8_t shift = 0; shift <= 16; shift += 8) {
+            uint8_t c = blendChannel(mode, (uint8_t)(below >> shift), (uint8_t)(above >> shift), opacity);
+            out |= (uint32_t)c << shift;
+        }
+        return out;
+    }
+
+public:
+    BasicLedCompositor() : layersChanged(true) {
+        for (size_t i = 0; i < Layers; i++) {
+            layers[i].active = i == 0;
+            layers[i].opacity = 255;
+            layers[i].mode = BlendMode::NORMAL;
+            layers[i].startedAt = 0;
+            layers[i].lifetimeMs = 0;
+            layers[i].fadeMs = 0;
+        }
+    }
+
+    static size_t layerCount() { return Layers; }
+
+    Canvas& canvas(size_t layer) { return layers[layer < Layers ? layer : 0].canvas; }
+
+    void setLayer(size_t layer, uint8_t opacity, BlendMode mode, uint32_t now,
+                  uint32_t lifetimeMs = 0, uint32_t fadeMs = 0) {
+        if (layer == 0 || layer >= Layers) return;
+        Layer& l = layers[layer];
+        l.active = true;
+        l.opacity = opacity;
+        l.mode = mode;
+        l.startedAt = now;
+        l.lifetimeMs = lifetimeMs;
+        l.fadeMs = fadeMs > lifetimeMs ? lifetimeMs : fadeMs;
+        layersChanged = true;
+    }
+
+    void clearLayer(size_t layer) {
+        if (layer == 0 || layer >= Layers) return;
+        layers[layer].active = false;
+        layers[layer].canvas.clear();
+        layersChanged = true;
+    }
+
+    // Opacity of an active overlay, e.g. one its behavior drives
+    void setOpacity(size_t layer, uint8_t opacity) {
+        if (layer == 0 || layer >= Layers || !layers[layer].active) return;
+        if (layers[layer].opacity == opacity) return;
+        layers[layer].opacity = opacity;
+        layersChanged = true;
+    }
+
+    bool isActive(size_t layer) const { return layer < Layers && layers[layer].active; }
+
+    // Switches off layers whose lifetime is over; returns them as a bit mask
+    uint32_t expire(uint32_t now) {
+        uint32_t expired = 0;
+        for (size_t i = 1; i < Layers; i++) {
+            Layer& l = layers[i];
+            if (l.active && l.lifetimeMs && now - l.startedAt >= l.lifetimeMs) {
+                clearLayer(i);
+                expired |= 1u << i;
+            }
+        }
+        return expired;
+    }
+
+    // Opacity right now, lowered during the fade at the end of the lifetime
+    uint8_t opacityAt(size_t layer, uint32_t now) const {
+        const Layer& l = layers[layer];
+        if (!l.fadeMs) return l.opacity;
+        uint32_t age = now - l.startedAt;
+        uint32_t fadeStart = l.lifetimeMs - l.fadeMs;
+        if (age <= fadeStart) return l.opacity;
+        if (age >= l.lifetimeMs) return 0;
+        return ledScale8(l.opacity, (uint8_t)(255 - ledRamp8(age - fadeStart, l.fadeMs)));
+    }
+
+    // Blends the active layers bottom to top. Returns false, leaving `out`
+    // alone, when no canvas was drawn and no layer changed since last time.
+    bool compose(uint32_t now, uint32_t* out) {
+        bool changed = layersChanged;
+        layersChanged = false;
+        for (size_t i = 0; i < Layers; i++) {
+            if (layers[i].canvas.takeDrawn() && layers[i].active) changed = true;
+            if (i > 0 && layers[i].active && layers[i].fadeMs) {
+                changed = true;
+                layersChanged = true;   // keep composing until the fade is over
+            }
+        }
+        if (!changed) return false;
+
+        memcpy(out, layers[0].canvas.data(), sizeof(uint32_t) * Count);
+        for (size_t i = 1; i < Layers; i++) {
+            if (!layers[i].active) continue;
+            uint8_t opacity = opacityAt(i, now);
+            if (opacity == 0) continue;
+            const uint32_t* above = layers[i].canvas.data();
+            for (size_t p = 0; p < Count; p++) {
+                out[p] = blendPixel(layers[i].mode, out[p], above[p], opacity);
+            }
+        }
+        return true;
+    }
+};
+
+#if defined(ARDUINO)
+#include "config.h"
+
+typedef BasicLedCanvas<LED_COUNT> LedCanvas;
+typedef BasicLedCompositor<LED_COUNT, LED_LAYERS> LedCompositor;
+#endif
+
+#endif // LED_COMPOSITOR_H
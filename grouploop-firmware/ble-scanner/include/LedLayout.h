@@ -0,0 +1,90 @@
+#ifndef LED_LAYOUT_H
+#define LED_LAYOUT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <utility>
+
+// How the pixels of a board are arranged
+enum class LedShape : uint8_t {
+    STRIP,      // in a row, like the wristband
+    RING        // in a closed circle
+};
+
+namespace led_layout_detail {
+
+// Data-line index of each logical pixel
+template <uint16_t Count, LedShape Shape, uint16_t FirstPixel, bool Reversed>
+constexpr std::array<uint16_t, Count> physicalOrder() {
+    std::array<uint16_t, Count> order{};
+    for (uint16_t i = 0; i < Count; i++) {
+        if (Shape == LedShape::STRIP) {
+            order[i] = Reversed ? (uint16_t)(Count - 1 - i) : i;
+        } else {
+            uint16_t step = Reversed ? (uint16_t)(Count - i) : i;
+            order[i] = (uint16_t)((FirstPixel + step) % Count);
+        }
+    }
+    return order;
+}
+
+template <uint16_t Count>
+constexpr bool isIdentity(const std::array<uint16_t, Count>& order) {
+    for (uint16_t i = 0; i < Count; i++) {
+        if (order[i] != i) return false;
+    }
+    return true;
+}
+
+} // namespace led_layout_detail
+
+// The pixel count and arrangement of a board as a type, so the behaviors
+// and LedProcess get their bounds and tables at compile time and each board
+// is its own build. Pixels are addressed logically: 0..Count-1 along the
+// strip, or clockwise around the ring starting at FirstPixel, the pixel on
+// the data line at twelve o'clock. Reversed is for wiring that runs the
+// other way.
+template <uint16_t Count, LedShape Shape, uint16_t FirstPixel = 0, bool Reversed = false>
+struct LedLayout {
+    static_assert(Count > 0, "a layout needs pixels");
+    static_assert(Shape == LedShape::RING || FirstPixel == 0, "only rings start elsewhere");
+    static_assert(FirstPixel < Count, "first pixel is not on the ring");
+
+    static constexpr uint16_t count = Count;
+    static constexpr LedShape shape = Shape;
+
+    // Logical pixel -> data-line index
+    static constexpr std::array<uint16_t, Count> physical =
+        led_layout_detail::physicalOrder<Count, Shape, FirstPixel, Reversed>();
+    static constexpr bool identity = led_layout_detail::isIdentity<Count>(physical);
+
+    // forEach() spells loops out up to this many pixels
+    static constexpr bool unrolled = Count <= 8;
+
+    static constexpr bool contains(int index) { return index >= 0 && index < (int)Count; }
+
+    // Calls fn(i) for every logical pixel in order
+    template <typename Fn>
+    static inline void forEach(Fn&& fn) {
+        if constexpr (unrolled) {
+            forEachOf(fn, std::make_integer_sequence<uint16_t, Count>());
+        } else {
+            for (uint16_t i = 0; i < Count; i++) fn(i);
+        }
+    }
+
+private:
+    template <typename Fn, uint16_t... I>
+    static inline void forEachOf(Fn& fn, std::integer_sequence<uint16_t, I...>) {
+        (fn(I), ...);
+    }
+};
+
+#if defined(ARDUINO)
+#include "config.h"
+
+typedef LedLayout<LED_COUNT, LED_SHAPE, LED_FIRST_PIXEL, LED_REVERSED> BoardLayout;
+#endif
+
+#endif // LED_LAYOUT_H
@@ -0,0 +1,193 @@
+#ifndef LED_MATH_H
+#define LED_MATH_H
+
+#include <stdint.h>
+
+// Integer animation maths for the LED behaviors. The ESP32-C3 has no FPU,
+// so sin(), float physics and per-pixel divisions all end up in soft-float
+// or libgcc helpers; everything here is table lookups, shifts and 32x32
+// multiplies. Phases are uint32_t fractions of a turn (2^32 = one period),
+// brightness is 0..255 and fixed-point values are Q16.16.
+
+typedef int32_t q16_t;
+#define Q16_ONE ((q16_t)0x10000)
+
+inline q16_t q16FromFloat(float value) {
+    return (q16_t)(value * 65536.0f + (value < 0 ? -0.5f : 0.5f));
+}
+
+inline q16_t q16Mul(q16_t a, q16_t b) {
+    return (q16_t)(((int64_t)a * b) >> 16);
+}
+
+// (sin + 1) / 2 * 255 over one turn in 256 steps, plus the wrap-around
+// entry so interpolation never needs a modulo
+static const uint8_t LED_SINE_TABLE[257] = {
+    128, 131, 134, 137, 140, 143, 146, 149, 152, 155, 158, 162, 165, 167, 170, 173,
+    176, 179, 182, 185, 188, 190, 193, 196, 198, 201, 203, 206, 208, 211, 213, 215,
+    218, 220, 222, 224, 226, 228, 230, 232, 234, 235, 237, 238, 240, 241, 243, 244,
+    245, 246, 248, 249, 250, 250, 251, 252, 253, 253, 254, 254, 254, 255, 255, 255,
+    255, 255, 255, 255, 254, 254, 254, 253, 253, 252, 251, 250, 250, 249, 248, 246,
+    245, 244, 243, 241, 240, 238, 237, 235, 234, 232, 230, 228, 226, 224, 222, 220,
+    218, 215, 213, 211, 208, 206, 203, 201, 198, 196, 193, 190, 188, 185, 182, 179,
+    176, 173, 170, 167, 165, 162, 158, 155, 152, 149, 146, 143, 140, 137, 134, 131,
+    128, 124, 121, 118, 115, 112, 109, 106, 103, 100,  97,  93,  90,  88,  85,  82,
+     79,  76,  73,  70,  67,  65,  62,  59,  57,  54,  52,  49,  47,  44,  42,  40,
+     37,  35,  33,  31,  29,  27,  25,  23,  21,  20,  18,  17,  15,  14,  12,  11,
+     10,   9,   7,   6,   5,   5,   4,   3,   2,   2,   1,   1,   1,   0,   0,   0,
+      0,   0,   0,   0,   1,   1,   1,   2,   2,   3,   4,   5,   5,   6,   7,   9,
+     10,  11,  12,  14,  15,  17,  18,  20,  21,  23,  25,  27,  29,  31,  33,  35,
+     37,  40,  42,  44,  47,  49,  52,  54,  57,  59,  62,  65,  67,  70,  73,  76,
+     79,  82,  85,  88,  90,  93,  97, 100, 103, 106, 109, 112, 115, 118, 121, 124,
+    128,
+};
+
+// Perceived brightness to PWM level, gamma 2.2
+static const uint8_t LED_GAMMA_TABLE[256] = {
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   1,
+      1,   1,   1,   1,   1,   1,   1,   1,   1,   2,   2,   2,   2,   2,   2,   2,
+      3,   3,   3,   3,   3,   4,   4,   4,   4,   5,   5,   5,   5,   6,   6,   6,
+      6,   7,   7,   7,   8,   8,   8,   9,   9,   9,  10,  10,  11,  11,  11,  12,
+     12,  13,  13,  13,  14,  14,  15,  15,  16,  16,  17,  17,  18,  18,  19,  19,
+     20,  20,  21,  22,  22,  23,  23,  24,  25,  25,  26,  26,  27,  28,  28,  29,
+     30,  30,  31,  32,  33,  33,  34,  35,  35,  36,  37,  38,  39,  39,  40,  41,
+     42,  43,  43,  44,  45,  46,  47,  48,  49,  49,  50,  51,  52,  53,  54,  55,
+     56,  57,  58,  59,  60,  61,  62,  63,  64,  65,  66,  67,  68,  69,  70,  71,
+     73,  74,  75,  76,  77,  78,  79,  81,  82,  83,  84,  85,  87,  88,  89,  90,
+     91,  93,  94,  95,  97,  98,  99, 100, 102, 103, 105, 106, 107, 109, 110, 111,
+    113, 114, 116, 117, 119, 120, 121, 123, 124, 126, 127, 129, 130, 132, 133, 135,
+    137, 138, 140, 141, 143, 145, 146, 148, 149, 151, 153, 154, 156, 158, 159, 161,
+    163, 165, 166, 168, 170, 172, 173, 175, 177, 179, 181, 182, 184, 186, 188, 190,
+    192, 194, 196, 197, 199, 201, 203, 205, 207, 209, 211, 213, 215, 217, 219, 221,
+    223, 225, 227, 229, 231, 234, 236, 238, 240, 242, 244, 246, 248, 251, 253, 255,
+};
+
+// Phase advance per millisecond for a period in ms. Multiplying elapsed
+// time by it wraps at exactly one period, so there is no modulo per frame
+// and the only division happens when the period changes.
+inline uint32_t ledPhaseStep(uint32_t periodMs) {
+    return periodMs ? (uint32_t)(0x100000000ULL / periodMs) : 0;
+}
+
+// Brightness 0..255 following a sine, 128 at phase 0 like (sin + 1) / 2.
+// Linear interpolation between table entries keeps slow breathing smooth.
+inline uint8_t ledSin8(uint32_t phase) {
+    uint8_t index = (uint8_t)(phase >> 24);
+    int32_t fraction = (phase >> 16) & 0xFF;
+    int32_t a = LED_SINE_TABLE[index];
+    int32_t b = LED_SINE_TABLE[index + 1];
+    return (uint8_t)(a + (((b - a) * fraction) >> 8));
+}
+
+inline uint8_t ledGamma8(uint8_t level) {
+    return LED_GAMMA_TABLE[level];
+}
+
+// value * scale / 255 without the division; exact at 0 and 255
+inline uint8_t ledScale8(uint8_t value, uint8_t scale) {
+    return (uint8_t)(((uint16_t)value * (uint16_t)(scale + 1)) >> 8);
+}
+
+// Scales a packed 0xRRGGBB color with two multiplies: red and blue share
+// one, their 8-bit gap absorbs the product
+inline uint32_t ledScaleColor(uint32_t color, uint8_t scale) {
+    uint32_t s = (uint32_t)scale + 1;
+    uint32_t rb = (((color & 0xFF00FF) * s) >> 8) & 0xFF00FF;
+    uint32_t g = (((color & 0x00FF00) * s) >> 8) & 0x00FF00;
+    return rb | g;
+}
+
+// Linear ramp: 0 at elapsed = 0, 255 at elapsed = durationMs
+inline uint8_t ledRamp8(uint32_t elapsed, uint32_t durationMs) {
+    if (elapsed >= durationMs) return 255;
+    return (uint8_t)((elapsed * 255UL) / durationMs);
+}
+
+// Damped spring in Q16.16: brightness as position (1.0 = full), velocity
+// per second. Time is spent in fixed steps of stepMs from an accumulator, so
+// the motion does not depend on how regularly the renderer polls. Each step
+// is semi-implicit with the damping solved implicitly:
+//
+//   v' = (v - h k/m (x - target)) / (1 + h c/m)      x' = x + h v'
+//
+// That is stable for any damping, and for any stiffness with h sqrt(k/m) < 2;
+// the stiffest spring_param (k/m = 255) at 4 ms steps has 0.064.
+struct FixedSpring {
+    static const q16_t MAX_VELOCITY = 64 * Q16_ONE;
+
+    q16_t position;
+    q16_t velocity;
+    q16_t target;
+
+    explicit FixedSpring(uint16_t stepMs = 4, uint16_t maxSteps = 64)
+        : position(Q16_ONE), velocity(0), target(0), stiffnessStep(0), dampingFactor(Q16_ONE),
+          stepSize((q16_t)(((uint32_t)stepMs << 16) / 1000)), stepMs(stepMs ? stepMs : 1),
+          maxSteps(maxSteps), accumulatorMs(0) {}
+
+    // Floats only here; the step itself is integer
+    void setParams(float k, float c, float mass) {
+        if (mass <= 0) mass = 0.1f;
+        if (k < 0) k = 0;
+        if (c < 0) c = 0;
+        float h = stepMs / 1000.0f;
+        stiffnessStep = q16FromFloat(h * k / mass);
+        dampingFactor = q16FromFloat(1.0f / (1.0f + h * c / mass));
+    }
+
+    // Kick: adds to the velocity right away (e.g. a tap)
+    void impulse(q16_t deltaVelocity) {
+        int64_t v = (int64_t)velocity + deltaVelocity;
+        velocity = (q16_t)(v > MAX_VELOCITY ? MAX_VELOCITY : (v < -MAX_VELOCITY ? -MAX_VELOCITY : v));
+    }
+
+    // Put at rest at `at`, dropping time not yet stepped
+    void settle(q16_t at) {
+        position = at;
+        velocity = 0;
+        accumulatorMs = 0;
+    }
+
+    // Runs the whole steps elapsedMs completes and returns how many. After
+    // a stall, time beyond maxSteps is dropped rather than caught up in one
+    // burst on the renderer.
+    uint16_t advance(uint32_t elapsedMs) {
+        uint32_t limit = (uint32_t)maxSteps * stepMs;
+        accumulatorMs += elapsedMs > limit ? limit + stepMs : elapsedMs;
+        uint32_t steps = accumulatorMs / stepMs;
+        if (steps > maxSteps) {
+            steps = maxSteps;
+            accumulatorMs = 0;
+        } else {
+            accumulatorMs -= steps * stepMs;
+        }
+        for (uint32_t i = 0; i < steps; i++) step();
+        return (uint16_t)steps;
+    }
+
+    void step() {
+        velocity = mulRound(velocity - mulRound(stiffnessStep, position - target), dampingFactor);
+        position += mulRound(velocity, stepSize);
+    }
+
+    // |position| as 0..255, saturating above full brightness
+    uint8_t level() const {
+        uint32_t magnitude = position < 0 ? (uint32_t)-position : (uint32_t)position;
+        if (magnitude >= (uint32_t)Q16_ONE) return 255;
+        return (uint8_t)((magnitude * 255u + 0x8000u) >> 16);
+    }
+
+private:
+    q16_t stiffnessStep;    // h k / m
+    q16_t dampingFactor;    // 1 / (1 + h c / m)
+    q16_t stepSize;         // h, seconds
+    uint16_t stepMs;
+    uint16_t maxSteps;
+    uint32_t accumulatorMs;
+
+    // Rounded, so small velocities decay to zero instead of to -1
+    static q16_t mulRound(q16_t a, q16_t b) {
+        return (q16_t)(((int64_t)a * b + 0x8000) >> 16);
+    }
+};
+
+#endif // LED_MATH_H
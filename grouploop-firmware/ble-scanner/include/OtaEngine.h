@@ -0,0 +1,301 @@
+#ifndef OTA_ENGINE_H
+#define OTA_ENGINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "Sha256.h"
+
+// Where the image comes from (an HTTP download on the device)
+class OtaSource {
+public:
+    virtual ~OtaSource() {}
+    // Request the image starting at `offset` (a Range request when > 0).
+    // Returns the offset the body really starts at, which is 0 when the
+    // server ignored the range, or -1 on failure. totalSize() is valid after.
+    virtual int32_t open(uint32_t offset) = 0;
+    virtual uint32_t totalSize() const = 0;
+    // Copy up to `max` bytes that have already arrived. Returns 0 if nothing
+    // is available yet and -1 once the connection is gone.
+    virtual int32_t read(uint8_t* buffer, size_t max) = 0;
+    // Safe to call when already closed
+    virtual void close() = 0;
+};
+
+// Where the image goes (the inactive OTA partition on the device)
+class OtaFlashWriter {
+public:
+    virtual ~OtaFlashWriter() {}
+    virtual bool begin(uint32_t size) = 0;
+    virtual bool write(const uint8_t* data, size_t length) = 0;
+    // Finalize the image and make it the boot partition
+    virtual bool commit() = 0;
+    virtual void abort() = 0;
+    // Writers that expand their input (see OtaImageDecoder.h) may take a
+    // chunk and finish writing it over several calls; while busy() the
+    // engine calls drain() instead of reading more.
+    virtual bool busy() const { return false; }
+    virtual bool drain() { return true; }
+};
+
+struct OtaEngineConfig {
+    uint16_t chunksPerStep;     // upper bound on work done by one step()
+    uint8_t maxRetries;         // consecutive reconnects without progress
+    uint32_t retryDelayMs;
+    uint32_t stallTimeoutMs;    // no data for this long counts as a dropped connection
+
+    OtaEngineConfig()
+        : chunksPerStep(4), maxRetries(5), retryDelayMs(2000), stallTimeoutMs(10000) {}
+};
+
+// Streaming OTA download, driven in small slices from a periodic step().
+//
+// Each step copies at most chunksPerStep * ChunkSize bytes from the source
+// into flash, hashing as it goes, so the caller keeps its own cadence. A
+// dropped or stalled connection is reopened after retryDelayMs with a range
+// request from the last written byte. Once the last byte is written the
+// SHA-256 of the whole download is compared with the expected digest, and
+// only a match lets the flash writer switch partitions.
+template <size_t ChunkSize>
+class OtaEngine {
+public:
+    enum class State : uint8_t {
+        IDLE,
+        CONNECTING,
+        DOWNLOADING,
+        RETRY_WAIT,
+        DONE,
+        FAILED
+    };
+
+    enum class Error : uint8_t {
+        NONE,
+        CONNECT,        // could not (re)open the source after maxRetries
+        SIZE,           // missing or changed image size
+        FLASH_BEGIN,
+        FLASH_WRITE,
+        DIGEST,         // downloaded image does not match the expected SHA-256
+        FLASH_COMMIT,
+        ABORTED
+    };
+
+private:
+    OtaSource& source;
+    OtaFlashWriter& flash;
+    OtaEngineConfig config;
+    uint8_t buffer[ChunkSize];
+
+    State state;
+    Error error;
+    uint8_t expected[Sha256::DIGEST_SIZE];
+    Sha256 sha;
+    uint32_t written;
+    uint32_t total;
+    bool flashOpen;
+    uint8_t retries;
+    uint32_t resumes;           // successful range requests after a drop
+    uint32_t stateSince;
+    uint32_t lastDataAt;
+
+public:
+    OtaEngine(OtaSource& aSource, OtaFlashWriter& aFlash, const OtaEngineConfig& aConfig = OtaEngineConfig())
+        : source(aSource), flash(aFlash), config(aConfig), state(State::IDLE), error(Error::NONE),
+          written(0), total(0), flashOpen(false), retries(0), resumes(0), stateSince(0), lastDataAt(0) {
+        memset(expected, 0, sizeof(expected));
+    }
+
+    // Start a new download that must hash to `digest`
+    bool start(const uint8_t digest[Sha256::DIGEST_SIZE], uint32_t now) {
+        if (isActive()) return false;
+        memcpy(expected, digest, sizeof(expected));
+        sha.reset();
+        written = 0;
+        total = 0;
+        flashOpen = false;
+        retries = 0;
+        resumes = 0;
+        error = Error::NONE;
+        enter(State::CONNECTING, now);
+        return true;
+    }
+
+    void abort(uint32_t now) {
+        if (!isActive()) return;
+        fail(Error::ABORTED, now);
+    }
+
+    // Do one bounded slice of work
+    void step(uint32_t now) {
+        switch (state) {
+            case State::CONNECTING:
+                connect(now);
+                break;
+            case State::DOWNLOADING:
+                download(now);
+                break;
+            case State::RETRY_WAIT:
+                if (now - stateSince >= config.retryDelayMs) {
+                    enter(State::CONNECTING, now);
+                    connect(now);
+                }
+                break;
+            case State::IDLE:
+            case State::DONE:
+            case State::FAILED:
+                break;
+        }
+    }
+
+    State getState() const { return state; }
+    Error getError() const { return error; }
+    bool isActive() const {
+        return state == State::CONNECTING || state == State::DOWNLOADING || state == State::RETRY_WAIT;
+    }
+    uint32_t getWritten() const { return written; }
+    uint32_t getTotal() const { return total; }
+    uint32_t getResumes() const { return resumes; }
+    uint8_t getPercent() const {
+        return total ? (uint8_t)((uint64_t)written * 100 / total) : 0;
+    }
+
+    static const char* stateName(State s) {
+        switch (s) {
+            case State::IDLE: return "idle";
+            case State::CONNECTING: return "connecting";
+            case State::DOWNLOADING: return "downloading";
+            case State::RETRY_WAIT: return "retrying";
+            case State::DONE: return "done";
+            case State::FAILED: return "failed";
+        }
+        return "unknown";
+    }
+
+    static const char* errorName(Error e) {
+        switch (e) {
+            case Error::NONE: return "none";
+            case Error::CONNECT: return "connect";
+            case Error::SIZE: return "size";
+            case Error::FLASH_BEGIN: return "flash_begin";
+            case Error::FLASH_WRITE: return "flash_write";
+            case Error::DIGEST: return "digest";
+            case Error::FLASH_COMMIT: return "flash_commit";
+            case Error::ABORTED: return "aborted";
+        }
+        return "unknown";
+    }
+
+private:
+    void enter(State next, uint32_t now) {
+        state = next;
+        stateSince = now;
+    }
+
+    void connect(uint32_t now) {
+        int32_t start = source.open(written);
+        if (start < 0) {
+            retry(now);
+            return;
+        }
+        uint32_t size = source.totalSize();
+        if (size == 0 || (flashOpen && size != total)) {
+            fail(Error::SIZE, now);
+            return;
+        }
+
+        if (flashOpen && (uint32_t)start != written) {
+            // The server ignored the range; start the image over
+            flash.abort();
+            flashOpen = false;
+        }
+        if (!flashOpen) {
+            total = size;
+            written = 0;
+            sha.reset();
+            if (!flash.begin(total)) {
+                fail(Error::FLASH_BEGIN, now);
+                return;
+            }
+            flashOpen = true;
+        } else {
+            resumes++;
+        }
+
+        lastDataAt = now;
+        enter(State::DOWNLOADING, now);
+    }
+
+    void download(uint32_t now) {
+        if (flash.busy()) {
+            lastDataAt = now;   // not reading while the writer catches up
+            if (!flash.drain()) {
+                fail(Error::FLASH_WRITE, now);
+                return;
+            }
+            if (written >= total && !flash.busy()) finish(now);
+            return;
+        }
+        for (uint16_t i = 0; i < config.chunksPerStep && written < total; i++) {
+            size_t want = total - written;
+            if (want > ChunkSize) want = ChunkSize;
+            int32_t n = source.read(buffer, want);
+            if (n < 0) {
+                retry(now);
+                return;
+            }
+            if (n == 0) {
+                if (now - lastDataAt >= config.stallTimeoutMs) retry(now);
+                return;
+            }
+            if (!flash.write(buffer, (size_t)n)) {
+                fail(Error::FLASH_WRITE, now);
+                return;
+            }
+            sha.update(buffer, (size_t)n);
+            written += (uint32_t)n;
+            lastDataAt = now;
+            retries = 0;
+            if (flash.busy()) return;
+        }
+        if (written >= total && !flash.busy()) {
+            finish(now);
+        }
+    }
+
+    void finish(uint32_t now) {
+        source.close();
+        uint8_t digest[Sha256::DIGEST_SIZE];
+        sha.finish(digest);
+        if (memcmp(digest, expected, sizeof(digest)) != 0) {
+            fail(Error::DIGEST, now);
+            return;
+        }
+        if (!flash.commit()) {
+            flashOpen = false;
+            fail(Error::FLASH_COMMIT, now);
+            return;
+        }
+        flashOpen = false;
+        enter(State::DONE, now);
+    }
+
+    void retry(uint32_t now) {
+        source.close();
+        if (++retries > config.maxRetries) {
+            fail(Error::CONNECT, now);
+            return;
+        }
+        enter(State::RETRY_WAIT, now);
+    }
+
+    void fail(Error reason, uint32_t now) {
+        source.close();
+        if (flashOpen) {
+            flash.abort();
+            flashOpen = false;
+        }
+        error = reason;
+        enter(State::FAILED, now);
+    }
+};
+
+#endif // OTA_ENGINE_H
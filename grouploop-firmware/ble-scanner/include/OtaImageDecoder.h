@@ -0,0 +1,491 @@
+#ifndef OTA_IMAGE_DECODER_H
+#define OTA_IMAGE_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "OtaEngine.h"
+#include "Sha256.h"
+
+// Packed OTA images as produced by tools/ota-pack.
+//
+// A packed image starts with a 48 byte header (little endian):
+//   0  "GLZ1"           magic; anything else is a plain firmware image
+//   4  kind             1 = compressed image, 2 = compressed delta
+//   5  windowBits       LZSS window, always 12 (4 KB)
+//   6  reserved[2]
+//   8  targetSize       size of the decoded firmware image
+//   12 baseSize         bytes of the running image a delta reads from
+//   16 targetSha[32]    SHA-256 of the decoded firmware image
+// followed by an LZSS stream. For a delta the LZSS stream decodes to a list
+// of COPY/INSERT operations that rebuild the new image from the running one.
+struct OtaImageHeader {
+    static const size_t SIZE = 48;
+    static const uint8_t KIND_COMPRESSED = 1;
+    static const uint8_t KIND_DELTA = 2;
+    static const uint8_t WINDOW_BITS = 12;
+
+    uint8_t kind;
+    uint8_t windowBits;
+    uint32_t targetSize;
+    uint32_t baseSize;
+    uint8_t targetSha[Sha256::DIGEST_SIZE];
+
+    OtaImageHeader() : kind(0), windowBits(WINDOW_BITS), targetSize(0), baseSize(0) {
+        memset(targetSha, 0, sizeof(targetSha));
+    }
+
+    static bool hasMagic(const uint8_t* bytes) {
+        return bytes[0] == 'G' && bytes[1] == 'L' && bytes[2] == 'Z' && bytes[3] == '1';
+    }
+
+    bool parse(const uint8_t* bytes) {
+        if (!hasMagic(bytes)) return false;
+        kind = bytes[4];
+        windowBits = bytes[5];
+        targetSize = readU32(bytes + 8);
+        baseSize = readU32(bytes + 12);
+        memcpy(targetSha, bytes + 16, sizeof(targetSha));
+        return (kind == KIND_COMPRESSED || kind == KIND_DELTA) && windowBits == WINDOW_BITS;
+    }
+
+    void serialize(uint8_t* bytes) const {
+        memset(bytes, 0, SIZE);
+        bytes[0] = 'G'; bytes[1] = 'L'; bytes[2] = 'Z'; bytes[3] = '1';
+        bytes[4] = kind;
+        bytes[5] = windowBits;
+        writeU32(bytes + 8, targetSize);
+        writeU32(bytes + 12, baseSize);
+        memcpy(bytes + 16, targetSha, sizeof(targetSha));
+    }
+
+private:
+    static uint32_t readU32(const uint8_t* p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+    static void writeU32(uint8_t* p, uint32_t v) {
+        p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+    }
+};
+
+// Streaming LZSS decoder with a 4 KB window.
+//
+// Tokens come in groups of eight behind a flag byte (LSB first): a set bit
+// is one literal byte, a clear bit a two byte match `dddddddd ddddllll`
+// copying (l + 3) bytes from (d + 1) bytes back. Input may be split
+// anywhere, and output stops when `out` is full, so a long match simply
+// continues on the next call.
+class LzssDecoder {
+public:
+    static const uint16_t WINDOW_SIZE = 1 << OtaImageHeader::WINDOW_BITS;
+    static const uint8_t MIN_MATCH = 3;
+    static const uint8_t MAX_MATCH = 18;
+
+private:
+    uint8_t window[WINDOW_SIZE];
+    uint16_t windowPos;
+    uint8_t flags;
+    uint8_t flagCount;          // tokens left in the current group
+    bool haveHigh;              // first byte of a match has been read
+    uint8_t high;
+    uint16_t matchDistance;
+    uint8_t matchRemaining;
+
+public:
+    LzssDecoder() { reset(); }
+
+    void reset() {
+        memset(window, 0, sizeof(window));
+        windowPos = 0;
+        flags = 0;
+        flagCount = 0;
+        haveHigh = false;
+        high = 0;
+        matchDistance = 0;
+        matchRemaining = 0;
+    }
+
+    // Decode from `in` into `out`; returns how many input bytes were used
+    // and sets `produced` to the bytes written to `out`
+    size_t decode(const uint8_t* in, size_t inLength, uint8_t* out, size_t outCapacity, size_t& produced) {
+        size_t used = 0;
+        produced = 0;
+        while (produced < outCapacity) {
+            if (matchRemaining > 0) {
+                emit(window[(uint16_t)(windowPos - matchDistance) & (WINDOW_SIZE - 1)], out, produced);
+                matchRemaining--;
+                continue;
+            }
+            if (used >= inLength) break;
+            if (flagCount == 0) {
+                flags = in[used++];
+                flagCount = 8;
+                continue;
+            }
+            if (flags & 1) {
+                emit(in[used++], out, produced);
+                nextToken();
+                continue;
+            }
+            if (!haveHigh) {
+                high = in[used++];
+                haveHigh = true;
+                continue;
+            }
+            uint8_t low = in[used++];
+            haveHigh = false;
+            nextToken();
+            matchDistance = (uint16_t)(((uint16_t)high << 4) | (low >> 4)) + 1;
+            matchRemaining = (uint8_t)((low & 0x0F) + MIN_MATCH);
+        }
+        return used;
+    }
+
+    // A match is still being copied out
+    bool hasPending() const { return matchRemaining > 0; }
+
+private:
+    void emit(uint8_t byte, uint8_t* out, size_t& produced) {
+        out[produced++] = byte;
+        window[windowPos] = byte;
+        windowPos = (windowPos + 1) & (WINDOW_SIZE - 1);
+    }
+
+    void nextToken() {
+        flags >>= 1;
+        flagCount--;
+    }
+};
+
+// Read access to the image a delta was made against (the running partition
+// on the device)
+class OtaBaseReader {
+public:
+    virtual ~OtaBaseReader() {}
+    virtual uint32_t size() const = 0;
+    virtual bool read(uint32_t offset, uint8_t* buffer, size_t length) = 0;
+};
+
+// Applies a delta operation stream:
+//   0x00 <offset varint> <length varint>   copy from the base image
+//   0x01 <length varint> <bytes>           insert new bytes
+// Varints are LEB128. Like the decoder it stops when `out` is full and a
+// copy carries over to the next call.
+class DeltaApplier {
+private:
+    enum class Phase : uint8_t {
+        OPCODE,
+        COPY_OFFSET,
+        COPY_LENGTH,
+        INSERT_LENGTH,
+        COPYING,
+        INSERTING
+    };
+
+    Phase phase;
+    uint32_t varint;
+    uint8_t shift;
+    uint32_t copyOffset;
+    uint32_t remaining;
+    bool failed;
+
+public:
+    static const uint8_t OP_COPY = 0x00;
+    static const uint8_t OP_INSERT = 0x01;
+
+    DeltaApplier() { reset(); }
+
+    void reset() {
+        phase = Phase::OPCODE;
+        varint = 0;
+        shift = 0;
+        copyOffset = 0;
+        remaining = 0;
+        failed = false;
+    }
+
+    size_t apply(const uint8_t* in, size_t inLength, uint8_t* out, size_t outCapacity,
+                 size_t& produced, OtaBaseReader& base) {
+        size_t used = 0;
+        produced = 0;
+        while (!failed && produced < outCapacity) {
+            if (phase == Phase::COPYING) {
+                size_t n = outCapacity - produced;
+                if (n > remaining) n = remaining;
+                if ((uint64_t)copyOffset + n > base.size() || !base.read(copyOffset, out + produced, n)) {
+                    failed = true;
+                    break;
+                }
+                copyOffset += (uint32_t)n;
+                remaining -= (uint32_t)n;
+                produced += n;
+                if (remaining == 0) phase = Phase::OPCODE;
+                continue;
+            }
+            if (used >= inLength) break;
+            if (phase == Phase::INSERTING) {
+                size_t n = outCapacity - produced;
+                if (n > remaining) n = remaining;
+                if (n > inLength - used) n = inLength - used;
+                memcpy(out + produced, in + used, n);
+                used += n;
+                produced += n;
+                remaining -= (uint32_t)n;
+                if (remaining == 0) phase = Phase::OPCODE;
+                continue;
+            }
+            uint8_t byte = in[used++];
+            if (phase == Phase::OPCODE) {
+                if (byte == OP_COPY) {
+                    phase = Phase::COPY_OFFSET;
+                } else if (byte == OP_INSERT) {
+                    phase = Phase::INSERT_LENGTH;
+                } else {
+                    failed = true;
+                }
+                varint = 0;
+                shift = 0;
+                continue;
+            }
+            if (shift > 28) {
+                failed = true;
+                break;
+            }
+            varint |= (uint32_t)(byte & 0x7F) << shift;
+            shift += 7;
+            if (byte & 0x80) continue;
+
+            uint32_t value = varint;
+            varint = 0;
+            shift = 0;
+            if (phase == Phase::COPY_OFFSET) {
+                copyOffset = value;
+                phase = Phase::COPY_LENGTH;
+            } else if (phase == Phase::COPY_LENGTH) {
+                remaining = value;
+                phase = value > 0 ? Phase::COPYING : Phase::OPCODE;
+            } else {
+                remaining = value;
+                phase = value > 0 ? Phase::INSERTING : Phase::OPCODE;
+            }
+        }
+        return used;
+    }
+
+    // A copy from the base image is still being written out
+    bool hasPending() const { return phase == Phase::COPYING && remaining > 0; }
+    bool hasFailed() const { return failed; }
+};
+
+// OtaFlashWriter decorator that unpacks packed images on their way to flash.
+//
+// The first bytes decide the format: plain images pass straight through,
+// packed ones are decoded and written as the firmware image they describe.
+// Each write() or drain() produces at most `outputBudget` bytes of flash
+// writes; a chunk that expands further is kept and finished by the engine
+// calling drain() while busy(). RAM use is fixed: the 4 KB LZSS window
+// plus an InputCapacity buffer and two small staging buffers. The decoded
+// image is checked against the header's SHA-256 before commit.
+template <size_t InputCapacity>
+class DecodingFlashWriter : public OtaFlashWriter {
+public:
+    enum class Format : uint8_t {
+        UNKNOWN,
+        PLAIN,
+        COMPRESSED,
+        DELTA
+    };
+
+private:
+    static const size_t STAGE_SIZE = 256;
+
+    OtaFlashWriter& target;
+    OtaBaseReader* base;
+    uint32_t outputBudget;
+
+    Format format;
+    OtaImageHeader header;
+    uint8_t headerBytes[OtaImageHeader::SIZE];
+    size_t headerLength;
+    uint32_t downloadSize;
+    bool targetOpen;
+    bool failed;
+
+    uint8_t input[InputCapacity];
+    size_t inputLength;
+    size_t inputPos;
+    uint8_t ops[STAGE_SIZE];    // decompressed delta operations
+    size_t opsLength;
+    size_t opsPos;
+    uint8_t out[STAGE_SIZE];
+
+    LzssDecoder lzss;
+    DeltaApplier delta;
+    Sha256 sha;
+    uint32_t produced;
+
+public:
+    DecodingFlashWriter(OtaFlashWriter& aTarget, OtaBaseReader* aBase, uint32_t anOutputBudget)
+        : target(aTarget), base(aBase), outputBudget(anOutputBudget) {
+        reset();
+    }
+
+    bool begin(uint32_t size) override {
+        reset();
+        downloadSize = size;
+        return true;
+    }
+
+    bool write(const uint8_t* data, size_t length) override {
+        if (failed || busy()) return false;
+        size_t used = 0;
+        if (format == Format::UNKNOWN) {
+            used = readHeader(data, length);
+            if (failed) return false;
+            if (format == Format::UNKNOWN) return true;     // header not complete yet
+        }
+        if (format == Format::PLAIN) {
+            return used == length || target.write(data + used, length - used);
+        }
+        if (length - used > InputCapacity) return false;
+        memcpy(input, data + used, length - used);
+        inputLength = length - used;
+        inputPos = 0;
+        return drain();
+    }
+
+    bool busy() const override {
+        return !failed && (inputPos < inputLength || lzss.hasPending() || opsPos < opsLength || delta.hasPending());
+    }
+
+    bool drain() override {
+        uint32_t budget = outputBudget;
+        while (!failed && budget > 0 && busy()) {
+            size_t capacity = budget < STAGE_SIZE ? budget : STAGE_SIZE;
+            size_t outLength = 0;
+            size_t consumed = 0;
+            if (format == Format::COMPRESSED) {
+                consumed = lzss.decode(input + inputPos, inputLength - inputPos, out, capacity, outLength);
+                inputPos += consumed;
+            } else {
+                if (opsPos == opsLength && (inputPos < inputLength || lzss.hasPending())) {
+                    opsPos = 0;
+                    consumed = lzss.decode(input + inputPos, inputLength - inputPos, ops, sizeof(ops), opsLength);
+                    inputPos += consumed;
+                }
+                size_t applied = delta.apply(ops + opsPos, opsLength - opsPos, out, capacity, outLength, *base);
+                opsPos += applied;
+                consumed += applied;
+                if (delta.hasFailed()) failed = true;
+            }
+            if (outLength > 0 && !emit(out, outLength)) failed = true;
+            if (outLength == 0 && consumed == 0) break;     // waiting for more input
+            budget -= (uint32_t)outLength;
+        }
+        return !failed;
+    }
+
+    bool commit() override {
+        if (format == Format::PLAIN) {
+            targetOpen = false;
+            return target.commit();
+        }
+        if (failed || busy() || format == Format::UNKNOWN || produced != header.targetSize) {
+            abort();
+            return false;
+        }
+        uint8_t digest[Sha256::DIGEST_SIZE];
+        sha.finish(digest);
+        if (memcmp(digest, header.targetSha, sizeof(digest)) != 0) {
+            abort();
+            return false;
+        }
+        targetOpen = false;
+        return target.commit();
+    }
+
+    void abort() override {
+        if (targetOpen) target.abort();
+        reset();
+    }
+
+    Format getFormat() const { return format; }
+    // Bytes of firmware written so far (the download size for plain images
+    // is tracked by the engine)
+    uint32_t getProduced() const { return produced; }
+
+    static const char* formatName(Format f) {
+        switch (f) {
+            case Format::UNKNOWN: return "unknown";
+            case Format::PLAIN: return "plain";
+            case Format::COMPRESSED: return "compressed";
+            case Format::DELTA: return "delta";
+        }
+        return "unknown";
+    }
+
+private:
+    void reset() {
+        format = Format::UNKNOWN;
+        headerLength = 0;
+        downloadSize = 0;
+        targetOpen = false;
+        failed = false;
+        inputLength = 0;
+        inputPos = 0;
+        opsLength = 0;
+        opsPos = 0;
+        lzss.reset();
+        delta.reset();
+        sha.reset();
+        produced = 0;
+    }
+
+    // Collect header bytes; returns how many of `data` were used
+    size_t readHeader(const uint8_t* data, size_t length) {
+        size_t need = (headerLength < 4 ? 4 : OtaImageHeader::SIZE) - headerLength;
+        size_t take = need < length ? need : length;
+        memcpy(headerBytes + headerLength, data, take);
+        headerLength += take;
+        if (headerLength < 4) return take;
+
+        if (!OtaImageHeader::hasMagic(headerBytes)) {
+            // A plain image: replay what we held back and pass the rest through
+            format = Format::PLAIN;
+            if (!target.begin(downloadSize)) {
+                failed = true;
+                return take;
+            }
+            targetOpen = true;
+            if (!target.write(headerBytes, headerLength)) failed = true;
+            return take;
+        }
+        if (headerLength < OtaImageHeader::SIZE) {
+            // The rest of the header may arrive in a later write
+            if (take == length) return take;
+            return take + readHeader(data + take, length - take);
+        }
+
+        if (!header.parse(headerBytes) || header.targetSize == 0 ||
+            (header.kind == OtaImageHeader::KIND_DELTA && (!base || base->size() < header.baseSize))) {
+            failed = true;
+            return take;
+        }
+        if (!target.begin(header.targetSize)) {
+            failed = true;
+            return take;
+        }
+        targetOpen = true;
+        format = header.kind == OtaImageHeader::KIND_DELTA ? Format::DELTA : Format::COMPRESSED;
+        return take;
+    }
+
+    bool emit(const uint8_t* bytes, size_t length) {
+        if (produced + length > header.targetSize) return false;
+        sha.update(bytes, length);
+        produced += (uint32_t)length;
+        return target.write(bytes, length);
+    }
+};
+
+#endif // OTA_IMAGE_DECODER_H
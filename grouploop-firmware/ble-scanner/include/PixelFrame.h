@@ -0,0 +1,136 @@
+#ifndef PIXEL_FRAME_H
+#define PIXEL_FRAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "LedMath.h"
+
+// Where encoded frames go: GRB bytes, three per pixel. An asynchronous
+// output returns from write() at once and keeps reading the buffer until
+// busy() turns false, so the caller must leave it alone until then.
+class PixelOutput {
+public:
+    virtual ~PixelOutput() {}
+    virtual void begin() {}
+    virtual void write(const uint8_t* grb, size_t length) = 0;
+    virtual bool busy() { return false; }
+};
+
+struct PixelStats {
+    uint32_t shown;             // frames handed to the output
+    uint32_t skipped;           // show() calls with nothing changed
+    uint32_t deferred;          // changed frames that waited for the output
+    uint32_t showMicros;        // total time spent in PixelOutput::write()
+    uint32_t maxShowMicros;
+};
+
+// Frame buffer with the drawing calls behaviors use (a subset of
+// Adafruit_NeoPixel). show() only reaches the output when the frame differs
+// from the one last sent, so behaviors may redraw every tick for free.
+// A frame that changes while the output is still sending is kept and sent
+// by the next show() or poll().
+template <size_t Count>
+class BasicPixelFrame {
+public:
+    typedef unsigned long (*Clock)();
+
+    explicit BasicPixelFrame(PixelOutput& anOutput, Clock aClock = nullptr)
+        : output(anOutput), clock(aClock), brightness(255), sentBrightness(255), hasSent(false), pending(false), deferredCounted(false) {
+        memset(pixels, 0, sizeof(pixels));
+        memset(sent, 0, sizeof(sent));
+        memset(&stats, 0, sizeof(stats));
+    }
+
+    void begin() { output.begin(); }
+
+    uint16_t numPixels() const { return (uint16_t)Count; }
+
+    void setPixelColor(uint16_t index, uint32_t color) {
+        if (index < Count) pixels[index] = color & 0xFFFFFF;
+    }
+    uint32_t getPixelColor(uint16_t index) const {
+        return index < Count ? pixels[index] : 0;
+    }
+    void fill(uint32_t color) {
+        for (size_t i = 0; i < Count; i++) pixels[i] = color & 0xFFFFFF;
+    }
+    void clear() { fill(0); }
+
+    // Applied when a frame is encoded, so the buffer keeps full colors
+    void setBrightness(uint8_t value) { brightness = value; }
+    uint8_t getBrightness() const { return brightness; }
+
+    static uint32_t Color(uint8_t r, uint8_t g, uint8_t b) {
+        return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+    }
+
+    void show() {
+        if (hasSent && brightness == sentBrightness && memcmp(pixels, sent, sizeof(pixels)) == 0) {
+            // Back to (or still) what the LEDs show: nothing to send
+            pending = false;
+            stats.skipped++;
+            return;
+        }
+        if (pending) stats.skipped++;   // replaces a frame that never went out
+        pending = true;
+        flush();
+    }
+
+    // Sends a frame deferred by a busy output; call once per tick
+    void poll() {
+        if (pending) flush();
+    }
+
+    const PixelStats& getStats() const { return stats; }
+
+private:
+    PixelOutput& output;
+    Clock clock;
+    uint32_t pixels[Count];
+    uint32_t sent[Count];
+    uint8_t encoded[Count * 3];
+    uint8_t brightness;
+    uint8_t sentBrightness;
+    bool hasSent;
+    bool pending;
+    bool deferredCounted;
+    PixelStats stats;
+
+    void flush() {
+        if (output.busy()) {
+            if (!deferredCounted) {
+                stats.deferred++;
+                deferredCounted = true;
+            }
+            return;
+        }
+        deferredCounted = false;
+        for (size_t i = 0; i < Count; i++) {
+            uint32_t c = brightness == 255 ? pixels[i] : ledScaleColor(pixels[i], brightness);
+            encoded[i * 3] = (uint8_t)(c >> 8);         // green
+            encoded[i * 3 + 1] = (uint8_t)(c >> 16);    // red
+            encoded[i * 3 + 2] = (uint8_t)c;            // blue
+        }
+        unsigned long start = clock ? clock() : 0;
+        output.write(encoded, sizeof(encoded));
+        if (clock) {
+            uint32_t elapsed = (uint32_t)(clock() - start);
+            stats.showMicros += elapsed;
+            if (elapsed > stats.maxShowMicros) stats.maxShowMicros = elapsed;
+        }
+        memcpy(sent, pixels, sizeof(pixels));
+        sentBrightness = brightness;
+        hasSent = true;
+        pending = false;
+        stats.shown++;
+    }
+};
+
+#if defined(ARDUINO)
+#include "config.h"
+
+typedef BasicPixelFrame<LED_COUNT> PixelFrame;
+#endif
+
+#endif // PIXEL_FRAME_H
@@ -0,0 +1,119 @@
+#ifndef POWER_POLICY_H
+#define POWER_POLICY_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Power modes trade frame rate for battery life. The profiles are plain
+// data so the energy model (EnergyModel.h) can compare them on the host.
+enum class PowerMode : uint8_t {
+    PERFORMANCE,    // the core's default modem sleep, full clock, frames every publishIntervalMs
+    BALANCED,       // modem sleep between DTIM beacons, frames on each DTIM
+    SAVER           // radio wakes every few beacons, low clock
+};
+
+// Maps onto WIFI_PS_NONE / WIFI_PS_MIN_MODEM / WIFI_PS_MAX_MODEM
+enum class ModemSleep : uint8_t {
+    NONE,   // ESP-IDF refuses this while BLE is on, so no mode uses it
+    MIN,    // wake for every DTIM beacon
+    MAX     // wake every listenInterval beacons
+};
+
+struct PowerProfile {
+    uint16_t cpuMHz;            // clock while there is work
+    uint16_t idleCpuMHz;        // clock while waiting, with SDK power management
+    ModemSleep modemSleep;
+    uint8_t listenInterval;     // beacons between wakes with ModemSleep::MAX
+    uint8_t publishWakes;       // frames go out every N radio wakes (0 = the publishIntervalMs setting)
+};
+
+inline PowerProfile powerProfileFor(PowerMode mode) {
+    PowerProfile p;
+    switch (mode) {
+        case PowerMode::BALANCED:
+            p.cpuMHz = 160; p.idleCpuMHz = 80; p.modemSleep = ModemSleep::MIN;
+            p.listenInterval = 1; p.publishWakes = 1;
+            return p;
+        case PowerMode::SAVER:
+            p.cpuMHz = 80; p.idleCpuMHz = 80; p.modemSleep = ModemSleep::MAX;
+            p.listenInterval = 3; p.publishWakes = 1;
+            return p;
+        case PowerMode::PERFORMANCE:
+        default:
+            p.cpuMHz = 160; p.idleCpuMHz = 160; p.modemSleep = ModemSleep::MIN;
+            p.listenInterval = 1; p.publishWakes = 0;
+            return p;
+    }
+}
+
+// The profile as it runs without SDK power management: nothing lowers the
+// clock while idle, so it stays at cpuMHz
+inline PowerProfile fixedClock(PowerProfile p) {
+    p.idleCpuMHz = p.cpuMHz;
+    return p;
+}
+
+inline const char* powerModeName(PowerMode mode) {
+    switch (mode) {
+        case PowerMode::PERFORMANCE: return "performance";
+        case PowerMode::BALANCED: return "balanced";
+        case PowerMode::SAVER: return "saver";
+    }
+    return "unknown";
+}
+
+inline bool parsePowerMode(const char* name, PowerMode& mode) {
+    for (uint8_t i = 0; i <= (uint8_t)PowerMode::SAVER; i++) {
+        if (strcmp(name, powerModeName((PowerMode)i)) == 0) {
+            mode = (PowerMode)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Milliseconds between radio wakes for a profile: every DTIM beacon with
+// MIN modem sleep, every listenInterval beacons with MAX
+inline uint32_t radioWakeIntervalMs(const PowerProfile& p, uint32_t beaconIntervalMs, uint8_t dtimPeriod) {
+    if (p.modemSleep == ModemSleep::MAX) return beaconIntervalMs * p.listenInterval;
+    return beaconIntervalMs * dtimPeriod;
+}
+
+// Predicts when the radio is awake anyway so sends can ride along instead
+// of waking it separately. The phase comes from an anchor, a moment the
+// radio is known to have just woken for a beacon (downlink traffic for a
+// sleeping station is delivered right after the DTIM beacon).
+class DtimSchedule {
+private:
+    uint32_t intervalMs;
+    uint32_t anchorMs;
+    uint32_t guardMs;
+    bool anchored;
+
+public:
+    DtimSchedule(uint32_t anIntervalMs = 102, uint32_t aGuardMs = 2)
+        : intervalMs(anIntervalMs ? anIntervalMs : 1), anchorMs(0), guardMs(aGuardMs), anchored(false) {}
+
+    void setInterval(uint32_t ms) { intervalMs = ms ? ms : 1; }
+    uint32_t getInterval() const { return intervalMs; }
+
+    void anchor(uint32_t beaconMs) {
+        anchorMs = beaconMs;
+        anchored = true;
+    }
+    bool isAnchored() const { return anchored; }
+
+    // First wake at or after `now`, `everyWakes` wakes apart, plus a small
+    // guard so the send lands inside the wake rather than just before it.
+    // Without an anchor the grid starts at `now`.
+    uint32_t nextSlot(uint32_t now, uint8_t everyWakes = 1) const {
+        uint32_t step = intervalMs * (everyWakes ? everyWakes : 1);
+        uint32_t base = anchored ? anchorMs + guardMs : now;
+        uint32_t elapsed = now - base;
+        if ((int32_t)elapsed <= 0) return base;
+        uint32_t k = (elapsed + step - 1) / step;
+        return base + k * step;
+    }
+};
+
+#endif // POWER_POLICY_H
@@ -2,6 +2,10 @@
 #define PROCESS_H
 
 #include "Arduino.h"
+#include "config.h"
+#if PROCESS_PROFILING
+#include "LatencyHistogram.h"
+#endif
 
 class ProcessManager; // Forward declaration
 
@@ -10,8 +14,15 @@ class Process {
 protected:
     bool isRunning = true;
     ProcessManager* processManager = nullptr;
+    String name;                // as registered with the ProcessManager
+    uint32_t period = 0;        // Scheduling period in ms (0 = every loop pass)
+    uint32_t nextWakeAt = 0;    // millis() value at which update() is next due
 
 public:
+#if PROCESS_PROFILING
+    LatencyHistogram profile;   // update() duration in CPU cycles
+#endif
+
     virtual ~Process() {}
     virtual void setup() { }
     virtual void update() = 0;
@@ -23,6 +34,17 @@ public:
     void halt() { isRunning = false; }
     void start() { isRunning = true; }
     
+    // Scheduling: declare a fixed period, or call wakeAt() from update()
+    // to pick the next wake time explicitly
+    uint32_t getPeriod() const { return period; }
+    void setPeriod(uint32_t ms) { period = ms; }
+    uint32_t getNextWakeAt() const { return nextWakeAt; }
+    void wakeAt(uint32_t at) { nextWakeAt = at; }
+    
+    // Name under which the ProcessManager knows this process
+    void setName(const String& aName) { name = aName; }
+    const char* getName() const { return name.c_str(); }
+    
     // ProcessManager reference
     void setProcessManager(ProcessManager* manager) { processManager = manager; }
     ProcessManager* getProcessManager() const { return processManager; }
@@ -3,11 +3,45 @@
 
 #include "Arduino.h"
 #include "Process.h"
+#include "Scheduler.h"
+#include "ProcessTask.h"
+#include "StallWatchdog.h"
+#include "config.h"
 #include <map>
+#if PROCESS_PROFILING
+#include <ArduinoJson.h>
+#include "LatencyHistogram.h"
+#endif
+
+// Watches each update() in the loop for stalls and, with profiling on,
+// times it with the CPU cycle counter
+struct ProcessSchedulerProbe {
+    static uint32_t begin(Process* process) {
+        stallWatchdog.enter(STALL_LANE_LOOP, process->getName(), WATCHDOG_BUDGET_MS, millis());
+#if PROCESS_PROFILING
+        return ESP.getCycleCount();
+#else
+        return 0;
+#endif
+    }
+    static void end(Process* process, uint32_t start) {
+#if PROCESS_PROFILING
+        process->profile.record(ESP.getCycleCount() - start);
+#endif
+        stallWatchdog.exit(STALL_LANE_LOOP, millis());
+    }
+};
 
 class ProcessManager {
 private:
     std::map<String, Process*> processes;
+    DeadlineScheduler<Process, MAX_PROCESSES, ProcessSchedulerProbe> scheduler;
+    ProcessTask tasks[MAX_PROCESS_TASKS];
+#if PROCESS_PROFILING
+    LatencyHistogram loopPeriod;    // cycles between successive updateProcesses() calls
+    uint32_t lastLoopCycles = 0;
+    uint32_t statsSinceMs = 0;
+#endif
 
 public:
     ProcessManager() {}
@@ -24,7 +58,12 @@ public:
     void addProcess(const String& name, Process* process) {
         if (process) {
             process->setProcessManager(this);
+            process->setName(name);
             processes[name] = process;
+            if (!scheduler.add(process)) {
+                Serial.print("ProcessManager: scheduler full, not scheduling ");
+                Serial.println(name);
+            }
         }
     }
     
@@ -60,20 +99,101 @@ public:
         }
     }
     
-    // Update all running processes
+    // Update the running processes that are due, in deadline order
     void updateProcesses() {
+#if PROCESS_PROFILING
+        uint32_t now = ESP.getCycleCount();
+        if (lastLoopCycles != 0) {
+            loopPeriod.record(now - lastLoopCycles);
+        }
+        lastLoopCycles = now;
+#endif
+        scheduler.runDue(millis());
+    }
+    
+    // Sleep until the next process deadline (bounded by LOOP_MAX_IDLE_MS).
+    // delay() blocks in vTaskDelay, so the idle task runs and the CPU can
+    // enter light sleep instead of spinning through loop().
+    void idleUntilNextDeadline() {
+        uint32_t wait = scheduler.timeUntilNextDeadline(millis(), LOOP_MAX_IDLE_MS);
+        if (wait > 0) {
+            delay(wait);
+        }
+    }
+    
+    // Number of loop passes that found work, and total process updates
+    uint32_t getWakeups() const { return scheduler.getWakeups(); }
+    uint32_t getUpdateCount() const { return scheduler.getRuns(); }
+    
+#if PROCESS_PROFILING
+    // Per-process update() timing and loop period jitter as JSON (times in us)
+    String getStatsJSON(const String& deviceId) {
+        uint32_t cyclesPerUs = ESP.getCpuFreqMHz();
+        uint64_t elapsedCycles = (uint64_t)(millis() - statsSinceMs) * 1000 * cyclesPerUs;
+        JsonDocument doc;
+        doc["type"] = "stats";
+        doc["id"] = deviceId;
+        doc["cpuMHz"] = cyclesPerUs;
+        doc["wakeups"] = scheduler.getWakeups();
+        
+        JsonObject loop = doc["loop"].to<JsonObject>();
+        addHistogram(loop, loopPeriod, cyclesPerUs, 0);
+        // Spread between typical and worst-case loop periods
+        loop["jitterUs"] = (loopPeriod.percentile(99) - loopPeriod.percentile(50)) / cyclesPerUs;
+        
+        JsonObject procs = doc["processes"].to<JsonObject>();
         for (auto& entry : processes) {
-            if (entry.second->isProcessRunning()) {
-                entry.second->update();
-            }
+            JsonObject proc = procs[entry.first].to<JsonObject>();
+            addHistogram(proc, entry.second->profile, cyclesPerUs, elapsedCycles);
         }
+        
+        String output;
+        serializeJson(doc, output);
+        return output;
     }
     
-    // Setup all processes
+    void resetStats() {
+        loopPeriod.reset();
+        lastLoopCycles = 0;
+        statsSinceMs = millis();
+        for (auto& entry : processes) {
+            entry.second->profile.reset();
+        }
+    }
+#endif
+    
+    // Setup all processes; each becomes due one period after setup
     void setupProcesses() {
         for (auto& entry : processes) {
             entry.second->setup();
         }
+        uint32_t now = millis();
+        for (auto& entry : processes) {
+            entry.second->wakeAt(now + entry.second->getPeriod());
+        }
+    }
+    
+    // Move a process out of the cooperative loop into its own FreeRTOS task.
+    // Call after setupProcesses(); the task runs at the process period.
+    bool runInTask(const String& name, uint32_t stackSize, UBaseType_t priority) {
+        Process* process = getProcess(name);
+        if (!process) return false;
+        for (size_t i = 0; i < MAX_PROCESS_TASKS; i++) {
+            ProcessTask& task = tasks[i];
+            if (task.isStarted()) continue;
+            scheduler.remove(process);
+            if (task.start(process, name.c_str(), stackSize, priority, STALL_LANE_LOOP + 1 + i)) {
+                Serial.print("Process running in own task: ");
+                Serial.println(name);
+                return true;
+            }
+            // Could not create the task; keep it in the loop
+            scheduler.add(process);
+            break;
+        }
+        Serial.print("Failed to start task for process: ");
+        Serial.println(name);
+        return false;
     }
     
     // Get a process by name
@@ -91,6 +211,20 @@ public:
     bool hasProcess(const String& name) {
         return processes.find(name) != processes.end();
     }
+
+private:
+#if PROCESS_PROFILING
+    static void addHistogram(JsonObject& out, const LatencyHistogram& histogram, uint32_t cyclesPerUs, uint64_t elapsedCycles) {
+        out["count"] = histogram.getCount();
+        out["meanUs"] = histogram.getMean() / cyclesPerUs;
+        out["maxUs"] = histogram.getMax() / cyclesPerUs;
+        out["p99Us"] = histogram.percentile(99) / cyclesPerUs;
+        if (elapsedCycles > 0) {
+            // Share of wall-clock time spent here, in tenths of a percent
+            out["loadPermille"] = (uint32_t)(histogram.getTotal() * 1000 / elapsedCycles);
+        }
+    }
+#endif
 };
 
 #endif // PROCESS_MANAGER_H
@@ -0,0 +1,59 @@
+#ifndef PROCESS_TASK_H
+#define PROCESS_TASK_H
+
+#include "Arduino.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "Process.h"
+#include "StallWatchdog.h"
+
+// Runs a single Process in its own FreeRTOS task at the process period.
+// vTaskDelayUntil keeps the cadence fixed no matter how long loop() blocks
+// on the network.
+class ProcessTask {
+private:
+    Process* process;
+    uint32_t periodMs;
+    uint8_t lane;               // stall watchdog lane
+    TaskHandle_t handle;
+
+    static void run(void* arg) {
+        ProcessTask* self = static_cast<ProcessTask*>(arg);
+        TickType_t lastWake = xTaskGetTickCount();
+        for (;;) {
+            if (self->process->isProcessRunning()) {
+                stallWatchdog.enter(self->lane, self->process->getName(), WATCHDOG_BUDGET_MS, millis());
+#if PROCESS_PROFILING
+                uint32_t start = ESP.getCycleCount();
+                self->process->update();
+                self->process->profile.record(ESP.getCycleCount() - start);
+#else
+                self->process->update();
+#endif
+                stallWatchdog.exit(self->lane, millis());
+            }
+            vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(self->periodMs));
+        }
+    }
+
+public:
+    ProcessTask() : process(nullptr), periodMs(0), lane(0), handle(nullptr) {}
+
+    bool start(Process* aProcess, const char* name, uint32_t stackSize, UBaseType_t priority, uint8_t aLane) {
+        if (!aProcess || handle) return false;
+        process = aProcess;
+        lane = aLane;
+        periodMs = process->getPeriod() > 0 ? process->getPeriod() : 1;
+        return xTaskCreate(run, name, stackSize, this, priority, &handle) == pdPASS;
+    }
+
+    bool isStarted() const { return handle != nullptr; }
+    Process* getProcess() const { return process; }
+
+    // Smallest amount of stack (in bytes) that has remained free so far
+    uint32_t getStackHighWaterMark() const {
+        return handle ? uxTaskGetStackHighWaterMark(handle) : 0;
+    }
+};
+
+#endif // PROCESS_TASK_H
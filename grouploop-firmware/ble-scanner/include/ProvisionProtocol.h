@@ -0,0 +1,334 @@
+#ifndef PROVISION_PROTOCOL_H
+#define PROVISION_PROTOCOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// Framed provisioning over the USB serial port, for pushing settings to a
+// batch of wristbands from a host tool (tools/provision) without the
+// boot-button JSON mode and without a reboot.
+//
+// Frame:
+//
+//   u8  sync               0xA5 0x5A
+//   u8  type
+//   u8  seq                echoed in the reply
+//   u16 length             payload bytes, little-endian
+//   payload
+//   u16 crc                CRC-16/CCITT-FALSE of type..payload, little-endian
+//
+// The log text the firmware prints on the same port is skipped while
+// looking for the sync bytes, and a frame that stops arriving for the
+// timeout is dropped, so a host can always start over.
+//
+// Exchanges (the host waits for the reply and resends the same frame,
+// same seq, if none comes):
+//
+//   HELLO  (no payload)          -> INFO  u8 protocol version
+//                                         u8 number of settings
+//                                         u8 mac[6]
+//                                         the deviceLabel setting
+//   CONFIG (ConfigPatch bytes)   -> ACK   u8 status (ProvisionStatus)
+//                                         u32 settings changed, bit per Setting
+//                                         u8 flags (PROVISION_ACK_*)
+//                                         error text unless status is OK
+//
+// CONFIG carries any settings in one frame: server, beacon addresses and
+// the device label are all ConfigPatch records. It is applied all or
+// nothing and written to NVS before the ACK. A CONFIG with the seq of the
+// previous one is answered from the saved reply instead of applied again;
+// HELLO starts a new session.
+
+enum ProvisionFrameType : uint8_t {
+    PROVISION_HELLO = 0x01,
+    PROVISION_CONFIG = 0x02,
+    PROVISION_INFO = 0x81,
+    PROVISION_ACK = 0x82
+};
+
+enum ProvisionStatus : uint8_t {
+    PROVISION_OK = 0,
+    PROVISION_BAD_PATCH = 1,     // ConfigPatch framing
+    PROVISION_BAD_VALUE = 2,     // unknown setting or wrong value type
+    PROVISION_NOT_SAVED = 3,     // applied, but NVS could not be opened
+    PROVISION_UNSUPPORTED = 4    // unknown frame type
+};
+
+enum ProvisionAckFlags : uint8_t {
+    PROVISION_ACK_RESTART = 1 << 0,  // the device restarts to apply pins
+    PROVISION_ACK_SAVED = 1 << 1     // everything is in NVS
+};
+
+static const uint8_t PROVISION_VERSION = 1;
+static const uint8_t PROVISION_SYNC_1 = 0xA5;
+static const uint8_t PROVISION_SYNC_2 = 0x5A;
+static const size_t PROVISION_HEADER_BYTES = 6;
+static const size_t PROVISION_OVERHEAD = PROVISION_HEADER_BYTES + 2;
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF); "123456789" is 0x29B1
+inline uint16_t provisionCrc16(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF) {
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// Writes one frame to `out`; its size, or 0 if it does not fit
+inline size_t provisionEncode(uint8_t type, uint8_t seq, const uint8_t* payload, size_t length,
+                              uint8_t* out, size_t capacity) {
+    if (length > 0xFFFF || capacity < length + PROVISION_OVERHEAD) return 0;
+    out[0] = PROVISION_SYNC_1;
+    out[1] = PROVISION_SYNC_2;
+    out[2] = type;
+    out[3] = seq;
+    out[4] = (uint8_t)(length & 0xFF);
+    out[5] = (uint8_t)(length >> 8);
+    if (length) memcpy(out + PROVISION_HEADER_BYTES, payload, length);
+    uint16_t crc = provisionCrc16(out + 2, length + 4);
+    out[PROVISION_HEADER_BYTES + length] = (uint8_t)(crc & 0xFF);
+    out[PROVISION_HEADER_BYTES + length + 1] = (uint8_t)(crc >> 8);
+    return length + PROVISION_OVERHEAD;
+}
+
+// Finds frames in a byte stream, one byte at a time; nothing is buffered
+// beyond MaxPayload
+template <size_t MaxPayload>
+class BasicProvisionDecoder {
+public:
+    enum Result : uint8_t {
+        TEXT,   // not part of a frame
+        BUSY,   // taken by a frame in progress (or a rejected one)
+        FRAME   // completed a valid frame
+    };
+
+    struct Stats {
+        uint32_t frames;
+        uint32_t crcErrors;
+        uint32_t oversize;
+        uint32_t timeouts;
+    };
+
+    explicit BasicProvisionDecoder(uint32_t timeoutMs)
+        : timeout(timeoutMs), state(SYNC_1), frameType(0), frameSeq(0), length(0), received(0), crc(0),
+          lastByteAt(0), stats() {}
+
+    Result feed(uint8_t byte, uint32_t now) {
+        if (state != SYNC_1 && now - lastByteAt > timeout) {
+            stats.timeouts++;
+            state = SYNC_1;
+        }
+        lastByteAt = now;
+
+        switch (state) {
+        case SYNC_1:
+            if (byte != PROVISION_SYNC_1) return TEXT;
+            state = SYNC_2;
+            return BUSY;
+        case SYNC_2:
+            // A5 A5 5A still starts a frame
+            if (byte == PROVISION_SYNC_2) state = TYPE;
+            else if (byte != PROVISION_SYNC_1) state = SYNC_1;
+            return BUSY;
+        case TYPE:
+            frameType = byte;
+            state = SEQ;
+            return BUSY;
+        case SEQ:
+            frameSeq = byte;
+            state = LENGTH_LOW;
+            return BUSY;
+        case LENGTH_LOW:
+            length = byte;
+            state = LENGTH_HIGH;
+            return BUSY;
+        case LENGTH_HIGH:
+            length |= (size_t)byte << 8;
+            if (length > MaxPayload) {
+                stats.oversize++;
+                state = SYNC_1;
+                return BUSY;
+            }
+            received = 0;
+            state = length ? PAYLOAD : CRC_LOW;
+            return BUSY;
+        case PAYLOAD:
+            buffer[received++] = byte;
+            if (received == length) state = CRC_LOW;
+            return BUSY;
+        case CRC_LOW:
+            crc = byte;
+            state = CRC_HIGH;
+            return BUSY;
+        case CRC_HIGH:
+            crc |= (uint16_t)byte << 8;
+            state = SYNC_1;
+            if (crc != frameCrc()) {
+                stats.crcErrors++;
+                return BUSY;
+            }
+            stats.frames++;
+            return FRAME;
+        }
+        return TEXT;
+    }
+
+    // Whether the next byte continues a frame
+    bool inFrame() const { return state != SYNC_1; }
+
+    // The frame feed() just returned FRAME for
+    uint8_t type() const { return frameType; }
+    uint8_t seq() const { return frameSeq; }
+    const uint8_t* payload() const { return buffer; }
+    size_t size() const { return length; }
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    enum State : uint8_t { SYNC_1, SYNC_2, TYPE, SEQ, LENGTH_LOW, LENGTH_HIGH, PAYLOAD, CRC_LOW, CRC_HIGH };
+
+    uint32_t timeout;
+    State state;
+    uint8_t frameType;
+    uint8_t frameSeq;
+    size_t length;
+    size_t received;
+    uint16_t crc;
+    uint32_t lastByteAt;
+    Stats stats;
+    uint8_t buffer[MaxPayload ? MaxPayload : 1];
+
+    uint16_t frameCrc() const {
+        uint8_t header[4] = { frameType, frameSeq, (uint8_t)(length & 0xFF), (uint8_t)(length >> 8) };
+        return provisionCrc16(buffer, length, provisionCrc16(header, sizeof(header)));
+    }
+};
+
+// What a HELLO reports
+struct ProvisionInfo {
+    uint8_t settings;
+    uint8_t mac[6];
+    const char* label;
+};
+
+// The outcome of a CONFIG
+struct ProvisionAck {
+    uint8_t status;
+    uint32_t changed;
+    uint8_t flags;
+    const char* error;
+};
+
+// The device the server provisions
+class ProvisionTarget {
+public:
+    virtual ~ProvisionTarget() {}
+    virtual void identify(ProvisionInfo& info) = 0;
+    // Apply a ConfigPatch, all or nothing, and save it
+    virtual void apply(const uint8_t* patch, size_t length, ProvisionAck& ack) = 0;
+};
+
+// Device side: turns frames into calls on the target and encodes the reply
+template <size_t MaxPayload>
+class BasicProvisionServer {
+public:
+    typedef BasicProvisionDecoder<MaxPayload> Decoder;
+
+    // Room for the label and error texts in a reply
+    static const size_t MAX_REPLY_PAYLOAD = 64;
+
+    BasicProvisionServer(ProvisionTarget& aTarget, uint32_t timeoutMs)
+        : target(aTarget), decoder(timeoutMs), replyLength(0), lastConfigSeq(0), haveLastConfig(false),
+          duplicates(0) {}
+
+    // Feed one received byte; on FRAME there is a reply to send
+    typename Decoder::Result feed(uint8_t byte, uint32_t now) {
+        typename Decoder::Result result = decoder.feed(byte, now);
+        if (result == Decoder::FRAME) handle();
+        return result;
+    }
+
+    const uint8_t* reply() const { return replyFrame; }
+    size_t getReplyLength() const { return replyLength; }
+
+    bool inFrame() const { return decoder.inFrame(); }
+    const typename Decoder::Stats& getStats() const { return decoder.getStats(); }
+    uint32_t getDuplicates() const { return duplicates; }
+
+private:
+    ProvisionTarget& target;
+    Decoder decoder;
+    uint8_t replyFrame[MAX_REPLY_PAYLOAD + PROVISION_OVERHEAD];
+    size_t replyLength;
+    uint8_t lastConfigSeq;
+    bool haveLastConfig;
+    uint32_t duplicates;
+
+    void handle() {
+        uint8_t payload[MAX_REPLY_PAYLOAD];
+        switch (decoder.type()) {
+        case PROVISION_HELLO: {
+            haveLastConfig = false;
+            ProvisionInfo info = {};
+            info.label = "";
+            target.identify(info);
+            payload[0] = PROVISION_VERSION;
+            payload[1] = info.settings;
+            memcpy(payload + 2, info.mac, sizeof(info.mac));
+            size_t length = 8 + copyText(info.label, payload + 8, sizeof(payload) - 8);
+            send(PROVISION_INFO, payload, length);
+            return;
+        }
+        case PROVISION_CONFIG: {
+            if (haveLastConfig && decoder.seq() == lastConfigSeq) {
+                // Our ACK got lost and the host resent the frame; the ACK
+                // is still in replyFrame
+                duplicates++;
+                return;
+            }
+            ProvisionAck ack = {};
+            target.apply(decoder.payload(), decoder.size(), ack);
+            send(PROVISION_ACK, payload, writeAck(ack, payload));
+            lastConfigSeq = decoder.seq();
+            haveLastConfig = true;
+            return;
+        }
+        default: {
+            haveLastConfig = false;
+            ProvisionAck ack = { PROVISION_UNSUPPORTED, 0, 0, "unsupported frame type" };
+            send(PROVISION_ACK, payload, writeAck(ack, payload));
+            return;
+        }
+        }
+    }
+
+    static size_t writeAck(const ProvisionAck& ack, uint8_t* payload) {
+        payload[0] = ack.status;
+        for (int i = 0; i < 4; i++) payload[1 + i] = (uint8_t)(ack.changed >> (8 * i));
+        payload[5] = ack.flags;
+        if (ack.status == PROVISION_OK || !ack.error) return 6;
+        return 6 + copyText(ack.error, payload + 6, MAX_REPLY_PAYLOAD - 6);
+    }
+
+    static size_t copyText(const char* text, uint8_t* out, size_t capacity) {
+        size_t length = text ? strlen(text) : 0;
+        if (length > capacity) length = capacity;
+        if (length) memcpy(out, text, length);
+        return length;
+    }
+
+    void send(uint8_t type, const uint8_t* payload, size_t length) {
+        replyLength = provisionEncode(type, decoder.seq(), payload, length, replyFrame, sizeof(replyFrame));
+    }
+};
+
+#if defined(ARDUINO)
+#include "config.h"
+
+typedef BasicProvisionServer<PROVISION_MAX_PAYLOAD> ProvisionServer;
+#endif
+
+#endif // PROVISION_PROTOCOL_H
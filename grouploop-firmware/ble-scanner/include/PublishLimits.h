@@ -0,0 +1,9 @@
+#ifndef PUBLISH_LIMITS_H
+#define PUBLISH_LIMITS_H
+
+// Bounds of the publishIntervalMs setting. Plain defines with no Arduino
+// dependency, so config.h and ConfigSchema.h (host tests, tools) share them.
+#define PUBLISH_MIN_INTERVAL_MS 10
+#define PUBLISH_MAX_INTERVAL_MS 10000
+
+#endif // PUBLISH_LIMITS_H
@@ -0,0 +1,442 @@
+#ifndef REACTION_VM_H
+#define REACTION_VM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "LedMath.h"
+
+// Small stack machine for reactions the server uploads (`vm:<hex>`), so a
+// tap, a tilt or a beacon can light the LEDs without a network round trip.
+//
+// The program runs from the start once per tick, until HALT or until it
+// has used its instruction budget. Values are int32. Registers keep their
+// value from tick to tick; the stack starts empty each tick. Everything a
+// program can reach is checked: jump targets and operands when it is
+// loaded, the stack while it runs. A fault unloads the program, it never
+// touches memory outside the VM.
+//
+// Binary format (hex-encoded in `vm:<hex>`): u8 version (1), then code.
+// Immediates are little-endian; jumps are absolute code offsets.
+//
+//   00 HALT                    10 ADD  11 SUB  12 MUL  13 DIV  14 MOD
+//   01 PUSH8 i8                15 NEG  16 ABS  17 MIN  18 MAX
+//   02 PUSH16 i16              19 AND  1A OR   1B XOR  1C SHL  1D SHR
+//   03 PUSH32 i32              1E NOT (logical)
+//   04 DUP   05 DROP           20 EQ   21 LT   22 GT
+//   06 SWAP  07 OVER           23 CLAMP  x lo hi -> x within [lo, hi]
+//                              24 SIN    turn/65536 -> 0..255 (trough at 0)
+//   30 JMP u16                 25 RGB    r g b -> 0xRRGGBB
+//   31 JZ u16  (pops)
+//   32 JNZ u16 (pops)          40 LOAD r   41 STORE r
+//                              50 IN id    51 OUT id
+//
+// Binary operators take the top of the stack as their right-hand side:
+// `PUSH8 7, PUSH8 2, SUB` leaves 5.
+
+enum class VmOp : uint8_t {
+    HALT = 0x00, PUSH8 = 0x01, PUSH16 = 0x02, PUSH32 = 0x03,
+    DUP = 0x04, DROP = 0x05, SWAP = 0x06, OVER = 0x07,
+    ADD = 0x10, SUB = 0x11, MUL = 0x12, DIV = 0x13, MOD = 0x14,
+    NEG = 0x15, ABS = 0x16, MIN = 0x17, MAX = 0x18,
+    AND = 0x19, OR = 0x1A, XOR = 0x1B, SHL = 0x1C, SHR = 0x1D, NOT = 0x1E,
+    EQ = 0x20, LT = 0x21, GT = 0x22, CLAMP = 0x23, SIN = 0x24, RGB = 0x25,
+    JMP = 0x30, JZ = 0x31, JNZ = 0x32,
+    LOAD = 0x40, STORE = 0x41,
+    IN = 0x50, OUT = 0x51
+};
+
+// What IN can read
+enum class VmInput : uint8_t {
+    AX = 0, AY, AZ,         // acceleration, mg
+    MOTION,                 // |acceleration|, mg
+    TAP,                    // taps since the last tick
+    BEACON_NW, BEACON_NE, BEACON_SE, BEACON_SW,     // RSSI dBm, -128 if unseen
+    MILLIS,                 // ms since the program was loaded
+    DT,                     // ms since the last tick
+    COUNT
+};
+
+// What OUT can write
+enum class VmOutput : uint8_t {
+    LED_COLOR = 0,          // 0xRRGGBB
+    LED_LEVEL,              // 0..255: how far the color covers the LED pattern
+    VIBRATE,                // pulse of this many ms, this tick
+    COUNT
+};
+
+enum class VmStatus : uint8_t {
+    IDLE,           // no program
+    HALTED,         // ran to HALT this tick
+    OUT_OF_BUDGET,  // cut off; starts over next tick
+    FAULT           // stopped and unloaded, see getError()
+};
+
+struct VmInputs {
+    int32_t values[(size_t)VmInput::COUNT];
+
+    VmInputs() { memset(values, 0, sizeof(values)); }
+    int32_t& operator[](VmInput input) { return values[(size_t)input]; }
+};
+
+struct VmOutputs {
+    uint32_t ledColor;
+    uint8_t ledLevel;
+    uint16_t vibrateMs;
+    uint8_t written;        // bit per VmOutput written this tick
+
+    VmOutputs() : ledColor(0), ledLevel(0), vibrateMs(0), written(0) {}
+    bool wrote(VmOutput output) const { return written & (1u << (uint8_t)output); }
+};
+
+struct VmStats {
+    uint32_t ticks;
+    uint32_t outOfBudget;
+    uint16_t lastInstructions;
+    uint16_t maxInstructions;
+};
+
+template <size_t CodeSize, size_t StackSize, size_t Registers>
+class BasicReactionVm {
+public:
+    static constexpr uint8_t VERSION = 1;
+
+    explicit BasicReactionVm(uint16_t budget) : budget(budget) { unload(); }
+
+    void unload() {
+        codeLength = 0;
+        error = nullptr;
+        faultPc = 0;
+        memset(registers, 0, sizeof(registers));
+        memset(&stats, 0, sizeof(stats));
+    }
+
+    bool load(const uint8_t* data, size_t length) {
+        unload();
+        if (length < 1 || data[0] != VERSION) return fail(length < 1 ? "empty program" : "unsupported version");
+        if (length - 1 > CodeSize) return fail("program too large");
+        memcpy(code, data + 1, length - 1);
+        return verify(length - 1);
+    }
+
+    // Same format as load(), two hex digits per byte
+    bool loadHex(const char* hex) {
+        unload();
+        size_t digits = hex ? strlen(hex) : 0;
+        if (digits % 2) return fail("odd number of hex digits");
+        if (digits < 2) return fail("empty program");
+        if (digits / 2 - 1 > CodeSize) return fail("program too large");
+        uint8_t version = 0;
+        for (size_t i = 0; i < digits / 2; i++) {
+            int hi = hexDigit(hex[2 * i]);
+            int lo = hexDigit(hex[2 * i + 1]);
+            if (hi < 0 || lo < 0) return fail("invalid hex digit");
+            uint8_t byte = (uint8_t)((hi << 4) | lo);
+            if (i == 0) version = byte;
+            else code[i - 1] = byte;
+        }
+        if (version != VERSION) return fail("unsupported version");
+        return verify(digits / 2 - 1);
+    }
+
+    bool isLoaded() const { return codeLength > 0; }
+    const char* getError() const { return error; }
+    uint16_t getFaultPc() const { return faultPc; }
+    uint16_t getCodeLength() const { return codeLength; }
+    uint16_t getBudget() const { return budget; }
+    const VmStats& getStats() const { return stats; }
+    int32_t getRegister(size_t index) const { return index < Registers ? registers[index] : 0; }
+
+    // One tick: runs the program from the start. Outputs it writes are set
+    // in `outputs` and flagged in `outputs.written`; the rest keep their value.
+    VmStatus run(const VmInputs& inputs, VmOutputs& outputs) {
+        outputs.written = 0;
+        outputs.vibrateMs = 0;
+        if (!isLoaded()) return VmStatus::IDLE;
+
+        int32_t stack[StackSize];
+        size_t sp = 0;
+        uint16_t pc = 0;
+        uint16_t executed = 0;
+        stats.ticks++;
+
+#define VM_NEED(n) do { if (sp < (n)) return fault(at, "stack underflow"); } while (0)
+#define VM_ROOM(n) do { if (sp + (n) > StackSize) return fault(at, "stack overflow"); } while (0)
+        for (;;) {
+            if (executed >= budget) {
+                stats.outOfBudget++;
+                finishTick(executed);
+                return VmStatus::OUT_OF_BUDGET;
+            }
+            executed++;
+            uint16_t at = pc;
+            VmOp op = (VmOp)code[pc++];
+            switch (op) {
+                case VmOp::HALT:
+                    finishTick(executed);
+                    return VmStatus::HALTED;
+                case VmOp::PUSH8:
+                    VM_ROOM(1);
+                    stack[sp++] = (int8_t)code[pc];
+                    pc += 1;
+                    break;
+                case VmOp::PUSH16:
+                    VM_ROOM(1);
+                    stack[sp++] = (int16_t)read16(pc);
+                    pc += 2;
+                    break;
+                case VmOp::PUSH32:
+                    VM_ROOM(1);
+                    stack[sp++] = (int32_t)(read16(pc) | ((uint32_t)read16(pc + 2) << 16));
+                    pc += 4;
+                    break;
+                case VmOp::DUP:
+                    VM_NEED(1); VM_ROOM(1);
+                    stack[sp] = stack[sp - 1];
+                    sp++;
+                    break;
+                case VmOp::DROP:
+                    VM_NEED(1);
+                    sp--;
+                    break;
+                case VmOp::SWAP: {
+                    VM_NEED(2);
+                    int32_t top = stack[sp - 1];
+                    stack[sp - 1] = stack[sp - 2];
+                    stack[sp - 2] = top;
+                    break;
+                }
+                case VmOp::OVER:
+                    VM_NEED(2); VM_ROOM(1);
+                    stack[sp] = stack[sp - 2];
+                    sp++;
+                    break;
+                case VmOp::NEG:
+                    VM_NEED(1);
+                    stack[sp - 1] = (int32_t)(0u - (uint32_t)stack[sp - 1]);
+                    break;
+                case VmOp::ABS:
+                    VM_NEED(1);
+                    if (stack[sp - 1] < 0) stack[sp - 1] = (int32_t)(0u - (uint32_t)stack[sp - 1]);
+                    break;
+                case VmOp::NOT:
+                    VM_NEED(1);
+                    stack[sp - 1] = !stack[sp - 1];
+                    break;
+                case VmOp::SIN:
+                    VM_NEED(1);
+                    stack[sp - 1] = ledSin8((uint32_t)stack[sp - 1] << 16);
+                    break;
+                case VmOp::CLAMP: {
+                    VM_NEED(3);
+                    int32_t hi = stack[--sp];
+                    int32_t lo = stack[--sp];
+                    int32_t& x = stack[sp - 1];
+                    if (x > hi) x = hi;
+                    if (x < lo) x = lo;
+                    break;
+                }
+                case VmOp::RGB: {
+                    VM_NEED(3);
+                    uint32_t b = clampByte(stack[--sp]);
+                    uint32_t g = clampByte(stack[--sp]);
+                    uint32_t r = clampByte(stack[sp - 1]);
+                    stack[sp - 1] = (int32_t)((r << 16) | (g << 8) | b);
+                    break;
+                }
+                case VmOp::JMP:
+                    pc = read16(pc);
+                    break;
+                case VmOp::JZ:
+                case VmOp::JNZ: {
+                    VM_NEED(1);
+                    bool zero = stack[--sp] == 0;
+                    uint16_t target = read16(pc);
+                    pc += 2;
+                    if (zero == (op == VmOp::JZ)) pc = target;
+                    break;
+                }
+                case VmOp::LOAD:
+                    VM_ROOM(1);
+                    stack[sp++] = registers[code[pc++]];
+                    break;
+                case VmOp::STORE:
+                    VM_NEED(1);
+                    registers[code[pc++]] = stack[--sp];
+                    break;
+                case VmOp::IN:
+                    VM_ROOM(1);
+                    stack[sp++] = inputs.values[code[pc++]];
+                    break;
+                case VmOp::OUT:
+                    VM_NEED(1);
+                    write(outputs, (VmOutput)code[pc++], stack[--sp]);
+                    break;
+                default: {
+                    // Binary operators; verify() let no other opcode through
+                    VM_NEED(2);
+                    int32_t b = stack[--sp];
+                    int32_t& a = stack[sp - 1];
+                    if ((op == VmOp::DIV || op == VmOp::MOD) && b == 0) return fault(at, "division by zero");
+                    a = binary(op, a, b);
+                    break;
+                }
+            }
+        }
+#undef VM_NEED
+#undef VM_ROOM
+    }
+
+    // Bytes an instruction takes, 0 if `op` is not one
+    static uint8_t instructionSize(uint8_t op) {
+        switch ((VmOp)op) {
+            case VmOp::PUSH8: case VmOp::LOAD: case VmOp::STORE: case VmOp::IN: case VmOp::OUT:
+                return 2;
+            case VmOp::PUSH16: case VmOp::JMP: case VmOp::JZ: case VmOp::JNZ:
+                return 3;
+            case VmOp::PUSH32:
+                return 5;
+            case VmOp::HALT: case VmOp::DUP: case VmOp::DROP: case VmOp::SWAP: case VmOp::OVER:
+            case VmOp::ADD: case VmOp::SUB: case VmOp::MUL: case VmOp::DIV: case VmOp::MOD:
+            case VmOp::NEG: case VmOp::ABS: case VmOp::MIN: case VmOp::MAX:
+            case VmOp::AND: case VmOp::OR: case VmOp::XOR: case VmOp::SHL: case VmOp::SHR: case VmOp::NOT:
+            case VmOp::EQ: case VmOp::LT: case VmOp::GT: case VmOp::CLAMP: case VmOp::SIN: case VmOp::RGB:
+                return 1;
+            default:
+                return 0;
+        }
+    }
+
+private:
+    uint8_t code[CodeSize];
+    uint16_t codeLength;
+    uint16_t budget;
+    int32_t registers[Registers];
+    const char* error;
+    uint16_t faultPc;
+    VmStats stats;
+
+    bool fail(const char* message) {
+        codeLength = 0;
+        error = message;
+        return false;
+    }
+
+    VmStatus fault(uint16_t pc, const char* message) {
+        faultPc = pc;
+        codeLength = 0;
+        error = message;
+        return VmStatus::FAULT;
+    }
+
+    void finishTick(uint16_t executed) {
+        stats.lastInstructions = executed;
+        if (executed > stats.maxInstructions) stats.maxInstructions = executed;
+    }
+
+    // Everything run() trusts: whole instructions, operands in range, jumps
+    // onto instruction starts, and no way to run off the end
+    bool verify(size_t length) {
+        if (length == 0) return fail("empty program");
+        uint8_t starts[(CodeSize + 7) / 8];
+        memset(starts, 0, sizeof(starts));
+        size_t pc = 0;
+        uint8_t last = 0;
+        while (pc < length) {
+            uint8_t op = code[pc];
+            uint8_t size = instructionSize(op);
+            if (size == 0) return failAt(pc, "unknown opcode");
+            if (pc + size > length) return failAt(pc, "truncated instruction");
+            uint8_t operand = size > 1 ? code[pc + 1] : 0;
+            if ((op == (uint8_t)VmOp::LOAD || op == (uint8_t)VmOp::STORE) && operand >= Registers) {
+                return failAt(pc, "no such register");
+            }
+            if (op == (uint8_t)VmOp::IN && operand >= (uint8_t)VmInput::COUNT) return failAt(pc, "no such input");
+            if (op == (uint8_t)VmOp::OUT && operand >= (uint8_t)VmOutput::COUNT) return failAt(pc, "no such output");
+            starts[pc / 8] |= 1 << (pc % 8);
+            last = op;
+            pc += size;
+        }
+        // The last instruction must not fall through past the end
+        if (last != (uint8_t)VmOp::HALT && last != (uint8_t)VmOp::JMP) return fail("program must end in HALT or JMP");
+
+        for (pc = 0; pc < length; pc += instructionSize(code[pc])) {
+            uint8_t op = code[pc];
+            if (op != (uint8_t)VmOp::JMP && op != (uint8_t)VmOp::JZ && op != (uint8_t)VmOp::JNZ) continue;
+            uint16_t target = read16(pc + 1);
+            if (target >= length || !(starts[target / 8] & (1 << (target % 8)))) {
+                return failAt(pc, "bad jump target");
+            }
+        }
+        codeLength = (uint16_t)length;
+        return true;
+    }
+
+    bool failAt(size_t pc, const char* message) {
+        faultPc = (uint16_t)pc;
+        return fail(message);
+    }
+
+    uint16_t read16(size_t pc) const {
+        return (uint16_t)(code[pc] | (code[pc + 1] << 8));
+    }
+
+    static int hexDigit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    static uint32_t clampByte(int32_t v) {
+        return v < 0 ? 0 : (v > 255 ? 255 : (uint32_t)v);
+    }
+
+    // Wrapping two's complement, like the C++ code a program replaces
+    static int32_t binary(VmOp op, int32_t a, int32_t b) {
+        uint32_t ua = (uint32_t)a, ub = (uint32_t)b;
+        switch (op) {
+            case VmOp::ADD: return (int32_t)(ua + ub);
+            case VmOp::SUB: return (int32_t)(ua - ub);
+            case VmOp::MUL: return (int32_t)(ua * ub);
+            case VmOp::DIV: return (a == INT32_MIN && b == -1) ? a : a / b;
+            case VmOp::MOD: return (a == INT32_MIN && b == -1) ? 0 : a % b;
+            case VmOp::MIN: return a < b ? a : b;
+            case VmOp::MAX: return a > b ? a : b;
+            case VmOp::AND: return a & b;
+            case VmOp::OR: return a | b;
+            case VmOp::XOR: return a ^ b;
+            case VmOp::SHL: return (int32_t)(ua << (ub & 31));
+            case VmOp::SHR: return a >> (ub & 31);
+            case VmOp::EQ: return a == b;
+            case VmOp::LT: return a < b;
+            case VmOp::GT: return a > b;
+            default: return 0;
+        }
+    }
+
+    static void write(VmOutputs& outputs, VmOutput output, int32_t value) {
+        switch (output) {
+            case VmOutput::LED_COLOR:
+                outputs.ledColor = (uint32_t)value & 0xFFFFFF;
+                break;
+            case VmOutput::LED_LEVEL:
+                outputs.ledLevel = (uint8_t)clampByte(value);
+                break;
+            case VmOutput::VIBRATE:
+                outputs.vibrateMs = value < 0 ? 0 : (value > 0xFFFF ? 0xFFFF : (uint16_t)value);
+                break;
+            default:
+                return;
+        }
+        outputs.written |= 1u << (uint8_t)output;
+    }
+};
+
+#if defined(ARDUINO)
+#include "config.h"
+
+typedef BasicReactionVm<VM_MAX_CODE, VM_STACK_SIZE, VM_REGISTERS> ReactionVm;
+#endif
+
+#endif // REACTION_VM_H
@@ -0,0 +1,128 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Default probe: no instrumentation, compiles away entirely
+struct NullSchedulerProbe {
+    template <typename Task>
+    static uint32_t begin(Task*) { return 0; }
+    template <typename Task>
+    static void end(Task*, uint32_t) {}
+};
+
+// Deadline-ordered cooperative scheduler used by ProcessManager.
+//
+// A task is anything that provides:
+//   bool isProcessRunning() const;
+//   uint32_t getPeriod() const;        // 0 = run on every pass
+//   uint32_t getNextWakeAt() const;
+//   void wakeAt(uint32_t at);
+//   void update();
+//
+// Only tasks whose wake time has been reached are run, earliest deadline
+// first. The header has no Arduino dependency so the same code can be driven
+// by a virtual clock in host tests. Probe::begin()/end() bracket every
+// update() call, e.g. for per-process profiling or a stall watchdog.
+template <typename Task, size_t MaxTasks, typename Probe = NullSchedulerProbe>
+class DeadlineScheduler {
+private:
+    Task* tasks[MaxTasks];
+    size_t count;
+    uint32_t wakeups;   // passes that ran at least one task
+    uint32_t runs;      // total task updates
+
+public:
+    DeadlineScheduler() : count(0), wakeups(0), runs(0) {}
+
+    bool add(Task* task) {
+        if (!task || count >= MaxTasks) return false;
+        tasks[count++] = task;
+        return true;
+    }
+
+    bool remove(Task* task) {
+        for (size_t i = 0; i < count; i++) {
+            if (tasks[i] == task) {
+                tasks[i] = tasks[--count];
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Wrap-safe "has `at` been reached at time `now`"
+    static bool isDue(uint32_t at, uint32_t now) {
+        return (int32_t)(now - at) >= 0;
+    }
+
+    // Run every due task in deadline order. Returns the number of tasks run.
+    size_t runDue(uint32_t now) {
+        Task* due[MaxTasks];
+        size_t n = 0;
+
+        // Insertion sort by deadline; the task list is tiny
+        for (size_t i = 0; i < count; i++) {
+            Task* task = tasks[i];
+            if (!task->isProcessRunning() || !isDue(task->getNextWakeAt(), now)) continue;
+            size_t j = n++;
+            while (j > 0 && (int32_t)(task->getNextWakeAt() - due[j - 1]->getNextWakeAt()) < 0) {
+                due[j] = due[j - 1];
+                j--;
+            }
+            due[j] = task;
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            Task* task = due[i];
+            uint32_t scheduledAt = task->getNextWakeAt();
+            uint32_t probeToken = Probe::begin(task);
+            task->update();
+            Probe::end(task, probeToken);
+            // A task that picked its own wake time keeps it; otherwise advance by its period
+            if (task->getNextWakeAt() == scheduledAt) {
+                reschedule(task, now);
+            }
+        }
+
+        if (n > 0) wakeups++;
+        runs += n;
+        return n;
+    }
+
+    // Milliseconds until the earliest running task is due, capped at maxIdle.
+    uint32_t timeUntilNextDeadline(uint32_t now, uint32_t maxIdle) const {
+        uint32_t wait = maxIdle;
+        for (size_t i = 0; i < count; i++) {
+            const Task* task = tasks[i];
+            if (!task->isProcessRunning()) continue;
+            int32_t remaining = (int32_t)(task->getNextWakeAt() - now);
+            if (remaining <= 0) return 0;
+            if ((uint32_t)remaining < wait) wait = (uint32_t)remaining;
+        }
+        return wait;
+    }
+
+    size_t size() const { return count; }
+    uint32_t getWakeups() const { return wakeups; }
+    uint32_t getRuns() const { return runs; }
+
+private:
+    static void reschedule(Task* task, uint32_t now) {
+        uint32_t period = task->getPeriod();
+        if (period == 0) {
+            task->wakeAt(now);
+            return;
+        }
+        // Advance on the fixed grid; if we fell a whole period behind, skip the
+        // missed slots instead of running the task back-to-back to catch up.
+        uint32_t next = task->getNextWakeAt() + period;
+        if (isDue(next, now)) {
+            next = now + period;
+        }
+        task->wakeAt(next);
+    }
+};
+
+#endif // SCHEDULER_H
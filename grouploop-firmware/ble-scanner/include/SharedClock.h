@@ -0,0 +1,69 @@
+#ifndef SHARED_CLOCK_H
+#define SHARED_CLOCK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Estimates the server's millisecond clock from request/response pairs,
+// NTP style: the device notes millis() when it sends a request and when the
+// reply arrives, the server puts its own clock in the reply, and the server
+// is assumed to have read it halfway through the round trip.
+//
+// Of the last `Samples` exchanges the one with the shortest round trip wins:
+// queueing delay only ever adds to a round trip, so the fastest exchange is
+// the one whose midpoint guess is best. All times wrap with millis().
+template <size_t Samples>
+class BasicSharedClock {
+private:
+    struct Sample {
+        uint32_t offset;    // shared - local
+        uint32_t roundTrip;
+    };
+
+    Sample samples[Samples];
+    size_t count;
+    size_t next;
+    uint32_t offset;
+    uint32_t roundTrip;
+    uint32_t maxRoundTrip;
+
+public:
+    explicit BasicSharedClock(uint32_t aMaxRoundTrip = 1000)
+        : count(0), next(0), offset(0), roundTrip(0), maxRoundTrip(aMaxRoundTrip) {}
+
+    // Returns false when the exchange is unusable (reply before request, or
+    // a round trip too long to say anything about the server's clock)
+    bool addSample(uint32_t sentAt, uint32_t serverMs, uint32_t receivedAt) {
+        uint32_t rtt = receivedAt - sentAt;
+        if ((int32_t)rtt < 0 || rtt > maxRoundTrip) return false;
+
+        samples[next].offset = serverMs + rtt / 2 - receivedAt;
+        samples[next].roundTrip = rtt;
+        next = (next + 1) % Samples;
+        if (count < Samples) count++;
+
+        size_t best = 0;
+        for (size_t i = 1; i < count; i++) {
+            if (samples[i].roundTrip < samples[best].roundTrip) best = i;
+        }
+        offset = samples[best].offset;
+        roundTrip = samples[best].roundTrip;
+        return true;
+    }
+
+    void reset() {
+        count = 0;
+        next = 0;
+    }
+
+    bool isSynced() const { return count > 0; }
+    // Exchanges so far, up to Samples
+    size_t getSampleCount() const { return count; }
+    // Round trip of the sample in use; the offset is good to about half of it
+    uint32_t getRoundTrip() const { return roundTrip; }
+
+    uint32_t sharedNow(uint32_t localMs) const { return localMs + offset; }
+    uint32_t toLocal(uint32_t sharedMs) const { return sharedMs - offset; }
+};
+
+#endif // SHARED_CLOCK_H
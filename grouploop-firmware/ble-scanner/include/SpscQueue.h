@@ -0,0 +1,49 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <stddef.h>
+#include <atomic>
+
+// Bounded lock-free queue for exactly one producer and one consumer context
+// (e.g. an RTOS task feeding the network loop). Capacity must be a power of
+// two; one slot is kept free to tell "full" from "empty".
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscQueue capacity must be a power of two");
+
+private:
+    T items[Capacity];
+    std::atomic<size_t> head;   // next slot to read, owned by the consumer
+    std::atomic<size_t> tail;   // next slot to write, owned by the producer
+
+public:
+    SpscQueue() : head(0), tail(0) {}
+
+    // Producer side. Returns false (and drops the item) when full.
+    bool push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t next = (t + 1) & (Capacity - 1);
+        if (next == head.load(std::memory_order_acquire)) return false;
+        items[t] = item;
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false when empty.
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        item = items[h];
+        head.store((h + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return Capacity - 1; }
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,192 @@
+#ifndef STALL_WATCHDOG_H
+#define STALL_WATCHDOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// What the watchdog remembers about the worst stall since it was last
+// reported. Plain data so it can live in RTC memory that survives a reset
+// (RTC_NOINIT_ATTR on the device); magic and checksum tell a record left
+// by the previous boot from power-on garbage.
+struct StallRecord {
+    static constexpr uint32_t MAGIC = 0x53544C31;   // "STL1"
+    static constexpr size_t NAME_SIZE = 16;
+    static constexpr size_t COMMAND_SIZE = 24;
+
+    uint32_t magic;
+    uint32_t stalls;            // overruns since the last report
+    uint32_t durationMs;        // longest overrun
+    uint32_t budgetMs;          // the budget it overran
+    uint32_t uptimeMs;          // when that overrun was (last) seen
+    uint8_t lane;               // 0 = loop(), 1.. = process tasks
+    uint8_t inProgress;         // update() had not returned yet when last seen
+    uint8_t reserved[2];
+    char process[NAME_SIZE];
+    char command[COMMAND_SIZE]; // last command executed before the overrun
+    uint32_t checksum;
+
+    uint32_t computeChecksum() const {
+        // FNV-1a over everything before the checksum
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(this);
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < offsetof(StallRecord, checksum); i++) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    bool isValid() const {
+        return magic == MAGIC && checksum == computeChecksum();
+    }
+
+    void clear() {
+        memset(this, 0, sizeof(*this));
+        magic = MAGIC;
+        checksum = computeChecksum();
+    }
+};
+
+// Software watchdog around Process::update().
+//
+// Each execution lane (the loop and every process task) brackets its
+// update() calls with enter()/exit(). An update that takes longer than its
+// budget is recorded when it returns. A monitor calling check() from a
+// timer also records one that is still running, and keeps extending it, so
+// when a hang ends in a reset the record tells which process hung, for how
+// long and after which command. The worst stall is kept until takeReport().
+//
+// Lanes are written by their own task and read by the monitor; fields are
+// single words and a torn read at worst misattributes one sample.
+template <size_t MaxLanes>
+class BasicStallWatchdog {
+private:
+    struct Lane {
+        const char* volatile process;   // nullptr while idle
+        volatile uint32_t startedAt;
+        volatile uint32_t budgetMs;
+        volatile bool counted;          // this overrun is already in `stalls`
+    };
+
+    StallRecord& record;
+    Lane lanes[MaxLanes];
+    char lastCommand[StallRecord::COMMAND_SIZE];
+
+public:
+    explicit BasicStallWatchdog(StallRecord& aRecord) : record(aRecord) {
+        for (size_t i = 0; i < MaxLanes; i++) {
+            lanes[i].process = nullptr;
+            lanes[i].startedAt = 0;
+            lanes[i].budgetMs = 0;
+            lanes[i].counted = false;
+        }
+        lastCommand[0] = '\0';
+    }
+
+    // Call once at boot: keeps a valid record from before the reset and
+    // wipes anything else. Returns true when there is a stall to report.
+    bool begin() {
+        if (!record.isValid()) record.clear();
+        return hasReport();
+    }
+
+    void enter(uint8_t lane, const char* process, uint32_t budgetMs, uint32_t now) {
+        if (lane >= MaxLanes) return;
+        Lane& l = lanes[lane];
+        l.startedAt = now;
+        l.budgetMs = budgetMs;
+        l.counted = false;
+        l.process = process;
+    }
+
+    void exit(uint8_t lane, uint32_t now) {
+        if (lane >= MaxLanes) return;
+        Lane& l = lanes[lane];
+        const char* process = l.process;
+        if (!process) return;
+        uint32_t elapsed = now - l.startedAt;
+        if (elapsed > l.budgetMs) {
+            capture(lane, process, elapsed, now, false);
+        }
+        l.process = nullptr;
+    }
+
+    // Called periodically from a timer, outside the lanes being watched.
+    // Returns true once an update() has been running for `hangMs`, at which
+    // point the caller should reset the device; the record is up to date.
+    bool check(uint32_t now, uint32_t hangMs = 0xFFFFFFFF) {
+        bool hung = false;
+        for (uint8_t i = 0; i < MaxLanes; i++) {
+            Lane& l = lanes[i];
+            const char* process = l.process;
+            if (!process) continue;
+            uint32_t elapsed = now - l.startedAt;
+            if (elapsed > l.budgetMs) {
+                capture(i, process, elapsed, now, true);
+            }
+            if (elapsed >= hangMs) hung = true;
+        }
+        return hung;
+    }
+
+    void noteCommand(const char* command) {
+        strncpy(lastCommand, command, sizeof(lastCommand) - 1);
+        lastCommand[sizeof(lastCommand) - 1] = '\0';
+    }
+
+    bool hasReport() const { return record.isValid() && record.stalls > 0; }
+    const StallRecord& getRecord() const { return record; }
+
+    // Hand out the record and start collecting afresh
+    StallRecord takeReport() {
+        StallRecord report = record;
+        record.clear();
+        return report;
+    }
+
+    // Name of the process a lane is running right now, or nullptr
+    const char* currentProcess(uint8_t lane) const {
+        return lane < MaxLanes ? lanes[lane].process : nullptr;
+    }
+
+private:
+    void capture(uint8_t lane, const char* process, uint32_t elapsed, uint32_t now, bool inProgress) {
+        Lane& l = lanes[lane];
+        bool sameStall = l.counted && record.lane == lane && strncmp(record.process, process, StallRecord::NAME_SIZE - 1) == 0;
+        if (!l.counted) {
+            record.stalls++;
+            l.counted = true;
+        }
+        // Keep the worst one, but always follow the stall we are already in
+        if (sameStall || elapsed >= record.durationMs) {
+            record.durationMs = elapsed;
+            record.budgetMs = l.budgetMs;
+            record.uptimeMs = now;
+            record.lane = lane;
+            record.inProgress = inProgress ? 1 : 0;
+            strncpy(record.process, process, sizeof(record.process) - 1);
+            record.process[sizeof(record.process) - 1] = '\0';
+            memcpy(record.command, lastCommand, sizeof(record.command));
+        }
+        record.checksum = record.computeChecksum();
+    }
+};
+
+#if defined(ARDUINO)
+#include "Arduino.h"
+#include "config.h"
+
+typedef BasicStallWatchdog<1 + MAX_PROCESS_TASKS> StallWatchdog;
+
+// The record lives in RTC memory (see src/StallWatchdog.cpp)
+extern StallWatchdog stallWatchdog;
+
+// Validate the retained record and start the monitor timer, which resets
+// the device after WATCHDOG_HANG_MS in one update(). Call first thing in
+// setup().
+void stallWatchdogBegin();
+// The last stall and the reason for the previous reset as JSON
+String stallReportJSON(const String& deviceId, const StallRecord& report);
+#endif
+
+#endif // STALL_WATCHDOG_H
@@ -0,0 +1,307 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "LedMath.h"
+
+// Keyframe LED program, uploaded once and rendered on the device.
+//
+// Binary format, little-endian (sent hex-encoded in `timeline:<hex>`):
+//
+//   u8  version            1
+//   u8  trackCount         1..MaxTracks
+//   u16 durationMs         end of the program
+//   u16 loopStartMs        jump back here at durationMs; 0xFFFF = play once
+//                          and hold the last frame
+//   then per track:
+//     u8 target            LED index, 0xFF = every LED
+//     u8 keyCount          1..
+//     keyCount x 7 bytes:  u16 timeMs, u8 r, u8 g, u8 b, u8 brightness,
+//                          u8 easing (curve from this key to the next)
+//
+// Key times must not decrease within a track. Before its first key a track
+// holds that key, after its last key it holds the last one. Tracks are
+// applied in order, so a later track overrides an earlier one on the same
+// LED; LEDs no track targets stay dark.
+
+enum class TimelineEasing : uint8_t {
+    LINEAR = 0,
+    STEP = 1,       // hold until the next key
+    EASE_IN = 2,    // quadratic
+    EASE_OUT = 3,
+    EASE_IN_OUT = 4, // smoothstep
+    SINE = 5,       // half a cosine
+    COUNT
+};
+
+struct TimelineKey {
+    uint16_t timeMs;
+    uint8_t brightness;
+    TimelineEasing easing;
+    uint32_t color;
+};
+
+// Maps a segment fraction (Q8, 0..256) through a curve
+inline uint16_t timelineEase(TimelineEasing easing, uint16_t f) {
+    switch (easing) {
+        case TimelineEasing::STEP:
+            return f >= 256 ? 256 : 0;
+        case TimelineEasing::EASE_IN:
+            return (uint16_t)(((uint32_t)f * f) >> 8);
+        case TimelineEasing::EASE_OUT: {
+            uint32_t r = 256 - f;
+            return (uint16_t)(256 - ((r * r) >> 8));
+        }
+        case TimelineEasing::EASE_IN_OUT:
+            return (uint16_t)(((uint32_t)f * f * (768 - 2 * f)) >> 16);
+        case TimelineEasing::SINE: {
+            // (1 - cos(pi f)) / 2: the sine table from its trough, half a turn
+            uint8_t v = ledSin8(0xC0000000u + ((uint32_t)f << 23));
+            return (uint16_t)(v + (v >> 7));
+        }
+        case TimelineEasing::LINEAR:
+        default:
+            return f;
+    }
+}
+
+template <size_t MaxTracks, size_t MaxKeys>
+class BasicTimelineProgram {
+public:
+    static const uint8_t VERSION = 1;
+    static const uint16_t NO_LOOP = 0xFFFF;
+    static const uint8_t ALL_LEDS = 0xFF;
+    static const size_t HEADER_SIZE = 6;
+    static const size_t KEY_SIZE = 7;
+
+    BasicTimelineProgram() { clear(); }
+
+    void clear() {
+        trackCount = 0;
+        keyCount = 0;
+        durationMs = 0;
+        loopStartMs = NO_LOOP;
+        error = nullptr;
+    }
+
+    bool load(const uint8_t* data, size_t length) {
+        Reader reader(data, nullptr, length);
+        return parse(reader);
+    }
+
+    // Same format as load(), hex-encoded (two characters per byte)
+    bool loadHex(const char* hex) {
+        size_t length = hex ? strlen(hex) : 0;
+        if (length % 2) {
+            clear();
+            error = "odd number of hex digits";
+            return false;
+        }
+        Reader reader(nullptr, hex, length / 2);
+        return parse(reader);
+    }
+
+    bool isLoaded() const { return trackCount > 0; }
+    const char* getError() const { return error; }
+    uint8_t getTrackCount() const { return trackCount; }
+    uint16_t getKeyCount() const { return keyCount; }
+    uint16_t getDurationMs() const { return durationMs; }
+    bool loops() const { return loopStartMs != NO_LOOP; }
+
+    // Program time for time since start, following the loop
+    uint32_t localTime(uint32_t elapsedMs) const {
+        if (elapsedMs < durationMs) return elapsedMs;
+        if (!loops()) return durationMs;
+        uint32_t span = durationMs - loopStartMs;
+        return loopStartMs + (elapsedMs - durationMs) % span;
+    }
+
+    bool finished(uint32_t elapsedMs) const {
+        return !loops() && elapsedMs >= durationMs;
+    }
+
+    // Color (full intensity) and brightness of every LED at a program time.
+    // Tracks remember the segment they were in, so playing forward costs a
+    // comparison per track and frame rather than a search.
+    void render(uint32_t timeMs, uint32_t* colors, uint8_t* levels, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            colors[i] = 0;
+            levels[i] = 0;
+        }
+        for (uint8_t t = 0; t < trackCount; t++) {
+            uint32_t color;
+            uint8_t level;
+            sample(t, timeMs, color, level);
+            uint8_t target = tracks[t].target;
+            if (target == ALL_LEDS) {
+                for (size_t i = 0; i < count; i++) {
+                    colors[i] = color;
+                    levels[i] = level;
+                }
+            } else if (target < count) {
+                colors[target] = color;
+                levels[target] = level;
+            }
+        }
+    }
+
+private:
+    struct Track {
+        uint8_t target;
+        uint16_t firstKey;
+        uint16_t keyCount;
+        uint16_t cursor;    // index within the track of the segment's start key
+    };
+
+    // Bytes from a buffer or from hex text
+    struct Reader {
+        const uint8_t* bytes;
+        const char* hex;
+        size_t length;
+        size_t position;
+        bool bad;
+
+        Reader(const uint8_t* someBytes, const char* someHex, size_t aLength)
+            : bytes(someBytes), hex(someHex), length(aLength), position(0), bad(false) {}
+
+        bool u8(uint8_t& value) {
+            if (position >= length) return false;
+            if (bytes) {
+                value = bytes[position++];
+                return true;
+            }
+            int hi = digit(hex[2 * position]);
+            int lo = digit(hex[2 * position + 1]);
+            position++;
+            if (hi < 0 || lo < 0) {
+                bad = true;
+                return false;
+            }
+            value = (uint8_t)((hi << 4) | lo);
+            return true;
+        }
+
+        bool u16(uint16_t& value) {
+            uint8_t lo, hi;
+            if (!u8(lo) || !u8(hi)) return false;
+            value = (uint16_t)(lo | (hi << 8));
+            return true;
+        }
+
+        static int digit(char c) {
+            if (c >= '0' && c <= '9') return c - '0';
+            if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+            if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+            return -1;
+        }
+    };
+
+    Track tracks[MaxTracks];
+    TimelineKey keys[MaxKeys];
+    uint8_t trackCount;
+    uint16_t keyCount;
+    uint16_t durationMs;
+    uint16_t loopStartMs;
+    const char* error;
+
+    bool fail(const Reader& reader, const char* message) {
+        clear();
+        error = reader.bad ? "invalid hex digit" : message;
+        return false;
+    }
+
+    bool parse(Reader& reader) {
+        clear();
+        uint8_t version, tracksInProgram;
+        uint16_t duration, loopStart;
+        if (!reader.u8(version) || !reader.u8(tracksInProgram) || !reader.u16(duration) || !reader.u16(loopStart)) {
+            return fail(reader, "truncated header");
+        }
+        if (version != VERSION) return fail(reader, "unsupported version");
+        if (tracksInProgram == 0 || tracksInProgram > MaxTracks) return fail(reader, "bad track count");
+        if (duration == 0) return fail(reader, "zero duration");
+        if (loopStart != NO_LOOP && loopStart >= duration) return fail(reader, "loop start past the end");
+
+        uint16_t keysLoaded = 0;
+        for (uint8_t t = 0; t < tracksInProgram; t++) {
+            uint8_t target, count;
+            if (!reader.u8(target) || !reader.u8(count)) return fail(reader, "truncated track");
+            if (count == 0) return fail(reader, "empty track");
+            if ((size_t)keysLoaded + count > MaxKeys) return fail(reader, "too many keys");
+            tracks[t].target = target;
+            tracks[t].firstKey = keysLoaded;
+            tracks[t].keyCount = count;
+            tracks[t].cursor = 0;
+            for (uint8_t k = 0; k < count; k++) {
+                TimelineKey& key = keys[keysLoaded + k];
+                uint8_t r, g, b, easing;
+                if (!reader.u16(key.timeMs) || !reader.u8(r) || !reader.u8(g) || !reader.u8(b) ||
+                    !reader.u8(key.brightness) || !reader.u8(easing)) {
+                    return fail(reader, "truncated key");
+                }
+                if (easing >= (uint8_t)TimelineEasing::COUNT) return fail(reader, "unknown easing");
+                if (k > 0 && key.timeMs < keys[keysLoaded + k - 1].timeMs) return fail(reader, "keys out of order");
+                key.easing = (TimelineEasing)easing;
+                key.color = ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+            }
+            keysLoaded += count;
+        }
+        if (reader.position != reader.length) return fail(reader, "trailing bytes");
+
+        trackCount = tracksInProgram;
+        keyCount = keysLoaded;
+        durationMs = duration;
+        loopStartMs = loopStart;
+        return true;
+    }
+
+    void sample(uint8_t t, uint32_t timeMs, uint32_t& color, uint8_t& level) {
+        Track& track = tracks[t];
+        const TimelineKey* k = keys + track.firstKey;
+        uint16_t last = track.keyCount - 1;
+
+        if (timeMs <= k[0].timeMs || last == 0) {
+            color = k[0].color;
+            level = k[0].brightness;
+            return;
+        }
+        if (timeMs >= k[last].timeMs) {
+            color = k[last].color;
+            level = k[last].brightness;
+            return;
+        }
+        // Find the segment [cursor, cursor + 1] holding timeMs
+        uint16_t i = track.cursor;
+        if (i >= last || k[i].timeMs > timeMs) i = 0;   // jumped back (loop)
+        while (k[i + 1].timeMs <= timeMs) i++;
+        track.cursor = i;
+
+        const TimelineKey& from = k[i];
+        const TimelineKey& to = k[i + 1];
+        uint32_t span = to.timeMs - from.timeMs;
+        uint16_t f = timelineEase(from.easing, (uint16_t)(((timeMs - from.timeMs) << 8) / span));
+        color = lerpColor(from.color, to.color, f);
+        level = (uint8_t)lerp(from.brightness, to.brightness, f);
+    }
+
+    static int32_t lerp(int32_t a, int32_t b, uint16_t f) {
+        return a + (((b - a) * (int32_t)f) >> 8);
+    }
+
+    static uint32_t lerpColor(uint32_t a, uint32_t b, uint16_t f) {
+        uint32_t r = (uint32_t)lerp((a >> 16) & 0xFF, (b >> 16) & 0xFF, f);
+        uint32_t g = (uint32_t)lerp((a >> 8) & 0xFF, (b >> 8) & 0xFF, f);
+        uint32_t bl = (uint32_t)lerp(a & 0xFF, b & 0xFF, f);
+        return (r << 16) | (g << 8) | bl;
+    }
+};
+
+#if defined(ARDUINO)
+#include "config.h"
+
+typedef BasicTimelineProgram<TIMELINE_MAX_TRACKS, TIMELINE_MAX_KEYS> TimelineProgram;
+#endif
+
+#endif // TIMELINE_H
@@ -1,47 +1,104 @@
 #ifndef TIMER_H
 #define TIMER_H
 
+#include <stdint.h>
+#if defined(ARDUINO)
 #include "Arduino.h"
+#endif
 
-struct Timer {
-    unsigned long last_update;
-    unsigned long interval;
-    unsigned long elapsed_millis;
-    unsigned long started_at;
+// What a fixed-rate timer does when it is polled late and has missed ticks
+enum class TimerCatchUp : uint8_t {
+    BURST,  // fire once per missed tick on successive checks until caught up
+    SKIP    // fire once, drop the missed ticks and stay on the original grid
+};
+
+// Interval timer over any clock that provides `static uint32_t now()`.
+//
+// The default mode restarts the interval from the moment it fires, so the
+// period stretches by however late it was polled. Fixed-rate mode advances
+// by exactly one interval per tick instead, so the long-term rate does not
+// drift no matter how jittery the caller is.
+template <typename Clock>
+struct BasicTimer {
+    uint32_t last_update;
+    uint32_t interval;
+    uint32_t elapsed_millis;
+    uint32_t started_at;
+    bool fixed_rate;
+    TimerCatchUp catch_up;
 
-    Timer(unsigned long an_interval) : interval(an_interval), last_update(0), elapsed_millis(0) {
-        started_at = millis();
+    BasicTimer(uint32_t an_interval)
+        : last_update(0), interval(an_interval), elapsed_millis(0),
+          fixed_rate(false), catch_up(TimerCatchUp::SKIP) {
+        started_at = Clock::now();
     }
-    Timer() : interval(0), last_update(0) {
-        started_at = millis();
+    BasicTimer() : BasicTimer(0) {}
+
+    // Fixed-rate timer
+    BasicTimer(uint32_t an_interval, TimerCatchUp policy) : BasicTimer(an_interval) {
+        setFixedRate(policy);
+    }
+
+    void setFixedRate(TimerCatchUp policy) {
+        fixed_rate = true;
+        catch_up = policy;
     }
 
     bool hasElapsed() {
-        return millis() - last_update > interval;
+        uint32_t since = Clock::now() - last_update;
+        return fixed_rate ? since >= interval : since > interval;
     }
 
-    unsigned long elapsed() {
-        return millis() - started_at;
+    uint32_t elapsed() {
+        return Clock::now() - started_at;
     }
 
     bool checkAndReset() {
         if (interval == 0) return false;
 
-        if (hasElapsed()) {
-            reset();
-            return true;
+        if (!fixed_rate) {
+            if (hasElapsed()) {
+                reset();
+                return true;
+            }
+            return false;
+        }
+
+        uint32_t now = Clock::now();
+        if (now - last_update < interval) return false;
+        last_update += interval;
+        if (catch_up == TimerCatchUp::SKIP && now - last_update >= interval) {
+            // Jump over the missed ticks but keep the phase of the grid
+            last_update += ((now - last_update) / interval) * interval;
         }
-        return false;
+        return true;
     }
 
+    // Restart the interval (and, in fixed-rate mode, the tick grid) from now
     void reset() {
-        last_update = millis();
+        last_update = Clock::now();
     }
 
     void resetMillis() {
         elapsed_millis = 0;
-        started_at = millis();
+        started_at = Clock::now();
     }
 };
 
-#endif // TIMER_H 
\ No newline at end of file
+#if defined(ARDUINO)
+struct MillisClock {
+    static uint32_t now() { return millis(); }
+};
+
+struct MicrosClock {
+    static uint32_t now() { return micros(); }
+};
+
+// Millisecond timer used throughout the firmware
+typedef BasicTimer<MillisClock> Timer;
+
+// Microsecond-resolution variant; intervals and elapsed() are in us
+typedef BasicTimer<MicrosClock> MicroTimer;
+#endif
+
+#endif // TIMER_H
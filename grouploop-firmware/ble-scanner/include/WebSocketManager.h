@@ -26,6 +26,7 @@ private:
     MessageCallback messageCallback;
     String lastReceivedMessage;
     bool hasNewMessage = false;
+    unsigned long lastReceiveMs = 0;    // millis() of the last message from the server
     
     // Connection management
     bool isInitialized = false;
@@ -38,6 +39,7 @@ public:
         , deviceIdHex("0000")
         , state("DISCONNECTED")
         , hasNewMessage(false)
+        , lastReceiveMs(0)
         , isInitialized(false)
         , lastReconnectAttempt(0)
     {}
@@ -66,7 +68,6 @@ public:
         
         // Handle reconnection if needed
         if (!connected && (millis() - lastReconnectAttempt) > RECONNECT_INTERVAL) {
-            lastReconnectAttempt = millis();
             reconnect();
         }
     }
@@ -96,6 +97,11 @@ public:
         messageCallback = callback;
     }
 
+    // When the last message arrived (millis(), 0 if none yet)
+    unsigned long getLastReceiveMs() const {
+        return lastReceiveMs;
+    }
+
     // Get connection state
     bool isConnected() const {
         return connected;
@@ -111,8 +117,18 @@ public:
         return state;
     }
 
-    // Force reconnection
+    // Switch to another server and connect to it right away
+    void setUrl(const String& wsUrl) {
+        if (!isInitialized) return;     // not connecting yet; initialize() gets the URL
+        webSocket.disconnect();
+        connected = false;
+        parseAndConnect(wsUrl);
+        lastReconnectAttempt = millis();
+    }
+
+    // Force reconnection; the next update() connects right away
     void reconnect() {
+        lastReconnectAttempt = millis();
         if (wsHost.length() > 0) {
             webSocket.begin(wsHost.c_str(), wsPort, wsPath.c_str());
         }
@@ -155,6 +171,7 @@ private:
                 // Store the message
                 lastReceivedMessage = message;
                 hasNewMessage = true;
+                lastReceiveMs = millis();
                 
                 // Call callback if set
                 if (messageCallback) {
@@ -176,6 +193,7 @@ private:
                 
                 lastReceivedMessage = hexMessage;
                 hasNewMessage = true;
+                lastReceiveMs = millis();
                 
                 // Call callback if set
                 if (messageCallback) {
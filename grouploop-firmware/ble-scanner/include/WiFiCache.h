@@ -0,0 +1,70 @@
+#ifndef WIFI_CACHE_H
+#define WIFI_CACHE_H
+
+#include "Arduino.h"
+#include <Preferences.h>
+#include "WiFiConnector.h"
+
+// Last good access point (BSSID, channel) and IP lease, kept in NVS so a
+// reboot can rejoin without scanning. Tied to the SSID it was learned on.
+class WiFiCache {
+private:
+    static constexpr const char* NVS_NAMESPACE = "wifi_cache";
+    static constexpr const char* KEY_RECORD = "record";
+    static const uint32_t MAGIC = 0x57434101; // "WCA" v1
+
+    struct Record {
+        uint32_t magic;
+        char ssid[33];
+        WiFiNetwork network;
+    };
+
+    Record stored;
+    bool valid;
+
+public:
+    WiFiCache() : valid(false) {
+        memset(&stored, 0, sizeof(stored));
+    }
+
+    // Cached network for `ssid`, if there is one
+    bool load(const String& ssid, WiFiNetwork& network) {
+        Preferences preferences;
+        if (!preferences.begin(NVS_NAMESPACE, true)) return false;
+        valid = preferences.getBytes(KEY_RECORD, &stored, sizeof(stored)) == sizeof(stored) &&
+                stored.magic == MAGIC;
+        preferences.end();
+        if (!valid || ssid != stored.ssid) return false;
+        network = stored.network;
+        return true;
+    }
+
+    // Remember a working network. Only writes when something changed, to
+    // spare the flash on every reconnect.
+    void store(const String& ssid, const WiFiNetwork& network) {
+        Record record;
+        memset(&record, 0, sizeof(record));
+        record.magic = MAGIC;
+        strncpy(record.ssid, ssid.c_str(), sizeof(record.ssid) - 1);
+        record.network = network;
+        record.network.rssi = 0;    // changes on every join, not worth a write
+        if (valid && memcmp(&record, &stored, sizeof(record)) == 0) return;
+
+        Preferences preferences;
+        if (!preferences.begin(NVS_NAMESPACE, false)) return;
+        preferences.putBytes(KEY_RECORD, &record, sizeof(record));
+        preferences.end();
+        stored = record;
+        valid = true;
+    }
+
+    void clear() {
+        Preferences preferences;
+        if (!preferences.begin(NVS_NAMESPACE, false)) return;
+        preferences.remove(KEY_RECORD);
+        preferences.end();
+        valid = false;
+    }
+};
+
+#endif // WIFI_CACHE_H
@@ -0,0 +1,280 @@
+#ifndef WIFI_CONNECTOR_H
+#define WIFI_CONNECTOR_H
+
+#include <stdint.h>
+#include <string.h>
+
+// Access point chosen for an association attempt. A non-zero `ip` asks the
+// driver to configure that address statically instead of running DHCP.
+struct WiFiNetwork {
+    uint8_t bssid[6];
+    int32_t channel;
+    int32_t rssi;
+    uint32_t ip;
+    uint32_t gateway;
+    uint32_t subnet;
+    uint32_t dns;
+};
+
+// Completion events reported by the driver, possibly from another task
+enum class WiFiDriverEvent : uint8_t {
+    SCAN_DONE,
+    ASSOCIATED,
+    GOT_IP,
+    DISCONNECTED
+};
+
+// Radio operations used by WiFiConnector. Every call must return
+// immediately; completion is reported later as a WiFiDriverEvent.
+class WiFiDriver {
+public:
+    virtual ~WiFiDriver() {}
+    virtual bool startScan() = 0;
+    // After SCAN_DONE: strongest access point advertising `ssid`
+    virtual bool findBestNetwork(const char* ssid, WiFiNetwork& network) = 0;
+    virtual void associate(const char* ssid, const char* password, const WiFiNetwork& network) = 0;
+    virtual void disconnect() = 0;
+};
+
+struct WiFiConnectorConfig {
+    uint32_t scanTimeoutMs;
+    uint32_t associateTimeoutMs;
+    uint32_t fastAssociateTimeoutMs;   // cached network; fall back to a scan sooner
+    uint32_t dhcpTimeoutMs;
+    uint32_t backoffInitialMs;      // delay after the first failure, doubled per failure
+    uint32_t backoffMaxMs;
+    uint8_t jitterPercent;          // random reduction of each delay, spreads out a fleet
+
+    WiFiConnectorConfig()
+        : scanTimeoutMs(8000), associateTimeoutMs(8000), fastAssociateTimeoutMs(2000),
+          dhcpTimeoutMs(8000),
+          backoffInitialMs(500), backoffMaxMs(30000), jitterPercent(25) {}
+};
+
+// Non-blocking station connection state machine:
+//
+//   SCANNING -> ASSOCIATING -> OBTAINING_IP -> CONNECTED
+//       \______________\______________\___________\__> BACKOFF -> SCANNING
+//
+// begin() can be given a cached network (BSSID, channel, optional IP lease)
+// to associate directly and skip the scan. If that fast attempt fails the
+// connector falls back to a full scan right away, without backing off.
+// Every other failure (no matching network, timeout, disconnect) waits in BACKOFF
+// for an exponentially growing, jittered delay and then starts over. It never
+// gives up. Driver events are fed in with handle(); update() handles timeouts.
+// Times are milliseconds from any wrapping 32-bit clock.
+class WiFiConnector {
+public:
+    enum class State : uint8_t {
+        IDLE,
+        SCANNING,
+        ASSOCIATING,
+        OBTAINING_IP,
+        CONNECTED,
+        BACKOFF
+    };
+
+private:
+    WiFiDriver& driver;
+    WiFiConnectorConfig config;
+    char ssid[33];
+    char password[65];
+    WiFiNetwork network;
+
+    State state;
+    uint32_t stateSince;
+    uint32_t retryDelay;
+    uint32_t failures;          // consecutive failures, reset on connect
+    uint32_t attempts;          // connection attempts since begin()
+    uint32_t random;
+    bool fastPath;              // current attempt uses the cached network
+    bool connectedViaCache;
+
+public:
+    WiFiConnector(WiFiDriver& aDriver, const WiFiConnectorConfig& aConfig = WiFiConnectorConfig())
+        : driver(aDriver), config(aConfig), state(State::IDLE), stateSince(0),
+          retryDelay(0), failures(0), attempts(0), random(0x9E3779B9u),
+          fastPath(false), connectedViaCache(false) {
+        ssid[0] = '\0';
+        password[0] = '\0';
+        memset(&network, 0, sizeof(network));
+    }
+
+    // Seed for the backoff jitter; use something unique per device
+    void setSeed(uint32_t seed) {
+        random = seed ? seed : 0x9E3779B9u;
+    }
+
+    // (Re)start connecting with the given credentials, optionally trying a
+    // previously used network first
+    void begin(const char* aSsid, const char* aPassword, uint32_t now, const WiFiNetwork* cached = nullptr) {
+        copy(ssid, sizeof(ssid), aSsid);
+        copy(password, sizeof(password), aPassword);
+        failures = 0;
+        attempts = 0;
+        fastPath = false;
+        connectedViaCache = false;
+        if (state == State::ASSOCIATING || state == State::OBTAINING_IP || state == State::CONNECTED) {
+            driver.disconnect();
+        }
+        if (ssid[0] == '\0') {
+            enter(State::IDLE, now);
+            return;
+        }
+        if (cached) {
+            network = *cached;
+            fastPath = true;
+            attempts++;
+            driver.associate(ssid, password, network);
+            enter(State::ASSOCIATING, now);
+            return;
+        }
+        startScan(now);
+    }
+
+    void stop(uint32_t now) {
+        if (state != State::IDLE && state != State::BACKOFF) {
+            driver.disconnect();
+        }
+        enter(State::IDLE, now);
+    }
+
+    void handle(WiFiDriverEvent event, uint32_t now) {
+        switch (event) {
+            case WiFiDriverEvent::SCAN_DONE:
+                if (state != State::SCANNING) break;
+                memset(&network, 0, sizeof(network));
+                if (driver.findBestNetwork(ssid, network)) {
+                    driver.associate(ssid, password, network);
+                    enter(State::ASSOCIATING, now);
+                } else {
+                    fail(now);
+                }
+                break;
+            case WiFiDriverEvent::ASSOCIATED:
+                if (state == State::ASSOCIATING) {
+                    enter(State::OBTAINING_IP, now);
+                }
+                break;
+            case WiFiDriverEvent::GOT_IP:
+                if (state == State::ASSOCIATING || state == State::OBTAINING_IP) {
+                    failures = 0;
+                    connectedViaCache = fastPath;
+                    fastPath = false;
+                    enter(State::CONNECTED, now);
+                }
+                break;
+            case WiFiDriverEvent::DISCONNECTED:
+                if (state == State::CONNECTED) {
+                    // Lost an established link: retry after the shortest delay
+                    failures = 0;
+                    fail(now);
+                } else if (state == State::ASSOCIATING || state == State::OBTAINING_IP) {
+                    fail(now);
+                }
+                break;
+        }
+    }
+
+    void update(uint32_t now) {
+        uint32_t inState = now - stateSince;
+        switch (state) {
+            case State::SCANNING:
+                if (inState >= config.scanTimeoutMs) fail(now);
+                break;
+            case State::ASSOCIATING:
+                if (inState >= (fastPath ? config.fastAssociateTimeoutMs : config.associateTimeoutMs)) fail(now);
+                break;
+            case State::OBTAINING_IP:
+                if (inState >= config.dhcpTimeoutMs) fail(now);
+                break;
+            case State::BACKOFF:
+                if (inState >= retryDelay) startScan(now);
+                break;
+            case State::IDLE:
+            case State::CONNECTED:
+                break;
+        }
+    }
+
+    State getState() const { return state; }
+    bool isConnected() const { return state == State::CONNECTED; }
+    uint32_t getFailures() const { return failures; }
+    uint32_t getAttempts() const { return attempts; }
+    uint32_t getRetryDelay() const { return retryDelay; }
+    uint32_t getStateSince() const { return stateSince; }
+    // The current link was joined from the cached network, without a scan
+    bool isConnectedViaCache() const { return connectedViaCache; }
+    const WiFiNetwork& getNetwork() const { return network; }
+
+    static const char* stateName(State s) {
+        switch (s) {
+            case State::IDLE: return "IDLE";
+            case State::SCANNING: return "SCANNING";
+            case State::ASSOCIATING: return "ASSOCIATING";
+            case State::OBTAINING_IP: return "OBTAINING_IP";
+            case State::CONNECTED: return "CONNECTED";
+            case State::BACKOFF: return "BACKOFF";
+        }
+        return "UNKNOWN";
+    }
+
+private:
+    void enter(State next, uint32_t now) {
+        state = next;
+        stateSince = now;
+    }
+
+    void startScan(uint32_t now) {
+        attempts++;
+        if (driver.startScan()) {
+            enter(State::SCANNING, now);
+        } else {
+            fail(now);
+        }
+    }
+
+    void fail(uint32_t now) {
+        if (state == State::ASSOCIATING || state == State::OBTAINING_IP) {
+            driver.disconnect();
+        }
+        if (fastPath) {
+            // The cached access point is gone or moved: scan immediately
+            fastPath = false;
+            startScan(now);
+            return;
+        }
+        retryDelay = backoffDelay(failures);
+        if (failures < 31) failures++;
+        enter(State::BACKOFF, now);
+    }
+
+    uint32_t backoffDelay(uint32_t failureCount) {
+        uint32_t delay = config.backoffInitialMs;
+        for (uint32_t i = 0; i < failureCount && delay < config.backoffMaxMs; i++) {
+            delay *= 2;
+        }
+        if (delay > config.backoffMaxMs) delay = config.backoffMaxMs;
+        if (config.jitterPercent > 0) {
+            uint32_t span = (uint32_t)((uint64_t)delay * config.jitterPercent / 100);
+            if (span > 0) delay -= nextRandom() % (span + 1);
+        }
+        return delay;
+    }
+
+    uint32_t nextRandom() {
+        // xorshift32
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        return random;
+    }
+
+    static void copy(char* dest, size_t size, const char* src) {
+        if (!src) src = "";
+        strncpy(dest, src, size - 1);
+        dest[size - 1] = '\0';
+    }
+};
+
+#endif // WIFI_CONNECTOR_H
@@ -8,7 +8,6 @@
 #define WIFI_CONNECT_DELAY 500
 #define WIFI_SEND_DELAY 3000
 #define SERIAL_BAUD_RATE 115200
-#define SETUP_DELAY 1000
 #define SCAN_DURATION 1 // Scan for 2 seconds
 #define SCAN_INTERVAL_MS (5000 - (SCAN_DURATION * 1000)) // Interval between scans
 
@@ -19,9 +18,136 @@
 
 #define IMU_UPDATE_INTERVAL_MS 10
 
+// LED layout (see LedLayout.h); the ring24 env builds for the 24-pixel ring
+#if defined(LED_RING_24)
+#define LED_COUNT 24
+#define LED_SHAPE LedShape::RING
+#else
 #define LED_COUNT 6
+#define LED_SHAPE LedShape::STRIP
+#endif
+#define LED_FIRST_PIXEL 0        // Data-line index of logical pixel 0 (rings: the one at twelve o'clock)
+#define LED_REVERSED false       // Wired right to left / counter-clockwise
+#define LED_GAMMA_CORRECTION 1 // Behaviors treat brightness as perceived and map it through a gamma table
+#define LED_RMT_OUTPUT 1        // Send frames through RMT without blocking (0 = Adafruit_NeoPixel show())
+#define LED_RMT_CHANNEL 0
+#define LED_LAYERS 4             // Compositor layers: the base pattern plus overlays (see LedCompositor.h)
+#define LED_LAYER_FADE_MS 250    // Overlays with a lifetime fade out over its last this many ms
+#define SPRING_STEP_MS 4         // Spring pattern physics step; frames run as many steps as fit
+#define SPRING_MAX_STEPS 64      // Steps per frame at most; time beyond that (a stall) is dropped
+#define SPRING_TAP_IMPULSE 4.0f  // Spring kick per g a tap exceeds TAP_THRESHOLD by (brightness/s)
+
+// LED keyframe timelines (see Timeline.h)
+#define TIMELINE_MAX_TRACKS 16
+#define TIMELINE_MAX_KEYS 192
+#define TIMELINE_FRAME_MS 16
+
+// Reaction programs uploaded with vm:<hex> (see ReactionVm.h, ReactionProcess.h)
+#define VM_TICK_MS 20                    // inputs read and program run this often
+#define VM_BUDGET 256                    // instructions per tick before the program is cut off
+#define VM_MAX_CODE 512
+#define VM_STACK_SIZE 16
+#define VM_REGISTERS 16
+#define VM_LED_LAYER 2                   // compositor layer the program's color shows on
+
+// Cues on the shared clock (see CueProcess.h)
+#define CUE_QUEUE_SIZE 16
+#define CUE_MAX_COMMAND 64               // "<command>:<params>" of one cue, including the terminator
+#define CUE_MAX_LATE_MS 5000             // a cue this far past its time is stale and dropped
+#define CUE_MAX_AHEAD_MS 3600000         // ...and one further ahead than this is a mistake
+#define CUE_SYNC_SAMPLES 8               // clock exchanges the best one is picked from
+#define CUE_SYNC_FAST_INTERVAL_MS 1000   // until the sample window is full
+#define CUE_SYNC_INTERVAL_MS 10000       // afterwards, to track crystal drift
+#define CUE_SYNC_MAX_RTT_MS 500          // slower exchanges say too little about the offset
 
 #define VIBRATION_MOTOR_PIN 0
 
+// Haptic engine (see HapticEngine.h)
+#define HAPTIC_LEDC_CHANNEL 0    // LEDC channel driving the motor
+#define HAPTIC_PWM_FREQ 20000    // Hz; above hearing, so the motor does not whine
+#define HAPTIC_RAMP_STEP_MS 5    // Duty updates during attack and decay ramps
+#define HAPTIC_QUEUE_SIZE 4      // Patterns waiting behind the one playing
+#define HAPTIC_WAVEFORM_SLOTS 8  // Uploaded waveforms kept for hw:<id> (see HapticWaveform.h)
+#define HAPTIC_WAVEFORM_MAX_SEGMENTS 32
+
+// Scheduler
+#define MAX_PROCESSES 16
+#define LOOP_MAX_IDLE_MS 10 // Upper bound on a single idle sleep in loop()
+
+// Dedicated RTOS tasks for sensing and LED rendering (0 = run everything in loop())
+#ifndef USE_PROCESS_TASKS
+#define USE_PROCESS_TASKS 1
+#endif
+#define MAX_PROCESS_TASKS 2
+#define IMU_TASK_STACK_SIZE 3072
+#define IMU_TASK_PRIORITY 3  // Above loop() (1) so sampling never waits on the network
+#define LED_TASK_STACK_SIZE 4096
+#define LED_TASK_PRIORITY 2
+
+// Stall watchdog (see StallWatchdog.h)
+#define STALL_LANE_LOOP 0                // lane of loop(); process tasks follow
+#define WATCHDOG_BUDGET_MS 200           // an update() running longer is recorded as a stall
+#define WATCHDOG_CHECK_INTERVAL_MS 100   // monitor timer period
+#define WATCHDOG_HANG_MS 20000           // reset once a single update() runs this long
+
+// WiFi connection state machine (see WiFiConnector.h)
+#define WIFI_UPDATE_INTERVAL_MS 100
+#define WIFI_SCAN_TIMEOUT_MS 8000
+#define WIFI_ASSOCIATE_TIMEOUT_MS 8000
+#define WIFI_FAST_ASSOCIATE_TIMEOUT_MS 2000 // Cached BSSID/channel before falling back to a scan
+#define WIFI_DHCP_TIMEOUT_MS 8000
+#define WIFI_BACKOFF_INITIAL_MS 500   // doubled after every failed attempt
+#define WIFI_BACKOFF_MAX_MS 30000
+// Reuse the last DHCP lease as a static IP on the fast path. Saves the DHCP
+// round trips but never renews the lease, so only enable it on networks
+// with DHCP reservations (0 = always DHCP)
+#ifndef WIFI_REUSE_IP_LEASE
+#define WIFI_REUSE_IP_LEASE 0
+#endif
+
+// Streaming OTA (see OtaEngine.h)
+#define OTA_CHUNK_SIZE 1024
+#define OTA_CHUNKS_PER_STEP 4           // at most 4 KB flashed per step
+#define OTA_STEP_INTERVAL_MS 10         // process period while downloading
+#define OTA_IDLE_INTERVAL_MS 1000
+#define OTA_HTTP_TIMEOUT_MS 5000        // connect/header timeout and stall timeout
+#define OTA_MAX_RETRIES 5               // reconnects without progress before giving up
+#define OTA_RETRY_DELAY_MS 2000
+#define OTA_PROGRESS_INTERVAL_MS 1000
+#define OTA_RESTART_DELAY_MS 500
+#define OTA_DECODE_BUDGET 4096          // max bytes a packed image expands to per step
+
+// Power management (see PowerPolicy.h and EnergyModel.h)
+#define POWER_DEFAULT_MODE PowerMode::PERFORMANCE
+#define POWER_BEACON_INTERVAL_MS 102    // 100 TU, the usual AP setting
+#define POWER_DTIM_PERIOD 1             // beacons per DTIM on the venue AP
+#define POWER_DTIM_GUARD_MS 2           // send this long after the expected beacon
+#define POWER_UPDATE_INTERVAL_MS 1000
+#define POWER_ESTIMATE_WINDOW_MS 5000   // simulated time per current estimate
+
+// Configuration writes to NVS (see ConfigCommitter.h)
+#define CONFIG_COMMIT_DEBOUNCE_MS 2000    // changed settings are written once quiet this long
+#define CONFIG_COMMIT_MAX_DELAY_MS 10000  // ...or at the latest this long after the first change
+#define CONFIG_PATCH_MAX_BYTES 512        // decoded size of a binary config_set:<hex> (see ConfigPatch.h)
+#define CONFIG_RESTART_DELAY_MS 500       // after a change that needs a restart, time for the reply to go out
+#define CONFIG_LINE_MAX 512               // longest JSON line accepted in boot-button configuration mode
+
+// Framed provisioning over USB serial (see ProvisionProtocol.h)
+#define PROVISION_MAX_PAYLOAD CONFIG_PATCH_MAX_BYTES  // a CONFIG frame carries one ConfigPatch
+#define PROVISION_FRAME_TIMEOUT_MS 200    // a frame with a gap this long is dropped
+#define PROVISION_READ_BUDGET 256         // serial bytes handled per ConfigurationProcess update
+
+// Sensor frames (PublishProcess); the interval itself is the publishIntervalMs setting
+#include "PublishLimits.h"
+
+// Event bus
+#define EVENT_MAX_SUBSCRIBERS 16
+#define EVENT_QUEUE_SIZE 16
+
+// Per-process cycle-count profiling, reported by the "stats" command (0 = compiled out)
+#ifndef PROCESS_PROFILING
+#define PROCESS_PROFILING 1
+#endif
+
 #endif
 
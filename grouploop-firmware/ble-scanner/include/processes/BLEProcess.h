@@ -6,6 +6,7 @@
 #include "Process.h"
 #include "Timer.h"
 #include "config.h"
+#include "Configuration.h"
 
 // Forward declaration for the global pointer
 class BLEProcess;
@@ -24,6 +25,7 @@ public:
           scanning(false)
     {
         g_BLEProcess = this;
+        setPeriod(50); // Scan on/off timers only need coarse resolution
         // Initialize RSSI buffer
         for (int i = 0; i < 4; ++i) beaconRssi[i] = -128;
     }
@@ -56,21 +58,35 @@ public:
         Serial.printf("Scan complete! Found %d devices.\n", results.getCount());
         BLEUUID targetUUID(BEACON_SERVICE_UUID);
         int matched = 0;
+        // Beacons go into the slot of their configured address, read every
+        // scan so config_set changes apply from the next one; beacons not in
+        // the table fill the slots left over, in the order they were seen
+        const String* table[4] = {&configuration.getBeaconNW(), &configuration.getBeaconNE(),
+                                  &configuration.getBeaconSE(), &configuration.getBeaconSW()};
+        int unknownRssi[4];
+        int unknown = 0;
         // reset buffer for this scan cycle
         for (int k = 0; k < 4; ++k) beaconRssi[k] = -128;
         for (int i = 0; i < results.getCount(); ++i) {
             BLEAdvertisedDevice dev = results.getDevice(i);
             if (dev.isAdvertisingService(targetUUID)) {
                 matched++;
-                // Handle beacon device here (e.g., store, publish, etc.)
-                // Example: print address and RSSI for matches
-                Serial.printf("Beacon %s RSSI %d\n", dev.getAddress().toString().c_str(), dev.getRSSI());
-                // Store RSSI in first four slots
-                if (matched <= 4) {
-                    beaconRssi[matched - 1] = dev.getRSSI();
+                String address = dev.getAddress().toString().c_str();
+                Serial.printf("Beacon %s RSSI %d\n", address.c_str(), dev.getRSSI());
+                int slot = -1;
+                for (int k = 0; k < 4 && slot < 0; ++k) {
+                    if (address.equalsIgnoreCase(*table[k])) slot = k;
+                }
+                if (slot >= 0) {
+                    beaconRssi[slot] = dev.getRSSI();
+                } else if (unknown < 4) {
+                    unknownRssi[unknown++] = dev.getRSSI();
                 }
             }
         }
+        for (int k = 0, next = 0; k < 4 && next < unknown; ++k) {
+            if (beaconRssi[k] == -128) beaconRssi[k] = unknownRssi[next++];
+        }
         Serial.printf("Matched %d beacon devices with UUID %s\n", matched, BEACON_SERVICE_UUID);
     }
 
@@ -3,15 +3,29 @@
 
 #include "Process.h"
 #include "Configuration.h"
+#include "ConfigPatch.h"
+#include "ProvisionProtocol.h"
+#include "CommandRegistry.h"
+#include "WebSocketManager.h"
 #include "config.h"
+#include <ArduinoJson.h>
+#include <WiFi.h>
 
-class ConfigurationProcess : public Process {
+// Settings from the outside: the boot button's JSON line mode, the
+// config_get/config_set commands and framed provisioning over USB serial
+// (ProvisionProtocol.h, sent by tools/provision)
+class ConfigurationProcess : public Process, private ProvisionTarget {
 private:
     int bootButtonPin;
     int lastButtonState;
     bool configurationMode;
     String incomingConfig;
+    bool lineTooLong;
     unsigned long configTimeout;
+    bool restartPending;
+    uint32_t restartAt;
+    ConfigPatch patch;
+    ProvisionServer provision;
     static const unsigned long CONFIG_TIMEOUT_MS = 30000; // 30 seconds timeout
     
 public:
@@ -19,7 +33,13 @@ public:
         bootButtonPin(BOOT_BUTTON_PIN),
         lastButtonState(HIGH),
         configurationMode(false),
-        configTimeout(0) {}
+        lineTooLong(false),
+        configTimeout(0),
+        restartPending(false),
+        restartAt(0),
+        provision(*this, PROVISION_FRAME_TIMEOUT_MS) {
+        setPeriod(20); // Button poll rate
+    }
     
     bool isInConfigurationMode() const { return configurationMode; }
     
@@ -28,7 +48,9 @@ public:
         lastButtonState = digitalRead(bootButtonPin);
         configurationMode = false;
         incomingConfig = "";
+        lineTooLong = false;
         configTimeout = 0;
+        registerCommands();
     }
     
     void update() override {
@@ -41,9 +63,20 @@ public:
         
         lastButtonState = currentButtonState;
         
-        // Handle configuration mode
-        if (configurationMode) {
-            handleConfigurationMode();
+        readSerial();
+
+        if (configurationMode && millis() > configTimeout) {
+            Serial.println("\nConfiguration timeout - exiting configuration mode");
+            exitConfigurationMode();
+        }
+
+        // Write settings changed since the last batch once they settle
+        configuration.update();
+
+        if (restartPending && (int32_t)(millis() - restartAt) >= 0) {
+            Serial.println("Restarting to apply configuration");
+            configuration.save();
+            ESP.restart();
         }
     }
     
@@ -68,6 +101,8 @@ private:
         // Enter configuration mode
         configurationMode = true;
         incomingConfig = "";
+        incomingConfig.reserve(CONFIG_LINE_MAX);
+        lineTooLong = false;
         configTimeout = millis() + CONFIG_TIMEOUT_MS;
         
         Serial.println("\nSend new configuration JSON within 30 seconds...");
@@ -76,27 +111,40 @@ private:
         Serial.println("==========================================\n");
     }
     
-    void handleConfigurationMode() {
-        // Check for timeout
-        if (millis() > configTimeout) {
-            Serial.println("\nConfiguration timeout - exiting configuration mode");
-            exitConfigurationMode();
-            return;
+    // Serial input: provisioning frames at any time, a JSON line in
+    // configuration mode, at most PROVISION_READ_BUDGET bytes per update
+    void readSerial() {
+        for (int budget = PROVISION_READ_BUDGET; budget > 0 && Serial.available() > 0; budget--) {
+            uint8_t c = (uint8_t)Serial.read();
+            switch (provision.feed(c, millis())) {
+            case ProvisionServer::Decoder::FRAME:
+                Serial.write(provision.reply(), provision.getReplyLength());
+                break;
+            case ProvisionServer::Decoder::TEXT:
+                if (configurationMode) readConfigLine((char)c);
+                break;
+            default:
+                break;
+            }
         }
-        
-        // Read incoming serial data
-        while (Serial.available() > 0) {
-            char c = Serial.read();
-            
-            if (c == '\n' || c == '\r') {
-                // End of line received
-                if (incomingConfig.length() > 0) {
-                    processIncomingConfiguration();
-                }
-                incomingConfig = "";
-            } else {
-                incomingConfig += c;
+    }
+
+    void readConfigLine(char c) {
+        if (c == '\n' || c == '\r') {
+            // End of line received
+            if (incomingConfig.length() > 0) {
+                processIncomingConfiguration();
             }
+            incomingConfig = "";
+            lineTooLong = false;
+        } else if (lineTooLong) {
+            // Drop the rest of the line
+        } else if (incomingConfig.length() < CONFIG_LINE_MAX) {
+            incomingConfig += c;
+        } else {
+            Serial.println("Configuration line too long - ignored");
+            incomingConfig = "";
+            lineTooLong = true;
         }
     }
     
@@ -112,25 +160,143 @@ private:
         
         // Try to parse the JSON configuration
         
+        uint32_t announcements = configuration.getAnnouncements();
         if (configuration.parseFromJSON(incomingConfig)) {
             Serial.println("\nConfiguration accepted!");
             Serial.println("New configuration:");
             configuration.printConfiguration();
             
-            Serial.println("\nResetting device in 2 seconds...");
-            delay(2000);
-            
-            // Reset the device
-            ESP.restart();
+            // Everything else was applied live
+            if (restartIfRequired(changedSince(announcements))) {
+                Serial.println("\nResetting device for the new pins...");
+            }
+            exitConfigurationMode();
         } else {
             Serial.println("Invalid JSON configuration. Please try again.");
             Serial.println("Format: {\"wifiSSID\":\"value\",\"wifiPassword\":\"value\",...}");
         }
     }
     
+    // Settings the last CONFIG_CHANGED announced, if it came after
+    // `announcements`; saved to NVS or not
+    static uint32_t changedSince(uint32_t announcements) {
+        return configuration.getAnnouncements() != announcements ? configuration.getLastChanged() : 0;
+    }
+
+    // Restarts shortly if a changed setting only takes effect at boot
+    bool restartIfRequired(uint32_t changed) {
+        if (!(changed & Configuration::RESTART_SETTINGS)) return false;
+        restartPending = true;
+        restartAt = millis() + CONFIG_RESTART_DELAY_MS;
+        return true;
+    }
+
+    static void reply(JsonDocument& doc) {
+        String json;
+        serializeJson(doc, json);
+        Serial.println(json);
+        webSocketManager.sendMessage(json);
+    }
+
+    // Apply the loaded patch, all or nothing, in one batch; the error or
+    // nullptr
+    const char* applyPatch() {
+        ConfigPatchRecord record{};
+        for (size_t at = 0; patch.next(at, record);) {
+            if (!Configuration::acceptsPatchRecord(record)) return "bad setting or value";
+        }
+        configuration.begin();
+        for (size_t at = 0; patch.next(at, record);) {
+            configuration.applyPatchRecord(record);
+        }
+        configuration.commit();
+        return nullptr;
+    }
+
+    // HELLO from the provisioning tool
+    void identify(ProvisionInfo& info) override {
+        info.settings = Configuration::SETTING_COUNT;
+        WiFi.macAddress(info.mac);
+        info.label = configuration.getDeviceLabel().c_str();
+    }
+
+    // CONFIG from the provisioning tool; saved before the ACK goes out
+    void apply(const uint8_t* data, size_t length, ProvisionAck& ack) override {
+        uint32_t announcements = configuration.getAnnouncements();
+        if (!patch.load(data, length, ack.error)) {
+            ack.status = PROVISION_BAD_PATCH;
+            return;
+        }
+        if ((ack.error = applyPatch())) {
+            ack.status = PROVISION_BAD_VALUE;
+            return;
+        }
+        ack.changed = changedSince(announcements);
+        if (configuration.hasUnsavedChanges()) {
+            ack.status = PROVISION_NOT_SAVED;
+            ack.error = "NVS not available";
+        } else {
+            ack.status = PROVISION_OK;
+            ack.flags |= PROVISION_ACK_SAVED;
+        }
+        if (restartIfRequired(ack.changed)) ack.flags |= PROVISION_ACK_RESTART;
+    }
+
+    // Apply a partial update, JSON or hex (ConfigPatch.h), all or nothing,
+    // and reply with what changed
+    void applyUpdate(const String& params) {
+        JsonDocument doc;
+        doc["type"] = "config_set";
+        doc["id"] = webSocketManager.getDeviceId();
+        const char* error = nullptr;
+        uint32_t announcements = configuration.getAnnouncements();
+
+        if (params.startsWith("{")) {
+            if (!configuration.parseFromJSON(params)) error = "invalid JSON";
+        } else if (patch.loadHex(params.c_str(), error)) {
+            error = applyPatch();
+        }
+
+        doc["ok"] = error == nullptr;
+        if (error) {
+            doc["error"] = error;
+            reply(doc);
+            return;
+        }
+        uint32_t changed = changedSince(announcements);
+        JsonArray names = doc["changed"].to<JsonArray>();
+        for (size_t setting = 0; setting < Configuration::SETTING_COUNT; setting++) {
+            if (changed & (1u << setting)) names.add(Configuration::settingName(setting));
+        }
+        doc["saved"] = !configuration.hasUnsavedChanges();
+        doc["restart"] = restartIfRequired(changed);
+        reply(doc);
+    }
+
+    void registerCommands() {
+        // Current configuration, the WiFi password masked
+        commandRegistry.registerCommand("config_get", [](const String& params) {
+            JsonDocument doc;
+            doc["type"] = "config";
+            doc["id"] = webSocketManager.getDeviceId();
+            JsonDocument current;
+            deserializeJson(current, configuration.toJSON(false));
+            doc["config"] = current;
+            reply(doc);
+        });
+
+        // Change some settings without a reboot
+        // Format: config_set:{"socketServerURL":"ws://host:5003","beaconNE":"..."}
+        //     or: config_set:<hex> (binary format in ConfigPatch.h)
+        commandRegistry.registerCommand("config_set", [this](const String& params) {
+            applyUpdate(params);
+        });
+    }
+
     void exitConfigurationMode() {
         configurationMode = false;
         incomingConfig = "";
+        lineTooLong = false;
         configTimeout = 0;
         Serial.println("Exited configuration mode - returning to normal operation");
     }
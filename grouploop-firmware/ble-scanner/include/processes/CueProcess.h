@@ -0,0 +1,137 @@
+#ifndef CUE_PROCESS_H
+#define CUE_PROCESS_H
+
+#include "Process.h"
+#include "CommandRegistry.h"
+#include "WebSocketManager.h"
+#include "SharedClock.h"
+#include "CueQueue.h"
+#include "config.h"
+
+typedef BasicSharedClock<CUE_SYNC_SAMPLES> SharedClock;
+typedef BasicCueQueue<CUE_QUEUE_SIZE, CUE_MAX_COMMAND> CueQueue;
+
+// Runs commands at a time on the server's clock, so a broadcast that
+// reaches devices one by one still takes effect everywhere at once.
+//
+// "at:<T>:<command>[:<params>]" queues a command for shared time T (ms on
+// the server's clock). The clock is kept in sync by "sync:<millis>"
+// requests the server answers with "sync:<millis>:<server ms>". A cue runs
+// through CommandRegistry::executeCommandAt() with its due time, which LED
+// behaviors take as their phase origin: a cue that fires a few ms late, or
+// arrives after T, still animates in step with the rest of the room.
+class CueProcess : public Process {
+public:
+    CueProcess() : Process(), clock(CUE_SYNC_MAX_RTT_MS), lastSyncAt(0), late(0), dropped(0) {
+        setPeriod(CUE_SYNC_INTERVAL_MS);
+    }
+
+    void setup() override {
+        commandRegistry.registerCommand("at", [this](const String& params) {
+            schedule(params);
+        });
+
+        // Reply to our own sync request: "<sent millis>:<server ms>"
+        commandRegistry.registerCommand("sync", [this](const String& params) {
+            int split = params.indexOf(':');
+            if (split <= 0) return;
+            uint32_t sentAt = strtoul(params.substring(0, split).c_str(), NULL, 10);
+            uint32_t serverMs = strtoul(params.substring(split + 1).c_str(), NULL, 10);
+            // Stamped when the frame came off the socket, not when it was parsed
+            clock.addSample(sentAt, serverMs, (uint32_t)webSocketManager.getLastReceiveMs());
+        });
+    }
+
+    void update() override {
+        uint32_t now = millis();
+        if (webSocketManager.isConnected() && now - lastSyncAt >= syncInterval()) {
+            lastSyncAt = now;
+            webSocketManager.sendMessage("sync:" + String(now));
+        }
+        fireDue();
+
+        // Sleep until the next cue or sync, whichever is first
+        uint32_t next = lastSyncAt + syncInterval();
+        if (!queue.empty() && clock.isSynced()) {
+            uint32_t cueAt = clock.toLocal(queue.nextAt());
+            if ((int32_t)(cueAt - next) < 0) next = cueAt;
+        }
+        if ((int32_t)(next - now) <= 0) next = now + 1;
+        wakeAt(next);
+    }
+
+    const SharedClock& getClock() const { return clock; }
+    size_t getPendingCount() const { return queue.size(); }
+    uint32_t getLateCount() const { return late; }
+    uint32_t getDroppedCount() const { return dropped; }
+
+private:
+    SharedClock clock;
+    CueQueue queue;
+    uint32_t lastSyncAt;
+    uint32_t late;      // cues that arrived after their time and ran at once
+    uint32_t dropped;   // cues rejected as stale, too far out or not fitting
+
+    // Sync quickly until the sample window is full, then just track drift
+    uint32_t syncInterval() const {
+        return clock.getSampleCount() < CUE_SYNC_SAMPLES ? CUE_SYNC_FAST_INTERVAL_MS : CUE_SYNC_INTERVAL_MS;
+    }
+
+    void schedule(const String& params) {
+        int split = params.indexOf(':');
+        if (split <= 0 || split == (int)params.length() - 1) {
+            Serial.println("at format: <shared ms>:<command>[:<params>]");
+            return;
+        }
+        uint32_t at = strtoul(params.substring(0, split).c_str(), NULL, 10);
+        String command = params.substring(split + 1);
+
+        if (!clock.isSynced()) {
+            // No idea when T is here yet; better now than never
+            Serial.println("Cue: clock not synced, running now");
+            late++;
+            run(at, command, millis());
+            return;
+        }
+        int32_t until = (int32_t)(at - clock.sharedNow(millis()));
+        if (until < -(int32_t)CUE_MAX_LATE_MS || until > (int32_t)CUE_MAX_AHEAD_MS) {
+            dropped++;
+            Serial.print("Cue dropped, due in ");
+            Serial.print(until);
+            Serial.println(" ms");
+            return;
+        }
+        if (!queue.push(at, command.c_str())) {
+            dropped++;
+            Serial.println(queue.size() >= CUE_QUEUE_SIZE ? "Cue queue full" : "Cue command too long");
+            return;
+        }
+        if (until <= 0) late++;
+
+        // Come back in time for it, even if we were sleeping until later
+        uint32_t dueLocal = clock.toLocal(at);
+        if ((int32_t)(dueLocal - getNextWakeAt()) < 0) wakeAt(dueLocal);
+    }
+
+    void fireDue() {
+        if (!clock.isSynced()) return;
+        uint32_t at;
+        char text[CUE_MAX_COMMAND];
+        while (queue.popDue(clock.sharedNow(millis()), at, text)) {
+            run(at, String(text), clock.toLocal(at));
+        }
+    }
+
+    void run(uint32_t at, const String& command, uint32_t dueLocal) {
+        int split = command.indexOf(':');
+        String name = split >= 0 ? command.substring(0, split) : command;
+        String params = split >= 0 ? command.substring(split + 1) : String("");
+        Serial.print("Cue at ");
+        Serial.print(at);
+        Serial.print(": ");
+        Serial.println(command);
+        commandRegistry.executeCommandAt(name, params, dueLocal);
+    }
+};
+
+#endif // CUE_PROCESS_H
@@ -2,10 +2,14 @@
 #define IMU_PROCESS_H
 
 #include "Process.h"
-#include "Timer.h"
+#include "config.h"
+#include "SpscQueue.h"
+#include "EventBus.h"
+#include "processes/LedBehaviors.h"
 #include "SparkFun_LIS2DH12.h"
 #include <Wire.h>
 #include <math.h>
+#include <atomic>
 
 // Conversion factor from cm/s^2 to g. 1g = 980.665 cm/s^2
 #define CMS2_TO_G 0.0010197
@@ -21,17 +25,22 @@ struct IMUData {
 
 class IMUProcess : public Process {
 private:
-    Timer readTimer;
     SPARKFUN_LIS2DH12 sensor;       //Create instance
     bool sensorOk = false;
 
-    IMUData data;
-    bool tap = false;               // Tap detection flag
+    // Samples flow from update() (IMU task) to getIMUData() (network loop)
+    SpscQueue<IMUData, 8> samples;
+    IMUData latest = {0, 0, 0};
+    bool overThreshold = false;     // Previous sample was above the tap threshold
+
+    // Latest sample in mg for readers other than getIMUData(); each axis is
+    // atomic on its own, a reader may see axes from neighbouring samples
+    std::atomic<int16_t> xMg{0}, yMg{0}, zMg{0}, magnitudeMg{0};
     
 public:
-    IMUProcess() : 
-        readTimer(10) // Read every 10ms
-    {}
+    IMUProcess() {
+        setPeriod(IMU_UPDATE_INTERVAL_MS); // Read every 10ms
+    }
 
     void setup() override {        
         // The LIS2DH12 library uses Wire, so it should be initialized.
@@ -52,8 +61,9 @@ public:
     }
 
     void update() override {
-        if (sensorOk && readTimer.checkAndReset() && sensor.available()) {
+        if (sensorOk && sensor.available()) {
             // --- 1. Read and Convert Data ---            
+            IMUData data;
             data.x_g = sensor.getX() * CMS2_TO_G;
             data.y_g = sensor.getY() * CMS2_TO_G;
             data.z_g = sensor.getZ() * CMS2_TO_G;
@@ -61,21 +71,39 @@ public:
             // --- 2. Calculate acceleration magnitude ---
             float magnitude = sqrt(data.x_g * data.x_g + data.y_g * data.y_g + data.z_g * data.z_g);
             
-            // --- 3. Tap detection ---
-            if (magnitude > TAP_THRESHOLD) {
-                tap = true;
+            // --- 3. Tap detection: one TAP event per threshold crossing ---
+            bool above = magnitude > TAP_THRESHOLD;
+            if (above && !overThreshold) {
+                eventBus.publish(EventType::TAP, (uint32_t)(magnitude * 1000)); // mg
+                // Kick the spring from here: no trip through the main loop
+                ledsSpring.impulse((magnitude - TAP_THRESHOLD) * SPRING_TAP_IMPULSE);
             }
+            overThreshold = above;
+            xMg.store((int16_t)(data.x_g * 1000), std::memory_order_relaxed);
+            yMg.store((int16_t)(data.y_g * 1000), std::memory_order_relaxed);
+            zMg.store((int16_t)(data.z_g * 1000), std::memory_order_relaxed);
+            magnitudeMg.store((int16_t)(magnitude * 1000), std::memory_order_relaxed);
+            
+            // --- 4. Hand off to the consumer; drop the sample if it is behind ---
+            samples.push(data);
         }
     }
 
-    IMUData getIMUData() const {
-        return data;
+    // Latest sample; call from a single consumer context
+    IMUData getIMUData() {
+        IMUData sample;
+        while (samples.pop(sample)) {
+            latest = sample;
+        }
+        return latest;
     }
-    
-    bool isTapped() {
-        bool wasTapped = tap;
-        tap = false;  // Reset tap flag after reading
-        return wasTapped;
+
+    // Latest acceleration in mg; any context, any number of readers
+    void readMilliG(int16_t& x, int16_t& y, int16_t& z, int16_t& magnitude) const {
+        x = xMg.load(std::memory_order_relaxed);
+        y = yMg.load(std::memory_order_relaxed);
+        z = zMg.load(std::memory_order_relaxed);
+        magnitude = magnitudeMg.load(std::memory_order_relaxed);
     }
  
 };
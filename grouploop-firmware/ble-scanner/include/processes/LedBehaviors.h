@@ -1,9 +1,14 @@
 #ifndef LED_BEHAVIORS_H
 #define LED_BEHAVIORS_H
 
-#include <Adafruit_NeoPixel.h>
+#include <atomic>
+#include "LedCompositor.h"
+#include "LedLayout.h"
 #include "Timer.h"
 #include "Utils.h"
+#include "LedMath.h"
+#include "Timeline.h"
+#include "config.h"
 
 // --- LED Behavior Base Class ---
 class LedBehavior {
@@ -13,7 +18,7 @@ protected:
 public:
     const char* type;
     virtual ~LedBehavior() {}
-    virtual void setup(Adafruit_NeoPixel& pixels) {
+    virtual void setup(LedCanvas& pixels) {
         this->pixels = &pixels;
     }
     virtual void update() = 0;
@@ -22,6 +27,14 @@ public:
         updateTimer.resetMillis();
     }
 
+    // Make `localMs` (millis()) the start of the animation, e.g. the shared
+    // time a cue was due at, so devices started by one cue stay in phase.
+    // Frames also move onto a grid through that instant.
+    virtual void anchorAt(uint32_t localMs) {
+        updateTimer.started_at = localMs;
+        updateTimer.last_update = localMs;
+    }
+
     void setColor(uint32_t color) {
         this->color = color;        
     }
@@ -30,15 +43,22 @@ public:
         updateTimer.interval = interval;
     }
 
+    // Opacity the behavior wants for the overlay layer it is on, or -1 to
+    // keep the one it was put there with
+    virtual int16_t layerOpacity() const { return -1; }
+
 protected:
     LedBehavior(const char* type) : type(type) {        
+        // Frame ticks stay on a fixed grid even when the renderer is polled late
+        updateTimer.setFixedRate(TimerCatchUp::SKIP);
     }
-    Adafruit_NeoPixel* pixels;
+    LedCanvas* pixels;
+    // Brightness is perceptual; gamma maps it to PWM level (see LedMath.h)
     uint32_t scaleColor(uint32_t color, uint8_t brightness) {
-        uint8_t r = (uint8_t)(((color >> 16) & 0xFF) * brightness / 255);
-        uint8_t g = (uint8_t)(((color >> 8) & 0xFF) * brightness / 255);
-        uint8_t b = (uint8_t)((color & 0xFF) * brightness / 255);
-        return pixels->Color(r, g, b);
+#if LED_GAMMA_CORRECTION
+        brightness = ledGamma8(brightness);
+#endif
+        return ledScaleColor(color, brightness);
     }
 };
 
@@ -48,7 +68,7 @@ protected:
 class LedsOffBehavior : public LedBehavior {
 public:
     LedsOffBehavior() : LedBehavior("Off") {}
-    void setup(Adafruit_NeoPixel& pixels) override {
+    void setup(LedCanvas& pixels) override {
         LedBehavior::setup(pixels);
         this->pixels->clear();
         this->pixels->show();
@@ -65,7 +85,7 @@ public:
         setColor(color);
     }
   
-    void setup(Adafruit_NeoPixel& pixels) override {
+    void setup(LedCanvas& pixels) override {
         LedBehavior::setup(pixels);
         this->pixels->fill(color);
         this->pixels->show();
@@ -79,25 +99,33 @@ public:
 class BreathingBehavior : public LedBehavior {
 public:    
     uint32_t duration;
-    BreathingBehavior(uint32_t color, uint32_t duration) : LedBehavior("Breathing"), duration(duration) {
+    BreathingBehavior(uint32_t color, uint32_t duration)
+        : LedBehavior("Breathing"), duration(duration), phaseDuration(0), phaseStep(0) {
         setColor(color);
         setTimerInterval(1000 / 50);
     } // 50Hz for smooth animation
 
-    void setup(Adafruit_NeoPixel& pixels) override {
+    void setup(LedCanvas& pixels) override {
         LedBehavior::setup(pixels);
         updateTimer.reset();
     }
 
     void update() override {
         if (updateTimer.checkAndReset()) {
-            float sine_wave = sin(updateTimer.elapsed() * 2.0 * PI / duration); // 4-second period
-            uint8_t brightness = (uint8_t)(((sine_wave + 1.0) / 2.0) * 255.0);
+            if (duration != phaseDuration) {
+                phaseDuration = duration;
+                phaseStep = ledPhaseStep(duration);
+            }
+            uint8_t brightness = ledSin8((uint32_t)updateTimer.elapsed() * phaseStep);
             pixels->fill(scaleColor(color, brightness));
             pixels->show();
         }
     }
 
+private:
+    uint32_t phaseDuration;     // duration phaseStep was computed for
+    uint32_t phaseStep;
+
 };
 
 // 3. HeartBeatBehavior
@@ -117,7 +145,7 @@ public:
         setTimerInterval(20); // 50Hz update rate for smooth animation
     }    
 
-    void setup(Adafruit_NeoPixel& pixels) override {
+    void setup(LedCanvas& pixels) override {
         LedBehavior::setup(pixels);
         state = IDLE;
         stateStartTime = updateTimer.elapsed();
@@ -146,7 +174,7 @@ public:
                     pixels->show();
                     startState(FADE_OUT_1, getScaledDuration(FADE_OUT_1_DUR));
                 } else {
-                    uint8_t brightness = (elapsed * 255) / currentStateDuration;
+                    uint8_t brightness = ledRamp8(elapsed, currentStateDuration);
                     pixels->fill(scaleColor(color, brightness));
                     pixels->show();
                 }
@@ -159,7 +187,7 @@ public:
                     pixels->show();
                     startState(PAUSE, getScaledDuration(PAUSE_DUR));
                 } else {
-                    uint8_t brightness = 255 - (elapsed * 255 / currentStateDuration);
+                    uint8_t brightness = 255 - ledRamp8(elapsed, currentStateDuration);
                     pixels->fill(scaleColor(color, brightness));
                     pixels->show();
                 }
@@ -178,7 +206,7 @@ public:
                     pixels->show();
                     startState(FADE_OUT_2, getScaledDuration(FADE_OUT_2_DUR));
                 } else {
-                    uint8_t brightness = (elapsed * 255) / currentStateDuration;
+                    uint8_t brightness = ledRamp8(elapsed, currentStateDuration);
                     pixels->fill(scaleColor(color, brightness));
                     pixels->show();
                 }
@@ -191,7 +219,7 @@ public:
                     pixels->show();
                     startState(IDLE, pulse_interval);
                 } else {
-                    uint8_t brightness = 255 - (elapsed * 255 / currentStateDuration);
+                    uint8_t brightness = 255 - ledRamp8(elapsed, currentStateDuration);
                     pixels->fill(scaleColor(color, brightness));
                     pixels->show();
                 }
@@ -200,6 +228,13 @@ public:
         }
     }
 
+    void anchorAt(uint32_t localMs) override {
+        LedBehavior::anchorAt(localMs);
+        state = IDLE;
+        stateStartTime = 0;
+        currentStateDuration = pulse_interval;
+    }
+
     void setParams(uint32_t c, unsigned long dur, unsigned long inter) {
         setColor(c);
         pulse_duration = dur;
@@ -219,9 +254,12 @@ private:
     static const unsigned long FADE_IN_2_DUR = 60;
     static const unsigned long FADE_OUT_2_DUR = 400;
 
+    // States follow each other back to back from where the previous one was
+    // due to end, not from the frame that noticed it, so the beat keeps its
+    // phase instead of slipping by up to a frame per state
     void startState(BeatState newState, unsigned long duration) {
         state = newState;
-        stateStartTime = updateTimer.elapsed();
+        stateStartTime += currentStateDuration;
         currentStateDuration = duration;
     }
 
@@ -241,7 +279,7 @@ public:
         setTimerInterval(delay);
     }
 
-    void setup(Adafruit_NeoPixel& pixels) override {
+    void setup(LedCanvas& pixels) override {
         LedBehavior::setup(pixels);
         updateTimer.reset();
         currentPixel = 0;
@@ -261,31 +299,26 @@ private:
 };
 
 // 5. SpringBehavior - Implements Hooke's law for LED brightness
+// Parameters are given as floats and stepped in Q16.16 at a fixed
+// SPRING_STEP_MS (see FixedSpring); impulse() kicks it from any context.
 class SpringBehavior : public LedBehavior {
 public:
-    float targetBrightness;    // Target brightness (0.0 to 1.0)
-    float springConstant;      // Spring constant (k) - higher = stiffer spring
-    float damping;             // Damping factor (0.0 to 1.0) - higher = more damping
-    float mass;                // Mass of the spring system
-    
     SpringBehavior(uint32_t color, float targetBrightness = 0.0f, float springConstant = 20.1f, float damping = 2.0f, float mass = 1.0f) 
         : LedBehavior("Spring"), 
-          targetBrightness(targetBrightness),
-          springConstant(springConstant),
-          damping(damping),
-          mass(mass),
-          currentBrightness(1.0f),
-          velocity(0.0f),
+          spring(SPRING_STEP_MS, SPRING_MAX_STEPS),
+          pendingImpulse(0),
           lastUpdateTime(0) {
         setColor(color);
         setTimerInterval(16); // ~60Hz for smooth physics simulation
+        spring.setParams(springConstant, damping, mass);
+        spring.target = q16FromFloat(constrain(targetBrightness, 0.0f, 1.0f));
     }
 
-    void setup(Adafruit_NeoPixel& pixels) override {
+    void setup(LedCanvas& pixels) override {
         LedBehavior::setup(pixels);
         updateTimer.reset();
-        currentBrightness = 1.0f;
-        velocity = 0.0f;
+        spring.settle(Q16_ONE);
+        pendingImpulse.store(0, std::memory_order_relaxed);
         lastUpdateTime = 0;
     }
 
@@ -297,64 +330,46 @@ public:
                 return;
             }
             
-            // Calculate delta time in seconds
-            float deltaTime = (currentTime - lastUpdateTime) / 1000.0f;
+            spring.impulse(pendingImpulse.exchange(0, std::memory_order_relaxed));
+            spring.advance(currentTime - lastUpdateTime);
             lastUpdateTime = currentTime;
             
-            // Hooke's law: F = -k * x (where x is displacement from equilibrium)
-            float displacement = currentBrightness - targetBrightness;
-            float springForce = -springConstant * displacement;
-            
-            // Apply damping force (proportional to velocity)
-            float dampingForce = -damping * velocity;
-            
-            // Net force
-            float netForce = springForce + dampingForce;
-            
-            // Newton's second law: F = ma, so a = F/m
-            float acceleration = netForce / mass;
-            
-            // Update velocity and position using simple Euler integration
-            velocity += acceleration * deltaTime;
-            currentBrightness += velocity * deltaTime;
-            
-            // Clamp brightness to valid range
-            //currentBrightness = constrain(currentBrightness, 0.0f, 1.0f);
-            
-            // Convert to 8-bit brightness and apply to LEDs
-            uint8_t brightness = (uint8_t)(abs(currentBrightness) * 255.0f);
-            pixels->fill(scaleColor(color, brightness));
+            pixels->fill(scaleColor(color, spring.level()));
             pixels->show();
         }
     }
 
     void setTargetBrightness(float target) {
-        targetBrightness = constrain(target, 0.0f, 1.0f);
+        spring.target = q16FromFloat(constrain(target, 0.0f, 1.0f));
     }
 
     void setSpringParams(float k, float damp, float m) {
-        springConstant = k;
-        damping = damp;
-        mass = m;
+        spring.setParams(k, damp, m);
+    }
+
+    // Change in velocity (brightness per second), applied on the next frame.
+    // Safe from any task, e.g. the IMU's tap detection.
+    void impulse(float velocity) {
+        pendingImpulse.fetch_add(q16FromFloat(velocity), std::memory_order_relaxed);
     }
 
     void reset() override {
         LedBehavior::reset();
     
-        currentBrightness = 1.0f;
-        targetBrightness = 0.0f;
-        velocity = 0.0f;
+        spring.settle(Q16_ONE);
+        spring.target = 0;
         lastUpdateTime = 0;
     }
 
 private:
-    float currentBrightness;   // Current brightness (0.0 to 1.0)
-    float velocity;            // Current velocity of the spring
+    FixedSpring spring;
+    std::atomic<q16_t> pendingImpulse;
     unsigned long lastUpdateTime; // Last update time for delta calculation
 };
 
-// 6. IndividualLedBehavior - Control each of 6 LEDs independently
-class IndividualLedBehavior : public LedBehavior {
+// 6. IndividualLedBehavior - Control each LED of the layout independently
+template <typename Layout>
+class BasicIndividualLedBehavior : public LedBehavior {
 private:
     enum PatternMode {
         PATTERN_SOLID,
@@ -367,24 +382,26 @@ private:
         uint32_t color;
         uint8_t brightness;
     };
-    LedState ledStates[6];  // State for each of 6 LEDs
+    LedState ledStates[Layout::count];
     PatternMode patternMode;
     uint32_t breathingDurationMs;
+    uint32_t breathingPhaseStep;
     unsigned long heartbeatIntervalMs;
 
 public:
-    IndividualLedBehavior() : LedBehavior("Individual") {
+    BasicIndividualLedBehavior() : LedBehavior("Individual") {
         setTimerInterval(20); // 50Hz
         patternMode = PATTERN_SOLID;
         breathingDurationMs = 2000;
+        breathingPhaseStep = ledPhaseStep(breathingDurationMs);
         heartbeatIntervalMs = 2000;
         // Initialize all LEDs as off
-        for (int i = 0; i < 6; i++) {
+        for (uint16_t i = 0; i < Layout::count; i++) {
             ledStates[i] = {false, 0x000000, 255};
         }
     }
 
-    void setup(Adafruit_NeoPixel& pixels) override {
+    void setup(LedCanvas& pixels) override {
         LedBehavior::setup(pixels);
         updateTimer.reset();
         this->pixels->clear();
@@ -397,15 +414,15 @@ public:
         uint8_t frameBrightness = computeFrameBrightness();
 
         // Render each LED according to its individual state
-        for (int i = 0; i < 6; i++) {
+        Layout::forEach([&](uint16_t i) {
             if (ledStates[i].isOn) {
-                uint16_t combined = ((uint16_t)ledStates[i].brightness * (uint16_t)frameBrightness) / 255;
-                uint32_t scaledColor = scaleColor(ledStates[i].color, (uint8_t)combined);
+                uint8_t combined = ledScale8(ledStates[i].brightness, frameBrightness);
+                uint32_t scaledColor = scaleColor(ledStates[i].color, combined);
                 pixels->setPixelColor(i, scaledColor);
             } else {
                 pixels->setPixelColor(i, 0);  // Off
             }
-        }
+        });
         pixels->show();
     }
 
@@ -413,7 +430,7 @@ public:
         LedBehavior::reset();
         patternMode = PATTERN_SOLID;
         // Reset all LEDs to off
-        for (int i = 0; i < 6; i++) {
+        for (uint16_t i = 0; i < Layout::count; i++) {
             ledStates[i] = {false, 0x000000, 255};
         }
         pixels->clear();
@@ -422,21 +439,21 @@ public:
 
     // Set individual LED state
     void setLedOn(int index, uint32_t color, uint8_t brightness = 255) {
-        if (index >= 0 && index < 6) {
+        if (Layout::contains(index)) {
             ledStates[index] = {true, color, brightness};
         }
     }
 
     // Turn off individual LED
     void setLedOff(int index) {
-        if (index >= 0 && index < 6) {
+        if (Layout::contains(index)) {
             ledStates[index] = {false, 0x000000, 255};
         }
     }
 
     // Turn off all LEDs
     void clearAll() {
-        for (int i = 0; i < 6; i++) {
+        for (uint16_t i = 0; i < Layout::count; i++) {
             ledStates[i] = {false, 0x000000, 255};
         }
         if (pixels) {
@@ -452,6 +469,7 @@ public:
     void setPatternBreathing(uint32_t durationMs = 2000) {
         patternMode = PATTERN_BREATHING;
         breathingDurationMs = durationMs;
+        breathingPhaseStep = ledPhaseStep(durationMs);
     }
 
     void setPatternHeartBeat(unsigned long intervalMs = 2000) {
@@ -461,7 +479,7 @@ public:
 
     // Get current state of a specific LED
     bool isLedOn(int index) const {
-        if (index >= 0 && index < 6) {
+        if (Layout::contains(index)) {
             return ledStates[index].isOn;
         }
         return false;
@@ -469,7 +487,7 @@ public:
 
     // Get current color of a specific LED
     uint32_t getLedColor(int index) const {
-        if (index >= 0 && index < 6) {
+        if (Layout::contains(index)) {
             return ledStates[index].color;
         }
         return 0;
@@ -480,8 +498,7 @@ private:
         switch (patternMode) {
             case PATTERN_BREATHING: {
                 if (breathingDurationMs == 0) return 255;
-                float sine_wave = sin(updateTimer.elapsed() * 2.0 * PI / breathingDurationMs);
-                return (uint8_t)(((sine_wave + 1.0) / 2.0) * 255.0);
+                return ledSin8((uint32_t)updateTimer.elapsed() * breathingPhaseStep);
             }
             case PATTERN_HEARTBEAT:
                 return computeHeartBeatBrightness(updateTimer.elapsed());
@@ -514,11 +531,11 @@ private:
         t -= idle;
 
         if (t < fadeIn1) {
-            return (uint8_t)((t * 255UL) / fadeIn1);
+            return ledRamp8(t, fadeIn1);
         }
         t -= fadeIn1;
         if (t < fadeOut1) {
-            return (uint8_t)(255UL - ((t * 255UL) / fadeOut1));
+            return (uint8_t)(255 - ledRamp8(t, fadeOut1));
         }
         t -= fadeOut1;
         if (t < pause) {
@@ -526,16 +543,127 @@ private:
         }
         t -= pause;
         if (t < fadeIn2) {
-            return (uint8_t)((t * 255UL) / fadeIn2);
+            return ledRamp8(t, fadeIn2);
         }
         t -= fadeIn2;
         if (t < fadeOut2) {
-            return (uint8_t)(255UL - ((t * 255UL) / fadeOut2));
+            return (uint8_t)(255 - ledRamp8(t, fadeOut2));
         }
         return 0;
     }
 };
 
+typedef BasicIndividualLedBehavior<BoardLayout> IndividualLedBehavior;
+
+// 7. TimelineBehavior - Plays an uploaded keyframe program (see Timeline.h)
+// Two program buffers: the network loop loads into the one not playing and
+// the renderer switches over when it applies the TIMELINE command.
+template <typename Layout>
+class BasicTimelineBehavior : public LedBehavior {
+public:
+    BasicTimelineBehavior() : LedBehavior("Timeline"), active(0), swapPending(false) {
+        setTimerInterval(TIMELINE_FRAME_MS);
+    }
+
+    void setup(LedCanvas& pixels) override {
+        LedBehavior::setup(pixels);
+        restart();
+    }
+
+    void update() override {
+        if (!updateTimer.checkAndReset()) return;
+
+        TimelineProgram& program = programs[active];
+        if (!program.isLoaded()) {
+            pixels->clear();
+            pixels->show();
+            return;
+        }
+        uint32_t elapsed = updateTimer.elapsed();
+        program.render(program.localTime(elapsed), colors, levels, Layout::count);
+        Layout::forEach([&](uint16_t i) {
+            pixels->setPixelColor(i, scaleColor(colors[i], levels[i]));
+        });
+        pixels->show();
+    }
+
+    void reset() override {
+        restart();
+    }
+
+    // Network side: the buffer to load the next program into, or nullptr
+    // while the previous upload has not been picked up yet
+    TimelineProgram* beginLoad() {
+        if (swapPending.load(std::memory_order_acquire)) return nullptr;
+        return &programs[1 - active];
+    }
+
+    // Network side: the program filled in after beginLoad() is complete
+    void finishLoad() {
+        swapPending.store(true, std::memory_order_release);
+    }
+
+    // Renderer side: switch to the finished program and play it from zero
+    void activateLoaded() {
+        if (!swapPending.load(std::memory_order_acquire)) return;
+        active = 1 - active;
+        swapPending.store(false, std::memory_order_release);
+        restart();
+    }
+
+    const TimelineProgram& getProgram() const { return programs[active]; }
+
+private:
+    TimelineProgram programs[2];
+    uint8_t active;                 // renderer-owned; stable while no swap is pending
+    std::atomic<bool> swapPending;
+    uint32_t colors[Layout::count];
+    uint8_t levels[Layout::count];
+
+    void restart() {
+        updateTimer.resetMillis();
+        updateTimer.reset();
+    }
+};
+
+typedef BasicTimelineBehavior<BoardLayout> TimelineBehavior;
+
+// 8. ReactionBehavior - Shows what the reaction VM (ReactionProcess) writes.
+// The VM runs in the network loop; color and level cross over in one word.
+class ReactionBehavior : public LedBehavior {
+public:
+    ReactionBehavior() : LedBehavior("Reaction"), output(0), shownColor(NOT_SHOWN) {}
+
+    // Any context
+    void setOutput(uint32_t color, uint8_t level) {
+        output.store(((uint32_t)level << 24) | (color & 0xFFFFFF), std::memory_order_relaxed);
+    }
+
+    void setup(LedCanvas& pixels) override {
+        LedBehavior::setup(pixels);
+        shownColor = NOT_SHOWN;
+        update();
+    }
+
+    void update() override {
+        uint32_t color = output.load(std::memory_order_relaxed) & 0xFFFFFF;
+        if (color == shownColor) return;
+        shownColor = color;
+        pixels->fill(color);
+        pixels->show();
+    }
+
+    // The level decides how far the color covers the layers below
+    int16_t layerOpacity() const override {
+        return (int16_t)(output.load(std::memory_order_relaxed) >> 24);
+    }
+
+private:
+    static const uint32_t NOT_SHOWN = 0xFFFFFFFF;
+    std::atomic<uint32_t> output;
+    uint32_t shownColor;
+};
+
 // --- Global LED Behavior Instances ---
 // These instances are available globally to any file that includes LedBehaviors.h
 
@@ -547,5 +675,8 @@ extern HeartBeatBehavior ledsHeartBeat;
 extern CycleBehavior ledsCycle;
 extern SpringBehavior ledsSpring;
 extern IndividualLedBehavior ledsIndividual;
+extern TimelineBehavior ledsTimeline;
+extern SolidBehavior ledsFlash;
+extern ReactionBehavior ledsReaction;
 
 #endif // LED_BEHAVIORS_H 
\ No newline at end of file
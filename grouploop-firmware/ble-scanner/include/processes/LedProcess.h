@@ -1,31 +1,97 @@
 #ifndef LED_PROCESS_H
 #define LED_PROCESS_H
 
-#include <Adafruit_NeoPixel.h>
-#include <Ticker.h>
+#include "PixelFrame.h"
+#include "LedCompositor.h"
+#include "LedLayout.h"
+#include "EspPixelOutput.h"
 #include "Process.h"
 #include "config.h"
 #include "LedBehaviors.h"
 #include "Configuration.h"
 #include "CommandRegistry.h"
+#include "SpscQueue.h"
 
-class LedProcess : public Process {
-public:
-    LedProcess() : Process(), pixels(LED_COUNT, configuration.getLEDPin(), NEO_GRB + NEO_KHZ800), currentBehavior(nullptr) {
-    }
+// A change requested by a command handler or the main loop. LedProcess may
+// render from its own task, so other contexts never touch behavior state
+// directly: they post a command that is applied at the start of the next frame.
+struct LedCommand {
+    enum Type : uint8_t {
+        SET_BEHAVIOR,   // behavior
+        SET_COLOR,      // color, applied to all global behaviors
+        BREATHE,        // color, switch to breathing in that color
+        PATTERN,        // behavior; index = individual pattern in individual mode
+        RESET,
+        BRIGHTNESS,     // params[0]
+        SPRING_PARAMS,  // params = spring, damping, mass bytes
+        LED_SET,        // index, color
+        LED_OFF,        // index
+        LED_ALL_OFF,
+        TIMELINE,       // play the program just loaded into ledsTimeline
+        LAYER,          // index = layer, behavior (null clears it), params = opacity, blend; durationMs
+        FLASH,          // color, durationMs: fading flash on the top layer
+        SAVE_BEHAVIOR,  // behavior: remember the base behavior, then switch to this one
+        RESTORE_BEHAVIOR, // back to the behavior the last SAVE_BEHAVIOR remembered
+        REPORT          // print the renderer's state (led_get_state)
+    };
+    enum IndividualPattern : uint8_t { NONE, SOLID, BREATHING, HEARTBEAT };
 
-    ~LedProcess() {
-        ledTicker.detach();
+    Type type;
+    uint8_t index;
+    uint8_t params[3];
+    bool anchored;      // posted by a cue: animations start at anchorMs
+    bool unlessIndividual; // dropped if individual LED mode is on when applied
+    uint32_t color;
+    uint32_t anchorMs;  // millis() the cue was due at
+    uint32_t durationMs; // layer lifetime, 0 = until cleared
+    LedBehavior* behavior;
+};
+
+// Renders the behaviors for one board layout (see LedLayout.h)
+template <typename Layout>
+class BasicLedProcess : public Process {
+public:
+    BasicLedProcess()
+        : Process(), output(configuration.getLEDPin()), pixels(output, micros), currentBehavior(nullptr),
+          savedBehavior(nullptr) {
+        setPeriod(10); // Behaviors gate their own frame rate
+        for (size_t i = 0; i < LED_LAYERS; i++) overlays[i] = nullptr;
     }
 
+    // Apply a behavior immediately; only call from the rendering context
+    // (or before the process starts running). This is the base layer.
     void setBehavior(LedBehavior* newBehavior) {
+        detachOverlay(newBehavior);
         currentBehavior = newBehavior;
         if (currentBehavior) {
-            currentBehavior->setup(pixels);
+            currentBehavior->setup(compositor.canvas(0));
+        } else {
+            compositor.canvas(0).clear();
         }
     }
+
+    // Run a behavior on overlay layer 1..LED_LAYERS-1, blended over the
+    // layers below it; null clears the layer. A behavior draws on one layer
+    // at a time, so one already shown elsewhere moves here.
+    void setLayer(uint8_t layer, LedBehavior* behavior, uint8_t opacity, BlendMode mode,
+                  uint32_t startedAt, uint32_t lifetimeMs = 0, uint32_t fadeMs = 0) {
+        if (layer == 0 || layer >= LED_LAYERS) return;
+        if (!behavior) {
+            overlays[layer] = nullptr;
+            compositor.clearLayer(layer);
+            return;
+        }
+        if (behavior == currentBehavior) {
+            Serial.println("Layer: behavior is the base layer, not moving it");
+            return;
+        }
+        detachOverlay(behavior);
+        overlays[layer] = behavior;
+        compositor.setLayer(layer, opacity, mode, startedAt, lifetimeMs, fadeMs);
+        behavior->setup(compositor.canvas(layer));
+    }
     
-    // Change LED to a random non-red color
+    // Change LED to a random non-red color, unless in individual LED mode
     void changeToRandomColor() {
         // Array of non-red colors: green, blue, cyan, yellow, magenta, orange
         uint32_t colors[] = {
@@ -42,8 +108,9 @@ public:
         uint32_t selectedColor = colors[colorIndex];
         
         // Set the breathing behavior to the selected color
-        ledsBreathing.setColor(selectedColor);
-        setBehavior(&ledsBreathing);
+        LedCommand command = makeCommand(LedCommand::BREATHE, selectedColor);
+        command.unlessIndividual = true;
+        post(command);
         
         // Log the color change
         Serial.print("LED changed to random color: 0x");
@@ -56,36 +123,343 @@ public:
         Serial.println(colorNames[colorIndex]);
     }
     
-    // Set LED to red breathing (for WiFi disconnected state)
+    // Set LED to red breathing (for WiFi disconnected state), unless in
+    // individual LED mode
     void setToRedBreathing() {
-        ledsBreathing.setColor(0xFF0000); // Red
-        setBehavior(&ledsBreathing);
+        LedCommand command = makeCommand(LedCommand::BREATHE, 0xFF0000); // Red
+        command.unlessIndividual = true;
+        post(command);
         Serial.println("LED changed to red breathing (WiFi disconnected)");
     }
 
     void setup() override {        
         pixels.begin();
         pixels.setBrightness(255); // Don't set too high to avoid high current draw
-        // Use a lambda to call the member function, passing 'this'
-        ledTicker.attach_ms(20, +[](LedProcess* instance) { instance->update(); }, this);
         
         // Register LED commands
         registerCommands();
     }
 
     void update() override {
+        LedCommand command;
+        while (commands.pop(command)) {
+            apply(command);
+        }
+        
+        uint32_t now = millis();
+        uint32_t expired = compositor.expire(now);
+        for (size_t i = 1; i < LED_LAYERS; i++) {
+            if (expired & (1u << i)) overlays[i] = nullptr;
+        }
+
         if (currentBehavior) {
             currentBehavior->update();
         }
+        for (size_t i = 1; i < LED_LAYERS; i++) {
+            if (!overlays[i]) continue;
+            overlays[i]->update();
+            int16_t opacity = overlays[i]->layerOpacity();
+            if (opacity >= 0) compositor.setOpacity(i, (uint8_t)opacity);
+        }
+
+        // Behaviors only draw; the frame goes out once, blended and in
+        // data-line order
+        if (compositor.compose(now, frame)) {
+            Layout::forEach([this](uint16_t i) {
+                pixels.setPixelColor(Layout::physical[i], frame[i]);
+            });
+            pixels.show();
+        }
+        pixels.poll();
+    }
+
+    // Queue a change for the renderer; safe to call from the network loop.
+    // Commands posted while a cue runs carry its due time.
+    void post(LedCommand command) {
+        command.anchored = commandRegistry.getScheduledAt(command.anchorMs);
+        if (!commands.push(command)) {
+            Serial.println("LED command queue full, dropping command");
+        }
+    }
 
+    // Switch behavior from outside the rendering context
+    void requestBehavior(LedBehavior* behavior) {
+        LedCommand command = makeCommand(LedCommand::SET_BEHAVIOR);
+        command.behavior = behavior;
+        post(command);
     }
 
+    // Switch behavior for a while, e.g. during an OTA update, and go back
+    // with restoreBehavior(); the renderer remembers what was showing
+    void saveAndRequestBehavior(LedBehavior* behavior) {
+        LedCommand command = makeCommand(LedCommand::SAVE_BEHAVIOR);
+        command.behavior = behavior;
+        post(command);
+    }
+
+    void restoreBehavior() {
+        post(makeCommand(LedCommand::RESTORE_BEHAVIOR));
+    }
+
+    // Put a behavior on an overlay layer (null clears it) from outside the
+    // rendering context
+    void requestLayer(uint8_t layer, LedBehavior* behavior, uint8_t opacity, BlendMode mode, uint32_t lifetimeMs = 0) {
+        LedCommand command = makeCommand(LedCommand::LAYER);
+        command.index = layer;
+        command.behavior = behavior;
+        command.params[0] = opacity;
+        command.params[1] = (uint8_t)mode;
+        command.durationMs = lifetimeMs;
+        post(command);
+    }
+
+    // Frames shown, skipped as unchanged and time spent starting them
+    const PixelStats& getStats() const { return pixels.getStats(); }
+
+private:
+    LedPixelOutput output;
+
+public:
     // Public members for access by BleManager
-    Adafruit_NeoPixel pixels;
-    LedBehavior* currentBehavior;
+    BasicPixelFrame<Layout::count> pixels;
 
 private:
-    Ticker ledTicker;
+    // Renderer state: only read or written while applying commands and
+    // drawing frames, never from the network loop
+    LedBehavior* currentBehavior;
+    LedBehavior* savedBehavior;     // SAVE_BEHAVIOR's, for RESTORE_BEHAVIOR
+
+    // Network loop -> LED renderer
+    SpscQueue<LedCommand, 32> commands;
+
+    BasicLedCompositor<Layout::count, LED_LAYERS> compositor;
+    LedBehavior* overlays[LED_LAYERS];  // per layer; [0] is currentBehavior
+    uint32_t frame[Layout::count];
+
+    void detachOverlay(LedBehavior* behavior) {
+        if (!behavior) return;
+        for (size_t i = 1; i < LED_LAYERS; i++) {
+            if (overlays[i] == behavior) {
+                overlays[i] = nullptr;
+                compositor.clearLayer(i);
+            }
+        }
+    }
+
+    void printLayers() {
+        for (size_t i = 1; i < LED_LAYERS; i++) {
+            if (!overlays[i]) continue;
+            Serial.print("  Layer ");
+            Serial.print(i);
+            Serial.print(": ");
+            Serial.print(overlays[i]->type);
+            Serial.print(", opacity ");
+            Serial.println(compositor.opacityAt(i, millis()));
+        }
+    }
+
+    void printStats() {
+        const PixelStats& stats = pixels.getStats();
+        Serial.print("  Frames shown: ");
+        Serial.print(stats.shown);
+        Serial.print(", skipped: ");
+        Serial.print(stats.skipped);
+        Serial.print(", deferred: ");
+        Serial.println(stats.deferred);
+        Serial.print("  show(): avg ");
+        Serial.print(stats.shown ? stats.showMicros / stats.shown : 0);
+        Serial.print(" us, max ");
+        Serial.print(stats.maxShowMicros);
+        Serial.println(" us");
+    }
+
+    static LedCommand makeCommand(LedCommand::Type type, uint32_t color = 0) {
+        LedCommand command = {};
+        command.type = type;
+        command.color = color;
+        return command;
+    }
+
+    void apply(const LedCommand& command) {
+        // Decided here rather than by the sender: the mode may change while
+        // the command waits in the queue
+        if (command.unlessIndividual && currentBehavior == &ledsIndividual) return;
+        applyChange(command);
+
+        // A cued animation runs from the cue's time, however late it got here
+        LedBehavior* started = startedBehavior(command);
+        if (command.anchored && started) {
+            started->anchorAt(command.anchorMs);
+        }
+    }
+
+    LedBehavior* startedBehavior(const LedCommand& command) {
+        switch (command.type) {
+            case LedCommand::SET_BEHAVIOR:
+            case LedCommand::BREATHE:
+            case LedCommand::PATTERN:
+            case LedCommand::RESET:
+            case LedCommand::TIMELINE:
+            case LedCommand::SAVE_BEHAVIOR:
+            case LedCommand::RESTORE_BEHAVIOR:
+                return currentBehavior;
+            case LedCommand::LAYER:
+                return command.behavior;
+            default:
+                return nullptr;
+        }
+    }
+
+    void applyChange(const LedCommand& command) {
+        switch (command.type) {
+            case LedCommand::SET_BEHAVIOR:
+                setBehavior(command.behavior);
+                break;
+                
+            case LedCommand::SET_COLOR:
+                // If we are in individual mode, exit to a global mode so legacy
+                // led/pattern flows from device-control keep working.
+                if (currentBehavior == &ledsIndividual) {
+                    setBehavior(&ledsSolid);
+                }
+
+                // Keep global behaviors in sync with the latest chosen color.
+                ledsSolid.setColor(command.color);
+                ledsBreathing.setColor(command.color);
+                ledsHeartBeat.setColor(command.color);
+                ledsCycle.setColor(command.color);
+                ledsSpring.setColor(command.color);
+
+                if (currentBehavior) {
+                    currentBehavior->setColor(command.color);
+                }
+                break;
+                
+            case LedCommand::BREATHE:
+                ledsBreathing.setColor(command.color);
+                setBehavior(&ledsBreathing);
+                break;
+                
+            case LedCommand::PATTERN:
+                if (currentBehavior == &ledsIndividual && command.index != LedCommand::NONE) {
+                    if (command.index == LedCommand::SOLID) ledsIndividual.setPatternSolid();
+                    else if (command.index == LedCommand::BREATHING) ledsIndividual.setPatternBreathing();
+                    else if (command.index == LedCommand::HEARTBEAT) ledsIndividual.setPatternHeartBeat();
+                } else {
+                    setBehavior(command.behavior);
+                }
+                break;
+                
+            case LedCommand::RESET:
+                if (currentBehavior) {
+                    currentBehavior->reset();
+                }
+                break;
+                
+            case LedCommand::BRIGHTNESS:
+                pixels.setBrightness(command.params[0]);
+                break;
+                
+            case LedCommand::SPRING_PARAMS:
+                // Scale bytes to appropriate ranges
+                ledsSpring.setSpringParams(command.params[0] / 10.0f,          // 0.0 to 25.5
+                                           command.params[1] / 10.0f,          // 0.0 to 25.5
+                                           (command.params[2] / 10.0f) + 0.1f); // 0.1 to 25.6
+                break;
+                
+            case LedCommand::LED_SET:
+                setBehavior(&ledsIndividual);
+                ledsIndividual.setLedOn(command.index, command.color);
+                break;
+                
+            case LedCommand::LED_OFF:
+                if (currentBehavior != &ledsIndividual) {
+                    setBehavior(&ledsIndividual);
+                }
+                ledsIndividual.setLedOff(command.index);
+                break;
+                
+            case LedCommand::LED_ALL_OFF:
+                setBehavior(&ledsIndividual);
+                ledsIndividual.clearAll();
+                break;
+                
+            case LedCommand::TIMELINE:
+                ledsTimeline.activateLoaded();
+                if (currentBehavior != &ledsTimeline) {
+                    setBehavior(&ledsTimeline);
+                }
+                break;
+
+            case LedCommand::LAYER: {
+                // Lifetimes count from the cue's time too
+                uint32_t startedAt = command.anchored ? command.anchorMs : millis();
+                uint32_t fadeMs = command.durationMs < LED_LAYER_FADE_MS ? command.durationMs : LED_LAYER_FADE_MS;
+                setLayer(command.index, command.behavior, command.params[0], (BlendMode)command.params[1],
+                         startedAt, command.durationMs, fadeMs);
+                break;
+            }
+
+            case LedCommand::FLASH: {
+                uint32_t startedAt = command.anchored ? command.anchorMs : millis();
+                ledsFlash.setColor(command.color);
+                // Decays over its whole life, added to whatever is below
+                setLayer(LED_LAYERS - 1, &ledsFlash, 255, BlendMode::ADD,
+                         startedAt, command.durationMs, command.durationMs);
+                break;
+            }
+
+            case LedCommand::SAVE_BEHAVIOR:
+                savedBehavior = currentBehavior;
+                setBehavior(command.behavior);
+                break;
+
+            case LedCommand::RESTORE_BEHAVIOR:
+                if (savedBehavior) setBehavior(savedBehavior);
+                savedBehavior = nullptr;
+                break;
+
+            case LedCommand::REPORT:
+                printState();
+                break;
+        }
+    }
+
+    // Runs in the rendering context, after every change queued before the
+    // led_get_state that asked for it
+    void printState() {
+        Serial.println("LED States:");
+        if (currentBehavior == &ledsIndividual) {
+            for (uint16_t i = 0; i < Layout::count; i++) {
+                Serial.print("  LED ");
+                Serial.print(i);
+                Serial.print(": ");
+                if (ledsIndividual.isLedOn(i)) {
+                    Serial.print("ON  color=0x");
+                    Serial.println(ledsIndividual.getLedColor(i), HEX);
+                } else {
+                    Serial.println("OFF");
+                }
+            }
+        } else {
+            Serial.print("Current behavior: ");
+            Serial.println(currentBehavior ? currentBehavior->type : "none");
+        }
+        printLayers();
+        printStats();
+    }
+
+    // Behaviors the pattern and layer commands take by name
+    static LedBehavior* behaviorNamed(const String& name) {
+        if (name == "breathing") return &ledsBreathing;
+        if (name == "heartbeat") return &ledsHeartBeat;
+        if (name == "solid") return &ledsSolid;
+        if (name == "cycle") return &ledsCycle;
+        if (name == "spring") return &ledsSpring;
+        if (name == "timeline") return &ledsTimeline;
+        if (name == "off") return &ledsOff;
+        return nullptr;
+    }
     
     void registerCommands() {
         // Register LED command
@@ -93,23 +467,7 @@ private:
             if (params.length() == 0) return;             
             // Try to parse as hex color
             unsigned long color = strtoul(params.c_str(), NULL, 16);
-
-            // If we are in individual mode, exit to a global mode so legacy
-            // led/pattern flows from device-control keep working.
-            if (currentBehavior == &ledsIndividual) {
-                setBehavior(&ledsSolid);
-            }
-
-            // Keep global behaviors in sync with the latest chosen color.
-            ledsSolid.setColor(color);
-            ledsBreathing.setColor(color);
-            ledsHeartBeat.setColor(color);
-            ledsCycle.setColor(color);
-            ledsSpring.setColor(color);
-
-            if (currentBehavior) {
-                currentBehavior->setColor(color);
-            }
+            post(makeCommand(LedCommand::SET_COLOR, color));
             Serial.print("Set LED color to: ");
             Serial.println(params);
         
@@ -117,64 +475,37 @@ private:
         
         // Register pattern command
         commandRegistry.registerCommand("pattern", [this](const String& params) {
-            if (params == "breathing") {
-                if (currentBehavior == &ledsIndividual) {
-                    ledsIndividual.setPatternBreathing();
-                    Serial.println("Set individual LED pattern to breathing");
-                } else {
-                    setBehavior(&ledsBreathing);
-                    Serial.println("Set LED pattern to breathing");
-                }
-            }
-            else if (params == "heartbeat") {
-                if (currentBehavior == &ledsIndividual) {
-                    ledsIndividual.setPatternHeartBeat();
-                    Serial.println("Set individual LED pattern to heartbeat");
-                } else {
-                    setBehavior(&ledsHeartBeat);
-                    Serial.println("Set LED pattern to heartbeat");
-                }
-            }
-            else if (params == "solid") {
-                if (currentBehavior == &ledsIndividual) {
-                    ledsIndividual.setPatternSolid();
-                    Serial.println("Set individual LED pattern to solid");
-                } else {
-                    setBehavior(&ledsSolid);
-                    Serial.println("Set LED pattern to solid");
-                }
-            }
-            else if (params == "cycle") {
-                setBehavior(&ledsCycle);
-                Serial.println("Set LED pattern to cycle");
-            }
-            else if (params == "spring") {
-                setBehavior(&ledsSpring);
-                Serial.println("Set LED pattern to spring");
-            }
-            else if (params == "off") {
-                setBehavior(&ledsOff);
-                Serial.println("Set LED pattern to off");
-            }
-            else {
+            LedCommand command = makeCommand(LedCommand::PATTERN);
+            command.behavior = behaviorNamed(params);
+            if (!command.behavior) {
                 Serial.print("Unknown pattern: ");
                 Serial.println(params);
+                return;
             }
+
+            // breathing/heartbeat/solid also apply per-LED in individual mode
+            command.index = LedCommand::NONE;
+            if (command.behavior == &ledsBreathing) command.index = LedCommand::BREATHING;
+            else if (command.behavior == &ledsHeartBeat) command.index = LedCommand::HEARTBEAT;
+            else if (command.behavior == &ledsSolid) command.index = LedCommand::SOLID;
+            post(command);
+            Serial.print("Set LED pattern to ");
+            Serial.println(params);
         });
         
         // Register reset command
         commandRegistry.registerCommand("reset", [this](const String& params) {
-            if (currentBehavior) {
-                currentBehavior->reset();
-                Serial.println("Reset LED pattern");
-            }
+            post(makeCommand(LedCommand::RESET));
+            Serial.println("Reset LED pattern");
         });
 
         // Register brightness command
         commandRegistry.registerCommand("brightness", [this](const String& params) {
             int brightness = params.toInt();
             if (brightness >= 0 && brightness <= 255) {
-                pixels.setBrightness(brightness);
+                LedCommand command = makeCommand(LedCommand::BRIGHTNESS);
+                command.params[0] = brightness;
+                post(command);
                 Serial.print("Set LED brightness to: ");
                 Serial.println(brightness);
             } else {
@@ -194,24 +525,18 @@ private:
                 String dampingHex = params.substring(2, 4);
                 String massHex = params.substring(4, 6);
                 
-                uint8_t springByte = strtol(springHex.c_str(), NULL, 16);
-                uint8_t dampingByte = strtol(dampingHex.c_str(), NULL, 16);
-                uint8_t massByte = strtol(massHex.c_str(), NULL, 16);
-                
-                // Scale bytes to appropriate ranges
-                float springConstant = springByte / 10.0f;  // 0.0 to 25.5
-                float dampingConstant = dampingByte / 10.0f; // 0.0 to 25.5
-                float mass = (massByte / 10.0f) + 0.1f;     // 0.1 to 25.6
-                
-                // Apply to spring behavior
-                ledsSpring.setSpringParams(springConstant, dampingConstant, mass);
+                LedCommand command = makeCommand(LedCommand::SPRING_PARAMS);
+                command.params[0] = strtol(springHex.c_str(), NULL, 16);
+                command.params[1] = strtol(dampingHex.c_str(), NULL, 16);
+                command.params[2] = strtol(massHex.c_str(), NULL, 16);
+                post(command);
                 
                 Serial.print("Set spring parameters - k: ");
-                Serial.print(springConstant, 1);
+                Serial.print(command.params[0] / 10.0f, 1);
                 Serial.print(", damping: ");
-                Serial.print(dampingConstant, 1);
+                Serial.print(command.params[1] / 10.0f, 1);
                 Serial.print(", mass: ");
-                Serial.println(mass, 1);
+                Serial.println((command.params[2] / 10.0f) + 0.1f, 1);
             } else {
                 Serial.println("spring_param requires 6 hex characters (e.g., AA100D)");
             }
@@ -221,12 +546,9 @@ private:
         // Format: led_set:<index>:<color_hex>
         // Example: led_set:0:ff0000 (LED 0, red)
         commandRegistry.registerCommand("led_set", [this](const String& params) {
-            // Switch to individual LED behavior
-            setBehavior(&ledsIndividual);
-            
             // Parse params: index:color
             int colonIndex = params.indexOf(':');
-            if (colonIndex <= 0 || colonIndex >= params.length() - 1) {
+            if (colonIndex <= 0 || colonIndex >= (int)params.length() - 1) {
                 Serial.println("led_set format: <index>:<color_hex>");
                 return;
             }
@@ -235,8 +557,11 @@ private:
             String colorStr = params.substring(colonIndex + 1);
             unsigned long color = strtoul(colorStr.c_str(), NULL, 16);
             
-            if (index >= 0 && index < 6) {
-                ledsIndividual.setLedOn(index, color);
+            if (Layout::contains(index)) {
+                // Switches to individual LED behavior
+                LedCommand command = makeCommand(LedCommand::LED_SET, color);
+                command.index = index;
+                post(command);
                 Serial.print("Set LED ");
                 Serial.print(index);
                 Serial.print(" to color 0x");
@@ -251,14 +576,12 @@ private:
         // Format: led_off:<index>
         // Example: led_off:0 (turn off LED 0)
         commandRegistry.registerCommand("led_off", [this](const String& params) {
-            // Switch to individual LED behavior if not already
-            if (currentBehavior != &ledsIndividual) {
-                setBehavior(&ledsIndividual);
-            }
-            
             int index = params.toInt();
-            if (index >= 0 && index < 6) {
-                ledsIndividual.setLedOff(index);
+            if (Layout::contains(index)) {
+                // Switches to individual LED behavior if not already
+                LedCommand command = makeCommand(LedCommand::LED_OFF);
+                command.index = index;
+                post(command);
                 Serial.print("Turned off LED ");
                 Serial.println(index);
             } else {
@@ -269,33 +592,113 @@ private:
 
         // Register led_all_off command - Turn off all LEDs
         commandRegistry.registerCommand("led_all_off", [this](const String& params) {
-            // Switch to individual LED behavior
-            setBehavior(&ledsIndividual);
-            ledsIndividual.clearAll();
+            // Switches to individual LED behavior
+            post(makeCommand(LedCommand::LED_ALL_OFF));
             Serial.println("Turned off all LEDs");
         });
 
-        // Register led_get_state command - Get state of all LEDs (for debugging)
-        commandRegistry.registerCommand("led_get_state", [this](const String& params) {
-            Serial.println("LED States:");
-            if (currentBehavior == &ledsIndividual) {
-                for (int i = 0; i < 6; i++) {
-                    Serial.print("  LED ");
-                    Serial.print(i);
-                    Serial.print(": ");
-                    if (ledsIndividual.isLedOn(i)) {
-                        Serial.print("ON  color=0x");
-                        Serial.println(ledsIndividual.getLedColor(i), HEX);
-                    } else {
-                        Serial.println("OFF");
-                    }
+        // Register timeline command - Upload a keyframe program and play it
+        // Format: timeline:<hex> (binary format in Timeline.h)
+        commandRegistry.registerCommand("timeline", [this](const String& params) {
+            TimelineProgram* program = ledsTimeline.beginLoad();
+            if (!program) {
+                Serial.println("Timeline: previous upload not applied yet, try again");
+                return;
+            }
+            if (!program->loadHex(params.c_str())) {
+                Serial.print("Timeline rejected: ");
+                Serial.println(program->getError());
+                return;
+            }
+            ledsTimeline.finishLoad();
+            post(makeCommand(LedCommand::TIMELINE));
+            Serial.print("Timeline loaded: ");
+            Serial.print(program->getTrackCount());
+            Serial.print(" tracks, ");
+            Serial.print(program->getKeyCount());
+            Serial.print(" keys, ");
+            Serial.print(program->getDurationMs());
+            Serial.println(program->loops() ? " ms, looping" : " ms");
+        });
+
+        // Register layer command - Run a pattern over the base animation
+        // Format: layer:<1..LED_LAYERS-1>:<pattern|none>:<opacity>:<blend>:<lifetime ms, 0 = until cleared>
+        // Example: layer:1:heartbeat:128:add:0
+        commandRegistry.registerCommand("layer", [this](const String& params) {
+            String fields[5];
+            int start = 0;
+            for (int i = 0; i < 5; i++) {
+                int end = i < 4 ? params.indexOf(':', start) : (int)params.length();
+                if (end < 0) {
+                    Serial.println("layer format: <layer>:<pattern|none>:<opacity>:<blend>:<lifetime ms>");
+                    return;
                 }
-            } else {
-                Serial.print("Current behavior: ");
-                Serial.println(currentBehavior->type);
+                fields[i] = params.substring(start, end);
+                start = end + 1;
             }
+
+            LedCommand command = makeCommand(LedCommand::LAYER);
+            int layer = fields[0].toInt();
+            int opacity = fields[2].toInt();
+            BlendMode mode;
+            if (layer < 1 || layer >= LED_LAYERS) {
+                Serial.print("Layer out of range: ");
+                Serial.println(layer);
+                return;
+            }
+            if (fields[1] != "none") {
+                command.behavior = behaviorNamed(fields[1]);
+                if (!command.behavior) {
+                    Serial.print("Unknown pattern: ");
+                    Serial.println(fields[1]);
+                    return;
+                }
+            }
+            if (opacity < 0 || opacity > 255) {
+                Serial.println("Layer opacity must be between 0 and 255");
+                return;
+            }
+            if (!parseBlendMode(fields[3].c_str(), mode)) {
+                Serial.print("Unknown blend mode: ");
+                Serial.println(fields[3]);
+                return;
+            }
+            command.index = layer;
+            command.params[0] = opacity;
+            command.params[1] = (uint8_t)mode;
+            command.durationMs = strtoul(fields[4].c_str(), NULL, 10);
+            post(command);
+            Serial.print("Layer ");
+            Serial.print(layer);
+            Serial.print(": ");
+            Serial.println(fields[1]);
+        });
+
+        // Register flash command - Fading flash over whatever is showing
+        // Format: flash:<color_hex>:<ms>
+        commandRegistry.registerCommand("flash", [this](const String& params) {
+            int colonIndex = params.indexOf(':');
+            if (colonIndex <= 0 || colonIndex >= (int)params.length() - 1) {
+                Serial.println("flash format: <color_hex>:<ms>");
+                return;
+            }
+            LedCommand command = makeCommand(LedCommand::FLASH, strtoul(params.substring(0, colonIndex).c_str(), NULL, 16));
+            command.durationMs = strtoul(params.substring(colonIndex + 1).c_str(), NULL, 10);
+            if (command.durationMs == 0) {
+                Serial.println("flash needs a duration");
+                return;
+            }
+            post(command);
+        });
+
+        // Register led_get_state command - Get state of all LEDs (for debugging)
+        // The renderer prints it once it has applied the commands before it
+        commandRegistry.registerCommand("led_get_state", [this](const String& params) {
+            post(makeCommand(LedCommand::REPORT));
         });
     }
 };
 
+typedef BasicLedProcess<BoardLayout> LedProcess;
+
 #endif // LED_PROCESS_H 
\ No newline at end of file
@@ -4,87 +4,189 @@
 #include "Process.h"
 #include "ProcessManager.h"
 #include "CommandRegistry.h"
+#include "EventBus.h"
+#include "Configuration.h"
+#include "WebSocketManager.h"
+#include "OtaEngine.h"
+#include "EspOtaTransport.h"
+#include "Timer.h"
+#include "config.h"
 #include "processes/LedProcess.h"
-#include <HTTPUpdate.h>
-#include <WiFiClient.h>
-#include <WiFiClientSecure.h>
+#include <ArduinoJson.h>
+
+typedef OtaEngine<OTA_CHUNK_SIZE> FirmwareOtaEngine;
+typedef DecodingFlashWriter<OTA_CHUNK_SIZE> FirmwareImageDecoder;
 
 class OTAProcess : public Process {
 public:
-    OTAProcess() : Process(), otaBreathing(0x00FF00, 500) {}
+    OTAProcess()
+        : Process(),
+          otaBreathing(0x00FF00, 500),
+          decoder(flash, &runningPartition, OTA_DECODE_BUDGET),
+          engine(source, decoder, engineConfig()),
+          progressTimer(OTA_PROGRESS_INTERVAL_MS, TimerCatchUp::SKIP),
+          restartTimer(OTA_RESTART_DELAY_MS),
+          lastReportedState(FirmwareOtaEngine::State::IDLE),
+          restartPending(false)
+    {
+        setPeriod(OTA_IDLE_INTERVAL_MS);
+    }
 
     void setup() override {
+        // "ota:<url> <sha256>" downloads, verifies and flashes in the background;
+        // "ota:abort" cancels a running update
         commandRegistry.registerCommand("ota", [this](const String& params) {
-            if (params.length() == 0) {
-                Serial.println("OTA: no URL provided");
+            if (params == "abort") {
+                engine.abort(millis());
                 return;
             }
-            performUpdate(params);
+            startUpdate(params);
         });
         Serial.println("OTA process ready");
     }
 
     void update() override {
-        // OTA is command-triggered; nothing to poll
+        uint32_t now = millis();
+
+        if (restartPending) {
+            if (restartTimer.checkAndReset()) {
+                Serial.println("OTA: rebooting into new firmware");
+                configuration.save();   // settings still waiting for their batch
+                ESP.restart();
+            }
+            return;
+        }
+
+        engine.step(now);
+
+        FirmwareOtaEngine::State state = engine.getState();
+        if (state != lastReportedState) {
+            lastReportedState = state;
+            sendProgress();
+            if (state == FirmwareOtaEngine::State::DONE) {
+                onDone();
+            } else if (state == FirmwareOtaEngine::State::FAILED) {
+                onFailed();
+            }
+        } else if (engine.isActive() && progressTimer.checkAndReset()) {
+            sendProgress();
+        }
+    }
+
+    bool isUpdating() const {
+        return engine.isActive();
     }
 
 private:
     BreathingBehavior otaBreathing;
+    HttpOtaSource source;
+    UpdateFlashWriter flash;
+    RunningPartitionReader runningPartition;
+    FirmwareImageDecoder decoder;   // plain, compressed (.glz) or delta (.gld) images
+    FirmwareOtaEngine engine;
+    Timer progressTimer;
+    Timer restartTimer;
+    FirmwareOtaEngine::State lastReportedState;
+    bool restartPending;
+
+    static OtaEngineConfig engineConfig() {
+        OtaEngineConfig config;
+        config.chunksPerStep = OTA_CHUNKS_PER_STEP;
+        config.maxRetries = OTA_MAX_RETRIES;
+        config.retryDelayMs = OTA_RETRY_DELAY_MS;
+        config.stallTimeoutMs = OTA_HTTP_TIMEOUT_MS;
+        return config;
+    }
+
+    void startUpdate(const String& params) {
+        if (engine.isActive() || restartPending) {
+            Serial.println("OTA: update already in progress");
+            return;
+        }
+
+        // The digest follows the URL after a space or a colon (the hub joins
+        // parameters with ':'); URLs contain colons, so split at the last one
+        String trimmed = params;
+        trimmed.trim();
+        int space = trimmed.lastIndexOf(' ');
+        int colon = trimmed.lastIndexOf(':');
+        int split = space > colon ? space : colon;
+        String url = split >= 0 ? trimmed.substring(0, split) : trimmed;
+        String digestHex = split >= 0 ? trimmed.substring(split + 1) : String("");
+        url.trim();
+        uint8_t digest[Sha256::DIGEST_SIZE];
+        if (url.length() == 0 || !Sha256::parseHex(digestHex.c_str(), digest)) {
+            Serial.println("OTA: expected '<url> <sha256>'");
+            return;
+        }
 
-    void performUpdate(const String& url) {
         Serial.print("OTA: starting update from ");
         Serial.println(url);
 
-        // Halt non-essential processes to free resources
-        if (processManager) {
-            processManager->haltProcess("ble");
-            processManager->haltProcess("publish");
-        }
+        // Subscribers halt non-essential processes to free resources
+        eventBus.publish(EventType::OTA_STARTED);
+        eventBus.dispatch();
 
         // Switch LED to fast green breathing during update
         LedProcess* ledProcess = static_cast<LedProcess*>(processManager->getProcess("led"));
-        LedBehavior* previousBehavior = ledProcess ? ledProcess->currentBehavior : nullptr;
         if (ledProcess) {
-            ledProcess->setBehavior(&otaBreathing);
+            ledProcess->saveAndRequestBehavior(&otaBreathing);
         }
 
-        httpUpdate.rebootOnUpdate(true);
+        source.setUrl(url);
+        engine.start(digest, millis());
+        progressTimer.reset();
 
-        t_httpUpdate_return result;
+        // Step the download quickly while it runs, and start right away
+        setPeriod(OTA_STEP_INTERVAL_MS);
+        wakeAt(millis());
+    }
 
-        if (url.startsWith("https://")) {
-            WiFiClientSecure client;
-            client.setInsecure(); // accept self-signed certs
-            result = httpUpdate.update(client, url);
-        } else {
-            WiFiClient client;
-            result = httpUpdate.update(client, url);
-        }
+    void onDone() {
+        Serial.println("OTA: image verified and activated");
+        restartPending = true;
+        restartTimer.reset();   // give the final progress frame time to go out
+    }
+
+    void onFailed() {
+        Serial.print("OTA: failed (");
+        Serial.print(FirmwareOtaEngine::errorName(engine.getError()));
+        Serial.println(")");
+        LedProcess* ledProcess = static_cast<LedProcess*>(processManager->getProcess("led"));
+        if (ledProcess) ledProcess->restoreBehavior();
+        resumeProcesses();
+        setPeriod(OTA_IDLE_INTERVAL_MS);
+    }
 
-        switch (result) {
-            case HTTP_UPDATE_OK:
-                // rebootOnUpdate(true) means we never reach here
-                Serial.println("OTA: update applied, rebooting");
-                break;
-            case HTTP_UPDATE_NO_UPDATES:
-                Serial.println("OTA: server reported no update needed");
-                if (ledProcess && previousBehavior) ledProcess->setBehavior(previousBehavior);
-                resumeProcesses();
-                break;
-            case HTTP_UPDATE_FAILED:
-                Serial.printf("OTA: failed (%d) %s\n",
-                    httpUpdate.getLastError(),
-                    httpUpdate.getLastErrorString().c_str());
-                if (ledProcess && previousBehavior) ledProcess->setBehavior(previousBehavior);
-                resumeProcesses();
-                break;
+    // {"type":"ota","id":..,"state":..,"bytes":..,"total":..,"pct":..,"format":..}
+    void sendProgress() {
+        JsonDocument doc;
+        doc["type"] = "ota";
+        doc["id"] = webSocketManager.getDeviceId();
+        doc["state"] = FirmwareOtaEngine::stateName(engine.getState());
+        doc["bytes"] = engine.getWritten();
+        doc["total"] = engine.getTotal();
+        doc["pct"] = engine.getPercent();
+        if (decoder.getFormat() != FirmwareImageDecoder::Format::UNKNOWN) {
+            doc["format"] = FirmwareImageDecoder::formatName(decoder.getFormat());
+        }
+        if (engine.getResumes() > 0) {
+            doc["resumes"] = engine.getResumes();
+        }
+        if (engine.getState() == FirmwareOtaEngine::State::FAILED) {
+            doc["error"] = FirmwareOtaEngine::errorName(engine.getError());
         }
+        String json;
+        serializeJson(doc, json);
+        Serial.println(json);
+        webSocketManager.sendMessage(json);
     }
 
     void resumeProcesses() {
         if (processManager) {
             processManager->startProcess("ble");
             processManager->startProcess("publish");
+            processManager->startProcess("vibration");
         }
     }
 };
@@ -0,0 +1,220 @@
+#ifndef POWER_PROCESS_H
+#define POWER_PROCESS_H
+
+#include "Process.h"
+#include "ProcessManager.h"
+#include "CommandRegistry.h"
+#include "EventBus.h"
+#include "WebSocketManager.h"
+#include "PowerPolicy.h"
+#include "EnergyModel.h"
+#include "Configuration.h"
+#include "config.h"
+#include "processes/OTAProcess.h"
+#include <ArduinoJson.h>
+#include <WiFi.h>
+#include <esp_wifi.h>
+#if CONFIG_PM_ENABLE
+#include <esp_idf_version.h>
+#include <esp_pm.h>
+#endif
+
+// Applies the selected PowerMode: WiFi modem sleep, CPU clock (scaled down
+// while idle when the SDK has power management enabled) and the DTIM slots
+// PublishProcess sends in. An OTA download runs at full power regardless.
+class PowerProcess : public Process {
+public:
+    PowerProcess()
+        : Process(),
+          mode(POWER_DEFAULT_MODE),
+          schedule(POWER_BEACON_INTERVAL_MS * POWER_DTIM_PERIOD, POWER_DTIM_GUARD_MS),
+          wifiUp(false),
+          boosted(false),
+          scaling(false),
+          lastReceiveMs(0),
+          otaProcess(nullptr)
+    {
+        setPeriod(POWER_UPDATE_INTERVAL_MS);
+        EnergyConditions conditions;
+        conditions.beaconIntervalMs = POWER_BEACON_INTERVAL_MS;
+        conditions.dtimPeriod = POWER_DTIM_PERIOD;
+        model.setConditions(conditions);
+    }
+
+    void setup() override {
+        otaProcess = processManager ? static_cast<OTAProcess*>(processManager->getProcess("ota")) : nullptr;
+
+        // "power:<performance|balanced|saver>" switches mode, "power:status"
+        // (or no parameter) reports the mode and estimated current per mode
+        commandRegistry.registerCommand("power", [this](const String& params) {
+            String name = params;
+            name.trim();
+            PowerMode requested;
+            if (name.length() == 0 || name == "status") {
+                sendReport();
+            } else if (parsePowerMode(name.c_str(), requested)) {
+                setMode(requested);
+                sendReport();
+            } else {
+                Serial.println("Power: expected performance, balanced, saver or status");
+            }
+        });
+
+        eventBus.subscribe(EventType::WIFI_UP, onWiFiUp, this);
+        eventBus.subscribe(EventType::WIFI_DOWN, onWiFiDown, this);
+        eventBus.subscribe(EventType::OTA_STARTED, onOTAStarted, this);
+
+        applyCpu();
+        Serial.print("Power mode: ");
+        Serial.println(powerModeName(mode));
+    }
+
+    void update() override {
+        // Downlink frames for a dozing station arrive right after the
+        // beacon it woke for, which pins down the phase of the DTIM grid
+        unsigned long received = webSocketManager.getLastReceiveMs();
+        if (received != lastReceiveMs) {
+            lastReceiveMs = received;
+            schedule.anchor((uint32_t)received);
+        }
+
+        if (boosted && !(otaProcess && otaProcess->isUpdating())) {
+            boosted = false;
+            apply();
+        }
+    }
+
+    void setMode(PowerMode next) {
+        mode = next;
+        Serial.print("Power mode: ");
+        Serial.println(powerModeName(mode));
+        apply();
+    }
+
+    PowerMode getMode() const { return mode; }
+
+    // True when frames should go out in DTIM slots rather than on a fixed period
+    bool alignsPublishing() const {
+        PowerProfile profile = activeProfile();
+        return profile.modemSleep != ModemSleep::NONE && profile.publishWakes > 0;
+    }
+
+    // The next slot after `now` in which the radio is awake anyway
+    uint32_t nextPublishAt(uint32_t now) const {
+        return schedule.nextSlot(now + 1, activeProfile().publishWakes);
+    }
+
+    float estimatedMa(PowerMode m) const {
+        return model.simulate(runningProfile(powerProfileFor(m)), POWER_ESTIMATE_WINDOW_MS).averageMa;
+    }
+
+private:
+    PowerMode mode;
+    DtimSchedule schedule;
+    EnergyModel model;
+    bool wifiUp;
+    bool boosted;
+    bool scaling;               // esp_pm_configure() took the idle clock
+    unsigned long lastReceiveMs;
+    OTAProcess* otaProcess;
+
+    PowerProfile activeProfile() const {
+        return powerProfileFor(boosted ? PowerMode::PERFORMANCE : mode);
+    }
+
+    // The clocks a profile actually gets on this build
+    PowerProfile runningProfile(const PowerProfile& profile) const {
+        return scaling ? profile : fixedClock(profile);
+    }
+
+    void apply() {
+        applyCpu();
+        if (wifiUp) applyModemSleep();
+    }
+
+    void applyModemSleep() {
+        PowerProfile profile = activeProfile();
+        schedule.setInterval(radioWakeIntervalMs(profile, POWER_BEACON_INTERVAL_MS, POWER_DTIM_PERIOD));
+
+        // Used from the next association on; the SDK keeps the current one
+        wifi_config_t config;
+        if (esp_wifi_get_config(WIFI_IF_STA, &config) == ESP_OK) {
+            config.sta.listen_interval = profile.listenInterval;
+            esp_wifi_set_config(WIFI_IF_STA, &config);
+        }
+        switch (profile.modemSleep) {
+            case ModemSleep::NONE: WiFi.setSleep(WIFI_PS_NONE); break;
+            case ModemSleep::MIN: WiFi.setSleep(WIFI_PS_MIN_MODEM); break;
+            case ModemSleep::MAX: WiFi.setSleep(WIFI_PS_MAX_MODEM); break;
+        }
+    }
+
+    void applyCpu() {
+        PowerProfile profile = activeProfile();
+#if CONFIG_PM_ENABLE
+        // Dynamic frequency scaling: full clock while a task holds a PM
+        // lock (WiFi does while the radio is busy), idle clock otherwise
+#if ESP_IDF_VERSION_MAJOR >= 5
+        esp_pm_config_t pm;
+#else
+        esp_pm_config_esp32c3_t pm;
+#endif
+        pm.max_freq_mhz = profile.cpuMHz;
+        pm.min_freq_mhz = profile.idleCpuMHz;
+        pm.light_sleep_enable = false;
+        scaling = esp_pm_configure(&pm) == ESP_OK;
+        if (scaling) return;
+#endif
+        // No power management in this SDK build: a fixed clock per mode,
+        // which the report and estimates then assume too
+        if (getCpuFrequencyMhz() != profile.cpuMHz) {
+            setCpuFrequencyMhz(profile.cpuMHz);
+        }
+    }
+
+    // {"type":"power","id":..,"mode":..,"cpuMHz":..,"idleMHz":..,"modemSleep":..,
+    //  "wakeMs":..,"estMa":{"performance":..,"balanced":..,"saver":..}}
+    void sendReport() {
+        static const char* sleepNames[] = {"none", "min", "max"};
+        PowerProfile profile = runningProfile(activeProfile());
+        EnergyConditions conditions = model.getConditions();
+        conditions.publishIntervalMs = configuration.getPublishIntervalMs();
+        model.setConditions(conditions);
+        JsonDocument doc;
+        doc["type"] = "power";
+        doc["id"] = webSocketManager.getDeviceId();
+        doc["mode"] = powerModeName(mode);
+        if (boosted) doc["boosted"] = true;
+        doc["cpuMHz"] = getCpuFrequencyMhz();
+        doc["idleMHz"] = profile.idleCpuMHz;
+        doc["modemSleep"] = sleepNames[(uint8_t)profile.modemSleep];
+        doc["wakeMs"] = radioWakeIntervalMs(profile, POWER_BEACON_INTERVAL_MS, POWER_DTIM_PERIOD);
+        JsonObject estimates = doc["estMa"].to<JsonObject>();
+        for (uint8_t i = 0; i <= (uint8_t)PowerMode::SAVER; i++) {
+            PowerMode m = (PowerMode)i;
+            estimates[powerModeName(m)] = roundf(estimatedMa(m) * 10) / 10;
+        }
+        String json;
+        serializeJson(doc, json);
+        Serial.println(json);
+        webSocketManager.sendMessage(json);
+    }
+
+    static void onWiFiUp(const Event& event, void* context) {
+        PowerProcess* self = static_cast<PowerProcess*>(context);
+        self->wifiUp = true;
+        self->applyModemSleep();
+    }
+
+    static void onWiFiDown(const Event& event, void* context) {
+        static_cast<PowerProcess*>(context)->wifiUp = false;
+    }
+
+    static void onOTAStarted(const Event& event, void* context) {
+        PowerProcess* self = static_cast<PowerProcess*>(context);
+        self->boosted = true;
+        self->apply();
+    }
+};
+
+#endif // POWER_PROCESS_H
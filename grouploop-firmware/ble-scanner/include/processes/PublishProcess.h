@@ -7,7 +7,12 @@
 #include "Configuration.h"
 #include "processes/BLEProcess.h"
 #include "processes/IMUProcess.h"
+#include "processes/WiFiProcess.h"
+#include "processes/PowerProcess.h"
 #include "WebSocketManager.h"
+#include "EventBus.h"
+#include "StallWatchdog.h"
+#include <ArduinoJson.h>
 #include <WiFi.h>
 
 class PublishProcess : public Process {
@@ -15,8 +20,11 @@ class PublishProcess : public Process {
 private:
 	BLEProcess* bleProcess;
 	IMUProcess* imuProcess;
-	Timer publishTimer; // send interval
+	WiFiProcess* wifiProcess;
+	PowerProcess* powerProcess;
 	String state;
+	bool tapPending;	// TAP event seen since the last frame
+	uint32_t firstFrameMs;	// millis() when the first frame went out, 0 before
 
 	static int clampInt(int v, int lo, int hi) { return v < lo ? lo : (v > hi ? hi : v); }
 	static String toHexByte(int v) { char buf[3]; snprintf(buf, sizeof(buf), "%02x", clampInt(v, 0, 255)); return String(buf); }
@@ -51,7 +59,7 @@ private:
 			dSW = mapRssiToByte(bleProcess->getBeaconRSSI("SW"));
 		}
 		// Tap detection
-		int tap = imuProcess ? (imuProcess->isTapped() ? 255 : 0) : 0;
+		int tap = tapPending ? 255 : 0;
 		
 		String frame;
 		frame.reserve(4 + 2*8 + 1); // Updated to account for tap byte
@@ -73,14 +81,23 @@ public:
 		: Process()
 		, bleProcess(nullptr)
 		, imuProcess(nullptr)
-		, publishTimer(50) // 20 Hz
+		, wifiProcess(nullptr)
+		, powerProcess(nullptr)
 		, state("DISCONNECTED")
-	{}
+		, tapPending(false)
+		, firstFrameMs(0)
+	{
+		setPeriod(50); // 20 Hz
+	}
 
 	void setup() override {
 		// Find dependencies through ProcessManager
 		findDependencies();
 		
+		eventBus.subscribe(EventType::TAP, onTap, this);
+		eventBus.subscribe(EventType::CONFIG_CHANGED, onConfigChanged, this);
+		setPeriod(configuration.getPublishIntervalMs());
+		
 		// Initialize the shared WebSocket connection
 		webSocketManager.initialize(configuration.getSocketServerURL());
 	}
@@ -90,9 +107,65 @@ public:
 		webSocketManager.update();
 		state = webSocketManager.getState();
 		
-		if (webSocketManager.isConnected() && publishTimer.checkAndReset()) {
+		if (webSocketManager.isConnected()) {
 			String frame = buildFrame();
 			webSocketManager.sendMessage(frame);
+			tapPending = false;
+			if (firstFrameMs == 0) {
+				firstFrameMs = millis();
+				sendBootReport();
+			}
+			if (stallWatchdog.hasReport()) {
+				sendStallReport();
+			}
+		}
+		
+		// In modem sleep, send while the radio is awake for a beacon anyway
+		if (powerProcess && powerProcess->alignsPublishing()) {
+			wakeAt(powerProcess->nextPublishAt(millis()));
+		}
+	}
+
+	// Boot timing telemetry, sent once after the first frame
+	void sendBootReport() {
+		JsonDocument doc;
+		doc["type"] = "boot";
+		doc["id"] = webSocketManager.getDeviceId();
+		doc["firstFrameMs"] = firstFrameMs;
+		if (wifiProcess) {
+			doc["wifiMs"] = wifiProcess->getFirstConnectMs();
+			doc["cachedAp"] = wifiProcess->wasFirstConnectViaCache();
+		}
+		String json;
+		serializeJson(doc, json);
+		Serial.println(json);
+		webSocketManager.sendMessage(json);
+	}
+
+	// The worst stall since the last report, including one that ended in a
+	// reset; cleared once it went out
+	void sendStallReport() {
+		String json = stallReportJSON(webSocketManager.getDeviceId(), stallWatchdog.getRecord());
+		Serial.println(json);
+		if (webSocketManager.sendMessage(json)) {
+			stallWatchdog.takeReport();
+		}
+	}
+
+	static void onTap(const Event& event, void* context) {
+		static_cast<PublishProcess*>(context)->tapPending = true;
+	}
+
+	// Server and frame rate follow the configuration without a reboot
+	static void onConfigChanged(const Event& event, void* context) {
+		PublishProcess* self = static_cast<PublishProcess*>(context);
+		if (event.value & (1u << Configuration::SETTING_SOCKET_SERVER_URL)) {
+			Serial.print("Switching to server ");
+			Serial.println(configuration.getSocketServerURL());
+			webSocketManager.setUrl(configuration.getSocketServerURL());
+		}
+		if (event.value & (1u << Configuration::SETTING_PUBLISH_INTERVAL)) {
+			self->setPeriod(configuration.getPublishIntervalMs());
 		}
 	}
 
@@ -105,6 +178,18 @@ public:
 			bleProcess = static_cast<BLEProcess*>(ble);
 		}
 		
+		// Find WiFi process
+		Process* wifi = processManager->getProcess("wifi");
+		if (wifi) {
+			wifiProcess = static_cast<WiFiProcess*>(wifi);
+		}
+		
+		// Find power process
+		Process* power = processManager->getProcess("power");
+		if (power) {
+			powerProcess = static_cast<PowerProcess*>(power);
+		}
+		
 		// Find IMU process
 		Process* imu = processManager->getProcess("imu");
 		if (imu) {
@@ -114,6 +199,7 @@ public:
 
 	String getDeviceId() const { return webSocketManager.getDeviceId(); }
 	String getState() const { return state; }
+	uint32_t getFirstFrameMs() const { return firstFrameMs; }
 
 };
 
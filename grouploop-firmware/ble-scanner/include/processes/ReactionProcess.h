@@ -0,0 +1,141 @@
+#ifndef REACTION_PROCESS_H
+#define REACTION_PROCESS_H
+
+#include "Process.h"
+#include "ProcessManager.h"
+#include "CommandRegistry.h"
+#include "WebSocketManager.h"
+#include "EventBus.h"
+#include "ReactionVm.h"
+#include "processes/IMUProcess.h"
+#include "processes/BLEProcess.h"
+#include "processes/LedProcess.h"
+#include "processes/VibrationProcess.h"
+#include "config.h"
+#include <ArduinoJson.h>
+
+// Runs a reaction program the server uploads with `vm:<hex>` (see
+// ReactionVm.h; tools/vm-asm assembles and tries them). Every VM_TICK_MS it
+// reads motion, taps, beacons and the clock, and drives the LEDs and the
+// vibration motor, so a tap lights the wristband within a tick instead of a
+// network round trip. The LEDs show on overlay layer VM_LED_LAYER, over the
+// pattern the server set. `vm:off` stops the program.
+class ReactionProcess : public Process {
+public:
+    ReactionProcess()
+        : Process(), vm(VM_BUDGET), imuProcess(nullptr), bleProcess(nullptr), ledProcess(nullptr),
+          vibrationProcess(nullptr), taps(0), loadedAt(0), lastTickAt(0) {
+        setPeriod(VM_TICK_MS);
+    }
+
+    void setup() override {
+        if (processManager) {
+            imuProcess = static_cast<IMUProcess*>(processManager->getProcess("imu"));
+            bleProcess = static_cast<BLEProcess*>(processManager->getProcess("ble"));
+            ledProcess = static_cast<LedProcess*>(processManager->getProcess("led"));
+            vibrationProcess = static_cast<VibrationProcess*>(processManager->getProcess("vibration"));
+        }
+        eventBus.subscribe(EventType::TAP, onTap, this);
+
+        commandRegistry.registerCommand("vm", [this](const String& params) {
+            if (params == "off") {
+                stop();
+                Serial.println("Reaction program stopped");
+                return;
+            }
+            if (!vm.loadHex(params.c_str())) {
+                Serial.print("Reaction program rejected at ");
+                Serial.print(vm.getFaultPc());
+                Serial.print(": ");
+                Serial.println(vm.getError());
+                report();
+                stop();
+                return;
+            }
+            taps = 0;
+            loadedAt = lastTickAt = millis();
+            ledsReaction.setOutput(0, 0);
+            if (ledProcess) ledProcess->requestLayer(VM_LED_LAYER, &ledsReaction, 0, BlendMode::NORMAL);
+            Serial.print("Reaction program loaded: ");
+            Serial.print(vm.getCodeLength());
+            Serial.println(" bytes");
+        });
+    }
+
+    void update() override {
+        if (!vm.isLoaded()) return;
+
+        uint32_t now = millis();
+        VmInputs inputs;
+        if (imuProcess) {
+            int16_t x, y, z, magnitude;
+            imuProcess->readMilliG(x, y, z, magnitude);
+            inputs[VmInput::AX] = x;
+            inputs[VmInput::AY] = y;
+            inputs[VmInput::AZ] = z;
+            inputs[VmInput::MOTION] = magnitude;
+        }
+        inputs[VmInput::TAP] = taps;
+        for (int i = 0; i < 4; i++) {
+            inputs.values[(size_t)VmInput::BEACON_NW + i] = bleProcess ? bleProcess->getBeaconRSSIByIndex(i) : -128;
+        }
+        inputs[VmInput::MILLIS] = (int32_t)(now - loadedAt);
+        inputs[VmInput::DT] = (int32_t)(now - lastTickAt);
+        taps = 0;
+        lastTickAt = now;
+
+        VmStatus status = vm.run(inputs, outputs);
+        if (status == VmStatus::FAULT) {
+            Serial.print("Reaction program fault at ");
+            Serial.print(vm.getFaultPc());
+            Serial.print(": ");
+            Serial.println(vm.getError());
+            report();
+            stop();
+            return;
+        }
+        if (outputs.wrote(VmOutput::LED_COLOR) || outputs.wrote(VmOutput::LED_LEVEL)) {
+            ledsReaction.setOutput(outputs.ledColor, outputs.ledLevel);
+        }
+        if (outputs.vibrateMs && vibrationProcess) {
+            vibrationProcess->vibrate(outputs.vibrateMs);
+        }
+    }
+
+    const ReactionVm& getVm() const { return vm; }
+
+private:
+    ReactionVm vm;
+    VmOutputs outputs;
+    IMUProcess* imuProcess;
+    BLEProcess* bleProcess;
+    LedProcess* ledProcess;
+    VibrationProcess* vibrationProcess;
+    uint32_t taps;          // since the last tick
+    uint32_t loadedAt;
+    uint32_t lastTickAt;
+
+    void stop() {
+        vm.unload();
+        outputs = VmOutputs();
+        if (ledProcess) ledProcess->requestLayer(VM_LED_LAYER, nullptr, 0, BlendMode::NORMAL);
+    }
+
+    // Tell the server why its program stopped
+    void report() {
+        JsonDocument doc;
+        doc["type"] = "vm";
+        doc["id"] = webSocketManager.getDeviceId();
+        doc["error"] = vm.getError();
+        doc["pc"] = vm.getFaultPc();
+        String json;
+        serializeJson(doc, json);
+        webSocketManager.sendMessage(json);
+    }
+
+    static void onTap(const Event& event, void* context) {
+        static_cast<ReactionProcess*>(context)->taps++;
+    }
+};
+
+#endif // REACTION_PROCESS_H
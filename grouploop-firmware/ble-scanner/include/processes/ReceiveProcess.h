@@ -13,14 +13,14 @@ class ReceiveProcess : public Process {
 
 private:
 	String state;
-	Timer messageCheckTimer;
 
 public:
 	ReceiveProcess()
 		: Process()
 		, state("DISCONNECTED")
-		, messageCheckTimer(10) // Check for messages every 10ms
-	{}
+	{
+		setPeriod(10); // Check for messages every 10ms
+	}
 
 	void setup() override {
 		// Set up message callback for the shared WebSocket connection
@@ -34,7 +34,7 @@ public:
 		state = webSocketManager.getState();
 		
 		// Check for new messages and process them
-		if (webSocketManager.isConnected() && messageCheckTimer.checkAndReset()) {
+		if (webSocketManager.isConnected()) {
 			processMessages();
 		}
 	}
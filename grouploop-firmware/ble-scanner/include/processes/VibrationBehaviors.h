@@ -1,25 +1,24 @@
 #ifndef VIBRATION_BEHAVIORS_H
 #define VIBRATION_BEHAVIORS_H
 
-#include "Arduino.h"
-#include "Timer.h"
-#include "config.h"
-#include "Configuration.h"
-
-
+#include "HapticEngine.h"
 
 // --- Vibration Behavior Base Class ---
+// A behavior is the pattern the haptic engine loops in the background
+// while it is selected; commands and reaction programs play over it.
 class VibrationBehavior {
 public:
     const char* type;
     virtual ~VibrationBehavior() {}
-    virtual void setup() {
-        pinMode(configuration.getMotorPin(), OUTPUT);
-    }
-    virtual void update() = 0;    
+    virtual HapticPattern pattern() const = 0;
 
 protected:
     VibrationBehavior(const char* type) : type(type) {}
+
+    static HapticPattern loop(uint8_t level, uint16_t attackMs, uint16_t sustainMs, uint16_t decayMs, uint16_t gapMs) {
+        return HapticPattern{level, attackMs, sustainMs, decayMs, gapMs, HapticPattern::FOREVER,
+                             HapticPriority::BACKGROUND};
+    }
 };
 
 // --- Concrete Vibration Behaviors ---
@@ -28,12 +27,8 @@ protected:
 class MotorOffBehavior : public VibrationBehavior {
 public:
     MotorOffBehavior() : VibrationBehavior("Off") {}
-    void setup() override {
-        VibrationBehavior::setup();
-        analogWrite(configuration.getMotorPin(), 0);
-    }
-    void update() override {
-        // Do nothing, motor is off
+    HapticPattern pattern() const override {
+        return loop(0, 0, 1000, 0, 0);  // level 0: nothing to play
     }
 };
 
@@ -42,65 +37,38 @@ class ConstantVibrationBehavior : public VibrationBehavior {
 public:
     uint8_t intensity;
     ConstantVibrationBehavior(uint8_t intensity) : VibrationBehavior("Constant"), intensity(intensity) {}
-    
-    void setup() override {
-        VibrationBehavior::setup();
-        analogWrite(configuration.getMotorPin(), intensity);
-    }
-    
-    void update() override {
-        // Do nothing, motor is at constant vibration
+
+    HapticPattern pattern() const override {
+        return loop(intensity, 0, 1000, 0, 0);
     }
 };
 
-// 3. BurstVibrationBehavior
+// 3. BurstVibrationBehavior - on and off for 1/frequency s each
 class BurstVibrationBehavior : public VibrationBehavior {
 public:
     uint8_t intensity;
     unsigned long frequency;
-    BurstVibrationBehavior(uint8_t intensity, unsigned long frequency) 
-        : VibrationBehavior("Burst"), intensity(intensity), frequency(frequency), burstTimer(frequency > 0 ? 1000 / frequency : 0), motorOn(false) {}
+    BurstVibrationBehavior(uint8_t intensity, unsigned long frequency)
+        : VibrationBehavior("Burst"), intensity(intensity), frequency(frequency) {}
 
-    void setup() override {
-        VibrationBehavior::setup();
-        burstTimer.reset();
-        analogWrite(configuration.getMotorPin(), 0); // Start in off state
+    HapticPattern pattern() const override {
+        uint16_t half = frequency > 0 ? (uint16_t)(1000 / frequency) : 0;
+        return loop(half ? intensity : 0, 0, half, 0, half);
     }
-    
-    void update() override {
-        if (burstTimer.interval > 0 && burstTimer.checkAndReset()) {
-            motorOn = !motorOn;
-            analogWrite(configuration.getMotorPin(), motorOn ? intensity : 0);
-        }
-    }
-private:
-    Timer burstTimer;
-    bool motorOn;
 };
 
-// 4. PulseVibrationBehavior
+// 4. PulseVibrationBehavior - like a burst, but ramping up and down
 class PulseVibrationBehavior : public VibrationBehavior {
 public:
     uint8_t intensity;
     unsigned long frequency;
-    PulseVibrationBehavior(uint8_t intensity = 0, unsigned long frequency = 0) 
-        : VibrationBehavior("Pulse"), intensity(intensity), frequency(frequency), pulseTimer(frequency > 0 ? 1000 / frequency : 0), motorOn(false) {}
+    PulseVibrationBehavior(uint8_t intensity = 0, unsigned long frequency = 0)
+        : VibrationBehavior("Pulse"), intensity(intensity), frequency(frequency) {}
 
-    void setup() override {
-        VibrationBehavior::setup();
-        pulseTimer.reset();
-        analogWrite(configuration.getMotorPin(), 0);
-    }
-    
-    void update() override {
-        if (pulseTimer.interval > 0 && pulseTimer.checkAndReset()) {
-            motorOn = !motorOn;
-            analogWrite(configuration.getMotorPin(), motorOn ? intensity : 0);
-        }
+    HapticPattern pattern() const override {
+        uint16_t half = frequency > 0 ? (uint16_t)(1000 / frequency) : 0;
+        return loop(half ? intensity : 0, half / 2, 0, half - half / 2, half);
     }
-private:
-    Timer pulseTimer;
-    bool motorOn;
 };
 
-#endif // VIBRATION_BEHAVIORS_H 
\ No newline at end of file
+#endif // VIBRATION_BEHAVIORS_H
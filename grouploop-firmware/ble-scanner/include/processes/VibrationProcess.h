@@ -4,58 +4,199 @@
 #include <Arduino.h>
 #include "Process.h"
 #include "config.h"
+#include "Configuration.h"
+#include "HapticEngine.h"
+#include "HapticWaveform.h"
+#include "EspHapticOutput.h"
 #include "VibrationBehaviors.h"
 #include "CommandRegistry.h"
 
+// Drives the vibration motor through the haptic engine (HapticEngine.h) on
+// an LEDC channel. update() runs when the envelope next changes, not on a
+// fixed period, and the hardware keeps the PWM going in between.
 class VibrationProcess : public Process {
 public:
-    VibrationProcess() : Process(), currentBehavior(nullptr) {
+    VibrationProcess()
+        : Process(), currentBehavior(nullptr), output(configuration.getMotorPin()), engine(output, HAPTIC_RAMP_STEP_MS) {
+        setPeriod(HapticEngine::IDLE_MS);
     }
 
     ~VibrationProcess() {
     }
 
+    // The pattern to loop in the background; null or MotorOff for none
     void setBehavior(VibrationBehavior* newBehavior) {
         currentBehavior = newBehavior;
+        engine.stop();
         if (currentBehavior) {
-            currentBehavior->setup();
+            play(currentBehavior->pattern());
         }
     }
 
     void setup() override {
+        engine.begin();
         // Register vibration commands
         registerCommands();
     }
 
     void update() override {
-        if (currentBehavior) {
-            currentBehavior->update();
-        }
+        wakeAt(engine.update(millis()));
+    }
+
+    // Queue or start a pattern; false if it was turned away. Under a cue
+    // it starts at the cue's due time, in step with LED commands of the
+    // same cue.
+    bool play(const HapticPattern& pattern) {
+        uint32_t now = millis();
+        uint32_t startAt = now;
+        commandRegistry.getScheduledAt(startAt);
+        bool accepted = engine.play(pattern, startAt);
+        wakeAt(now);
+        return accepted;
     }
-    
-    // Method to trigger vibration for a specific duration
+
+    // Play a cached waveform; false if it is not cached or was turned away
+    bool playWaveform(uint8_t id, uint8_t level = 255) {
+        const HapticWaveformCache::Waveform* waveform = waveforms.use(id);
+        if (!waveform) return false;
+        return play(HapticPattern::waveform(waveform->segments, waveform->segmentCount, waveform->repeats,
+                                            (HapticPriority)waveform->priority, level));
+    }
+
+    // Full drive for a duration
     void vibrate(int duration) {
-        // This would need to be implemented based on your vibration hardware
-        Serial.print("Vibrating for ");
-        Serial.print(duration);
-        Serial.println("ms");
-        // TODO: Implement actual vibration control
+        if (duration <= 0) return;
+        play(HapticPattern::buzz(255, duration > 0xFFFF ? 0xFFFF : (uint16_t)duration));
     }
 
+    // Motor off and everything queued dropped
+    void stop() {
+        engine.stop();
+        currentBehavior = nullptr;
+    }
+
+    const HapticEngine& getEngine() const { return engine; }
+
     VibrationBehavior* currentBehavior;
 
 private:
+    EspLedcHapticOutput output;
+    HapticEngine engine;
+    HapticWaveformCache waveforms;
+
+    static bool parsePriority(const String& name, HapticPriority& priority) {
+        if (name == "background") priority = HapticPriority::BACKGROUND;
+        else if (name == "normal") priority = HapticPriority::NORMAL;
+        else if (name == "alert") priority = HapticPriority::ALERT;
+        else return false;
+        return true;
+    }
+
     void registerCommands() {
         // Register vibration command
         commandRegistry.registerCommand("vibrate", [this](const String& params) {
             int duration = params.toInt();
             if (duration > 0) {
                 vibrate(duration);
+                Serial.print("Vibrating for ");
+                Serial.print(duration);
+                Serial.println("ms");
             } else {
                 Serial.println("Invalid vibration duration");
             }
         });
+
+        // Envelope pattern
+        // Format: haptic:<level>:<attack>:<sustain>:<decay>[:<gap>:<repeats>[:<priority>]]
+        // repeats 0 = until interrupted; priority background|normal|alert
+        // Example: haptic:200:30:60:120:100:3:alert
+        commandRegistry.registerCommand("haptic", [this](const String& params) {
+            if (params == "stop") {
+                stop();
+                Serial.println("Haptics stopped");
+                return;
+            }
+            long fields[6] = {0, 0, 0, 0, 0, 1};
+            HapticPriority priority = HapticPriority::NORMAL;
+            int start = 0;
+            size_t count = 0;
+            while (start <= (int)params.length()) {
+                int colon = params.indexOf(':', start);
+                String field = params.substring(start, colon < 0 ? params.length() : colon);
+                if (count < 6) {
+                    fields[count] = field.toInt();
+                } else if (count == 6 && !parsePriority(field, priority)) {
+                    Serial.println("haptic priority: background, normal or alert");
+                    return;
+                }
+                count++;
+                if (colon < 0) break;
+                start = colon + 1;
+            }
+            if (count < 4 || count == 5 || count > 7) {
+                Serial.println("haptic format: <level>:<attack>:<sustain>:<decay>[:<gap>:<repeats>[:<priority>]]");
+                return;
+            }
+            for (size_t i = 0; i < 6; i++) {
+                if (fields[i] < 0 || fields[i] > (i == 0 || i == 5 ? 255 : 0xFFFF)) {
+                    Serial.println("haptic value out of range");
+                    return;
+                }
+            }
+            HapticPattern pattern{(uint8_t)fields[0], (uint16_t)fields[1], (uint16_t)fields[2], (uint16_t)fields[3],
+                                  (uint16_t)fields[4], (uint8_t)fields[5], priority};
+            if (!play(pattern)) {
+                Serial.println("Haptic pattern dropped");
+            }
+        });
+
+        // Upload a waveform into the cache
+        // Format: haptic_wave:<id 0-255>:<hex> (binary format in HapticWaveform.h)
+        commandRegistry.registerCommand("haptic_wave", [this](const String& params) {
+            int colon = params.indexOf(':');
+            long id = colon > 0 ? params.substring(0, colon).toInt() : -1;
+            if (id < 0 || id > 255) {
+                Serial.println("haptic_wave format: <id 0-255>:<hex>");
+                return;
+            }
+            String hex = params.substring(colon + 1);
+            const char* error = nullptr;
+            HapticWaveformCache::Waveform* slot = nullptr;
+            if (!waveforms.load((uint8_t)id, hex.c_str(), error, slot)) {
+                Serial.print("Haptic waveform rejected: ");
+                Serial.println(error);
+                return;
+            }
+            engine.forget(slot->segments);     // whatever the slot held before
+            Serial.print("Haptic waveform ");
+            Serial.print(id);
+            Serial.print(" loaded: ");
+            Serial.print(slot->segmentCount);
+            Serial.print(" segments, ");
+            Serial.print(slot->durationMs);
+            Serial.println(" ms");
+        });
+
+        // Play a cached waveform
+        // Format: hw:<id>[:<level 0-255>]
+        commandRegistry.registerCommand("hw", [this](const String& params) {
+            int colon = params.indexOf(':');
+            long id = (colon < 0 ? params : params.substring(0, colon)).toInt();
+            long level = colon < 0 ? 255 : params.substring(colon + 1).toInt();
+            if (id < 0 || id > 255 || level < 0 || level > 255) {
+                Serial.println("hw format: <id 0-255>[:<level 0-255>]");
+                return;
+            }
+            if (!waveforms.find((uint8_t)id)) {
+                Serial.print("No haptic waveform ");
+                Serial.println(id);
+                return;
+            }
+            if (!playWaveform((uint8_t)id, (uint8_t)level)) {
+                Serial.println("Haptic pattern dropped");
+            }
+        });
     }
 };
 
-#endif // VIBRATION_PROCESS_H 
\ No newline at end of file
+#endif // VIBRATION_PROCESS_H
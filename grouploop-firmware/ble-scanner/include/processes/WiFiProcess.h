@@ -2,189 +2,228 @@
 #define WIFI_PROCESS_H
 
 #include "Process.h"
-#include "Timer.h"
+#include "config.h"
 #include "Configuration.h"
-#include <WiFiMulti.h>
+#include "EventBus.h"
+#include "WiFiConnector.h"
+#include "EspWiFiDriver.h"
+#include "WiFiCache.h"
 #include <WiFi.h>
 
 class WiFiProcess : public Process {
 public:
-    WiFiProcess() 
+    WiFiProcess()
         : Process(),
-          connectionCheckTimer(5000), // Check connection every 5 seconds
-          reconnectAttemptTimer(10000), // Wait 10 seconds between reconnect attempts
-          lastConnectionCheck(0),
+          connector(driver, connectorConfig()),
           isConnected(false),
-          reconnectAttempts(0),
-          maxReconnectAttempts(5)
+          lastState(WiFiConnector::State::IDLE),
+          firstConnectMs(0),
+          firstConnectViaCache(false)
     {
+        setPeriod(WIFI_UPDATE_INTERVAL_MS);
     }
 
     void setup() override {
-        // Initialize WiFi in station mode
+        // Station mode; reconnects are handled by the connector, not the SDK,
+        // and WiFiCache replaces the SDK's own flash copy of the config
+        WiFi.persistent(false);
         WiFi.mode(WIFI_STA);
-        
-        // Add the configured WiFi network to WiFiMulti
-        String ssid = configuration.getWifiSSID();
-        String password = configuration.getWifiPassword();
-        
+        WiFi.setAutoReconnect(false);
+        driver.begin();
+
+        uint8_t mac[6];
+        WiFi.macAddress(mac);
+        connector.setSeed(((uint32_t)mac[2] << 24) | ((uint32_t)mac[3] << 16) | ((uint32_t)mac[4] << 8) | mac[5]);
+
+        ssid = configuration.getWifiSSID();
+        password = configuration.getWifiPassword();
+
         if (ssid.length() > 0) {
-            wifiMulti.addAP(ssid.c_str(), password.c_str());
-            Serial.print("Added WiFi network: ");
+            Serial.print("Connecting to WiFi network: ");
             Serial.println(ssid);
         } else {
             Serial.println("No WiFi SSID configured");
         }
-        
-        // Start initial connection attempt
-        attemptConnection();
+
+        // Reconnect when new credentials are saved
+        eventBus.subscribe(EventType::CONFIG_CHANGED, onConfigChanged, this);
+
+        // Start connecting, directly to the last good access point if known;
+        // progress is driven from update()
+        WiFiNetwork cached;
+        if (ssid.length() > 0 && cache.load(ssid, cached)) {
+            Serial.print("WiFi: trying cached access point on channel ");
+            Serial.println(cached.channel);
+            connector.begin(ssid.c_str(), password.c_str(), millis(), &cached);
+        } else {
+            connector.begin(ssid.c_str(), password.c_str(), millis());
+        }
     }
 
     void update() override {
-        uint32_t currentTime = millis();
-        
-        // Check connection status periodically
-        if (connectionCheckTimer.checkAndReset()) {
-            checkConnection();
+        uint32_t now = millis();
+
+        WiFiDriverEvent event;
+        while (driver.poll(event)) {
+            connector.handle(event, now);
         }
-        
-        // Attempt reconnection if needed
-        if (!isConnected && reconnectAttemptTimer.checkAndReset()) {
-            if (reconnectAttempts < maxReconnectAttempts) {
-                attemptConnection();
-            } else {
-                Serial.println("Max reconnection attempts reached. Stopping WiFi attempts.");
+        connector.update(now);
+
+        WiFiConnector::State state = connector.getState();
+        if (state != lastState) {
+            logTransition(state);
+            if (state == WiFiConnector::State::CONNECTED) {
+                onConnected(now);
             }
+            lastState = state;
         }
+        setConnected(connector.isConnected());
     }
 
     String getState() override {
         if (isConnected) {
             return String("CONNECTED (") + WiFi.SSID() + ")";
-        } else if (reconnectAttempts >= maxReconnectAttempts) {
-            return String("FAILED");
-        } else {
-            return String("CONNECTING (") + String(reconnectAttempts) + "/" + String(maxReconnectAttempts) + ")";
         }
+        return String(WiFiConnector::stateName(connector.getState())) +
+               " (attempt " + String(connector.getAttempts()) + ")";
     }
-    
+
     // Public methods for other processes to check WiFi status
     bool isWiFiConnected() const {
         return isConnected;
     }
-    
+
     String getIPAddress() const {
         if (isConnected) {
             return WiFi.localIP().toString();
         }
         return String("");
     }
-    
+
     String getSSID() const {
         if (isConnected) {
             return WiFi.SSID();
         }
         return String("");
     }
-    
+
     int getRSSI() const {
         if (isConnected) {
             return WiFi.RSSI();
         }
         return 0;
     }
-    
+
+    // Milliseconds from boot to the first WiFi connection (0 until connected)
+    uint32_t getFirstConnectMs() const {
+        return firstConnectMs;
+    }
+
+    // Whether that first connection skipped the scan thanks to the cache
+    bool wasFirstConnectViaCache() const {
+        return firstConnectViaCache;
+    }
+
     // Method to force reconnection (useful for configuration changes)
     void forceReconnect() {
         Serial.println("Forcing WiFi reconnection...");
-        isConnected = false;
-        reconnectAttempts = 0;
-        WiFi.disconnect();
-        reconnectAttemptTimer.reset();
+        setConnected(false);
+        connector.begin(ssid.c_str(), password.c_str(), millis());
     }
-    
+
     // Method to update WiFi credentials and reconnect
-    void updateCredentials(const String& ssid, const String& password) {
+    void updateCredentials(const String& newSSID, const String& newPassword) {
         Serial.println("Updating WiFi credentials...");
-        
-        // Clear existing networks by reinitializing WiFiMulti
-        wifiMulti = WiFiMulti();
-        
-        // Add new network
-        if (ssid.length() > 0) {
-            wifiMulti.addAP(ssid.c_str(), password.c_str());
-            Serial.print("Updated WiFi network: ");
-            Serial.println(ssid);
-        }
-        
+        ssid = newSSID;
+        password = newPassword;
+        Serial.print("Updated WiFi network: ");
+        Serial.println(ssid);
+
         // Force reconnection with new credentials
         forceReconnect();
     }
 
 private:
-    void checkConnection() {
-        bool wasConnected = isConnected;
-        isConnected = (WiFi.status() == WL_CONNECTED);
-        
-        if (isConnected && !wasConnected) {
-            // Just connected
-            Serial.println("WiFi connected successfully!");
-            Serial.print("IP address: ");
-            Serial.println(WiFi.localIP());
-            Serial.print("SSID: ");
-            Serial.println(WiFi.SSID());
-            Serial.print("Signal strength: ");
-            Serial.print(WiFi.RSSI());
-            Serial.println(" dBm");
-            
-            // Reset reconnect attempts counter
-            reconnectAttempts = 0;
-        } else if (!isConnected && wasConnected) {
-            // Just disconnected
-            Serial.println("WiFi connection lost!");
-            reconnectAttemptTimer.reset();
+    static WiFiConnectorConfig connectorConfig() {
+        WiFiConnectorConfig config;
+        config.scanTimeoutMs = WIFI_SCAN_TIMEOUT_MS;
+        config.associateTimeoutMs = WIFI_ASSOCIATE_TIMEOUT_MS;
+        config.fastAssociateTimeoutMs = WIFI_FAST_ASSOCIATE_TIMEOUT_MS;
+        config.dhcpTimeoutMs = WIFI_DHCP_TIMEOUT_MS;
+        config.backoffInitialMs = WIFI_BACKOFF_INITIAL_MS;
+        config.backoffMaxMs = WIFI_BACKOFF_MAX_MS;
+        return config;
+    }
+
+    void onConnected(uint32_t now) {
+        if (firstConnectMs == 0) {
+            firstConnectMs = now;
+            firstConnectViaCache = connector.isConnectedViaCache();
+        }
+
+        // Remember where we joined for the next boot
+        WiFiNetwork network = connector.getNetwork();
+#if WIFI_REUSE_IP_LEASE
+        network.ip = (uint32_t)WiFi.localIP();
+        network.gateway = (uint32_t)WiFi.gatewayIP();
+        network.subnet = (uint32_t)WiFi.subnetMask();
+        network.dns = (uint32_t)WiFi.dnsIP();
+#else
+        network.ip = network.gateway = network.subnet = network.dns = 0;
+#endif
+        cache.store(ssid, network);
+    }
+
+    static void onConfigChanged(const Event& event, void* context) {
+        WiFiProcess* self = static_cast<WiFiProcess*>(context);
+        String newSSID = configuration.getWifiSSID();
+        String newPassword = configuration.getWifiPassword();
+        if (newSSID != self->ssid || newPassword != self->password) {
+            self->updateCredentials(newSSID, newPassword);
         }
     }
-    
-    void attemptConnection() {
-        Serial.print("Attempting WiFi connection (attempt ");
-        Serial.print(reconnectAttempts + 1);
-        Serial.print("/");
-        Serial.print(maxReconnectAttempts);
-        Serial.println(")...");
-        
-        // Try to connect using WiFiMulti
-        uint8_t result = wifiMulti.run(10000); // 10 second timeout
-        
-        if (result == WL_CONNECTED) {
-            isConnected = true;
-            reconnectAttempts = 0;
-            Serial.println("WiFi connected successfully!");
-            Serial.print("IP address: ");
-            Serial.println(WiFi.localIP());
-        } else {
-            isConnected = false;
-            reconnectAttempts++;
-            Serial.print("WiFi connection failed. Status: ");
-            Serial.println(result);
-            
-            if (reconnectAttempts < maxReconnectAttempts) {
-                Serial.print("Retrying in 10 seconds... (");
-                Serial.print(reconnectAttempts);
-                Serial.print("/");
-                Serial.print(maxReconnectAttempts);
-                Serial.println(")");
-            }
+
+    // Track the link state and publish WIFI_UP / WIFI_DOWN on edges only
+    void setConnected(bool connected) {
+        if (connected == isConnected) return;
+        isConnected = connected;
+        eventBus.publish(connected ? EventType::WIFI_UP : EventType::WIFI_DOWN);
+    }
+
+    void logTransition(WiFiConnector::State state) {
+        switch (state) {
+            case WiFiConnector::State::CONNECTED:
+                Serial.print("WiFi connected successfully");
+                Serial.println(connector.isConnectedViaCache() ? " (cached access point)" : "!");
+                Serial.print("IP address: ");
+                Serial.println(WiFi.localIP());
+                Serial.print("SSID: ");
+                Serial.println(WiFi.SSID());
+                Serial.print("Signal strength: ");
+                Serial.print(WiFi.RSSI());
+                Serial.println(" dBm");
+                break;
+            case WiFiConnector::State::BACKOFF:
+                Serial.print("WiFi not connected, retrying in ");
+                Serial.print(connector.getRetryDelay());
+                Serial.println(" ms");
+                break;
+            default:
+                Serial.print("WiFi: ");
+                Serial.println(WiFiConnector::stateName(state));
+                break;
         }
     }
-    
-    Timer connectionCheckTimer;
-    Timer reconnectAttemptTimer;
-    WiFiMulti wifiMulti;
-    uint32_t lastConnectionCheck;
+
+    EspWiFiDriver driver;
+    WiFiConnector connector;
+    WiFiCache cache;
+    String ssid;
+    String password;
     bool isConnected;
-    int reconnectAttempts;
-    int maxReconnectAttempts;
+    WiFiConnector::State lastState;
+    uint32_t firstConnectMs;
+    bool firstConnectViaCache;
 };
 
 #endif // WIFI_PROCESS_H
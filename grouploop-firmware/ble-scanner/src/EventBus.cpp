@@ -0,0 +1,4 @@
+#include "EventBus.h"
+
+// Global event bus instance
+EventBus eventBus;
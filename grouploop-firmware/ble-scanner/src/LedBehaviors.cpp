@@ -11,4 +11,7 @@ HeartBeatBehavior ledsHeartBeat;
 CycleBehavior ledsCycle(0x000000, 100);
 SpringBehavior ledsSpring(0xFFFFFF); // Green spring with default parameters
 IndividualLedBehavior ledsIndividual; // Individual LED control
+TimelineBehavior ledsTimeline; // Uploaded keyframe program
+SolidBehavior ledsFlash; // Top layer of the flash command
+ReactionBehavior ledsReaction; // Driven by the reaction VM
 
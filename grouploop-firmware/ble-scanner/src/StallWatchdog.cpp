@@ -0,0 +1,72 @@
+#include "Arduino.h"
+#include <ArduinoJson.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include "StallWatchdog.h"
+#include "config.h"
+
+// Survives software, panic and watchdog resets; garbage after power-on,
+// which begin() detects and clears
+RTC_NOINIT_ATTR StallRecord stallRecord;
+
+StallWatchdog stallWatchdog(stallRecord);
+
+static esp_timer_handle_t monitorTimer = nullptr;
+
+static void onMonitorTimer(void* arg) {
+    if (stallWatchdog.check(millis(), WATCHDOG_HANG_MS)) {
+        // The record already names the hung process; reboot so the device
+        // comes back instead of staying silent
+        esp_restart();
+    }
+}
+
+void stallWatchdogBegin() {
+    if (stallWatchdog.begin()) {
+        Serial.print("Watchdog: stall recorded before reset in ");
+        Serial.println(stallWatchdog.getRecord().process);
+    }
+
+    esp_timer_create_args_t args = {};
+    args.callback = onMonitorTimer;
+    args.name = "stall_monitor";
+    if (esp_timer_create(&args, &monitorTimer) == ESP_OK) {
+        esp_timer_start_periodic(monitorTimer, (uint64_t)WATCHDOG_CHECK_INTERVAL_MS * 1000);
+    } else {
+        Serial.println("Watchdog: could not start monitor timer");
+    }
+}
+
+static const char* resetReasonName(esp_reset_reason_t reason) {
+    switch (reason) {
+        case ESP_RST_POWERON: return "power_on";
+        case ESP_RST_SW: return "software";
+        case ESP_RST_PANIC: return "panic";
+        case ESP_RST_INT_WDT: return "int_wdt";
+        case ESP_RST_TASK_WDT: return "task_wdt";
+        case ESP_RST_WDT: return "wdt";
+        case ESP_RST_BROWNOUT: return "brownout";
+        case ESP_RST_DEEPSLEEP: return "deep_sleep";
+        default: return "other";
+    }
+}
+
+// {"type":"stall","id":..,"process":..,"lane":..,"ms":..,"budgetMs":..,
+//  "atMs":..,"inProgress":..,"command":..,"stalls":..,"reset":..}
+String stallReportJSON(const String& deviceId, const StallRecord& report) {
+    JsonDocument doc;
+    doc["type"] = "stall";
+    doc["id"] = deviceId;
+    doc["process"] = report.process;
+    doc["lane"] = report.lane;
+    doc["ms"] = report.durationMs;
+    doc["budgetMs"] = report.budgetMs;
+    doc["atMs"] = report.uptimeMs;
+    doc["inProgress"] = report.inProgress != 0;
+    doc["command"] = report.command;
+    doc["stalls"] = report.stalls;
+    doc["reset"] = resetReasonName(esp_reset_reason());
+    String json;
+    serializeJson(doc, json);
+    return json;
+}
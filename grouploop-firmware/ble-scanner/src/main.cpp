@@ -21,10 +21,15 @@ Commands van de server uitvoeren.                         |
 #include "processes/ConfigurationProcess.h"
 #include "processes/WiFiProcess.h"
 #include "processes/OTAProcess.h"
+#include "processes/PowerProcess.h"
+#include "processes/CueProcess.h"
+#include "processes/ReactionProcess.h"
 #include "Process.h"
 #include "ProcessManager.h"
 #include "WebSocketManager.h"
 #include "CommandRegistry.h"
+#include "EventBus.h"
+#include "StallWatchdog.h"
 
 
 // Global pointer for BLE callback
@@ -57,6 +62,61 @@ void registerGlobalCommands() {
       Serial.println("Unknown");
     }
     
+    Serial.print("Boot to WiFi: ");
+    Serial.print(wifiProcess ? wifiProcess->getFirstConnectMs() : 0);
+    Serial.println(wifiProcess && wifiProcess->wasFirstConnectViaCache() ? " ms (cached AP)" : " ms");
+    
+    Serial.print("Boot to first frame: ");
+    PublishProcess* publishProcess = static_cast<PublishProcess*>(processManager.getProcess("publish"));
+    Serial.print(publishProcess ? publishProcess->getFirstFrameMs() : 0);
+    Serial.println(" ms");
+    
+    Serial.print("Power: ");
+    PowerProcess* powerProcess = static_cast<PowerProcess*>(processManager.getProcess("power"));
+    Serial.println(powerProcess ? powerModeName(powerProcess->getMode()) : "Unknown");
+    
+    Serial.print("LED frames: ");
+    LedProcess* ledProcess = static_cast<LedProcess*>(processManager.getProcess("led"));
+    if (ledProcess) {
+      const PixelStats& stats = ledProcess->getStats();
+      Serial.print(stats.shown);
+      Serial.print(" shown, ");
+      Serial.print(stats.skipped);
+      Serial.print(" skipped, ");
+      Serial.print(stats.shown ? stats.showMicros / stats.shown : 0);
+      Serial.println(" us per show()");
+    } else {
+      Serial.println("Unknown");
+    }
+    
+    Serial.print("Shared clock: ");
+    CueProcess* cueProcess = static_cast<CueProcess*>(processManager.getProcess("cue"));
+    if (cueProcess && cueProcess->getClock().isSynced()) {
+      Serial.print("synced, round trip ");
+      Serial.print(cueProcess->getClock().getRoundTrip());
+      Serial.print(" ms, ");
+      Serial.print(cueProcess->getPendingCount());
+      Serial.println(" cues pending");
+    } else {
+      Serial.println("not synced");
+    }
+    
+    Serial.print("Reaction program: ");
+    ReactionProcess* reactionProcess = static_cast<ReactionProcess*>(processManager.getProcess("vm"));
+    if (reactionProcess && reactionProcess->getVm().isLoaded()) {
+      const VmStats& vmStats = reactionProcess->getVm().getStats();
+      Serial.print(reactionProcess->getVm().getCodeLength());
+      Serial.print(" bytes, max ");
+      Serial.print(vmStats.maxInstructions);
+      Serial.print("/");
+      Serial.print(VM_BUDGET);
+      Serial.print(" instructions per tick, ");
+      Serial.print(vmStats.outOfBudget);
+      Serial.println(" ticks cut off");
+    } else {
+      Serial.println("none");
+    }
+    
     Serial.print("WebSocket: ");
     Serial.println(webSocketManager.isConnected() ? "Connected" : "Disconnected");
     
@@ -68,14 +128,75 @@ void registerGlobalCommands() {
     
     Serial.println("===================");
   });
+
+#if PROCESS_PROFILING
+  // Register stats command: per-process timing and loop jitter, sent back as JSON
+  // "stats:reset" clears the counters
+  commandRegistry.registerCommand("stats", [](const String& params) {
+    if (params == "reset") {
+      processManager.resetStats();
+      Serial.println("Process stats reset");
+      return;
+    }
+    String json = processManager.getStatsJSON(webSocketManager.getDeviceId());
+    Serial.println(json);
+    webSocketManager.sendMessage(json);
+  });
+#endif
+}
+
+void onWiFiUp(const Event& event, void* context) {
+  Serial.println("WiFi connected - starting BLE process");
+  processManager.startProcess("ble");
+  
+  // Don't wait out the socket's retry interval from the attempts made while offline
+  if (!webSocketManager.isConnected()) {
+    webSocketManager.reconnect();
+  }
+  
+  // Change LED to random non-red color when WiFi connects; the LED
+  // renderer skips it in individual LED mode
+  LedProcess* ledProcess = static_cast<LedProcess*>(processManager.getProcess("led"));
+  if (ledProcess) {
+    ledProcess->changeToRandomColor();
+  }
+}
+
+void onWiFiDown(const Event& event, void* context) {
+  Serial.println("WiFi disconnected - halting BLE process");
+  processManager.haltProcess("ble");
+  
+  // Change LED back to red breathing when WiFi disconnects; the LED
+  // renderer skips it in individual LED mode
+  LedProcess* ledProcess = static_cast<LedProcess*>(processManager.getProcess("led"));
+  if (ledProcess) {
+    ledProcess->setToRedBreathing();
+  }
+}
+
+void onOTAStarted(const Event& event, void* context) {
+  // Free radio time and power for the download
+  processManager.haltProcess("ble");
+  processManager.haltProcess("publish");
+  VibrationProcess* vibrationProcess = static_cast<VibrationProcess*>(processManager.getProcess("vibration"));
+  if (vibrationProcess) vibrationProcess->stop();   // halted, it would leave the motor running
+  processManager.haltProcess("vibration");
+}
+
+void registerEventHandlers() {
+  eventBus.subscribe(EventType::WIFI_UP, onWiFiUp);
+  eventBus.subscribe(EventType::WIFI_DOWN, onWiFiDown);
+  eventBus.subscribe(EventType::OTA_STARTED, onOTAStarted);
 }
 
 void setup() {
-  delay(SETUP_DELAY);
   Serial.setRxBufferSize(1024);
   Serial.begin(SERIAL_BAUD_RATE);
   Serial.println("Starting setup");
   
+  // Pick up a stall recorded before the last reset and watch from here on
+  stallWatchdogBegin();
+  
   // Initialize random seed for LED color selection
   randomSeed(analogRead(0));
 
@@ -93,6 +214,9 @@ void setup() {
   processManager.addProcess("publish", new PublishProcess());
   processManager.addProcess("receive", new ReceiveProcess());
   processManager.addProcess("ota", new OTAProcess());
+  processManager.addProcess("power", new PowerProcess());
+  processManager.addProcess("cue", new CueProcess());
+  processManager.addProcess("vm", new ReactionProcess());
   
   
   // Initially halt BLE process until WiFi is connected
@@ -105,8 +229,17 @@ void setup() {
     ledProcess->setBehavior(&ledsBreathing);
   }
 
+  // Subscribe before setup so an immediate WiFi connection is not missed
+  registerEventHandlers();
+
   // Initialize all processes
   processManager.setupProcesses();
+
+#if USE_PROCESS_TASKS
+  // Sensing and LED rendering keep their cadence even when the network stalls
+  processManager.runInTask("imu", IMU_TASK_STACK_SIZE, IMU_TASK_PRIORITY);
+  processManager.runInTask("led", LED_TASK_STACK_SIZE, LED_TASK_PRIORITY);
+#endif
   
   // Register global commands
   registerGlobalCommands();
@@ -116,7 +249,9 @@ void loop() {
   // Always update configuration process first
   ConfigurationProcess* configurationProcess = static_cast<ConfigurationProcess*>(processManager.getProcess("configuration"));
   if (configurationProcess && configurationProcess->isProcessRunning()) {
+    stallWatchdog.enter(STALL_LANE_LOOP, configurationProcess->getName(), WATCHDOG_BUDGET_MS, millis());
     configurationProcess->update();
+    stallWatchdog.exit(STALL_LANE_LOOP, millis());
   }
   
   // If in configuration mode, halt other processes until exit or timeout
@@ -124,34 +259,16 @@ void loop() {
     return;
   }
   
-  // Check WiFi status and start BLE process when WiFi is connected
-  WiFiProcess* wifiProcess = static_cast<WiFiProcess*>(processManager.getProcess("wifi"));
-  BLEProcess* bleProcess = static_cast<BLEProcess*>(processManager.getProcess("ble"));
-  LedProcess* ledProcess = static_cast<LedProcess*>(processManager.getProcess("led"));
-  
- if (wifiProcess && bleProcess) {
-    if (wifiProcess->isWiFiConnected() && !bleProcess->isProcessRunning()) {
-      Serial.println("WiFi connected - starting BLE process");
-      processManager.startProcess("ble");
-      
-      // Change LED to random non-red color when WiFi connects (unless in individual LED mode)
-      if (ledProcess && ledProcess->currentBehavior != &ledsIndividual) {
-        ledProcess->changeToRandomColor();
-      }
-    } else if (!wifiProcess->isWiFiConnected() && bleProcess->isProcessRunning()) {
-      Serial.println("WiFi disconnected - halting BLE process");
-      processManager.haltProcess("ble");
-      
-      // Change LED back to red breathing when WiFi disconnects (unless in individual LED mode)
-      if (ledProcess && ledProcess->currentBehavior != &ledsIndividual) {
-        ledProcess->setToRedBreathing();
-      }
-    }
-  }
+  // Deliver queued events (WiFi up/down, tap, config change, OTA start)
+  eventBus.dispatch();
   
-  // Update the shared WebSocket connection
+  // Update the shared WebSocket connection; its connect blocks, so it is
+  // watched like a process
+  stallWatchdog.enter(STALL_LANE_LOOP, "websocket", WATCHDOG_BUDGET_MS, millis());
   webSocketManager.update();
+  stallWatchdog.exit(STALL_LANE_LOOP, millis());
   
-  // Update all other running processes
+  // Update the processes that are due, then sleep until the next deadline
   processManager.updateProcesses();
+  processManager.idleUntilNextDeadline();
 }
@@ -0,0 +1,149 @@
+// Batched configuration writes against a fake Preferences that counts
+// namespace opens and key writes.
+// Run with: pio test -e native -f test_config_commit
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include "ConfigCommitter.h"
+
+class FakePreferences {
+public:
+    bool opens = true;
+    int begins = 0;
+    int ends = 0;
+    int writes = 0;
+    char lastKey[16] = "";
+
+    bool begin(const char* name, bool readOnly = false) {
+        if (!opens) return false;
+        begins++;
+        return true;
+    }
+
+    void end() { ends++; }
+
+    size_t putString(const char* key, const char* value) {
+        writes++;
+        strncpy(lastKey, key, sizeof(lastKey) - 1);
+        return strlen(value);
+    }
+};
+
+// Four beacon ids, like the device configuration
+struct Beacons {
+    static const size_t COUNT = 4;
+    const char* keys[COUNT] = {"beacon_ne", "beacon_nw", "beacon_se", "beacon_sw"};
+    const char* values[COUNT] = {"", "", "", ""};
+};
+
+typedef BasicConfigCommitter<FakePreferences, Beacons::COUNT> Committer;
+
+static const uint32_t DEBOUNCE_MS = 500;
+static const uint32_t MAX_DELAY_MS = 2000;
+
+static Beacons beacons;
+
+static auto writer() {
+    return [](FakePreferences& prefs, size_t key) { prefs.putString(beacons.keys[key], beacons.values[key]); };
+}
+
+static void set(Committer& committer, size_t key, const char* value, uint32_t now) {
+    beacons.values[key] = value;
+    committer.markDirty(key, now);
+}
+
+void setUp() {
+    beacons = Beacons();
+}
+void tearDown() {}
+
+void test_transaction_writes_each_changed_key_once() {
+    FakePreferences prefs;
+    Committer committer(prefs, "config", DEBOUNCE_MS, MAX_DELAY_MS);
+    committer.begin();
+    for (size_t i = 0; i < Beacons::COUNT; i++) set(committer, i, "64:e8:33:84:43:9a", 0);
+    set(committer, 0, "98:3d:ae:aa:16:8a", 0);
+    TEST_ASSERT_EQUAL(0, prefs.writes);
+    // Not before the outermost commit
+    committer.begin();
+    TEST_ASSERT_TRUE(committer.commit(0, writer()));
+    TEST_ASSERT_EQUAL(0, prefs.begins);
+    TEST_ASSERT_FALSE(committer.update(10000, writer()));
+
+    TEST_ASSERT_TRUE(committer.commit(0, writer()));
+    TEST_ASSERT_EQUAL(1, prefs.begins);
+    TEST_ASSERT_EQUAL(1, prefs.ends);
+    TEST_ASSERT_EQUAL(4, prefs.writes);
+    TEST_ASSERT_FALSE(committer.isDirty());
+    TEST_ASSERT_EQUAL(4, committer.getStats().keysWritten);
+}
+
+void test_only_dirty_keys_are_written() {
+    FakePreferences prefs;
+    Committer committer(prefs, "config", DEBOUNCE_MS, MAX_DELAY_MS);
+    set(committer, 2, "98:3d:ae:aa:16:8a", 0);
+    TEST_ASSERT_TRUE(committer.isDirty(2));
+    TEST_ASSERT_FALSE(committer.isDirty(1));
+    TEST_ASSERT_TRUE(committer.flush(0, writer()));
+    TEST_ASSERT_EQUAL(1, prefs.writes);
+    TEST_ASSERT_EQUAL_STRING("beacon_se", prefs.lastKey);
+
+    // Nothing changed: nothing opened
+    TEST_ASSERT_TRUE(committer.flush(0, writer()));
+    TEST_ASSERT_EQUAL(1, prefs.begins);
+}
+
+void test_background_commit_waits_for_quiet() {
+    FakePreferences prefs;
+    Committer committer(prefs, "config", DEBOUNCE_MS, MAX_DELAY_MS);
+    set(committer, 0, "a", 1000);
+    set(committer, 1, "b", 1200);
+    set(committer, 0, "c", 1400);
+    TEST_ASSERT_EQUAL_UINT32(1900, committer.dueAt());
+    TEST_ASSERT_FALSE(committer.update(1899, writer()));
+    TEST_ASSERT_EQUAL(0, prefs.writes);
+    TEST_ASSERT_TRUE(committer.update(1900, writer()));
+    TEST_ASSERT_EQUAL(1, prefs.begins);
+    TEST_ASSERT_EQUAL(2, prefs.writes);
+    TEST_ASSERT_FALSE(committer.update(5000, writer()));
+}
+
+// A change every 100 ms never goes quiet; it is still written every
+// MAX_DELAY_MS instead of once per change
+void test_steady_changes_are_written_by_the_deadline() {
+    FakePreferences prefs;
+    Committer committer(prefs, "config", DEBOUNCE_MS, MAX_DELAY_MS);
+    for (uint32_t now = 0; now < 5000; now += 100) {
+        set(committer, (now / 100) % Beacons::COUNT, "x", now);
+        committer.update(now, writer());
+    }
+    TEST_ASSERT_EQUAL(2, prefs.begins);
+    TEST_ASSERT_EQUAL(8, prefs.writes);
+}
+
+void test_failed_open_keeps_keys_for_a_retry() {
+    FakePreferences prefs;
+    Committer committer(prefs, "config", DEBOUNCE_MS, MAX_DELAY_MS);
+    prefs.opens = false;
+    set(committer, 3, "a", 0);
+    TEST_ASSERT_FALSE(committer.update(500, writer()));
+    TEST_ASSERT_EQUAL(1, committer.getStats().failures);
+    TEST_ASSERT_TRUE(committer.isDirty(3));
+
+    // Retried after another quiet period, not on every update
+    prefs.opens = true;
+    TEST_ASSERT_FALSE(committer.update(600, writer()));
+    TEST_ASSERT_TRUE(committer.update(1000, writer()));
+    TEST_ASSERT_EQUAL(1, prefs.writes);
+    TEST_ASSERT_EQUAL(0, prefs.ends - prefs.begins);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_transaction_writes_each_changed_key_once);
+    RUN_TEST(test_only_dirty_keys_are_written);
+    RUN_TEST(test_background_commit_waits_for_quiet);
+    RUN_TEST(test_steady_changes_are_written_by_the_deadline);
+    RUN_TEST(test_failed_open_keeps_keys_for_a_retry);
+    return UNITY_END();
+}
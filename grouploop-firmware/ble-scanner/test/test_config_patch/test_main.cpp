@@ -0,0 +1,85 @@
+// Binary configuration updates (config_set:<hex>): framing and records.
+// Run with: pio test -e native -f test_config_patch
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include "ConfigPatch.h"
+
+typedef BasicConfigPatch<32> Patch;
+
+// Socket URL (2) = "ws://a:5003", publish interval (10) = 100
+static const char* const URL_AND_RATE = "01020b77733a2f2f613a353030330a0464000000";
+
+void setUp() {}
+void tearDown() {}
+
+void test_reads_records_in_order() {
+    Patch patch;
+    const char* error = nullptr;
+    TEST_ASSERT_TRUE(patch.loadHex(URL_AND_RATE, error));
+    TEST_ASSERT_EQUAL(2, patch.size());
+
+    ConfigPatchRecord record{};
+    size_t at = 0;
+    TEST_ASSERT_TRUE(patch.next(at, record));
+    TEST_ASSERT_EQUAL_UINT8(2, record.setting);
+    TEST_ASSERT_EQUAL_UINT8(11, record.length);
+    TEST_ASSERT_EQUAL_INT(0, memcmp("ws://a:5003", record.value, 11));
+    TEST_ASSERT_TRUE(patch.next(at, record));
+    TEST_ASSERT_EQUAL_UINT8(10, record.setting);
+    TEST_ASSERT_EQUAL_INT32(100, record.asInt());
+    TEST_ASSERT_FALSE(patch.next(at, record));
+}
+
+void test_numbers_are_little_endian_and_signed() {
+    Patch patch;
+    const char* error = nullptr;
+    TEST_ASSERT_TRUE(patch.loadHex("010304feffffff", error));
+    ConfigPatchRecord record{};
+    size_t at = 0;
+    TEST_ASSERT_TRUE(patch.next(at, record));
+    TEST_ASSERT_EQUAL_INT32(-2, record.asInt());
+}
+
+void test_empty_value_is_allowed() {
+    // Clearing a beacon: setting 6, no bytes
+    Patch patch;
+    const char* error = nullptr;
+    TEST_ASSERT_TRUE(patch.loadHex("010600", error));
+    ConfigPatchRecord record{};
+    size_t at = 0;
+    TEST_ASSERT_TRUE(patch.next(at, record));
+    TEST_ASSERT_EQUAL_UINT8(0, record.length);
+    TEST_ASSERT_FALSE(patch.next(at, record));
+}
+
+void test_rejects_bad_framing() {
+    const struct { const char* hex; const char* error; } cases[] = {
+        { "01020", "odd number of hex digits" },
+        { "0102", "truncated" },
+        { "020600", "unsupported version" },
+        { "01060001", "truncated record" },
+        { "0106036161", "truncated value" },
+        { "01060g", "invalid hex digit" },
+        { "01063061616161616161616161616161616161616161616161616161616161616161", "too long" },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        Patch patch;
+        const char* error = nullptr;
+        TEST_ASSERT_FALSE(patch.loadHex(cases[i].hex, error));
+        TEST_ASSERT_EQUAL_STRING(cases[i].error, error);
+        TEST_ASSERT_EQUAL(0, patch.size());
+        ConfigPatchRecord record{};
+        size_t at = 0;
+        TEST_ASSERT_FALSE(patch.next(at, record));
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_reads_records_in_order);
+    RUN_TEST(test_numbers_are_little_endian_and_signed);
+    RUN_TEST(test_empty_value_is_allowed);
+    RUN_TEST(test_rejects_bad_framing);
+    return UNITY_END();
+}
@@ -0,0 +1,82 @@
+// The configuration schema table: indices, value slots and lookups.
+// Run with: pio test -e native -f test_config_schema
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include "ConfigSchema.h"
+
+typedef ConfigSchema Schema;
+
+// Slots and counts are compile-time constants
+static_assert(configSlot(Schema::SETTING_LED_PIN) == 0, "first INT setting");
+static_assert(configSlot(Schema::SETTING_DEVICE_NAME_PREFIX) == 3, "strings skip the INT settings");
+static_assert(configCount(ConfigType::STRING) + configCount(ConfigType::INT) == Schema::SETTING_COUNT, "every setting has a type");
+
+void setUp() {}
+void tearDown() {}
+
+// The indices are the ConfigPatch setting byte and the CONFIG_CHANGED
+// bit, so existing settings must keep them
+void test_settings_keep_their_indices() {
+    TEST_ASSERT_EQUAL(0, Schema::SETTING_WIFI_SSID);
+    TEST_ASSERT_EQUAL(2, Schema::SETTING_SOCKET_SERVER_URL);
+    TEST_ASSERT_EQUAL(6, Schema::SETTING_BEACON_NE);
+    TEST_ASSERT_EQUAL(10, Schema::SETTING_PUBLISH_INTERVAL);
+    TEST_ASSERT_EQUAL_STRING("beacon_ne", Schema::SETTINGS[Schema::SETTING_BEACON_NE].key);
+}
+
+void test_slots_are_unique_per_type() {
+    bool used[2][Schema::SETTING_COUNT] = {};
+    for (size_t i = 0; i < Schema::SETTING_COUNT; i++) {
+        size_t type = (size_t)Schema::SETTINGS[i].type;
+        size_t slot = configSlot(i);
+        TEST_ASSERT_TRUE(slot < configCount(Schema::SETTINGS[i].type));
+        TEST_ASSERT_FALSE(used[type][slot]);
+        used[type][slot] = true;
+    }
+}
+
+void test_names_and_keys_are_unique() {
+    for (size_t i = 0; i < Schema::SETTING_COUNT; i++) {
+        TEST_ASSERT_EQUAL(i, Schema::find(Schema::SETTINGS[i].name));
+        for (size_t j = i + 1; j < Schema::SETTING_COUNT; j++) {
+            TEST_ASSERT_TRUE(strcmp(Schema::SETTINGS[i].key, Schema::SETTINGS[j].key) != 0);
+        }
+    }
+    TEST_ASSERT_EQUAL(Schema::SETTING_COUNT, Schema::find("nope"));
+    TEST_ASSERT_EQUAL_STRING("", Schema::settingName(Schema::SETTING_COUNT));
+}
+
+void test_defaults_match_their_type() {
+    for (size_t i = 0; i < Schema::SETTING_COUNT; i++) {
+        const ConfigSettingInfo& info = Schema::SETTINGS[i];
+        if (info.type == ConfigType::STRING) {
+            TEST_ASSERT_NOT_NULL(info.defaultText);
+        } else {
+            TEST_ASSERT_NULL(info.defaultText);
+            TEST_ASSERT_EQUAL_INT32(info.defaultNumber, info.clamp(info.defaultNumber));
+        }
+    }
+    TEST_ASSERT_EQUAL_STRING("ws://feib.nl:5003", Schema::SETTINGS[Schema::SETTING_SOCKET_SERVER_URL].defaultText);
+}
+
+void test_flags_and_clamping() {
+    uint32_t restart = configMask(CONFIG_RESTART);
+    TEST_ASSERT_EQUAL_HEX32((1u << Schema::SETTING_LED_PIN) | (1u << Schema::SETTING_MOTOR_PIN), restart);
+    TEST_ASSERT_EQUAL_HEX32(1u << Schema::SETTING_WIFI_PASSWORD, configMask(CONFIG_SECRET));
+
+    const ConfigSettingInfo& interval = Schema::SETTINGS[Schema::SETTING_PUBLISH_INTERVAL];
+    TEST_ASSERT_EQUAL_INT32(10, interval.clamp(1));
+    TEST_ASSERT_EQUAL_INT32(250, interval.clamp(250));
+    TEST_ASSERT_EQUAL_INT32(10000, interval.clamp(60000));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_settings_keep_their_indices);
+    RUN_TEST(test_slots_are_unique_per_type);
+    RUN_TEST(test_names_and_keys_are_unique);
+    RUN_TEST(test_defaults_match_their_type);
+    RUN_TEST(test_flags_and_clamping);
+    return UNITY_END();
+}
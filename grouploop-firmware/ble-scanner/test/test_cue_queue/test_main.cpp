@@ -0,0 +1,110 @@
+// Cue queue ordering and shared clock estimation.
+// Run with: pio test -e native -f test_cue_queue
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include "CueQueue.h"
+#include "SharedClock.h"
+
+typedef BasicCueQueue<8, 16> Queue;
+
+void setUp() {}
+void tearDown() {}
+
+void test_cues_come_out_in_time_order() {
+    Queue queue;
+    TEST_ASSERT_TRUE(queue.push(300, "c"));
+    TEST_ASSERT_TRUE(queue.push(100, "a"));
+    TEST_ASSERT_TRUE(queue.push(200, "b"));
+    TEST_ASSERT_EQUAL_UINT32(100, queue.nextAt());
+
+    uint32_t at = 0;
+    char text[16] = "";
+    TEST_ASSERT_FALSE(queue.popDue(99, at, text));
+    TEST_ASSERT_TRUE(queue.popDue(250, at, text));
+    TEST_ASSERT_EQUAL_STRING("a", text);
+    TEST_ASSERT_TRUE(queue.popDue(250, at, text));
+    TEST_ASSERT_EQUAL_STRING("b", text);
+    TEST_ASSERT_EQUAL_UINT32(200, at);
+    TEST_ASSERT_FALSE(queue.popDue(250, at, text));
+    TEST_ASSERT_EQUAL(1, queue.size());
+}
+
+void test_same_time_keeps_arrival_order() {
+    Queue queue;
+    queue.push(500, "led:ff0000");
+    queue.push(400, "vibrate:100");
+    queue.push(500, "pattern:solid");
+    queue.push(500, "brightness:80");
+    uint32_t at = 0;
+    char text[16] = "";
+    queue.popDue(1000, at, text);
+    TEST_ASSERT_EQUAL_STRING("vibrate:100", text);
+    queue.popDue(1000, at, text);
+    TEST_ASSERT_EQUAL_STRING("led:ff0000", text);
+    queue.popDue(1000, at, text);
+    TEST_ASSERT_EQUAL_STRING("pattern:solid", text);
+    queue.popDue(1000, at, text);
+    TEST_ASSERT_EQUAL_STRING("brightness:80", text);
+}
+
+void test_rejects_when_full_or_too_long() {
+    Queue queue;
+    TEST_ASSERT_FALSE(queue.push(1, "this command is far too long"));
+    for (int i = 0; i < 8; i++) TEST_ASSERT_TRUE(queue.push(i, "x"));
+    TEST_ASSERT_FALSE(queue.push(0, "y"));
+}
+
+void test_order_holds_across_the_wrap() {
+    Queue queue;
+    queue.push(0x00000010u, "after");
+    queue.push(0xFFFFFFF0u, "before");
+    uint32_t at = 0;
+    char text[16] = "";
+    TEST_ASSERT_FALSE(queue.popDue(0xFFFFFFE0u, at, text));
+    TEST_ASSERT_TRUE(queue.popDue(0x00000020u, at, text));
+    TEST_ASSERT_EQUAL_STRING("before", text);
+    TEST_ASSERT_TRUE(queue.popDue(0x00000020u, at, text));
+    TEST_ASSERT_EQUAL_STRING("after", text);
+}
+
+void test_clock_uses_fastest_exchange() {
+    BasicSharedClock<4> clock(1000);
+    TEST_ASSERT_FALSE(clock.isSynced());
+
+    // Server is 10000 ms ahead; replies are delayed asymmetrically by queueing
+    // (sent, server, received): the server read its clock at local time + delay up
+    TEST_ASSERT_TRUE(clock.addSample(1000, 11000 + 80, 1000 + 100));  // 80 up, 20 down
+    TEST_ASSERT_EQUAL_UINT32(100, clock.getRoundTrip());
+    TEST_ASSERT_TRUE(clock.addSample(2000, 12000 + 5, 2000 + 10));    // 5 up, 5 down
+    TEST_ASSERT_TRUE(clock.addSample(3000, 13000 + 150, 3000 + 200));
+    TEST_ASSERT_EQUAL_UINT32(10, clock.getRoundTrip());
+    TEST_ASSERT_EQUAL_UINT32(15000, clock.sharedNow(5000));
+    TEST_ASSERT_EQUAL_UINT32(5000, clock.toLocal(15000));
+
+    // Unusable exchanges are ignored
+    TEST_ASSERT_FALSE(clock.addSample(4000, 99999, 3990));
+    TEST_ASSERT_FALSE(clock.addSample(4000, 99999, 5500));
+    TEST_ASSERT_EQUAL_UINT32(15000, clock.sharedNow(5000));
+}
+
+void test_old_samples_age_out() {
+    BasicSharedClock<2> clock;
+    clock.addSample(0, 10000 + 1, 2);       // rtt 2, offset 10000
+    // The server clock steps by +50 (or the crystal drifted); newer but slower
+    clock.addSample(100, 10150 + 10, 120);
+    TEST_ASSERT_EQUAL_UINT32(10000, clock.sharedNow(0));
+    clock.addSample(200, 10250 + 10, 220);  // the fast sample has left the window
+    TEST_ASSERT_EQUAL_UINT32(10050, clock.sharedNow(0));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_cues_come_out_in_time_order);
+    RUN_TEST(test_same_time_keeps_arrival_order);
+    RUN_TEST(test_rejects_when_full_or_too_long);
+    RUN_TEST(test_order_holds_across_the_wrap);
+    RUN_TEST(test_clock_uses_fastest_exchange);
+    RUN_TEST(test_old_samples_age_out);
+    return UNITY_END();
+}
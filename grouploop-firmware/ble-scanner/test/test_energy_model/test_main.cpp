@@ -0,0 +1,123 @@
+// Power policies compared on the host energy model, plus DTIM slot maths.
+// Run with: pio test -e native -f test_energy_model
+#include <unity.h>
+#include <stdint.h>
+#include "PowerPolicy.h"
+#include "EnergyModel.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_modes_trade_frame_rate_for_current() {
+    EnergyModel model;
+    EnergyReport performance = model.simulate(powerProfileFor(PowerMode::PERFORMANCE), 10000);
+    EnergyReport balanced = model.simulate(powerProfileFor(PowerMode::BALANCED), 10000);
+    EnergyReport saver = model.simulate(powerProfileFor(PowerMode::SAVER), 10000);
+
+    TEST_ASSERT_TRUE(saver.averageMa < balanced.averageMa);
+    TEST_ASSERT_TRUE(balanced.averageMa < performance.averageMa);
+
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 20.0f, performance.framesPerSecond());
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, 9.8f, balanced.framesPerSecond());
+    TEST_ASSERT_FLOAT_WITHIN(0.2f, 3.3f, saver.framesPerSecond());
+}
+
+void test_every_mode_keeps_modem_sleep() {
+    // Modem sleep has to stay on while BLE scans, and keeping the receiver
+    // on would dominate anyway: even performance draws less than half
+    EnergyModel model;
+    PowerProfile alwaysOn = powerProfileFor(PowerMode::PERFORMANCE);
+    alwaysOn.modemSleep = ModemSleep::NONE;
+    EnergyReport baseline = model.simulate(alwaysOn, 10000);
+    TEST_ASSERT_EQUAL_UINT32(10000, baseline.radioOnMs);
+
+    for (uint8_t i = 0; i <= (uint8_t)PowerMode::SAVER; i++) {
+        PowerProfile profile = powerProfileFor((PowerMode)i);
+        TEST_ASSERT_TRUE(profile.modemSleep != ModemSleep::NONE);
+        TEST_ASSERT_TRUE(model.simulate(profile, 10000).averageMa < baseline.averageMa / 2);
+    }
+}
+
+void test_dtim_aligned_sends_do_not_wake_the_radio() {
+    EnergyConditions conditions;
+    conditions.publishIntervalMs = 102;     // same rate, arbitrary phase
+    EnergyModel model(EnergyParams(), conditions);
+    PowerProfile aligned = powerProfileFor(PowerMode::BALANCED);
+    PowerProfile unaligned = aligned;
+    unaligned.publishWakes = 0;
+
+    EnergyReport a = model.simulate(aligned, 10000);
+    EnergyReport u = model.simulate(unaligned, 10000);
+    TEST_ASSERT_UINT32_WITHIN(1, a.frames, u.frames);   // phase may drop the last one
+    TEST_ASSERT_UINT32_WITHIN(2, 2 * a.radioWakes, u.radioWakes);
+    TEST_ASSERT_TRUE(a.radioOnMs < u.radioOnMs);
+    TEST_ASSERT_TRUE(a.averageMa < u.averageMa);
+}
+
+void test_lower_idle_clock_saves_current() {
+    EnergyModel model;
+    PowerProfile full = fixedClock(powerProfileFor(PowerMode::BALANCED));
+    TEST_ASSERT_EQUAL_UINT16(160, full.idleCpuMHz);
+    PowerProfile scaled = powerProfileFor(PowerMode::BALANCED);
+    TEST_ASSERT_TRUE(model.simulate(scaled, 5000).averageMa < model.simulate(full, 5000).averageMa);
+}
+
+void test_fixed_interval_follows_the_setting() {
+    EnergyConditions slow;
+    slow.publishIntervalMs = 200;
+    EnergyModel model(EnergyParams(), slow);
+    EnergyReport performance = model.simulate(powerProfileFor(PowerMode::PERFORMANCE), 10000);
+    TEST_ASSERT_FLOAT_WITHIN(0.1f, 5.0f, performance.framesPerSecond());
+    TEST_ASSERT_TRUE(performance.averageMa < EnergyModel().estimateMa(PowerMode::PERFORMANCE));
+}
+
+void test_longer_dtim_period_stretches_balanced_mode() {
+    EnergyConditions dtim3;
+    dtim3.dtimPeriod = 3;
+    EnergyModel dtim1Model;
+    EnergyModel dtim3Model(EnergyParams(), dtim3);
+    EnergyReport one = dtim1Model.simulate(powerProfileFor(PowerMode::BALANCED), 10000);
+    EnergyReport three = dtim3Model.simulate(powerProfileFor(PowerMode::BALANCED), 10000);
+    TEST_ASSERT_TRUE(three.frames < one.frames);
+    TEST_ASSERT_TRUE(three.averageMa < one.averageMa);
+    TEST_ASSERT_TRUE(three.hoursOn(500) > one.hoursOn(500));
+}
+
+void test_dtim_schedule_slots() {
+    DtimSchedule schedule(100, 2);
+    // No anchor yet: the grid starts now
+    TEST_ASSERT_EQUAL_UINT32(500, schedule.nextSlot(500));
+
+    schedule.anchor(1000);
+    TEST_ASSERT_EQUAL_UINT32(1002, schedule.nextSlot(900));
+    TEST_ASSERT_EQUAL_UINT32(1002, schedule.nextSlot(1002));
+    TEST_ASSERT_EQUAL_UINT32(1102, schedule.nextSlot(1003));
+    TEST_ASSERT_EQUAL_UINT32(1302, schedule.nextSlot(1003, 3));
+    TEST_ASSERT_EQUAL_UINT32(5002, schedule.nextSlot(4950));
+
+    // Across the millis() wrap
+    schedule.anchor(0xFFFFFF00u);
+    TEST_ASSERT_EQUAL_UINT32(0xFFFFFF02u + 300u, schedule.nextSlot(0x00000010u));
+}
+
+void test_mode_names_round_trip() {
+    PowerMode mode = PowerMode::PERFORMANCE;
+    TEST_ASSERT_TRUE(parsePowerMode("saver", mode));
+    TEST_ASSERT_TRUE(mode == PowerMode::SAVER);
+    TEST_ASSERT_EQUAL_STRING("balanced", powerModeName(PowerMode::BALANCED));
+    TEST_ASSERT_FALSE(parsePowerMode("turbo", mode));
+    TEST_ASSERT_TRUE(mode == PowerMode::SAVER);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_modes_trade_frame_rate_for_current);
+    RUN_TEST(test_every_mode_keeps_modem_sleep);
+    RUN_TEST(test_dtim_aligned_sends_do_not_wake_the_radio);
+    RUN_TEST(test_lower_idle_clock_saves_current);
+    RUN_TEST(test_fixed_interval_follows_the_setting);
+    RUN_TEST(test_longer_dtim_period_stretches_balanced_mode);
+    RUN_TEST(test_dtim_schedule_slots);
+    RUN_TEST(test_mode_names_round_trip);
+    return UNITY_END();
+}
@@ -0,0 +1,113 @@
+// Event bus delivery and overflow tests.
+// Run with: pio test -e native -f test_event_bus
+#include <unity.h>
+#include <stdint.h>
+#include "EventBus.h"
+
+typedef BasicEventBus<4, 8> TestBus;
+
+struct Recorder {
+    EventType types[32];
+    uint32_t values[32];
+    int count;
+};
+
+static Recorder recorder;
+
+static void record(const Event& event, void* context) {
+    Recorder* r = static_cast<Recorder*>(context);
+    r->types[r->count] = event.type;
+    r->values[r->count] = event.value;
+    r->count++;
+}
+
+void setUp() { recorder = Recorder(); }
+void tearDown() {}
+
+void test_publish_only_queues_until_dispatch() {
+    TestBus bus;
+    bus.subscribe(EventType::TAP, record, &recorder);
+    TEST_ASSERT_TRUE(bus.publish(EventType::TAP, 3000));
+    TEST_ASSERT_EQUAL(0, recorder.count);
+    TEST_ASSERT_EQUAL(1, bus.pending());
+
+    TEST_ASSERT_EQUAL(1, bus.dispatch());
+    TEST_ASSERT_EQUAL(1, recorder.count);
+    TEST_ASSERT_EQUAL_UINT32(3000, recorder.values[0]);
+    TEST_ASSERT_EQUAL(0, bus.dispatch());
+}
+
+void test_events_reach_only_their_subscribers_in_order() {
+    TestBus bus;
+    Recorder wifi = Recorder();
+    bus.subscribe(EventType::WIFI_UP, record, &wifi);
+    bus.subscribe(EventType::WIFI_DOWN, record, &wifi);
+    bus.subscribe(EventType::TAP, record, &recorder);
+
+    bus.publish(EventType::WIFI_UP);
+    bus.publish(EventType::TAP);
+    bus.publish(EventType::CONFIG_CHANGED);   // nobody listens
+    bus.publish(EventType::WIFI_DOWN);
+    TEST_ASSERT_EQUAL(4, bus.dispatch());
+
+    TEST_ASSERT_EQUAL(2, wifi.count);
+    TEST_ASSERT_TRUE(wifi.types[0] == EventType::WIFI_UP);
+    TEST_ASSERT_TRUE(wifi.types[1] == EventType::WIFI_DOWN);
+    TEST_ASSERT_EQUAL(1, recorder.count);
+}
+
+void test_full_queue_drops_and_counts() {
+    TestBus bus;
+    bus.subscribe(EventType::TAP, record, &recorder);
+    for (uint32_t i = 0; i < 10; i++) {
+        bus.publish(EventType::TAP, i);
+    }
+    TEST_ASSERT_EQUAL_UINT32(2, bus.getDropped());
+    TEST_ASSERT_EQUAL(8, bus.dispatch());
+    // The oldest events survive; the wrapped ring still delivers in order
+    for (int i = 0; i < 8; i++) {
+        TEST_ASSERT_EQUAL_UINT32(i, recorder.values[i]);
+    }
+
+    bus.publish(EventType::TAP, 100);
+    bus.dispatch();
+    TEST_ASSERT_EQUAL_UINT32(100, recorder.values[8]);
+}
+
+void test_subscriber_table_is_bounded() {
+    TestBus bus;
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(bus.subscribe(EventType::TAP, record, &recorder));
+    }
+    TEST_ASSERT_FALSE(bus.subscribe(EventType::TAP, record, &recorder));
+    TEST_ASSERT_FALSE(bus.subscribe(EventType::TAP, nullptr));
+    bus.publish(EventType::TAP);
+    bus.dispatch();
+    TEST_ASSERT_EQUAL(4, recorder.count);
+}
+
+static TestBus* chainBus = nullptr;
+
+static void republish(const Event& event, void* context) {
+    chainBus->publish(EventType::CONFIG_CHANGED);
+}
+
+void test_events_published_by_handlers_are_delivered_in_same_dispatch() {
+    TestBus bus;
+    chainBus = &bus;
+    bus.subscribe(EventType::WIFI_UP, republish);
+    bus.subscribe(EventType::CONFIG_CHANGED, record, &recorder);
+    bus.publish(EventType::WIFI_UP);
+    TEST_ASSERT_EQUAL(2, bus.dispatch());
+    TEST_ASSERT_EQUAL(1, recorder.count);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_publish_only_queues_until_dispatch);
+    RUN_TEST(test_events_reach_only_their_subscribers_in_order);
+    RUN_TEST(test_full_queue_drops_and_counts);
+    RUN_TEST(test_subscriber_table_is_bounded);
+    RUN_TEST(test_events_published_by_handlers_are_delivered_in_same_dispatch);
+    return UNITY_END();
+}
@@ -0,0 +1,214 @@
+// Haptic engine against a fake PWM driver: edge timing under a late
+// scheduler, envelopes, priorities and the queue.
+// Run with: pio test -e native -f test_haptic_engine
+#include <unity.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "HapticEngine.h"
+
+// Records every duty change with the (virtual) time it happened at
+class FakePwm : public HapticOutput {
+public:
+    struct Change {
+        uint32_t at;
+        uint8_t duty;
+    };
+    static const size_t MAX_CHANGES = 1024;
+
+    Change changes[MAX_CHANGES];
+    size_t count;
+    uint32_t now;
+
+    FakePwm() : count(0), now(0) {}
+
+    void setDuty(uint8_t duty) override {
+        if (count < MAX_CHANGES) changes[count++] = Change{now, duty};
+    }
+
+    uint8_t dutyAt(uint32_t at) const {
+        uint8_t duty = 0;
+        for (size_t i = 0; i < count && changes[i].at <= at; i++) duty = changes[i].duty;
+        return duty;
+    }
+};
+
+typedef BasicHapticEngine<4> Engine;
+
+// Runs the engine like the scheduler would, waking up to `lateMs` after
+// the time it asked for, and leaves `now` at `until`
+static void runUntil(Engine& engine, FakePwm& pwm, uint32_t& now, uint32_t until, uint32_t lateMs = 0) {
+    while ((int32_t)(until - now) > 0) {
+        pwm.now = now;
+        uint32_t next = engine.update(now);
+        uint32_t late = lateMs ? (uint32_t)(rand() % (lateMs + 1)) : 0;
+        now = next + late;
+    }
+    now = until;
+}
+
+static HapticPattern pattern(uint8_t level, uint16_t attack, uint16_t sustain, uint16_t decay, uint16_t gap,
+                             uint8_t repeats, HapticPriority priority = HapticPriority::NORMAL) {
+    return HapticPattern{level, attack, sustain, decay, gap, repeats, priority};
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_buzz_switches_on_and_off_on_time() {
+    FakePwm pwm;
+    Engine engine(pwm, 5);
+    uint32_t now = 1000;
+    TEST_ASSERT_TRUE(engine.play(HapticPattern::buzz(255, 120), now));
+    runUntil(engine, pwm, now, 2000);
+
+    TEST_ASSERT_EQUAL(2, pwm.count);
+    TEST_ASSERT_EQUAL_UINT32(1000, pwm.changes[0].at);
+    TEST_ASSERT_EQUAL_UINT8(255, pwm.changes[0].duty);
+    TEST_ASSERT_EQUAL_UINT32(1120, pwm.changes[1].at);
+    TEST_ASSERT_EQUAL_UINT8(0, pwm.changes[1].duty);
+    TEST_ASSERT_FALSE(engine.isPlaying());
+}
+
+// 100 pulses of 40 ms on, 60 ms off with every wakeup up to 3 ms late: each
+// edge is at most 3 ms off, so the error never builds up
+void test_late_updates_do_not_drift() {
+    srand(7);
+    FakePwm pwm;
+    Engine engine(pwm, 5);
+    uint32_t now = 0;
+    engine.play(pattern(200, 0, 40, 0, 60, 100), now);
+    runUntil(engine, pwm, now, 11000, 3);
+
+    TEST_ASSERT_EQUAL(200, pwm.count);
+    for (size_t i = 0; i < pwm.count; i++) {
+        uint32_t ideal = (i / 2) * 100 + (i % 2 ? 40 : 0);
+        TEST_ASSERT_EQUAL_UINT8(i % 2 ? 0 : 200, pwm.changes[i].duty);
+        TEST_ASSERT_TRUE(pwm.changes[i].at >= ideal);
+        TEST_ASSERT_TRUE(pwm.changes[i].at - ideal <= 3);
+    }
+}
+
+void test_envelope_ramps_up_holds_and_decays() {
+    FakePwm pwm;
+    Engine engine(pwm, 5);
+    uint32_t now = 0;
+    engine.play(pattern(200, 100, 50, 200, 0, 1), now);
+    runUntil(engine, pwm, now, 1000);
+
+    TEST_ASSERT_EQUAL_UINT8(0, pwm.dutyAt(0));
+    TEST_ASSERT_UINT8_WITHIN(10, 100, pwm.dutyAt(50));
+    TEST_ASSERT_EQUAL_UINT8(200, pwm.dutyAt(100));
+    TEST_ASSERT_EQUAL_UINT8(200, pwm.dutyAt(149));
+    TEST_ASSERT_UINT8_WITHIN(10, 100, pwm.dutyAt(250));
+    TEST_ASSERT_EQUAL_UINT8(0, pwm.dutyAt(350));
+    // Ramps climb and fall in steps of the ramp interval, never backwards
+    for (size_t i = 1; i < pwm.count; i++) {
+        uint32_t at = pwm.changes[i].at;
+        if (at <= 100) TEST_ASSERT_TRUE(pwm.changes[i].duty > pwm.changes[i - 1].duty);
+        if (at > 150) TEST_ASSERT_TRUE(pwm.changes[i].duty < pwm.changes[i - 1].duty);
+        if (at <= 100 || at > 155) TEST_ASSERT_TRUE(at - pwm.changes[i - 1].at <= 5);
+    }
+}
+
+void test_queued_patterns_play_back_to_back() {
+    FakePwm pwm;
+    Engine engine(pwm, 5);
+    uint32_t now = 0;
+    engine.play(HapticPattern::buzz(100, 50), now);
+    engine.play(HapticPattern::buzz(150, 30), now);
+    TEST_ASSERT_EQUAL(1, engine.getQueued());
+    // Woken late: the second still starts exactly where the first ended
+    now = 70;
+    pwm.now = now;
+    engine.update(now);
+    TEST_ASSERT_EQUAL_UINT8(150, engine.getDuty());
+    TEST_ASSERT_EQUAL_UINT32(80, engine.update(now));
+}
+
+void test_higher_priority_interrupts() {
+    FakePwm pwm;
+    Engine engine(pwm, 5);
+    uint32_t now = 0;
+    engine.play(HapticPattern::buzz(100, 500), now);
+    runUntil(engine, pwm, now, 100);
+    TEST_ASSERT_TRUE(engine.play(HapticPattern::buzz(255, 50, HapticPriority::ALERT), now));
+    pwm.now = now;
+    engine.update(now);
+    TEST_ASSERT_EQUAL_UINT8(255, engine.getDuty());
+    TEST_ASSERT_EQUAL(1, engine.getStats().interrupted);
+    // The interrupted one-shot is not resumed
+    runUntil(engine, pwm, now, 1000);
+    TEST_ASSERT_EQUAL_UINT8(0, pwm.dutyAt(200));
+    TEST_ASSERT_FALSE(engine.isPlaying());
+
+    // A lower priority waits its turn
+    now = 2000;
+    engine.play(HapticPattern::buzz(255, 50, HapticPriority::ALERT), now);
+    engine.play(HapticPattern::buzz(100, 50), now);
+    TEST_ASSERT_EQUAL(1, engine.getQueued());
+    TEST_ASSERT_TRUE(engine.getCurrent().priority == HapticPriority::ALERT);
+}
+
+void test_background_loop_resumes_after_interruption() {
+    FakePwm pwm;
+    Engine engine(pwm, 5);
+    uint32_t now = 0;
+    engine.play(pattern(80, 0, 100, 0, 100, HapticPattern::FOREVER, HapticPriority::BACKGROUND), now);
+    runUntil(engine, pwm, now, 250);
+    engine.play(HapticPattern::buzz(255, 100), now);
+    TEST_ASSERT_EQUAL(1, engine.getQueued());
+    runUntil(engine, pwm, now, 400);
+    TEST_ASSERT_TRUE(engine.isPlaying());
+    TEST_ASSERT_TRUE(engine.getCurrent().loops());
+    TEST_ASSERT_EQUAL_UINT8(80, pwm.dutyAt(360));
+
+    // Another loop of the same priority replaces it
+    engine.play(pattern(40, 0, 100, 0, 0, HapticPattern::FOREVER, HapticPriority::BACKGROUND), now);
+    TEST_ASSERT_EQUAL(0, engine.getQueued());
+}
+
+void test_full_queue_keeps_the_highest_priorities() {
+    FakePwm pwm;
+    Engine engine(pwm, 5);
+    uint32_t now = 0;
+    engine.play(HapticPattern::buzz(255, 100, HapticPriority::ALERT), now);
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(engine.play(HapticPattern::buzz(10 + i, 100, HapticPriority::BACKGROUND), now));
+    }
+    TEST_ASSERT_FALSE(engine.play(HapticPattern::buzz(50, 100, HapticPriority::BACKGROUND), now));
+    TEST_ASSERT_TRUE(engine.play(HapticPattern::buzz(60, 100), now));
+    TEST_ASSERT_EQUAL(4, engine.getQueued());
+    TEST_ASSERT_EQUAL(2, engine.getStats().dropped);
+
+    // The NORMAL one went first in line
+    runUntil(engine, pwm, now, 150);
+    TEST_ASSERT_EQUAL_UINT8(60, engine.getDuty());
+}
+
+void test_stop_and_empty_patterns() {
+    FakePwm pwm;
+    Engine engine(pwm, 5);
+    uint32_t now = 0;
+    TEST_ASSERT_FALSE(engine.play(HapticPattern::buzz(0, 100), now));
+    TEST_ASSERT_FALSE(engine.play(HapticPattern::buzz(255, 0), now));
+    engine.play(HapticPattern::buzz(255, 1000), now);
+    engine.play(HapticPattern::buzz(255, 1000), now);
+    runUntil(engine, pwm, now, 10);
+    engine.stop();
+    TEST_ASSERT_EQUAL_UINT8(0, engine.getDuty());
+    TEST_ASSERT_EQUAL(0, engine.getQueued());
+    TEST_ASSERT_EQUAL_UINT32(now + Engine::IDLE_MS, engine.update(now));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_buzz_switches_on_and_off_on_time);
+    RUN_TEST(test_late_updates_do_not_drift);
+    RUN_TEST(test_envelope_ramps_up_holds_and_decays);
+    RUN_TEST(test_queued_patterns_play_back_to_back);
+    RUN_TEST(test_higher_priority_interrupts);
+    RUN_TEST(test_background_loop_resumes_after_interruption);
+    RUN_TEST(test_full_queue_keeps_the_highest_priorities);
+    RUN_TEST(test_stop_and_empty_patterns);
+    return UNITY_END();
+}
@@ -0,0 +1,146 @@
+// Haptic waveforms: parsing, the id cache and playback through the engine.
+// Run with: pio test -e native -f test_haptic_waveform
+#include <unity.h>
+#include <stdint.h>
+#include "HapticWaveform.h"
+#include "HapticEngine.h"
+
+typedef BasicHapticWaveformCache<2, 8> Cache;
+typedef Cache::Waveform Waveform;
+
+// 10 ms steps, once, normal: ramp to 255 in 20 ms, hold 30, drop to 0 for 50
+static const char* const RAMP_HOLD = "010a0101ff82ff030005";
+
+class FakePwm : public HapticOutput {
+public:
+    uint8_t duty;
+    FakePwm() : duty(0) {}
+    void setDuty(uint8_t value) override { duty = value; }
+};
+
+void setUp() {}
+void tearDown() {}
+
+void test_parses_segments_at_the_step_rate() {
+    Waveform waveform;
+    const char* error = nullptr;
+    TEST_ASSERT_TRUE(waveform.loadHex(RAMP_HOLD, error));
+    TEST_ASSERT_EQUAL(3, waveform.segmentCount);
+    TEST_ASSERT_EQUAL_UINT32(100, waveform.durationMs);
+    TEST_ASSERT_EQUAL(1, waveform.repeats);
+    TEST_ASSERT_EQUAL(1, waveform.priority);
+    TEST_ASSERT_TRUE(waveform.segments[0].ramp);
+    TEST_ASSERT_EQUAL_UINT16(20, waveform.segments[0].ms);
+    TEST_ASSERT_FALSE(waveform.segments[1].ramp);
+    TEST_ASSERT_EQUAL_UINT16(30, waveform.segments[1].ms);
+    TEST_ASSERT_EQUAL_UINT8(0, waveform.segments[2].level);
+}
+
+void test_rejects_bad_waveforms() {
+    const struct { const char* hex; const char* error; } cases[] = {
+        { "010a0101ff8", "odd number of hex digits" },
+        { "010a0101", "truncated" },
+        { "010a0101ff82ff", "truncated segment" },
+        { "020a0101ff82", "unsupported version" },
+        { "01000101ff82", "zero step" },
+        { "010a0103ff82", "unknown priority" },
+        { "010a0101ff80", "empty segment" },
+        { "010a01010082", "silent" },
+        { "010a0101zz82", "invalid hex digit" },
+        { "010a0101ff01ff01ff01ff01ff01ff01ff01ff01ff01", "too many segments" },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        Waveform waveform;
+        const char* error = nullptr;
+        TEST_ASSERT_FALSE(waveform.loadHex(cases[i].hex, error));
+        TEST_ASSERT_EQUAL_STRING(cases[i].error, error);
+        TEST_ASSERT_FALSE(waveform.isLoaded());
+    }
+}
+
+void test_cache_evicts_least_recently_played() {
+    Cache cache;
+    const char* error = nullptr;
+    Waveform* slot = nullptr;
+    TEST_ASSERT_TRUE(cache.load(1, RAMP_HOLD, error, slot));
+    TEST_ASSERT_TRUE(cache.load(2, RAMP_HOLD, error, slot));
+    TEST_ASSERT_NOT_NULL(cache.use(1));
+    TEST_ASSERT_TRUE(cache.load(3, RAMP_HOLD, error, slot));
+    TEST_ASSERT_NOT_NULL(cache.find(1));
+    TEST_ASSERT_NULL(cache.find(2));
+    TEST_ASSERT_EQUAL_PTR(cache.find(3), slot);
+
+    // Reloading an id reuses its slot; a rejected upload changes nothing
+    TEST_ASSERT_TRUE(cache.load(1, "010a0101ff01", error, slot));
+    TEST_ASSERT_EQUAL_PTR(cache.find(1), slot);
+    TEST_ASSERT_EQUAL_UINT32(10, slot->durationMs);
+    TEST_ASSERT_FALSE(cache.load(3, "010a01010082", error, slot));
+    TEST_ASSERT_EQUAL_UINT32(100, cache.find(3)->durationMs);
+    TEST_ASSERT_EQUAL(2, cache.size());
+}
+
+void test_engine_plays_waveform_scaled_by_level() {
+    Cache cache;
+    const char* error = nullptr;
+    Waveform* slot = nullptr;
+    cache.load(7, RAMP_HOLD, error, slot);
+    FakePwm pwm;
+    BasicHapticEngine<4> engine(pwm, 5);
+    engine.play(HapticPattern::waveform(slot->segments, slot->segmentCount, slot->repeats, HapticPriority::NORMAL), 0);
+
+    TEST_ASSERT_EQUAL_UINT32(5, engine.update(0));
+    TEST_ASSERT_EQUAL_UINT8(0, pwm.duty);
+    engine.update(10);
+    TEST_ASSERT_UINT8_WITHIN(2, 128, pwm.duty);
+    TEST_ASSERT_EQUAL_UINT32(50, engine.update(20));
+    TEST_ASSERT_EQUAL_UINT8(255, pwm.duty);
+    TEST_ASSERT_EQUAL_UINT32(100, engine.update(50));
+    TEST_ASSERT_EQUAL_UINT8(0, pwm.duty);
+    engine.update(100);
+    TEST_ASSERT_FALSE(engine.isPlaying());
+
+    // Half strength
+    engine.play(HapticPattern::waveform(slot->segments, slot->segmentCount, 1, HapticPriority::NORMAL, 128), 200);
+    engine.update(225);
+    TEST_ASSERT_EQUAL_UINT8(128, pwm.duty);
+}
+
+void test_cued_start_in_the_past_catches_up() {
+    Cache cache;
+    const char* error = nullptr;
+    Waveform* slot = nullptr;
+    cache.load(7, RAMP_HOLD, error, slot);
+    FakePwm pwm;
+    BasicHapticEngine<4> engine(pwm, 5);
+    // Due at 1000, run at 1030: already in the hold, as an LED timeline
+    // anchored at 1000 would be
+    engine.play(HapticPattern::waveform(slot->segments, slot->segmentCount, 1, HapticPriority::NORMAL), 1000);
+    TEST_ASSERT_EQUAL_UINT32(1050, engine.update(1030));
+    TEST_ASSERT_EQUAL_UINT8(255, pwm.duty);
+}
+
+void test_forget_drops_a_replaced_waveform() {
+    Cache cache;
+    const char* error = nullptr;
+    Waveform* slot = nullptr;
+    cache.load(7, RAMP_HOLD, error, slot);
+    FakePwm pwm;
+    BasicHapticEngine<4> engine(pwm, 5);
+    engine.play(HapticPattern::buzz(255, 100), 0);
+    engine.play(HapticPattern::waveform(slot->segments, slot->segmentCount, 1, HapticPriority::NORMAL), 0);
+    TEST_ASSERT_EQUAL(1, engine.getQueued());
+    engine.forget(slot->segments);
+    TEST_ASSERT_EQUAL(0, engine.getQueued());
+    TEST_ASSERT_TRUE(engine.isPlaying());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_parses_segments_at_the_step_rate);
+    RUN_TEST(test_rejects_bad_waveforms);
+    RUN_TEST(test_cache_evicts_least_recently_played);
+    RUN_TEST(test_engine_plays_waveform_scaled_by_level);
+    RUN_TEST(test_cued_start_in_the_past_catches_up);
+    RUN_TEST(test_forget_drops_a_replaced_waveform);
+    return UNITY_END();
+}
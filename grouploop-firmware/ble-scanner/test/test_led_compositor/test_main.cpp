@@ -0,0 +1,129 @@
+// LED compositor: blend modes, opacity, lifetimes and fades, skipped frames.
+// Run with: pio test -e native -f test_led_compositor
+#include <unity.h>
+#include <stdint.h>
+#include "LedCompositor.h"
+
+typedef BasicLedCompositor<3, 3> Compositor;
+
+void setUp() {}
+void tearDown() {}
+
+void test_base_layer_alone_passes_through() {
+    Compositor compositor;
+    uint32_t out[3] = {0};
+    compositor.canvas(0).fill(0x123456);
+    compositor.canvas(0).show();
+    TEST_ASSERT_TRUE(compositor.compose(0, out));
+    TEST_ASSERT_EQUAL_HEX32(0x123456, out[0]);
+    TEST_ASSERT_EQUAL_HEX32(0x123456, out[2]);
+}
+
+void test_blend_modes() {
+    Compositor compositor;
+    uint32_t out[3] = {0};
+    compositor.canvas(0).fill(0x804000);
+    compositor.canvas(1).fill(0x80FF40);
+    const struct { BlendMode mode; uint32_t expected; } cases[] = {
+        { BlendMode::NORMAL, 0x80FF40 },
+        { BlendMode::ADD, 0xFFFF40 },
+        { BlendMode::MULTIPLY, 0x404000 },
+        { BlendMode::SCREEN, 0xC0FF40 },
+        { BlendMode::LIGHTEN, 0x80FF40 },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        compositor.setLayer(1, 255, cases[i].mode, 0);
+        TEST_ASSERT_TRUE(compositor.compose(0, out));
+        TEST_ASSERT_UINT32_WITHIN(0x010101, cases[i].expected, out[0]);
+    }
+}
+
+void test_opacity_mixes_normal_layer() {
+    Compositor compositor;
+    uint32_t out[3] = {0};
+    compositor.canvas(0).fill(0x000000);
+    compositor.canvas(1).fill(0xFF0000);
+    compositor.setLayer(1, 0, BlendMode::NORMAL, 0);
+    compositor.compose(0, out);
+    TEST_ASSERT_EQUAL_HEX32(0x000000, out[1]);
+
+    compositor.setLayer(1, 128, BlendMode::NORMAL, 0);
+    compositor.compose(0, out);
+    TEST_ASSERT_INT_WITHIN(1, 128, (int)(out[1] >> 16));
+
+    // Layers stack in order: layer 2 covers layer 1
+    compositor.canvas(2).fill(0x0000FF);
+    compositor.setLayer(2, 255, BlendMode::NORMAL, 0);
+    compositor.compose(0, out);
+    TEST_ASSERT_EQUAL_HEX32(0x0000FF, out[1]);
+}
+
+void test_lifetime_fades_then_expires() {
+    Compositor compositor;
+    uint32_t out[3] = {0};
+    compositor.canvas(0).fill(0x000010);
+    compositor.canvas(1).fill(0xFF0000);
+    compositor.setLayer(1, 255, BlendMode::ADD, 1000, 400, 200);
+
+    compositor.compose(1100, out);
+    TEST_ASSERT_EQUAL_HEX32(0xFF0010, out[0]);      // before the fade
+    compositor.compose(1300, out);
+    TEST_ASSERT_INT_WITHIN(2, 128, (int)(out[0] >> 16));
+    TEST_ASSERT_EQUAL_UINT32(0, compositor.expire(1399));
+
+    TEST_ASSERT_EQUAL_UINT32(1u << 1, compositor.expire(1400));
+    TEST_ASSERT_FALSE(compositor.isActive(1));
+    TEST_ASSERT_TRUE(compositor.compose(1400, out));
+    TEST_ASSERT_EQUAL_HEX32(0x000010, out[0]);      // base untouched underneath
+}
+
+void test_unchanged_layers_skip_composition() {
+    Compositor compositor;
+    uint32_t out[3] = {0};
+    compositor.canvas(0).fill(0x0000FF);
+    compositor.canvas(1).fill(0x00FF00);
+    compositor.setLayer(1, 255, BlendMode::ADD, 0);
+    TEST_ASSERT_TRUE(compositor.compose(0, out));
+    TEST_ASSERT_FALSE(compositor.compose(10, out));
+
+    // Drawing into an inactive layer changes nothing
+    compositor.canvas(2).show();
+    TEST_ASSERT_FALSE(compositor.compose(20, out));
+
+    compositor.canvas(1).show();
+    TEST_ASSERT_TRUE(compositor.compose(30, out));
+    TEST_ASSERT_EQUAL_HEX32(0x00FFFF, out[0]);
+}
+
+void test_base_layer_cannot_be_cleared() {
+    Compositor compositor;
+    uint32_t out[3] = {0};
+    compositor.canvas(0).fill(0x010203);
+    compositor.clearLayer(0);
+    compositor.setLayer(0, 0, BlendMode::NORMAL, 0, 10);
+    TEST_ASSERT_EQUAL_UINT32(0, compositor.expire(100));
+    compositor.compose(100, out);
+    TEST_ASSERT_EQUAL_HEX32(0x010203, out[0]);
+}
+
+void test_blend_mode_names_round_trip() {
+    for (uint8_t i = 0; i < (uint8_t)BlendMode::COUNT; i++) {
+        BlendMode mode = BlendMode::COUNT;
+        TEST_ASSERT_TRUE(parseBlendMode(blendModeName((BlendMode)i), mode));
+        TEST_ASSERT_EQUAL(i, (uint8_t)mode);
+    }
+    BlendMode mode = BlendMode::COUNT;
+    TEST_ASSERT_FALSE(parseBlendMode("overlay", mode));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_base_layer_alone_passes_through);
+    RUN_TEST(test_blend_modes);
+    RUN_TEST(test_opacity_mixes_normal_layer);
+    RUN_TEST(test_lifetime_fades_then_expires);
+    RUN_TEST(test_unchanged_layers_skip_composition);
+    RUN_TEST(test_base_layer_cannot_be_cleared);
+    RUN_TEST(test_blend_mode_names_round_trip);
+    return UNITY_END();
+}
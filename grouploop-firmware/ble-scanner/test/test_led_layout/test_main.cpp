@@ -0,0 +1,76 @@
+// LED layouts: data-line order, bounds and pixel loops, checked at compile
+// time where they can be.
+// Run with: pio test -e native -f test_led_layout
+#include <unity.h>
+#include <stdint.h>
+#include "LedLayout.h"
+
+typedef LedLayout<6, LedShape::STRIP> Wristband;
+typedef LedLayout<6, LedShape::STRIP, 0, true> ReversedStrip;
+typedef LedLayout<24, LedShape::RING, 18> Ring;
+typedef LedLayout<24, LedShape::RING, 18, true> ReversedRing;
+
+static_assert(Wristband::count == 6, "count");
+static_assert(Wristband::identity, "a plain strip needs no remapping");
+static_assert(Wristband::unrolled && !Ring::unrolled, "only short loops are spelled out");
+static_assert(Wristband::contains(5) && !Wristband::contains(6) && !Wristband::contains(-1), "bounds");
+static_assert(Ring::physical[0] == 18 && Ring::physical[6] == 0, "ring starts at twelve o'clock");
+
+void setUp() {}
+void tearDown() {}
+
+void test_reversed_strip_runs_backwards() {
+    TEST_ASSERT_FALSE(ReversedStrip::identity);
+    for (uint16_t i = 0; i < 6; i++) {
+        TEST_ASSERT_EQUAL_UINT16(5 - i, ReversedStrip::physical[i]);
+    }
+}
+
+void test_ring_wraps_from_first_pixel() {
+    TEST_ASSERT_FALSE(Ring::identity);
+    TEST_ASSERT_EQUAL_UINT16(18, Ring::physical[0]);
+    TEST_ASSERT_EQUAL_UINT16(23, Ring::physical[5]);
+    TEST_ASSERT_EQUAL_UINT16(0, Ring::physical[6]);
+    TEST_ASSERT_EQUAL_UINT16(17, Ring::physical[23]);
+}
+
+void test_reversed_ring_runs_counter_clockwise() {
+    TEST_ASSERT_EQUAL_UINT16(18, ReversedRing::physical[0]);
+    TEST_ASSERT_EQUAL_UINT16(17, ReversedRing::physical[1]);
+    TEST_ASSERT_EQUAL_UINT16(0, ReversedRing::physical[18]);
+    TEST_ASSERT_EQUAL_UINT16(19, ReversedRing::physical[23]);
+}
+
+void test_physical_order_is_a_permutation() {
+    bool seen[24] = {false};
+    for (uint16_t i = 0; i < 24; i++) {
+        TEST_ASSERT_FALSE(seen[ReversedRing::physical[i]]);
+        seen[ReversedRing::physical[i]] = true;
+    }
+}
+
+template <typename Layout>
+void checkForEachVisitsInOrder() {
+    uint16_t visited[Layout::count];
+    uint16_t calls = 0;
+    Layout::forEach([&](uint16_t i) { visited[calls++] = i; });
+    TEST_ASSERT_EQUAL_UINT16(Layout::count, calls);
+    for (uint16_t i = 0; i < Layout::count; i++) {
+        TEST_ASSERT_EQUAL_UINT16(i, visited[i]);
+    }
+}
+
+void test_for_each_visits_every_pixel_in_order() {
+    checkForEachVisitsInOrder<Wristband>();     // unrolled
+    checkForEachVisitsInOrder<Ring>();          // looped
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_reversed_strip_runs_backwards);
+    RUN_TEST(test_ring_wraps_from_first_pixel);
+    RUN_TEST(test_reversed_ring_runs_counter_clockwise);
+    RUN_TEST(test_physical_order_is_a_permutation);
+    RUN_TEST(test_for_each_visits_every_pixel_in_order);
+    return UNITY_END();
+}
@@ -0,0 +1,91 @@
+// Fixed-point LED maths against the float and division versions it replaced.
+// Run with: pio test -e native -f test_led_math
+#include <unity.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include "LedMath.h"
+
+void setUp() {}
+void tearDown() {}
+
+void test_sine_matches_float_breathing() {
+    const uint32_t period = 2000;
+    uint32_t step = ledPhaseStep(period);
+    for (uint32_t t = 0; t < 3 * period; t += 7) {
+        double expected = (sin(t * 2.0 * M_PI / period) + 1.0) / 2.0 * 255.0;
+        TEST_ASSERT_INT_WITHIN(2, (int)(expected + 0.5), ledSin8(t * step));
+    }
+    TEST_ASSERT_EQUAL_UINT8(255, ledSin8(0x40000000u));
+    TEST_ASSERT_EQUAL_UINT8(0, ledSin8(0xC0000000u));
+}
+
+void test_phase_wraps_once_per_period() {
+    uint32_t step = ledPhaseStep(1500);
+    // An hour of uptime drifts by well under one table step (2^24)
+    uint32_t t = 1500u * 2400u;
+    TEST_ASSERT_INT_WITHIN(1 << 22, 0, (int32_t)(t * step));
+    TEST_ASSERT_EQUAL_UINT32(0, ledPhaseStep(0));
+}
+
+void test_scale8_agrees_with_division() {
+    for (int v = 0; v < 256; v++) {
+        for (int s = 0; s < 256; s++) {
+            TEST_ASSERT_INT_WITHIN(1, v * s / 255, ledScale8((uint8_t)v, (uint8_t)s));
+        }
+        TEST_ASSERT_EQUAL_UINT8(v, ledScale8((uint8_t)v, 255));
+        TEST_ASSERT_EQUAL_UINT8(0, ledScale8((uint8_t)v, 0));
+    }
+}
+
+void test_scale_color_keeps_channels_apart() {
+    const uint32_t colors[] = {0xFFFFFF, 0xFF0000, 0x00FF00, 0x0000FF, 0x12AB7F, 0xFF00FF};
+    for (size_t c = 0; c < sizeof(colors) / sizeof(colors[0]); c++) {
+        for (int s = 0; s < 256; s++) {
+            uint32_t scaled = ledScaleColor(colors[c], (uint8_t)s);
+            for (int shift = 0; shift <= 16; shift += 8) {
+                uint8_t channel = (colors[c] >> shift) & 0xFF;
+                TEST_ASSERT_EQUAL_UINT8(ledScale8(channel, (uint8_t)s), (scaled >> shift) & 0xFF);
+            }
+            TEST_ASSERT_EQUAL_UINT32(0, scaled & 0xFF000000);
+        }
+    }
+}
+
+void test_gamma_is_monotonic_with_fixed_ends() {
+    TEST_ASSERT_EQUAL_UINT8(0, ledGamma8(0));
+    TEST_ASSERT_EQUAL_UINT8(255, ledGamma8(255));
+    for (int i = 1; i < 256; i++) {
+        TEST_ASSERT_TRUE(ledGamma8((uint8_t)i) >= ledGamma8((uint8_t)(i - 1)));
+    }
+    TEST_ASSERT_TRUE(ledGamma8(128) < 128);
+}
+
+void test_fixed_spring_tracks_damped_oscillator() {
+    FixedSpring spring;
+    spring.setParams(20.1f, 2.0f, 1.0f);
+    // x(t) for x(0) = 1, v(0) = 0: underdamped, zeta = 0.22
+    const double w0 = sqrt(20.1), zeta = 2.0 / (2.0 * w0), wd = w0 * sqrt(1 - zeta * zeta);
+    for (int frame = 1; frame <= 300; frame++) {
+        spring.advance(16);
+        double t = frame * 0.016;
+        double expected = exp(-zeta * w0 * t) * (cos(wd * t) + zeta * w0 / wd * sin(wd * t));
+        TEST_ASSERT_FLOAT_WITHIN(0.02f, (float)expected, spring.position / 65536.0f);
+    }
+    // Settled on the target
+    TEST_ASSERT_TRUE(spring.level() <= 3);
+
+    spring.position = -Q16_ONE * 2;
+    TEST_ASSERT_EQUAL_UINT8(255, spring.level());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_sine_matches_float_breathing);
+    RUN_TEST(test_phase_wraps_once_per_period);
+    RUN_TEST(test_scale8_agrees_with_division);
+    RUN_TEST(test_scale_color_keeps_channels_apart);
+    RUN_TEST(test_gamma_is_monotonic_with_fixed_ends);
+    RUN_TEST(test_fixed_spring_tracks_damped_oscillator);
+    return UNITY_END();
+}
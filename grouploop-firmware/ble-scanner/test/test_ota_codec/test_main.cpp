@@ -0,0 +1,290 @@
+// Round trips for compressed and delta OTA images through the streaming
+// decoder, the OTA engine included.
+// Run with: pio test -e native -f test_ota_codec
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "OtaEngine.h"
+#include "OtaImageDecoder.h"
+#include "../../tools/ota-pack/OtaImageEncoder.h"
+
+using OtaImageEncoder::Bytes;
+typedef DecodingFlashWriter<256> TestDecoder;
+
+static uint32_t rngState = 1;
+static uint32_t nextRandom() {
+    rngState ^= rngState << 13;
+    rngState ^= rngState >> 17;
+    rngState ^= rngState << 5;
+    return rngState;
+}
+
+// Something shaped like a firmware image: a limited vocabulary of 32 bit
+// words with runs of padding and some incompressible data
+static Bytes makeFirmware(size_t size, uint32_t seed) {
+    rngState = seed;
+    uint32_t vocabulary[64];
+    for (int i = 0; i < 64; i++) vocabulary[i] = nextRandom();
+    Bytes image;
+    while (image.size() < size) {
+        uint32_t r = nextRandom() % 100;
+        if (r < 80) {
+            uint32_t word = vocabulary[nextRandom() % 64];
+            for (int k = 0; k < 4; k++) image.push_back((uint8_t)(word >> (8 * k)));
+        } else if (r < 90) {
+            image.insert(image.end(), 16 + nextRandom() % 64, 0xFF);
+        } else {
+            for (int k = 0; k < 8; k++) image.push_back((uint8_t)nextRandom());
+        }
+    }
+    image.resize(size);
+    return image;
+}
+
+class MemoryBase : public OtaBaseReader {
+public:
+    Bytes bytes;
+    explicit MemoryBase(const Bytes& aBytes) : bytes(aBytes) {}
+    uint32_t size() const override { return (uint32_t)bytes.size(); }
+    bool read(uint32_t offset, uint8_t* buffer, size_t length) override {
+        if ((uint64_t)offset + length > bytes.size()) return false;
+        memcpy(buffer, bytes.data() + offset, length);
+        return true;
+    }
+};
+
+class FakeFlash : public OtaFlashWriter {
+public:
+    Bytes data;
+    uint32_t size = 0;
+    int aborts = 0;
+    bool committed = false;
+    size_t writtenSinceMark = 0;
+
+    bool begin(uint32_t aSize) override {
+        size = aSize;
+        data.clear();
+        return true;
+    }
+    bool write(const uint8_t* bytes, size_t length) override {
+        if (data.size() + length > size) return false;
+        data.insert(data.end(), bytes, bytes + length);
+        writtenSinceMark += length;
+        return true;
+    }
+    bool commit() override {
+        committed = data.size() == size;
+        return committed;
+    }
+    void abort() override {
+        aborts++;
+        data.clear();
+    }
+};
+
+// Feed `packed` in `chunk` sized writes, draining in between like the engine
+static bool feed(TestDecoder& decoder, FakeFlash& flash, const Bytes& packed, size_t chunk, uint32_t budget) {
+    if (!decoder.begin((uint32_t)packed.size())) return false;
+    for (size_t i = 0; i < packed.size(); i += chunk) {
+        size_t n = packed.size() - i < chunk ? packed.size() - i : chunk;
+        flash.writtenSinceMark = 0;
+        if (!decoder.write(packed.data() + i, n)) return false;
+        TEST_ASSERT_TRUE(flash.writtenSinceMark <= budget);
+        while (decoder.busy()) {
+            flash.writtenSinceMark = 0;
+            if (!decoder.drain()) return false;
+            TEST_ASSERT_TRUE(flash.writtenSinceMark <= budget);
+        }
+    }
+    return decoder.commit();
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_lzss_round_trip_with_any_split() {
+    Bytes image = makeFirmware(20000, 7);
+    Bytes packed = OtaImageEncoder::lzssCompress(image);
+    TEST_ASSERT_TRUE(packed.size() < image.size() / 2);
+
+    // One input byte at a time into a 7 byte output buffer
+    LzssDecoder decoder;
+    Bytes decoded;
+    uint8_t out[7];
+    for (size_t i = 0; i < packed.size(); i++) {
+        size_t used = 0;
+        do {
+            size_t produced = 0;
+            used += decoder.decode(&packed[i] + used, 1 - used, out, sizeof(out), produced);
+            decoded.insert(decoded.end(), out, out + produced);
+        } while (used < 1 || decoder.hasPending());
+    }
+    TEST_ASSERT_EQUAL(image.size(), decoded.size());
+    TEST_ASSERT_EQUAL_MEMORY(image.data(), decoded.data(), image.size());
+}
+
+void test_compressed_image_streams_within_budget() {
+    Bytes image = makeFirmware(50000, 11);
+    Bytes packed = OtaImageEncoder::packCompressed(image);
+    FakeFlash flash;
+    TestDecoder decoder(flash, nullptr, 512);
+
+    TEST_ASSERT_TRUE(feed(decoder, flash, packed, 100, 512));
+    TEST_ASSERT_TRUE(decoder.getFormat() == TestDecoder::Format::COMPRESSED);
+    TEST_ASSERT_TRUE(flash.committed);
+    TEST_ASSERT_EQUAL(image.size(), flash.data.size());
+    TEST_ASSERT_EQUAL_MEMORY(image.data(), flash.data.data(), image.size());
+}
+
+// Writes that end inside the 48 byte header, e.g. TCP segments or a
+// resumed range: one byte at a time up to 47 at a time
+void test_header_split_across_writes() {
+    Bytes image = makeFirmware(3000, 5);
+    Bytes packed = OtaImageEncoder::packCompressed(image);
+    for (size_t chunk = 1; chunk <= 47; chunk++) {
+        FakeFlash flash;
+        TestDecoder decoder(flash, nullptr, 512);
+        TEST_ASSERT_TRUE(feed(decoder, flash, packed, chunk, 512));
+        TEST_ASSERT_TRUE(decoder.getFormat() == TestDecoder::Format::COMPRESSED);
+        TEST_ASSERT_EQUAL(image.size(), flash.data.size());
+        TEST_ASSERT_EQUAL_MEMORY(image.data(), flash.data.data(), image.size());
+    }
+}
+
+void test_delta_rebuilds_image_from_running_partition() {
+    Bytes base = makeFirmware(60000, 21);
+    // A new build: some code changed in place, a function grew, a table moved
+    Bytes image = base;
+    for (size_t i = 1000; i < 1040; i++) image[i] ^= 0x5A;
+    Bytes added = makeFirmware(700, 99);
+    image.insert(image.begin() + 20000, added.begin(), added.end());
+    image.erase(image.begin() + 40000, image.begin() + 40300);
+    image.insert(image.end(), base.begin() + 100, base.begin() + 3100);
+
+    Bytes packed = OtaImageEncoder::packDelta(base, image);
+    TEST_ASSERT_TRUE(packed.size() < image.size() / 20);
+
+    MemoryBase running(base);
+    FakeFlash flash;
+    TestDecoder decoder(flash, &running, 1024);
+    TEST_ASSERT_TRUE(feed(decoder, flash, packed, 256, 1024));
+    TEST_ASSERT_TRUE(decoder.getFormat() == TestDecoder::Format::DELTA);
+    TEST_ASSERT_EQUAL(image.size(), flash.data.size());
+    TEST_ASSERT_EQUAL_MEMORY(image.data(), flash.data.data(), image.size());
+}
+
+void test_delta_against_wrong_base_is_never_committed() {
+    Bytes base = makeFirmware(30000, 5);
+    Bytes image = base;
+    image[15000] ^= 1;
+    Bytes packed = OtaImageEncoder::packDelta(base, image);
+
+    MemoryBase other(makeFirmware(30000, 6));
+    FakeFlash flash;
+    TestDecoder decoder(flash, &other, 1024);
+    TEST_ASSERT_FALSE(feed(decoder, flash, packed, 256, 1024));
+    TEST_ASSERT_FALSE(flash.committed);
+    TEST_ASSERT_EQUAL(1, flash.aborts);
+
+    // A delta needs a base at least as large as the one it was made from
+    MemoryBase shorter(Bytes(base.begin(), base.begin() + 1000));
+    TestDecoder small(flash, &shorter, 1024);
+    TEST_ASSERT_FALSE(feed(small, flash, packed, 256, 1024));
+}
+
+void test_plain_image_passes_through() {
+    Bytes image = makeFirmware(5000, 3);
+    image[0] = 0xE9;    // ESP image magic
+    FakeFlash flash;
+    TestDecoder decoder(flash, nullptr, 512);
+    TEST_ASSERT_TRUE(feed(decoder, flash, image, 3, 512));
+    TEST_ASSERT_TRUE(decoder.getFormat() == TestDecoder::Format::PLAIN);
+    TEST_ASSERT_EQUAL(image.size(), flash.size);
+    TEST_ASSERT_EQUAL_MEMORY(image.data(), flash.data.data(), image.size());
+}
+
+// Serves a byte vector; drops the connection once at `dropAt`
+class FakeHttpSource : public OtaSource {
+public:
+    Bytes body;
+    uint32_t dropAt = 0xFFFFFFFF;
+    size_t position = 0;
+    bool connected = false;
+
+    int32_t open(uint32_t offset) override {
+        position = offset;
+        connected = true;
+        return (int32_t)offset;
+    }
+    uint32_t totalSize() const override { return (uint32_t)body.size(); }
+    int32_t read(uint8_t* buffer, size_t max) override {
+        if (!connected) return -1;
+        if (position >= dropAt) {
+            dropAt = 0xFFFFFFFF;
+            connected = false;
+            return -1;
+        }
+        size_t n = max < 200 ? max : 200;
+        if (n > body.size() - position) n = body.size() - position;
+        memcpy(buffer, &body[position], n);
+        position += n;
+        return (int32_t)n;
+    }
+    void close() override { connected = false; }
+};
+
+void test_engine_downloads_delta_across_a_dropped_connection() {
+    Bytes base = makeFirmware(40000, 41);
+    Bytes image = base;
+    Bytes added = makeFirmware(3000, 42);
+    image.insert(image.begin() + 12000, added.begin(), added.end());
+
+    FakeHttpSource http;
+    http.body = OtaImageEncoder::packDelta(base, image);
+    http.dropAt = (uint32_t)http.body.size() / 2;
+    uint8_t digest[Sha256::DIGEST_SIZE];
+    Sha256 sha;
+    sha.update(http.body.data(), http.body.size());
+    sha.finish(digest);
+
+    MemoryBase running(base);
+    FakeFlash flash;
+    TestDecoder decoder(flash, &running, 2048);
+    OtaEngineConfig config;
+    config.chunksPerStep = 2;
+    config.retryDelayMs = 100;
+    OtaEngine<256> engine(http, decoder, config);
+
+    uint32_t now = 0;
+    engine.start(digest, now);
+    size_t before = 0;
+    for (int i = 0; i < 10000 && engine.isActive(); i++) {
+        engine.step(now += 10);
+        // A step expands at most one chunk before it stops to drain
+        TEST_ASSERT_TRUE(flash.data.size() - before <= 2048);
+        before = flash.data.size();
+    }
+    TEST_ASSERT_TRUE(engine.getState() == OtaEngine<256>::State::DONE);
+    TEST_ASSERT_EQUAL_UINT32(1, engine.getResumes());
+    TEST_ASSERT_TRUE(flash.committed);
+    TEST_ASSERT_EQUAL_MEMORY(image.data(), flash.data.data(), image.size());
+}
+
+void test_decoder_ram_is_bounded() {
+    // Window plus buffers; independent of the image size
+    TEST_ASSERT_TRUE(sizeof(DecodingFlashWriter<1024>) < 7 * 1024);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_lzss_round_trip_with_any_split);
+    RUN_TEST(test_compressed_image_streams_within_budget);
+    RUN_TEST(test_header_split_across_writes);
+    RUN_TEST(test_delta_rebuilds_image_from_running_partition);
+    RUN_TEST(test_delta_against_wrong_base_is_never_committed);
+    RUN_TEST(test_plain_image_passes_through);
+    RUN_TEST(test_engine_downloads_delta_across_a_dropped_connection);
+    RUN_TEST(test_decoder_ram_is_bounded);
+    return UNITY_END();
+}
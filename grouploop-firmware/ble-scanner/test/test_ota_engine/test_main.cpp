@@ -0,0 +1,326 @@
+// Streaming OTA engine tests with an in-memory HTTP stand-in and flash.
+// Run with: pio test -e native -f test_ota_engine
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+#include "OtaEngine.h"
+
+static const size_t CHUNK = 256;
+typedef OtaEngine<CHUNK> TestEngine;
+typedef TestEngine::State State;
+typedef TestEngine::Error Error;
+
+// Serves an image like an HTTP server: Range requests get the tail
+// (206), `ignoreRange` answers 200 with the whole body. Bytes trickle in
+// `bytesPerRead` at a time, and the connection can drop at a given offset.
+class FakeHttpSource : public OtaSource {
+public:
+    std::vector<uint8_t> image;
+    size_t bytesPerRead = 100;
+    bool ignoreRange = false;
+    int failOpens = 0;              // refuse this many open() calls
+    uint32_t dropAt = 0xFFFFFFFF;   // close the connection once this offset is served
+    bool stalled = false;           // connection stays open but delivers nothing
+    std::vector<uint32_t> opens;
+
+    FakeHttpSource(size_t size) : image(size) {
+        uint32_t x = 2463534242u;
+        for (size_t i = 0; i < size; i++) {
+            x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+            image[i] = (uint8_t)x;
+        }
+    }
+
+    int32_t open(uint32_t offset) override {
+        opens.push_back(offset);
+        if (failOpens > 0) {
+            failOpens--;
+            return -1;
+        }
+        position = ignoreRange ? 0 : offset;
+        connected = true;
+        return (int32_t)position;
+    }
+
+    uint32_t totalSize() const override { return (uint32_t)image.size(); }
+
+    int32_t read(uint8_t* buffer, size_t max) override {
+        if (!connected) return -1;
+        if (position >= dropAt) {
+            dropAt = 0xFFFFFFFF;
+            connected = false;
+            return -1;
+        }
+        if (stalled) return 0;
+        size_t n = bytesPerRead < max ? bytesPerRead : max;
+        if (n > image.size() - position) n = image.size() - position;
+        if (position < dropAt && position + n > dropAt) n = dropAt - position;
+        memcpy(buffer, &image[position], n);
+        position += n;
+        return (int32_t)n;
+    }
+
+    void close() override { connected = false; }
+
+private:
+    size_t position = 0;
+    bool connected = false;
+};
+
+class FakeFlash : public OtaFlashWriter {
+public:
+    std::vector<uint8_t> data;
+    uint32_t size = 0;
+    int begins = 0;
+    int aborts = 0;
+    bool committed = false;
+    size_t largestWrite = 0;
+
+    bool begin(uint32_t aSize) override {
+        begins++;
+        size = aSize;
+        data.clear();
+        return true;
+    }
+    bool write(const uint8_t* bytes, size_t length) override {
+        if (data.size() + length > size) return false;
+        data.insert(data.end(), bytes, bytes + length);
+        if (length > largestWrite) largestWrite = length;
+        return true;
+    }
+    bool commit() override {
+        committed = data.size() == size;
+        return committed;
+    }
+    void abort() override {
+        aborts++;
+        data.clear();
+    }
+};
+
+static void digestOf(const std::vector<uint8_t>& bytes, uint8_t digest[32]) {
+    Sha256 sha;
+    sha.update(bytes.data(), bytes.size());
+    sha.finish(digest);
+}
+
+static OtaEngineConfig testConfig() {
+    OtaEngineConfig config;
+    config.chunksPerStep = 2;
+    config.maxRetries = 3;
+    config.retryDelayMs = 100;
+    config.stallTimeoutMs = 500;
+    return config;
+}
+
+// Step every 10 ms until the engine settles; returns the number of steps
+static int run(TestEngine& engine, uint32_t& now, int maxSteps = 100000) {
+    int steps = 0;
+    while (engine.isActive() && steps < maxSteps) {
+        now += 10;
+        engine.step(now);
+        steps++;
+    }
+    return steps;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_sha256_known_vectors() {
+    const char* expectedEmpty = "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855";
+    const char* expectedAbc = "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad";
+    const char* expectedLong = "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1";
+    uint8_t digest[32];
+    char hex[65];
+
+    Sha256 sha;
+    sha.finish(digest);
+    Sha256::toHex(digest, hex);
+    TEST_ASSERT_EQUAL_STRING(expectedEmpty, hex);
+
+    sha.reset();
+    sha.update((const uint8_t*)"abc", 3);
+    sha.finish(digest);
+    Sha256::toHex(digest, hex);
+    TEST_ASSERT_EQUAL_STRING(expectedAbc, hex);
+
+    // Fed in odd pieces across the block boundary
+    const char* msg = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    sha.reset();
+    sha.update((const uint8_t*)msg, 5);
+    sha.update((const uint8_t*)msg + 5, 50);
+    sha.update((const uint8_t*)msg + 55, strlen(msg) - 55);
+    sha.finish(digest);
+    Sha256::toHex(digest, hex);
+    TEST_ASSERT_EQUAL_STRING(expectedLong, hex);
+
+    uint8_t parsed[32];
+    TEST_ASSERT_TRUE(Sha256::parseHex(expectedLong, parsed));
+    TEST_ASSERT_EQUAL_MEMORY(digest, parsed, 32);
+    TEST_ASSERT_FALSE(Sha256::parseHex("abc", parsed));
+}
+
+void test_download_is_flashed_in_bounded_steps_and_committed() {
+    FakeHttpSource http(10000);
+    FakeFlash flash;
+    TestEngine engine(http, flash, testConfig());
+    uint8_t digest[32];
+    digestOf(http.image, digest);
+
+    uint32_t now = 0;
+    TEST_ASSERT_TRUE(engine.start(digest, now));
+    uint32_t before = 0;
+    int steps = 0;
+    while (engine.isActive()) {
+        now += 10;
+        engine.step(now);
+        // Never more than chunksPerStep reads per step
+        TEST_ASSERT_TRUE(engine.getWritten() - before <= 2 * 100);
+        before = engine.getWritten();
+        steps++;
+    }
+    TEST_ASSERT_TRUE(engine.getState() == State::DONE);
+    TEST_ASSERT_TRUE(flash.committed);
+    TEST_ASSERT_EQUAL(10000, flash.data.size());
+    TEST_ASSERT_EQUAL_MEMORY(http.image.data(), flash.data.data(), 10000);
+    TEST_ASSERT_EQUAL(100, engine.getPercent());
+    TEST_ASSERT_TRUE(flash.largestWrite <= CHUNK);
+    TEST_ASSERT_EQUAL(1 + 50, steps);   // connect, then 200 bytes per step
+}
+
+void test_digest_mismatch_never_switches_partition() {
+    FakeHttpSource http(3000);
+    FakeFlash flash;
+    TestEngine engine(http, flash, testConfig());
+    uint8_t digest[32];
+    digestOf(http.image, digest);
+    digest[7] ^= 0x01;
+
+    uint32_t now = 0;
+    engine.start(digest, now);
+    run(engine, now);
+    TEST_ASSERT_TRUE(engine.getState() == State::FAILED);
+    TEST_ASSERT_TRUE(engine.getError() == Error::DIGEST);
+    TEST_ASSERT_FALSE(flash.committed);
+    TEST_ASSERT_EQUAL(1, flash.aborts);
+}
+
+void test_dropped_connection_resumes_with_range_request() {
+    FakeHttpSource http(8000);
+    http.bytesPerRead = 256;
+    http.dropAt = 5000;
+    FakeFlash flash;
+    TestEngine engine(http, flash, testConfig());
+    uint8_t digest[32];
+    digestOf(http.image, digest);
+
+    uint32_t now = 0;
+    engine.start(digest, now);
+    run(engine, now);
+    TEST_ASSERT_TRUE(engine.getState() == State::DONE);
+    TEST_ASSERT_EQUAL(2, http.opens.size());
+    TEST_ASSERT_EQUAL_UINT32(0, http.opens[0]);
+    TEST_ASSERT_EQUAL_UINT32(5000, http.opens[1]);
+    TEST_ASSERT_EQUAL_UINT32(1, engine.getResumes());
+    TEST_ASSERT_EQUAL(1, flash.begins);
+    TEST_ASSERT_EQUAL_MEMORY(http.image.data(), flash.data.data(), 8000);
+}
+
+void test_server_ignoring_range_restarts_the_image() {
+    FakeHttpSource http(4000);
+    http.dropAt = 1500;
+    http.ignoreRange = true;
+    FakeFlash flash;
+    TestEngine engine(http, flash, testConfig());
+    uint8_t digest[32];
+    digestOf(http.image, digest);
+
+    uint32_t now = 0;
+    engine.start(digest, now);
+    run(engine, now);
+    TEST_ASSERT_TRUE(engine.getState() == State::DONE);
+    TEST_ASSERT_EQUAL(2, flash.begins);
+    TEST_ASSERT_EQUAL(1, flash.aborts);
+    TEST_ASSERT_EQUAL_MEMORY(http.image.data(), flash.data.data(), 4000);
+}
+
+void test_unreachable_server_fails_after_retries() {
+    FakeHttpSource http(1000);
+    http.failOpens = 100;
+    FakeFlash flash;
+    TestEngine engine(http, flash, testConfig());
+    uint8_t digest[32] = {0};
+
+    uint32_t now = 0;
+    engine.start(digest, now);
+    run(engine, now);
+    TEST_ASSERT_TRUE(engine.getState() == State::FAILED);
+    TEST_ASSERT_TRUE(engine.getError() == Error::CONNECT);
+    TEST_ASSERT_EQUAL(4, http.opens.size());   // first try plus 3 retries
+    TEST_ASSERT_EQUAL(0, flash.begins);
+}
+
+void test_stalled_connection_is_reopened() {
+    FakeHttpSource http(2000);
+    FakeFlash flash;
+    TestEngine engine(http, flash, testConfig());
+    uint8_t digest[32];
+    digestOf(http.image, digest);
+
+    uint32_t now = 0;
+    engine.start(digest, now);
+    for (int i = 0; i < 3; i++) {
+        now += 10;
+        engine.step(now);
+    }
+    uint32_t progress = engine.getWritten();
+    TEST_ASSERT_TRUE(progress > 0);
+
+    // No data for stallTimeoutMs: reconnect from where we were
+    http.stalled = true;
+    for (int i = 0; i < 60; i++) {
+        now += 10;
+        engine.step(now);
+    }
+    TEST_ASSERT_TRUE(engine.getState() == State::RETRY_WAIT || engine.getState() == State::DOWNLOADING);
+    http.stalled = false;
+    run(engine, now);
+    TEST_ASSERT_TRUE(engine.getState() == State::DONE);
+    TEST_ASSERT_EQUAL_UINT32(progress, http.opens.back());
+}
+
+void test_abort_discards_partial_image() {
+    FakeHttpSource http(5000);
+    FakeFlash flash;
+    TestEngine engine(http, flash, testConfig());
+    uint8_t digest[32];
+    digestOf(http.image, digest);
+
+    uint32_t now = 0;
+    engine.start(digest, now);
+    for (int i = 0; i < 5; i++) engine.step(now += 10);
+    engine.abort(now);
+    TEST_ASSERT_TRUE(engine.getError() == Error::ABORTED);
+    TEST_ASSERT_EQUAL(1, flash.aborts);
+    TEST_ASSERT_FALSE(flash.committed);
+
+    // A fresh start works after an abort
+    TEST_ASSERT_TRUE(engine.start(digest, now));
+    run(engine, now);
+    TEST_ASSERT_TRUE(engine.getState() == State::DONE);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_sha256_known_vectors);
+    RUN_TEST(test_download_is_flashed_in_bounded_steps_and_committed);
+    RUN_TEST(test_digest_mismatch_never_switches_partition);
+    RUN_TEST(test_dropped_connection_resumes_with_range_request);
+    RUN_TEST(test_server_ignoring_range_restarts_the_image);
+    RUN_TEST(test_unreachable_server_fails_after_retries);
+    RUN_TEST(test_stalled_connection_is_reopened);
+    RUN_TEST(test_abort_discards_partial_image);
+    return UNITY_END();
+}
@@ -0,0 +1,133 @@
+// Pixel frame: unchanged frames skipped, busy output deferral, encoding.
+// Run with: pio test -e native -f test_pixel_frame
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include "PixelFrame.h"
+
+// Records frames; stays busy until the test lets it finish
+class FakeOutput : public PixelOutput {
+public:
+    int writes;
+    bool transmitting;
+    bool async;
+    uint8_t last[12];
+
+    FakeOutput() : writes(0), transmitting(false), async(false) { memset(last, 0, sizeof(last)); }
+
+    void write(const uint8_t* grb, size_t length) override {
+        writes++;
+        memcpy(last, grb, length < sizeof(last) ? length : sizeof(last));
+        transmitting = async;
+    }
+    bool busy() override { return transmitting; }
+};
+
+static unsigned long fakeMicros = 0;
+static unsigned long fakeClock() {
+    fakeMicros += 40;   // each call: the write takes 40 us
+    return fakeMicros;
+}
+
+typedef BasicPixelFrame<4> Frame;
+
+void setUp() { fakeMicros = 0; }
+void tearDown() {}
+
+void test_unchanged_frames_are_skipped() {
+    FakeOutput output;
+    Frame frame(output, fakeClock);
+    for (int tick = 0; tick < 50; tick++) {
+        frame.fill(0x00FF00);
+        frame.show();
+    }
+    TEST_ASSERT_EQUAL(1, output.writes);
+    TEST_ASSERT_EQUAL_UINT32(1, frame.getStats().shown);
+    TEST_ASSERT_EQUAL_UINT32(49, frame.getStats().skipped);
+    TEST_ASSERT_EQUAL_UINT32(40, frame.getStats().showMicros);
+
+    frame.setPixelColor(2, 0x0000FF);
+    frame.show();
+    TEST_ASSERT_EQUAL(2, output.writes);
+    frame.setBrightness(128);
+    frame.show();
+    TEST_ASSERT_EQUAL(3, output.writes);
+}
+
+void test_first_frame_is_always_sent() {
+    FakeOutput output;
+    Frame frame(output);
+    frame.clear();
+    frame.show();
+    TEST_ASSERT_EQUAL(1, output.writes);
+    TEST_ASSERT_EQUAL_UINT32(0, frame.getStats().showMicros);  // no clock
+}
+
+void test_encodes_grb_with_brightness() {
+    FakeOutput output;
+    Frame frame(output);
+    frame.setPixelColor(0, Frame::Color(0x10, 0x20, 0x30));
+    frame.setPixelColor(1, 0xFF8000);
+    frame.show();
+    const uint8_t expected[] = {0x20, 0x10, 0x30, 0x80, 0xFF, 0x00};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, output.last, sizeof(expected));
+
+    frame.setBrightness(0);
+    frame.show();
+    const uint8_t dark[12] = {0};
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(dark, output.last, sizeof(dark));
+    TEST_ASSERT_EQUAL_HEX32(0xFF8000, frame.getPixelColor(1));   // buffer keeps the color
+}
+
+void test_busy_output_defers_latest_frame() {
+    FakeOutput output;
+    output.async = true;
+    Frame frame(output);
+    frame.fill(0x010101);
+    frame.show();
+    TEST_ASSERT_EQUAL(1, output.writes);
+
+    // Two changes while the first frame is still going out: only the last is sent
+    frame.fill(0x020202);
+    frame.show();
+    frame.fill(0x030303);
+    frame.show();
+    frame.poll();
+    TEST_ASSERT_EQUAL(1, output.writes);
+    TEST_ASSERT_EQUAL_UINT32(1, frame.getStats().deferred);
+
+    output.transmitting = false;
+    frame.poll();
+    TEST_ASSERT_EQUAL(2, output.writes);
+    TEST_ASSERT_EQUAL_UINT8(0x03, output.last[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, frame.getStats().skipped);
+
+    output.transmitting = false;
+    frame.poll();
+    TEST_ASSERT_EQUAL(2, output.writes);
+}
+
+void test_change_reverted_before_send_is_dropped() {
+    FakeOutput output;
+    output.async = true;
+    Frame frame(output);
+    frame.fill(0x111111);
+    frame.show();
+    frame.fill(0x222222);
+    frame.show();               // deferred
+    frame.fill(0x111111);
+    frame.show();               // the LEDs already show this
+    output.transmitting = false;
+    frame.poll();
+    TEST_ASSERT_EQUAL(1, output.writes);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_unchanged_frames_are_skipped);
+    RUN_TEST(test_first_frame_is_always_sent);
+    RUN_TEST(test_encodes_grb_with_brightness);
+    RUN_TEST(test_busy_output_defers_latest_frame);
+    RUN_TEST(test_change_reverted_before_send_is_dropped);
+    return UNITY_END();
+}
@@ -0,0 +1,253 @@
+// Framed serial provisioning: frame decoding, the device-side server and
+// the host client against a fake device over a pseudo-terminal.
+// Run with: pio test -e native -f test_provision
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include "ProvisionProtocol.h"
+#include "ConfigPatch.h"
+#include "../../tools/provision/ProvisionClient.h"
+
+using ProvisionClient::Bytes;
+
+typedef BasicProvisionDecoder<64> Decoder;
+typedef BasicProvisionServer<512> Server;
+
+static Bytes encode(uint8_t type, uint8_t seq, const Bytes& payload) {
+    Bytes frame(payload.size() + PROVISION_OVERHEAD);
+    frame.resize(provisionEncode(type, seq, payload.data(), payload.size(), frame.data(), frame.size()));
+    return frame;
+}
+
+// Feeds bytes one at a time, 1 ms apart; the number of frames found
+static int feedAll(Decoder& decoder, const Bytes& bytes, uint32_t& now) {
+    int frames = 0;
+    for (uint8_t byte : bytes) {
+        if (decoder.feed(byte, now++) == Decoder::FRAME) frames++;
+    }
+    return frames;
+}
+
+static Bytes join(std::initializer_list<Bytes> parts) {
+    Bytes out;
+    for (const Bytes& part : parts) out.insert(out.end(), part.begin(), part.end());
+    return out;
+}
+
+static Bytes text(const char* s) { return Bytes(s, s + strlen(s)); }
+
+// Records which settings a CONFIG touched, the way Configuration would
+class FakeTarget : public ProvisionTarget {
+public:
+    int applied = 0;
+
+    void identify(ProvisionInfo& info) override {
+        static const uint8_t mac[6] = { 0x64, 0xe8, 0x33, 0x01, 0x02, 0x03 };
+        info.settings = ConfigSchema::SETTING_COUNT;
+        memcpy(info.mac, mac, sizeof(mac));
+        info.label = "band-001";
+    }
+
+    void apply(const uint8_t* data, size_t length, ProvisionAck& ack) override {
+        BasicConfigPatch<512> patch;
+        if (!patch.load(data, length, ack.error)) {
+            ack.status = PROVISION_BAD_PATCH;
+            return;
+        }
+        applied++;
+        ConfigPatchRecord record{};
+        for (size_t at = 0; patch.next(at, record);) ack.changed |= 1u << record.setting;
+        ack.status = PROVISION_OK;
+        ack.flags = PROVISION_ACK_SAVED;
+    }
+};
+
+void setUp() {}
+void tearDown() {}
+
+void test_crc_matches_ccitt_false() {
+    const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, provisionCrc16(check, sizeof(check)));
+}
+
+void test_frame_round_trip() {
+    Decoder decoder(100);
+    uint32_t now = 0;
+    Bytes payload = text("hello");
+    TEST_ASSERT_EQUAL(1, feedAll(decoder, encode(PROVISION_CONFIG, 7, payload), now));
+    TEST_ASSERT_EQUAL_UINT8(PROVISION_CONFIG, decoder.type());
+    TEST_ASSERT_EQUAL_UINT8(7, decoder.seq());
+    TEST_ASSERT_EQUAL(5, decoder.size());
+    TEST_ASSERT_EQUAL_INT(0, memcmp("hello", decoder.payload(), 5));
+    TEST_ASSERT_EQUAL(1, feedAll(decoder, encode(PROVISION_HELLO, 8, Bytes()), now));
+    TEST_ASSERT_EQUAL(0, decoder.size());
+    TEST_ASSERT_FALSE(decoder.inFrame());
+}
+
+void test_skips_log_text_and_noise() {
+    Decoder decoder(100);
+    uint32_t now = 0;
+    Bytes frame = encode(PROVISION_HELLO, 1, Bytes());
+    // A lone sync byte, a doubled one and log lines around the frames
+    Bytes stream = join({ text("Configuration saved to NVS\r\n"), Bytes{ 0xA5, 'x' }, Bytes{ 0xA5 }, frame,
+                          text("WiFi connected\r\n"), frame });
+    TEST_ASSERT_EQUAL(2, feedAll(decoder, stream, now));
+
+    Decoder plain(100);
+    TEST_ASSERT_EQUAL(Decoder::TEXT, plain.feed('{', 0));
+    TEST_ASSERT_EQUAL(Decoder::BUSY, plain.feed(0xA5, 1));
+}
+
+void test_rejects_corrupt_and_oversize_frames() {
+    Decoder decoder(100);
+    uint32_t now = 0;
+    Bytes frame = encode(PROVISION_CONFIG, 1, text("abc"));
+    Bytes corrupt = frame;
+    corrupt[7] ^= 0x01;
+    TEST_ASSERT_EQUAL(0, feedAll(decoder, corrupt, now));
+    TEST_ASSERT_EQUAL(1, decoder.getStats().crcErrors);
+
+    // Length beyond the 64 byte buffer: dropped at the header
+    TEST_ASSERT_EQUAL(0, feedAll(decoder, encode(PROVISION_CONFIG, 2, Bytes(65, 'a')), now));
+    TEST_ASSERT_EQUAL(1, decoder.getStats().oversize);
+
+    // The stream recovers
+    TEST_ASSERT_EQUAL(1, feedAll(decoder, frame, now));
+}
+
+void test_drops_a_stalled_frame() {
+    Decoder decoder(100);
+    Bytes frame = encode(PROVISION_CONFIG, 1, text("abc"));
+    uint32_t now = 0;
+    for (size_t i = 0; i < 5; i++) decoder.feed(frame[i], now++);
+    // The host gave up and starts over after a pause
+    now += 500;
+    TEST_ASSERT_EQUAL(1, feedAll(decoder, frame, now));
+    TEST_ASSERT_EQUAL(1, decoder.getStats().timeouts);
+}
+
+void test_server_answers_and_ignores_resent_config() {
+    FakeTarget target;
+    Server server(target, 100);
+    Bytes patch = { 1, ConfigSchema::SETTING_DEVICE_LABEL, 2, 'b', '7' };
+    Bytes config = encode(PROVISION_CONFIG, 3, patch);
+
+    for (int round = 0; round < 2; round++) {
+        Server::Decoder::Result result = Server::Decoder::BUSY;
+        for (uint8_t byte : config) result = server.feed(byte, 0);
+        TEST_ASSERT_EQUAL(Server::Decoder::FRAME, result);
+
+        Decoder reply(100);
+        uint32_t now = 0;
+        TEST_ASSERT_EQUAL(1, feedAll(reply, Bytes(server.reply(), server.reply() + server.getReplyLength()), now));
+        TEST_ASSERT_EQUAL_UINT8(PROVISION_ACK, reply.type());
+        TEST_ASSERT_EQUAL_UINT8(3, reply.seq());
+        TEST_ASSERT_EQUAL_UINT8(PROVISION_OK, reply.payload()[0]);
+        TEST_ASSERT_EQUAL_UINT8(1u << ConfigSchema::SETTING_DEVICE_LABEL >> 8, reply.payload()[2]);
+    }
+    TEST_ASSERT_EQUAL(1, target.applied);
+    TEST_ASSERT_EQUAL(1, server.getDuplicates());
+}
+
+void test_server_rejects_unknown_frames() {
+    FakeTarget target;
+    Server server(target, 100);
+    for (uint8_t byte : encode(0x33, 1, Bytes())) server.feed(byte, 0);
+    Decoder reply(100);
+    uint32_t now = 0;
+    TEST_ASSERT_EQUAL(1, feedAll(reply, Bytes(server.reply(), server.reply() + server.getReplyLength()), now));
+    TEST_ASSERT_EQUAL_UINT8(PROVISION_UNSUPPORTED, reply.payload()[0]);
+}
+
+void test_build_patch_from_settings() {
+    Bytes patch;
+    std::string error;
+    TEST_ASSERT_TRUE(ProvisionClient::buildPatch({ "socketServerURL=ws://a:5003", "publishIntervalMs=100" }, patch, error));
+    // Same bytes as config_set:01020b77733a2f2f613a353030330a0464000000
+    Bytes expected = { 0x01, 0x02, 0x0b, 'w', 's', ':', '/', '/', 'a', ':', '5', '0', '0', '3', 0x0a, 0x04, 0x64, 0, 0, 0 };
+    TEST_ASSERT_TRUE(expected == patch);
+
+    TEST_ASSERT_FALSE(ProvisionClient::buildPatch({ "nope=1" }, patch, error));
+    TEST_ASSERT_FALSE(ProvisionClient::buildPatch({ "LEDPin=three" }, patch, error));
+    TEST_ASSERT_FALSE(ProvisionClient::buildPatch({ "deviceLabel" }, patch, error));
+}
+
+// The fake device: a server on the master side of the pty, printing log
+// text ahead of every reply like the firmware does
+static void runDevice(int master) {
+    FakeTarget target;
+    Server server(target, 100);
+    const char log[] = "Configuration saved to NVS\r\n";
+    for (;;) {
+        uint8_t buffer[64];
+        ssize_t n = read(master, buffer, sizeof(buffer));
+        if (n <= 0) _exit(0);
+        for (ssize_t i = 0; i < n; i++) {
+            if (server.feed(buffer[i], 0) != Server::Decoder::FRAME) continue;
+            if (write(master, log, sizeof(log) - 1) < 0) _exit(1);
+            if (write(master, server.reply(), server.getReplyLength()) < 0) _exit(1);
+        }
+    }
+}
+
+void test_provision_over_pty() {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    TEST_ASSERT_TRUE(master >= 0);
+    TEST_ASSERT_EQUAL(0, grantpt(master));
+    TEST_ASSERT_EQUAL(0, unlockpt(master));
+    std::string error;
+    int port = ProvisionClient::openSerial(ptsname(master), 115200, error);
+    TEST_ASSERT_TRUE_MESSAGE(port >= 0, error.c_str());
+
+    pid_t device = fork();
+    TEST_ASSERT_TRUE(device >= 0);
+    if (device == 0) {
+        close(port);
+        runDevice(master);
+    }
+
+    ProvisionClient::Client client(port, 1000, 2);
+    ProvisionClient::DeviceInfo info;
+    TEST_ASSERT_TRUE_MESSAGE(client.hello(info, error), error.c_str());
+    TEST_ASSERT_EQUAL_UINT8(PROVISION_VERSION, info.version);
+    TEST_ASSERT_EQUAL_UINT8(0x03, info.mac[5]);
+    TEST_ASSERT_EQUAL_STRING("band-001", info.label.c_str());
+
+    // Server, beacon table and label in one exchange
+    Bytes patch;
+    TEST_ASSERT_TRUE(ProvisionClient::buildPatch({ "socketServerURL=ws://10.0.0.2:5003", "beaconNE=64:e8:33:84:43:9a",
+                                                   "beaconNW=64:e8:33:87:0d:62", "beaconSE=98:3d:ae:aa:16:8a",
+                                                   "beaconSW=98:3d:ae:ab:b2:7a", "deviceLabel=band-017" },
+                                                 patch, error));
+    ProvisionClient::Ack ack;
+    TEST_ASSERT_TRUE_MESSAGE(client.pushConfig(patch, ack, error), error.c_str());
+    TEST_ASSERT_EQUAL_UINT8(PROVISION_OK, ack.status);
+    uint32_t expected = (1u << ConfigSchema::SETTING_SOCKET_SERVER_URL) | (1u << ConfigSchema::SETTING_BEACON_NE) |
+                        (1u << ConfigSchema::SETTING_BEACON_NW) | (1u << ConfigSchema::SETTING_BEACON_SE) |
+                        (1u << ConfigSchema::SETTING_BEACON_SW) | (1u << ConfigSchema::SETTING_DEVICE_LABEL);
+    TEST_ASSERT_EQUAL_HEX32(expected, ack.changed);
+    TEST_ASSERT_TRUE(ack.flags & PROVISION_ACK_SAVED);
+    TEST_ASSERT_EQUAL(0, client.getRetries());
+
+    kill(device, SIGTERM);
+    waitpid(device, nullptr, 0);
+    close(port);
+    close(master);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_crc_matches_ccitt_false);
+    RUN_TEST(test_frame_round_trip);
+    RUN_TEST(test_skips_log_text_and_noise);
+    RUN_TEST(test_rejects_corrupt_and_oversize_frames);
+    RUN_TEST(test_drops_a_stalled_frame);
+    RUN_TEST(test_server_answers_and_ignores_resent_config);
+    RUN_TEST(test_server_rejects_unknown_frames);
+    RUN_TEST(test_build_patch_from_settings);
+    RUN_TEST(test_provision_over_pty);
+    return UNITY_END();
+}
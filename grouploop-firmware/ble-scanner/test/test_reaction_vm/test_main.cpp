@@ -0,0 +1,162 @@
+// Reaction VM: assembled programs, budget, faults, load-time checks.
+// Run with: pio test -e native -f test_reaction_vm
+#include <unity.h>
+#include <stdint.h>
+#include <string>
+#include "ReactionVm.h"
+#include "../../tools/vm-asm/VmAssembler.h"
+
+typedef BasicReactionVm<128, 8, 4> Vm;
+
+static VmAssembler::Bytes program;
+
+static bool assembleAndLoad(Vm& vm, const char* source) {
+    std::string error;
+    if (!VmAssembler::assemble(source, program, error)) {
+        TEST_FAIL_MESSAGE(error.c_str());
+        return false;
+    }
+    return vm.load(program.data(), program.size());
+}
+
+void setUp() { program.clear(); }
+void tearDown() {}
+
+void test_arithmetic_and_outputs() {
+    Vm vm(64);
+    TEST_ASSERT_TRUE(assembleAndLoad(vm,
+        "push 7\n push 2\n sub\n push 40\n mul\n out led_level   ; (7 - 2) * 40\n"
+        "push 300\n push 0x10000\n push -70000\n over\n add\n add\n drop\n drop\n"
+        "push 255\n push 128\n push 0\n rgb\n out led_color\n halt\n"));
+    VmInputs inputs;
+    VmOutputs outputs;
+    TEST_ASSERT_EQUAL(VmStatus::HALTED, vm.run(inputs, outputs));
+    TEST_ASSERT_EQUAL_UINT8(200, outputs.ledLevel);
+    TEST_ASSERT_EQUAL_HEX32(0xFF8000, outputs.ledColor);
+    TEST_ASSERT_TRUE(outputs.wrote(VmOutput::LED_COLOR));
+    TEST_ASSERT_FALSE(outputs.wrote(VmOutput::VIBRATE));
+}
+
+void test_tap_glow_decays_across_ticks() {
+    Vm vm(64);
+    TEST_ASSERT_TRUE(assembleAndLoad(vm,
+        "        in tap\n"
+        "        jz decay\n"
+        "        push 255\n"
+        "        store r0\n"
+        "decay:  load r0\n"
+        "        in dt\n"
+        "        sub\n"
+        "        push 0\n"
+        "        max\n"
+        "        dup\n"
+        "        store r0\n"
+        "        out led_level\n"
+        "        halt\n"));
+    VmInputs inputs;
+    VmOutputs outputs;
+    inputs[VmInput::DT] = 20;
+    vm.run(inputs, outputs);
+    TEST_ASSERT_EQUAL_UINT8(0, outputs.ledLevel);
+
+    inputs[VmInput::TAP] = 1;
+    vm.run(inputs, outputs);
+    TEST_ASSERT_EQUAL_UINT8(235, outputs.ledLevel);     // reacts in the same tick
+    inputs[VmInput::TAP] = 0;
+    vm.run(inputs, outputs);
+    TEST_ASSERT_EQUAL_UINT8(215, outputs.ledLevel);
+    TEST_ASSERT_EQUAL_INT32(215, vm.getRegister(0));
+}
+
+void test_runaway_loop_is_cut_off_by_budget() {
+    Vm vm(50);
+    TEST_ASSERT_TRUE(assembleAndLoad(vm, "spin: push 1\n out vibrate\n jmp spin\n"));
+    VmInputs inputs;
+    VmOutputs outputs;
+    TEST_ASSERT_EQUAL(VmStatus::OUT_OF_BUDGET, vm.run(inputs, outputs));
+    TEST_ASSERT_EQUAL_UINT16(50, vm.getStats().lastInstructions);
+    TEST_ASSERT_EQUAL_UINT32(1, vm.getStats().outOfBudget);
+    TEST_ASSERT_TRUE(vm.isLoaded());        // runs again next tick
+    TEST_ASSERT_EQUAL(VmStatus::OUT_OF_BUDGET, vm.run(inputs, outputs));
+}
+
+void test_runtime_faults_unload_the_program() {
+    const char* programs[] = {
+        "drop\n halt\n",
+        "push 1\n push 0\n div\n halt\n",
+        "loop: push 1\n jmp loop\n",        // 8-deep stack overflows before the budget
+    };
+    const char* errors[] = {"stack underflow", "division by zero", "stack overflow"};
+    for (int i = 0; i < 3; i++) {
+        Vm vm(100);
+        TEST_ASSERT_TRUE(assembleAndLoad(vm, programs[i]));
+        VmInputs inputs;
+        VmOutputs outputs;
+        TEST_ASSERT_EQUAL(VmStatus::FAULT, vm.run(inputs, outputs));
+        TEST_ASSERT_EQUAL_STRING(errors[i], vm.getError());
+        TEST_ASSERT_FALSE(vm.isLoaded());
+        TEST_ASSERT_EQUAL(VmStatus::IDLE, vm.run(inputs, outputs));
+    }
+}
+
+void test_load_rejects_unsafe_code() {
+    Vm vm(100);
+    const uint8_t badOpcode[] = {1, 0x99, 0x00};
+    TEST_ASSERT_FALSE(vm.load(badOpcode, sizeof(badOpcode)));
+    TEST_ASSERT_EQUAL_STRING("unknown opcode", vm.getError());
+
+    const uint8_t intoOperand[] = {1, 0x01, 0x05, 0x30, 0x01, 0x00};     // JMP into PUSH8's operand
+    TEST_ASSERT_FALSE(vm.load(intoOperand, sizeof(intoOperand)));
+    TEST_ASSERT_EQUAL_STRING("bad jump target", vm.getError());
+
+    const uint8_t badRegister[] = {1, 0x40, 0x04, 0x00};
+    TEST_ASSERT_FALSE(vm.load(badRegister, sizeof(badRegister)));
+    TEST_ASSERT_EQUAL_STRING("no such register", vm.getError());
+
+    const uint8_t fallsOffEnd[] = {1, 0x01, 0x05};
+    TEST_ASSERT_FALSE(vm.load(fallsOffEnd, sizeof(fallsOffEnd)));
+
+    const uint8_t truncated[] = {1, 0x03, 0x01, 0x02};
+    TEST_ASSERT_FALSE(vm.load(truncated, sizeof(truncated)));
+    TEST_ASSERT_EQUAL_STRING("truncated instruction", vm.getError());
+
+    TEST_ASSERT_FALSE(vm.loadHex("0250"));
+    TEST_ASSERT_EQUAL_STRING("unsupported version", vm.getError());
+    TEST_ASSERT_FALSE(vm.loadHex("01zz"));
+    TEST_ASSERT_TRUE(vm.loadHex("0100"));
+}
+
+void test_hex_matches_assembler_output() {
+    std::string error;
+    TEST_ASSERT_TRUE(VmAssembler::assemble("in motion\n push 2500\n gt\n out vibrate\n halt\n", program, error));
+    std::string hex = VmAssembler::toHex(program);
+    TEST_ASSERT_EQUAL_STRING("01500302c40922510200", hex.c_str());
+    Vm vm(16);
+    TEST_ASSERT_TRUE(vm.loadHex(hex.c_str()));
+    VmInputs inputs;
+    VmOutputs outputs;
+    inputs[VmInput::MOTION] = 3000;
+    vm.run(inputs, outputs);
+    TEST_ASSERT_EQUAL_UINT16(1, outputs.vibrateMs);
+}
+
+void test_assembler_reports_errors_with_line() {
+    std::string error;
+    TEST_ASSERT_FALSE(VmAssembler::assemble("push 1\n jmp nowhere\n", program, error));
+    TEST_ASSERT_EQUAL_STRING("line 2: unknown label: nowhere", error.c_str());
+    TEST_ASSERT_FALSE(VmAssembler::assemble("in gyro\n", program, error));
+    TEST_ASSERT_EQUAL_STRING("line 1: unknown input: gyro", error.c_str());
+    TEST_ASSERT_FALSE(VmAssembler::assemble("add 3\n", program, error));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_arithmetic_and_outputs);
+    RUN_TEST(test_tap_glow_decays_across_ticks);
+    RUN_TEST(test_runaway_loop_is_cut_off_by_budget);
+    RUN_TEST(test_runtime_faults_unload_the_program);
+    RUN_TEST(test_load_rejects_unsafe_code);
+    RUN_TEST(test_hex_matches_assembler_output);
+    RUN_TEST(test_assembler_reports_errors_with_line);
+    return UNITY_END();
+}
@@ -0,0 +1,152 @@
+// Host simulation of the deadline scheduler against a virtual millisecond clock.
+// Run with: pio test -e native -f test_scheduler
+#include <unity.h>
+#include <stdint.h>
+#include "Scheduler.h"
+
+static uint32_t virtualNow = 0;
+
+struct FakeProcess {
+    uint32_t period;
+    uint32_t nextWakeAt;
+    bool running;
+    uint32_t runs;
+    uint32_t cost;          // virtual ms consumed by update()
+    uint32_t lastRunAt;
+    int id;
+    int* order;
+    int* orderLen;
+
+    FakeProcess(int id, uint32_t period)
+        : period(period), nextWakeAt(period), running(true), runs(0),
+          cost(0), lastRunAt(0), id(id), order(nullptr), orderLen(nullptr) {}
+
+    bool isProcessRunning() const { return running; }
+    uint32_t getPeriod() const { return period; }
+    uint32_t getNextWakeAt() const { return nextWakeAt; }
+    void wakeAt(uint32_t at) { nextWakeAt = at; }
+    void update() {
+        runs++;
+        lastRunAt = virtualNow;
+        if (order) order[(*orderLen)++] = id;
+        virtualNow += cost;
+    }
+};
+
+typedef DeadlineScheduler<FakeProcess, 16> Sched;
+
+// Drive the scheduler the way loop() does: run what is due, then sleep
+static uint32_t simulate(Sched& sched, uint32_t durationMs, uint32_t maxIdle) {
+    uint32_t passes = 0;
+    uint32_t end = virtualNow + durationMs;
+    while ((int32_t)(end - virtualNow) > 0) {
+        sched.runDue(virtualNow);
+        passes++;
+        uint32_t wait = sched.timeUntilNextDeadline(virtualNow, maxIdle);
+        virtualNow += wait;
+    }
+    return passes;
+}
+
+void setUp() { virtualNow = 0; }
+void tearDown() {}
+
+void test_each_process_runs_once_per_period() {
+    // Same periods as the firmware processes
+    FakeProcess imu(0, 10), receive(1, 10), led(2, 10), vibration(3, 10),
+                config(4, 20), publish(5, 50), ble(6, 50), wifi(7, 250), ota(8, 1000);
+    Sched sched;
+    FakeProcess* all[] = {&imu, &receive, &led, &vibration, &config, &publish, &ble, &wifi, &ota};
+    for (FakeProcess* p : all) sched.add(p);
+
+    simulate(sched, 10000, 1000);
+
+    for (FakeProcess* p : all) {
+        // First run at t = period, last one strictly before the 10 s mark
+        TEST_ASSERT_EQUAL_UINT32((10000 - 1) / p->period, p->runs);
+    }
+}
+
+void test_wakeups_only_on_deadlines() {
+    FakeProcess fast(0, 10), slow(1, 50), rare(2, 1000);
+    Sched sched;
+    sched.add(&fast);
+    sched.add(&slow);
+    sched.add(&rare);
+
+    uint32_t passes = simulate(sched, 10000, 1000);
+
+    // All periods are multiples of 10 ms, so there is exactly one wake-up per
+    // 10 ms slot; a busy-spinning loop() would instead poll millis() tens of
+    // thousands of times over the same 10 s.
+    TEST_ASSERT_EQUAL_UINT32(999, sched.getWakeups());
+    TEST_ASSERT_EQUAL_UINT32(999 + 1, passes);
+    TEST_ASSERT_EQUAL_UINT32(999 + 199 + 9, sched.getRuns());
+}
+
+void test_runs_due_processes_in_deadline_order() {
+    int order[8];
+    int orderLen = 0;
+    FakeProcess a(0, 30), b(1, 10), c(2, 20);
+    FakeProcess* all[] = {&a, &b, &c};
+    Sched sched;
+    for (FakeProcess* p : all) {
+        p->order = order;
+        p->orderLen = &orderLen;
+        sched.add(p);
+    }
+
+    // Let all three fall due at once; the earliest deadline runs first
+    virtualNow = 35;
+    TEST_ASSERT_EQUAL(3, (int)sched.runDue(virtualNow));
+    TEST_ASSERT_EQUAL(1, order[0]);
+    TEST_ASSERT_EQUAL(2, order[1]);
+    TEST_ASSERT_EQUAL(0, order[2]);
+}
+
+void test_stall_skips_missed_slots_without_bursting() {
+    FakeProcess stalled(0, 100), victim(1, 10);
+    Sched sched;
+    sched.add(&stalled);
+    sched.add(&victim);
+
+    stalled.cost = 45; // a blocking update eats 4.5 periods of the fast process
+    virtualNow = 100;
+    sched.runDue(virtualNow);
+    TEST_ASSERT_EQUAL_UINT32(1, stalled.runs);
+    TEST_ASSERT_EQUAL_UINT32(1, victim.runs);
+
+    // The fast process runs once to catch up, then returns to a 10 ms cadence
+    uint32_t before = victim.runs;
+    sched.runDue(virtualNow);
+    TEST_ASSERT_EQUAL_UINT32(before + 1, victim.runs);
+    TEST_ASSERT_EQUAL_UINT32(0, sched.runDue(virtualNow));
+    TEST_ASSERT_EQUAL_UINT32(virtualNow + 10, victim.nextWakeAt);
+}
+
+void test_explicit_wake_time_and_halted_processes() {
+    FakeProcess halted(0, 10), custom(1, 10);
+    halted.running = false;
+    Sched sched;
+    sched.add(&halted);
+    sched.add(&custom);
+
+    virtualNow = 10;
+    sched.runDue(virtualNow);
+    TEST_ASSERT_EQUAL_UINT32(0, halted.runs);
+
+    // A process that picks its own wake time is not re-gridded
+    custom.wakeAt(500);
+    TEST_ASSERT_EQUAL_UINT32(490, sched.timeUntilNextDeadline(virtualNow, 1000));
+    TEST_ASSERT_EQUAL_UINT32(100, sched.timeUntilNextDeadline(virtualNow, 100));
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_each_process_runs_once_per_period);
+    RUN_TEST(test_wakeups_only_on_deadlines);
+    RUN_TEST(test_runs_due_processes_in_deadline_order);
+    RUN_TEST(test_stall_skips_missed_slots_without_bursting);
+    RUN_TEST(test_explicit_wake_time_and_halted_processes);
+    return UNITY_END();
+}
@@ -0,0 +1,119 @@
+// Spring pattern physics: stable over every spring_param, independent of
+// how the renderer polls, stalls dropped, impulses.
+// Run with: pio test -e native -f test_spring
+#include <unity.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "LedMath.h"
+
+void setUp() {}
+void tearDown() {}
+
+// spring_param bytes map to k = b / 10, c = b / 10, m = b / 10 + 0.1
+static FixedSpring fromParams(int kByte, int cByte, int mByte) {
+    FixedSpring spring;
+    spring.setParams(kByte / 10.0f, cByte / 10.0f, mByte / 10.0f + 0.1f);
+    return spring;
+}
+
+void test_stable_over_full_parameter_range() {
+    int unstable = 0;
+    for (int k = 0; k <= 255; k += 15) {
+        for (int c = 0; c <= 255; c += 15) {
+            for (int m = 0; m <= 255; m += 15) {
+                FixedSpring spring = fromParams(k, c, m);
+                q16_t peak = 0;
+                // 10 s in frames of 16 ms, then one 5 s stall
+                for (int frame = 0; frame < 625; frame++) {
+                    spring.advance(16);
+                    q16_t magnitude = abs(spring.position);
+                    if (magnitude > peak) peak = magnitude;
+                }
+                spring.advance(5000);
+                q16_t magnitude = abs(spring.position);
+                if (magnitude > peak) peak = magnitude;
+                // Released from 1.0 at rest, a passive spring never goes further
+                if (peak > Q16_ONE + Q16_ONE / 50) unstable++;
+            }
+        }
+    }
+    TEST_ASSERT_EQUAL(0, unstable);
+}
+
+void test_stiffest_and_most_damped_extremes_settle() {
+    const int cases[][3] = {{255, 0, 0}, {255, 255, 0}, {0, 255, 0}, {255, 1, 255}};
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        FixedSpring spring = fromParams(cases[i][0], cases[i][1], cases[i][2]);
+        for (int frame = 0; frame < 2000; frame++) spring.advance(16);
+        TEST_ASSERT_TRUE(abs(spring.position) <= Q16_ONE);
+    }
+    // Heavily damped with a spring: creeps to the target without overshoot
+    FixedSpring spring = fromParams(100, 255, 0);
+    q16_t last = spring.position;
+    for (int frame = 0; frame < 2000; frame++) {
+        spring.advance(16);
+        TEST_ASSERT_TRUE(spring.position <= last);
+        TEST_ASSERT_TRUE(spring.position >= -1);
+        last = spring.position;
+    }
+}
+
+void test_motion_does_not_depend_on_polling() {
+    FixedSpring regular = fromParams(201, 20, 9);
+    FixedSpring jittery = fromParams(201, 20, 9);
+    const uint32_t gaps[] = {3, 27, 16, 9, 1, 30, 14, 28};
+    uint32_t regularMs = 0, jitteryMs = 0;
+    for (int i = 0; i < 400; i++) {
+        jittery.advance(gaps[i % 8]);
+        jitteryMs += gaps[i % 8];
+        while (regularMs + 16 <= jitteryMs) {
+            regular.advance(16);
+            regularMs += 16;
+        }
+    }
+    regular.advance(jitteryMs - regularMs);
+    TEST_ASSERT_EQUAL_INT32(regular.position, jittery.position);
+    TEST_ASSERT_EQUAL_INT32(regular.velocity, jittery.velocity);
+}
+
+void test_stall_is_dropped_not_replayed() {
+    FixedSpring spring(4, 64);
+    spring.setParams(20.1f, 2.0f, 1.0f);
+    TEST_ASSERT_EQUAL_UINT16(64, spring.advance(60000));
+    TEST_ASSERT_EQUAL_UINT16(4, spring.advance(16));     // nothing left over
+    TEST_ASSERT_EQUAL_UINT16(0, spring.advance(3));
+    TEST_ASSERT_EQUAL_UINT16(1, spring.advance(1));
+}
+
+void test_impulse_kicks_from_rest_and_returns() {
+    FixedSpring spring;
+    spring.setParams(20.1f, 2.0f, 1.0f);
+    spring.settle(0);
+    spring.advance(100);
+    TEST_ASSERT_EQUAL_INT32(0, spring.position);
+
+    spring.impulse(q16FromFloat(4.0f));
+    q16_t peak = 0;
+    for (int frame = 0; frame < 20; frame++) {
+        spring.advance(16);
+        if (spring.position > peak) peak = spring.position;
+    }
+    // v0 / w0 for a lightly damped spring, a little less
+    TEST_ASSERT_TRUE(peak > q16FromFloat(0.6f) && peak < q16FromFloat(0.9f));
+    for (int frame = 0; frame < 600; frame++) spring.advance(16);
+    TEST_ASSERT_TRUE(spring.level() <= 2);
+
+    // Kicks saturate instead of overflowing
+    for (int i = 0; i < 100; i++) spring.impulse(q16FromFloat(30000.0f));
+    TEST_ASSERT_EQUAL_INT32(FixedSpring::MAX_VELOCITY, spring.velocity);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_stable_over_full_parameter_range);
+    RUN_TEST(test_stiffest_and_most_damped_extremes_settle);
+    RUN_TEST(test_motion_does_not_depend_on_polling);
+    RUN_TEST(test_stall_is_dropped_not_replayed);
+    RUN_TEST(test_impulse_kicks_from_rest_and_returns);
+    return UNITY_END();
+}
@@ -0,0 +1,119 @@
+// Stall watchdog: overrun capture, hang detection and the retained record.
+// Run with: pio test -e native -f test_stall_watchdog
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include "StallWatchdog.h"
+
+typedef BasicStallWatchdog<3> TestWatchdog;
+
+// Stands in for the RTC_NOINIT record: outlives each watchdog instance
+static StallRecord retained;
+
+void setUp() {
+    memset(&retained, 0xA5, sizeof(retained));  // power-on garbage
+}
+void tearDown() {}
+
+void test_garbage_record_is_cleared_at_boot() {
+    TestWatchdog watchdog(retained);
+    TEST_ASSERT_FALSE(watchdog.begin());
+    TEST_ASSERT_TRUE(retained.isValid());
+    TEST_ASSERT_EQUAL_UINT32(0, retained.stalls);
+}
+
+void test_updates_within_budget_leave_no_record() {
+    TestWatchdog watchdog(retained);
+    watchdog.begin();
+    watchdog.enter(0, "led", 100, 1000);
+    watchdog.check(1050);
+    watchdog.exit(0, 1100);
+    TEST_ASSERT_FALSE(watchdog.hasReport());
+}
+
+void test_overrun_names_process_duration_and_last_command() {
+    TestWatchdog watchdog(retained);
+    watchdog.begin();
+    watchdog.noteCommand("pattern");
+    watchdog.enter(0, "receive", 100, 1000);
+    watchdog.exit(0, 1350);
+
+    TEST_ASSERT_TRUE(watchdog.hasReport());
+    const StallRecord& r = watchdog.getRecord();
+    TEST_ASSERT_EQUAL_STRING("receive", r.process);
+    TEST_ASSERT_EQUAL_STRING("pattern", r.command);
+    TEST_ASSERT_EQUAL_UINT32(350, r.durationMs);
+    TEST_ASSERT_EQUAL_UINT32(100, r.budgetMs);
+    TEST_ASSERT_EQUAL_UINT32(1350, r.uptimeMs);
+    TEST_ASSERT_EQUAL_UINT32(1, r.stalls);
+    TEST_ASSERT_EQUAL(0, r.inProgress);
+}
+
+void test_hang_survives_reset_in_retained_record() {
+    {
+        TestWatchdog watchdog(retained);
+        watchdog.begin();
+        watchdog.noteCommand("ota");
+        watchdog.enter(1, "imu", 100, 4000);    // a process task lane
+        watchdog.enter(0, "ble", 100, 5000);
+        uint32_t now = 5000;
+        bool hung = false;
+        while (!hung) {
+            now += 100;
+            hung = watchdog.check(now, 3000);
+        }
+        TEST_ASSERT_EQUAL_UINT32(7000, now);
+        // The device resets here; update() never returned
+    }
+
+    TestWatchdog rebooted(retained);
+    TEST_ASSERT_TRUE(rebooted.begin());
+    const StallRecord& r = rebooted.getRecord();
+    TEST_ASSERT_EQUAL_STRING("imu", r.process);     // stuck longest
+    TEST_ASSERT_EQUAL(1, r.lane);
+    TEST_ASSERT_EQUAL(1, r.inProgress);
+    TEST_ASSERT_EQUAL_UINT32(3000, r.durationMs);
+    TEST_ASSERT_EQUAL_STRING("ota", r.command);
+    TEST_ASSERT_EQUAL_UINT32(2, r.stalls);          // each hang counted once
+
+    StallRecord report = rebooted.takeReport();
+    TEST_ASSERT_EQUAL_STRING("imu", report.process);
+    TEST_ASSERT_FALSE(rebooted.hasReport());
+    TEST_ASSERT_TRUE(retained.isValid());
+}
+
+void test_worst_stall_is_kept_until_reported() {
+    TestWatchdog watchdog(retained);
+    watchdog.begin();
+    watchdog.enter(0, "wifi", 100, 0);
+    watchdog.exit(0, 900);
+    watchdog.enter(0, "publish", 100, 1000);
+    watchdog.check(1200);                   // seen while running...
+    watchdog.exit(0, 1300);                 // ...and finished: still one stall
+    TEST_ASSERT_EQUAL_UINT32(2, watchdog.getRecord().stalls);
+    TEST_ASSERT_EQUAL_STRING("wifi", watchdog.getRecord().process);
+    TEST_ASSERT_EQUAL_UINT32(900, watchdog.getRecord().durationMs);
+}
+
+void test_tampered_record_is_not_trusted() {
+    {
+        TestWatchdog watchdog(retained);
+        watchdog.begin();
+        watchdog.enter(0, "led", 10, 0);
+        watchdog.exit(0, 500);
+    }
+    retained.durationMs ^= 0x10;            // e.g. a bit flipped across a brownout
+    TestWatchdog rebooted(retained);
+    TEST_ASSERT_FALSE(rebooted.begin());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_garbage_record_is_cleared_at_boot);
+    RUN_TEST(test_updates_within_budget_leave_no_record);
+    RUN_TEST(test_overrun_names_process_duration_and_last_command);
+    RUN_TEST(test_hang_survives_reset_in_retained_record);
+    RUN_TEST(test_worst_stall_is_kept_until_reported);
+    RUN_TEST(test_tampered_record_is_not_trusted);
+    return UNITY_END();
+}
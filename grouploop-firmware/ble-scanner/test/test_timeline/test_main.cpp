@@ -0,0 +1,182 @@
+// Keyframe timelines: parsing, interpolation, easing and loop points.
+// Run with: pio test -e native -f test_timeline
+#include <unity.h>
+#include <stdint.h>
+#include <vector>
+#include "Timeline.h"
+
+typedef BasicTimelineProgram<4, 16> Program;
+typedef std::vector<uint8_t> Bytes;
+
+static void u16(Bytes& out, uint16_t v) {
+    out.push_back((uint8_t)v);
+    out.push_back((uint8_t)(v >> 8));
+}
+
+static Bytes header(uint8_t tracks, uint16_t duration, uint16_t loopStart) {
+    Bytes out;
+    out.push_back(1);
+    out.push_back(tracks);
+    u16(out, duration);
+    u16(out, loopStart);
+    return out;
+}
+
+static void track(Bytes& out, uint8_t target, uint8_t keys) {
+    out.push_back(target);
+    out.push_back(keys);
+}
+
+static void key(Bytes& out, uint16_t time, uint32_t color, uint8_t brightness, TimelineEasing easing) {
+    u16(out, time);
+    out.push_back((uint8_t)(color >> 16));
+    out.push_back((uint8_t)(color >> 8));
+    out.push_back((uint8_t)color);
+    out.push_back(brightness);
+    out.push_back((uint8_t)easing);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_linear_fade_between_keys() {
+    Bytes b = header(1, 1000, Program::NO_LOOP);
+    track(b, Program::ALL_LEDS, 2);
+    key(b, 0, 0x000000, 255, TimelineEasing::LINEAR);
+    key(b, 1000, 0xFF8000, 255, TimelineEasing::LINEAR);
+    Program program;
+    TEST_ASSERT_TRUE(program.load(&b[0], b.size()));
+
+    uint32_t colors[3];
+    uint8_t levels[3];
+    program.render(500, colors, levels, 3);
+    TEST_ASSERT_EQUAL_HEX32(0x7F4000, colors[0]);
+    TEST_ASSERT_EQUAL_HEX32(0x7F4000, colors[2]);
+    TEST_ASSERT_EQUAL_UINT8(255, levels[1]);
+
+    // Played once: holds the last frame
+    TEST_ASSERT_TRUE(program.finished(5000));
+    program.render(program.localTime(5000), colors, levels, 3);
+    TEST_ASSERT_EQUAL_HEX32(0xFF8000, colors[0]);
+}
+
+void test_tracks_target_leds_and_later_ones_win() {
+    Bytes b = header(2, 100, Program::NO_LOOP);
+    track(b, Program::ALL_LEDS, 1);
+    key(b, 0, 0x0000FF, 100, TimelineEasing::LINEAR);
+    track(b, 1, 1);
+    key(b, 0, 0xFF0000, 200, TimelineEasing::LINEAR);
+    Program program;
+    TEST_ASSERT_TRUE(program.load(&b[0], b.size()));
+
+    uint32_t colors[3];
+    uint8_t levels[3];
+    program.render(50, colors, levels, 3);
+    TEST_ASSERT_EQUAL_HEX32(0x0000FF, colors[0]);
+    TEST_ASSERT_EQUAL_HEX32(0xFF0000, colors[1]);
+    TEST_ASSERT_EQUAL_UINT8(200, levels[1]);
+    TEST_ASSERT_EQUAL_UINT8(100, levels[2]);
+}
+
+void test_loop_points_and_cursor_rewind() {
+    // Intro 0..1000 once, then 1000..3000 repeats
+    Bytes b = header(1, 3000, 1000);
+    track(b, 0, 3);
+    key(b, 0, 0, 0, TimelineEasing::LINEAR);
+    key(b, 1000, 0, 200, TimelineEasing::STEP);
+    key(b, 2000, 0, 50, TimelineEasing::LINEAR);
+    Program program;
+    TEST_ASSERT_TRUE(program.load(&b[0], b.size()));
+    TEST_ASSERT_TRUE(program.loops());
+    TEST_ASSERT_FALSE(program.finished(100000));
+
+    TEST_ASSERT_EQUAL_UINT32(2999, program.localTime(2999));
+    TEST_ASSERT_EQUAL_UINT32(1000, program.localTime(3000));
+    TEST_ASSERT_EQUAL_UINT32(1500, program.localTime(5500));
+
+    uint32_t color;
+    uint8_t level;
+    program.render(program.localTime(2500), &color, &level, 1);
+    TEST_ASSERT_EQUAL_UINT8(50, level);
+    program.render(program.localTime(3500), &color, &level, 1);  // wrapped: step segment holds
+    TEST_ASSERT_EQUAL_UINT8(200, level);
+    program.render(program.localTime(500), &color, &level, 1);
+    TEST_ASSERT_EQUAL_UINT8(100, level);
+}
+
+void test_easing_curves() {
+    TEST_ASSERT_EQUAL_UINT16(0, timelineEase(TimelineEasing::STEP, 255));
+    TEST_ASSERT_EQUAL_UINT16(64, timelineEase(TimelineEasing::EASE_IN, 128));
+    TEST_ASSERT_EQUAL_UINT16(192, timelineEase(TimelineEasing::EASE_OUT, 128));
+    TEST_ASSERT_EQUAL_UINT16(128, timelineEase(TimelineEasing::EASE_IN_OUT, 128));
+    TEST_ASSERT_UINT32_WITHIN(2, 128, timelineEase(TimelineEasing::SINE, 128));
+    for (uint8_t e = 0; e < (uint8_t)TimelineEasing::COUNT; e++) {
+        TimelineEasing easing = (TimelineEasing)e;
+        if (easing != TimelineEasing::STEP) TEST_ASSERT_UINT32_WITHIN(1, 0, timelineEase(easing, 0));
+        TEST_ASSERT_UINT32_WITHIN(1, 256, timelineEase(easing, 256));
+        for (uint16_t f = 1; f <= 256; f++) {
+            TEST_ASSERT_TRUE(timelineEase(easing, f) >= timelineEase(easing, f - 1));
+        }
+    }
+}
+
+void test_hex_upload() {
+    // 1 track on LED 2, one red key; 100 ms, no loop
+    Program program;
+    TEST_ASSERT_TRUE(program.loadHex("01016400FFFF02010000FF0000FF00"));
+    TEST_ASSERT_EQUAL(1, program.getTrackCount());
+    uint32_t colors[3];
+    uint8_t levels[3];
+    program.render(10, colors, levels, 3);
+    TEST_ASSERT_EQUAL_HEX32(0xFF0000, colors[2]);
+    TEST_ASSERT_EQUAL_HEX32(0, colors[0]);
+
+    TEST_ASSERT_FALSE(program.loadHex("01016400FFFF02010000FF0000FF0"));
+    TEST_ASSERT_FALSE(program.loadHex("01016400FFFF02010000FF0000FFZZ"));
+    TEST_ASSERT_EQUAL_STRING("invalid hex digit", program.getError());
+    TEST_ASSERT_FALSE(program.isLoaded());
+}
+
+void test_rejects_malformed_programs() {
+    Program program;
+    Bytes b = header(1, 100, 100);      // loop start at the end
+    track(b, 0, 1);
+    key(b, 0, 0, 0, TimelineEasing::LINEAR);
+    TEST_ASSERT_FALSE(program.load(&b[0], b.size()));
+
+    b = header(1, 100, Program::NO_LOOP);
+    track(b, 0, 2);
+    key(b, 50, 0, 0, TimelineEasing::LINEAR);
+    key(b, 10, 0, 0, TimelineEasing::LINEAR);
+    TEST_ASSERT_FALSE(program.load(&b[0], b.size()));
+    TEST_ASSERT_EQUAL_STRING("keys out of order", program.getError());
+
+    b = header(1, 100, Program::NO_LOOP);
+    track(b, 0, 17);                    // more keys than the program holds
+    for (int i = 0; i < 17; i++) key(b, i, 0, 0, TimelineEasing::LINEAR);
+    TEST_ASSERT_FALSE(program.load(&b[0], b.size()));
+
+    b = header(1, 100, Program::NO_LOOP);
+    track(b, 0, 1);
+    key(b, 0, 0, 0, (TimelineEasing)9);
+    TEST_ASSERT_FALSE(program.load(&b[0], b.size()));
+
+    b = header(1, 100, Program::NO_LOOP);
+    track(b, 0, 1);
+    key(b, 0, 0, 0, TimelineEasing::LINEAR);
+    TEST_ASSERT_FALSE(program.load(&b[0], b.size() - 1));
+    b.push_back(0);
+    TEST_ASSERT_FALSE(program.load(&b[0], b.size()));
+    TEST_ASSERT_EQUAL_STRING("trailing bytes", program.getError());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_linear_fade_between_keys);
+    RUN_TEST(test_tracks_target_leds_and_later_ones_win);
+    RUN_TEST(test_loop_points_and_cursor_rewind);
+    RUN_TEST(test_easing_curves);
+    RUN_TEST(test_hex_upload);
+    RUN_TEST(test_rejects_malformed_programs);
+    return UNITY_END();
+}
@@ -0,0 +1,104 @@
+// Timer drift tests against a virtual clock.
+// Run with: pio test -e native -f test_timer
+#include <unity.h>
+#include <stdint.h>
+#include "Timer.h"
+
+struct VirtualClock {
+    static uint32_t t;
+    static uint32_t now() { return t; }
+};
+uint32_t VirtualClock::t = 0;
+
+typedef BasicTimer<VirtualClock> VTimer;
+
+// Deterministic poll jitter of 1..7 time units, like a loop with varying work
+static uint32_t nextStep() {
+    static uint32_t state = 12345;
+    state = state * 1103515245 + 12345;
+    return 1 + (state >> 16) % 7;
+}
+
+void setUp() { VirtualClock::t = 0; }
+void tearDown() {}
+
+void test_default_mode_drifts_by_poll_latency() {
+    VTimer timer(10);
+    timer.reset();
+    uint32_t fired = 0;
+    for (VirtualClock::t = 0; VirtualClock::t < 3600000u; VirtualClock::t++) {
+        if (timer.checkAndReset()) fired++;
+    }
+    // Restarting from "now" with '>' turns a 10 ms timer into an 11 ms one
+    TEST_ASSERT_EQUAL_UINT32(3600000u / 11, fired);
+}
+
+void test_fixed_rate_has_zero_long_term_drift() {
+    VTimer timer(10, TimerCatchUp::BURST);
+    timer.reset();
+    uint32_t start = timer.last_update;
+    uint32_t fired = 0;
+    while (VirtualClock::t < 3600000u) {   // one hour of jittery polling
+        VirtualClock::t += nextStep();
+        while (timer.checkAndReset()) fired++;
+    }
+    // Every tick up to the current time fired, and the grid never moved
+    TEST_ASSERT_EQUAL_UINT32((VirtualClock::t - start) / 10, fired);
+    TEST_ASSERT_EQUAL_UINT32(start + fired * 10, timer.last_update);
+}
+
+void test_fixed_rate_skip_stays_on_grid_after_stall() {
+    VTimer timer(10, TimerCatchUp::SKIP);
+    timer.reset();
+
+    VirtualClock::t = 10;
+    TEST_ASSERT_TRUE(timer.checkAndReset());
+
+    // A 95 ms stall fires once and drops the missed ticks
+    VirtualClock::t = 105;
+    TEST_ASSERT_TRUE(timer.checkAndReset());
+    TEST_ASSERT_FALSE(timer.checkAndReset());
+    TEST_ASSERT_EQUAL_UINT32(100, timer.last_update);
+
+    // The next tick is still on the original 10 ms grid
+    VirtualClock::t = 109;
+    TEST_ASSERT_FALSE(timer.checkAndReset());
+    VirtualClock::t = 110;
+    TEST_ASSERT_TRUE(timer.checkAndReset());
+}
+
+void test_fixed_rate_burst_replays_missed_ticks() {
+    VTimer timer(10, TimerCatchUp::BURST);
+    timer.reset();
+
+    VirtualClock::t = 95;
+    int fired = 0;
+    while (timer.checkAndReset()) fired++;
+    TEST_ASSERT_EQUAL(9, fired);
+    TEST_ASSERT_EQUAL_UINT32(90, timer.last_update);
+}
+
+void test_microsecond_timer_survives_clock_wrap() {
+    // micros() wraps every ~71 minutes; start just before the wrap
+    VirtualClock::t = 0xFFFFFFFFu - 5000;
+    VTimer timer(250, TimerCatchUp::BURST);   // 4 kHz in microseconds
+    timer.reset();
+    uint32_t start = timer.last_update;
+    uint32_t fired = 0;
+    for (int i = 0; i < 100000; i++) {
+        VirtualClock::t += nextStep() * 37;
+        while (timer.checkAndReset()) fired++;
+    }
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(VirtualClock::t - start) / 250, fired);
+    TEST_ASSERT_EQUAL_UINT32((uint32_t)(start + fired * 250), timer.last_update);
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_default_mode_drifts_by_poll_latency);
+    RUN_TEST(test_fixed_rate_has_zero_long_term_drift);
+    RUN_TEST(test_fixed_rate_skip_stays_on_grid_after_stall);
+    RUN_TEST(test_fixed_rate_burst_replays_missed_ticks);
+    RUN_TEST(test_microsecond_timer_survives_clock_wrap);
+    return UNITY_END();
+}
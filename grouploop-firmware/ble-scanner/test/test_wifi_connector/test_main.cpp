@@ -0,0 +1,302 @@
+// WiFi connection state machine tests against a fake driver.
+// Run with: pio test -e native -f test_wifi_connector
+#include <unity.h>
+#include <stdint.h>
+#include <string.h>
+#include "WiFiConnector.h"
+
+typedef WiFiConnector::State State;
+
+class FakeWiFiDriver : public WiFiDriver {
+public:
+    bool scanAccepted = true;
+    bool networkVisible = true;
+    int scans = 0;
+    int associations = 0;
+    int disconnects = 0;
+    char lastSsid[33] = "";
+    int32_t lastChannel = 0;
+    uint32_t lastIp = 0;
+
+    bool startScan() override {
+        scans++;
+        return scanAccepted;
+    }
+
+    bool findBestNetwork(const char* ssid, WiFiNetwork& network) override {
+        if (!networkVisible || strcmp(ssid, "show-net") != 0) return false;
+        const uint8_t bssid[6] = {0x02, 0x11, 0x22, 0x33, 0x44, 0x55};
+        memcpy(network.bssid, bssid, sizeof(bssid));
+        network.channel = 6;
+        network.rssi = -58;
+        return true;
+    }
+
+    void associate(const char* ssid, const char* password, const WiFiNetwork& network) override {
+        associations++;
+        strncpy(lastSsid, ssid, sizeof(lastSsid) - 1);
+        lastChannel = network.channel;
+        lastIp = network.ip;
+    }
+
+    void disconnect() override {
+        disconnects++;
+    }
+};
+
+static WiFiConnectorConfig testConfig() {
+    WiFiConnectorConfig config;
+    config.scanTimeoutMs = 1000;
+    config.associateTimeoutMs = 1000;
+    config.fastAssociateTimeoutMs = 300;
+    config.dhcpTimeoutMs = 1000;
+    config.backoffInitialMs = 100;
+    config.backoffMaxMs = 1600;
+    config.jitterPercent = 0;
+    return config;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_happy_path_walks_through_every_state() {
+    FakeWiFiDriver driver;
+    WiFiConnector connector(driver, testConfig());
+
+    connector.begin("show-net", "secret", 0);
+    TEST_ASSERT_TRUE(connector.getState() == State::SCANNING);
+    TEST_ASSERT_EQUAL(1, driver.scans);
+
+    connector.handle(WiFiDriverEvent::SCAN_DONE, 300);
+    TEST_ASSERT_TRUE(connector.getState() == State::ASSOCIATING);
+    TEST_ASSERT_EQUAL(1, driver.associations);
+    TEST_ASSERT_EQUAL_STRING("show-net", driver.lastSsid);
+    TEST_ASSERT_EQUAL(6, driver.lastChannel);
+
+    connector.handle(WiFiDriverEvent::ASSOCIATED, 400);
+    TEST_ASSERT_TRUE(connector.getState() == State::OBTAINING_IP);
+
+    connector.handle(WiFiDriverEvent::GOT_IP, 450);
+    TEST_ASSERT_TRUE(connector.isConnected());
+    TEST_ASSERT_EQUAL_UINT32(0, connector.getFailures());
+
+    // Nothing times out once connected
+    connector.update(100000);
+    TEST_ASSERT_TRUE(connector.isConnected());
+}
+
+void test_missing_network_backs_off_exponentially_and_never_gives_up() {
+    FakeWiFiDriver driver;
+    driver.networkVisible = false;
+    WiFiConnector connector(driver, testConfig());
+
+    uint32_t now = 0;
+    connector.begin("show-net", "secret", now);
+    const uint32_t expected[] = {100, 200, 400, 800, 1600, 1600, 1600, 1600, 1600, 1600};
+    for (int i = 0; i < 10; i++) {
+        connector.handle(WiFiDriverEvent::SCAN_DONE, now);
+        TEST_ASSERT_TRUE(connector.getState() == State::BACKOFF);
+        TEST_ASSERT_EQUAL_UINT32(expected[i], connector.getRetryDelay());
+
+        connector.update(now + expected[i] - 1);
+        TEST_ASSERT_TRUE(connector.getState() == State::BACKOFF);
+        now += expected[i];
+        connector.update(now);
+        TEST_ASSERT_TRUE(connector.getState() == State::SCANNING);
+    }
+    TEST_ASSERT_EQUAL(11, driver.scans);
+    TEST_ASSERT_EQUAL(0, driver.associations);
+
+    // The network shows up: the next scan joins it
+    driver.networkVisible = true;
+    connector.handle(WiFiDriverEvent::SCAN_DONE, now);
+    connector.handle(WiFiDriverEvent::GOT_IP, now + 10);
+    TEST_ASSERT_TRUE(connector.isConnected());
+}
+
+void test_each_phase_times_out_into_backoff() {
+    FakeWiFiDriver driver;
+    WiFiConnector connector(driver, testConfig());
+
+    // Scan never completes
+    connector.begin("show-net", "secret", 0);
+    connector.update(999);
+    TEST_ASSERT_TRUE(connector.getState() == State::SCANNING);
+    connector.update(1000);
+    TEST_ASSERT_TRUE(connector.getState() == State::BACKOFF);
+
+    // Association never completes
+    connector.update(1100);
+    connector.handle(WiFiDriverEvent::SCAN_DONE, 1100);
+    connector.update(2100);
+    TEST_ASSERT_TRUE(connector.getState() == State::BACKOFF);
+    TEST_ASSERT_EQUAL(1, driver.disconnects);
+
+    // DHCP never completes
+    connector.update(2300);
+    connector.handle(WiFiDriverEvent::SCAN_DONE, 2300);
+    connector.handle(WiFiDriverEvent::ASSOCIATED, 2310);
+    connector.update(3310);
+    TEST_ASSERT_TRUE(connector.getState() == State::BACKOFF);
+    TEST_ASSERT_EQUAL(2, driver.disconnects);
+    TEST_ASSERT_EQUAL_UINT32(3, connector.getFailures());
+}
+
+void test_link_loss_retries_after_shortest_delay() {
+    FakeWiFiDriver driver;
+    WiFiConnector connector(driver, testConfig());
+
+    // Two failures first, so the backoff has grown
+    driver.networkVisible = false;
+    connector.begin("show-net", "secret", 0);
+    connector.handle(WiFiDriverEvent::SCAN_DONE, 0);
+    connector.update(100);
+    connector.handle(WiFiDriverEvent::SCAN_DONE, 100);
+    TEST_ASSERT_EQUAL_UINT32(200, connector.getRetryDelay());
+
+    driver.networkVisible = true;
+    connector.update(300);
+    connector.handle(WiFiDriverEvent::SCAN_DONE, 300);
+    connector.handle(WiFiDriverEvent::GOT_IP, 320);
+    TEST_ASSERT_TRUE(connector.isConnected());
+
+    connector.handle(WiFiDriverEvent::DISCONNECTED, 5000);
+    TEST_ASSERT_TRUE(connector.getState() == State::BACKOFF);
+    TEST_ASSERT_EQUAL_UINT32(100, connector.getRetryDelay());
+}
+
+void test_stale_events_are_ignored() {
+    FakeWiFiDriver driver;
+    WiFiConnector connector(driver, testConfig());
+    connector.begin("show-net", "secret", 0);
+
+    // Link events before the scan finished, and a disconnect while scanning
+    connector.handle(WiFiDriverEvent::ASSOCIATED, 10);
+    connector.handle(WiFiDriverEvent::DISCONNECTED, 20);
+    TEST_ASSERT_TRUE(connector.getState() == State::SCANNING);
+
+    connector.handle(WiFiDriverEvent::SCAN_DONE, 30);
+    connector.handle(WiFiDriverEvent::SCAN_DONE, 40);
+    TEST_ASSERT_EQUAL(1, driver.associations);
+}
+
+void test_jitter_stays_within_bounds_and_differs_per_seed() {
+    FakeWiFiDriver driver;
+    driver.networkVisible = false;
+    WiFiConnectorConfig config = testConfig();
+    config.jitterPercent = 25;
+    WiFiConnector a(driver, config);
+    WiFiConnector b(driver, config);
+    a.setSeed(1);
+    b.setSeed(2);
+
+    bool differs = false;
+    uint32_t now = 0;
+    a.begin("show-net", "", now);
+    b.begin("show-net", "", now);
+    for (int i = 0; i < 8; i++) {
+        a.handle(WiFiDriverEvent::SCAN_DONE, now);
+        b.handle(WiFiDriverEvent::SCAN_DONE, now);
+        uint32_t nominal = 100u << i;
+        if (nominal > 1600) nominal = 1600;
+        TEST_ASSERT_TRUE(a.getRetryDelay() <= nominal);
+        TEST_ASSERT_TRUE(a.getRetryDelay() >= nominal - nominal / 4);
+        if (a.getRetryDelay() != b.getRetryDelay()) differs = true;
+        now += 2000;
+        a.update(now);
+        b.update(now);
+    }
+    TEST_ASSERT_TRUE(differs);
+}
+
+void test_empty_ssid_stays_idle() {
+    FakeWiFiDriver driver;
+    WiFiConnector connector(driver, testConfig());
+    connector.begin("", "", 0);
+    connector.update(100000);
+    TEST_ASSERT_TRUE(connector.getState() == State::IDLE);
+    TEST_ASSERT_EQUAL(0, driver.scans);
+}
+
+static WiFiNetwork cachedNetwork() {
+    WiFiNetwork network = {};
+    const uint8_t bssid[6] = {0x02, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE};
+    memcpy(network.bssid, bssid, sizeof(bssid));
+    network.channel = 11;
+    network.ip = 0x0A00A8C0;    // 192.168.0.10
+    network.gateway = 0x0100A8C0;
+    network.subnet = 0x00FFFFFF;
+    return network;
+}
+
+void test_cached_network_joins_without_scanning() {
+    FakeWiFiDriver driver;
+    WiFiConnector connector(driver, testConfig());
+    WiFiNetwork cached = cachedNetwork();
+
+    connector.begin("show-net", "secret", 0, &cached);
+    TEST_ASSERT_TRUE(connector.getState() == State::ASSOCIATING);
+    TEST_ASSERT_EQUAL(0, driver.scans);
+    TEST_ASSERT_EQUAL(11, driver.lastChannel);
+    TEST_ASSERT_EQUAL_UINT32(cached.ip, driver.lastIp);
+
+    // With a reused lease GOT_IP can arrive right after association
+    connector.handle(WiFiDriverEvent::ASSOCIATED, 80);
+    connector.handle(WiFiDriverEvent::GOT_IP, 90);
+    TEST_ASSERT_TRUE(connector.isConnected());
+    TEST_ASSERT_TRUE(connector.isConnectedViaCache());
+}
+
+void test_failed_cached_join_falls_back_to_scan_without_backoff() {
+    FakeWiFiDriver driver;
+    WiFiConnector connector(driver, testConfig());
+    WiFiNetwork cached = cachedNetwork();
+
+    // The access point is gone: the shorter fast-path timeout expires
+    connector.begin("show-net", "secret", 0, &cached);
+    connector.update(299);
+    TEST_ASSERT_TRUE(connector.getState() == State::ASSOCIATING);
+    connector.update(300);
+    TEST_ASSERT_TRUE(connector.getState() == State::SCANNING);
+    TEST_ASSERT_EQUAL(1, driver.scans);
+    TEST_ASSERT_EQUAL(1, driver.disconnects);
+    TEST_ASSERT_EQUAL_UINT32(0, connector.getFailures());
+
+    // The scanned network is joined over DHCP, not with the stale lease
+    connector.handle(WiFiDriverEvent::SCAN_DONE, 500);
+    TEST_ASSERT_EQUAL(6, driver.lastChannel);
+    TEST_ASSERT_EQUAL_UINT32(0, driver.lastIp);
+    connector.handle(WiFiDriverEvent::GOT_IP, 700);
+    TEST_ASSERT_TRUE(connector.isConnected());
+    TEST_ASSERT_FALSE(connector.isConnectedViaCache());
+}
+
+void test_rejected_cached_join_falls_back_immediately() {
+    FakeWiFiDriver driver;
+    WiFiConnector connector(driver, testConfig());
+    WiFiNetwork cached = cachedNetwork();
+
+    connector.begin("show-net", "secret", 0, &cached);
+    connector.handle(WiFiDriverEvent::DISCONNECTED, 50);
+    TEST_ASSERT_TRUE(connector.getState() == State::SCANNING);
+
+    // Later failures back off as usual
+    connector.update(1050);
+    TEST_ASSERT_TRUE(connector.getState() == State::BACKOFF);
+    TEST_ASSERT_EQUAL_UINT32(100, connector.getRetryDelay());
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_happy_path_walks_through_every_state);
+    RUN_TEST(test_missing_network_backs_off_exponentially_and_never_gives_up);
+    RUN_TEST(test_each_phase_times_out_into_backoff);
+    RUN_TEST(test_link_loss_retries_after_shortest_delay);
+    RUN_TEST(test_stale_events_are_ignored);
+    RUN_TEST(test_jitter_stays_within_bounds_and_differs_per_seed);
+    RUN_TEST(test_empty_ssid_stays_idle);
+    RUN_TEST(test_cached_network_joins_without_scanning);
+    RUN_TEST(test_failed_cached_join_falls_back_to_scan_without_backoff);
+    RUN_TEST(test_rejected_cached_join_falls_back_immediately);
+    return UNITY_END();
+}
@@ -0,0 +1,166 @@
+// led-bench: cost of one LED frame with the old float maths and with
+// LedMath.h, measured on the host.
+//
+// Build: c++ -std=c++11 -O2 -Iinclude tools/led-bench/led_bench.cpp -o led-bench
+//        (from grouploop-firmware/ble-scanner)
+//
+//   led-bench [frames]
+//
+// A host CPU has an FPU and a divider, so the gap shown here is the lower
+// bound; on the ESP32-C3 every float operation and sin() is a soft-float
+// library call. For device numbers build the same file with the RISC-V
+// toolchain (riscv32-esp-elf-g++ -march=rv32imc) and run it under QEMU or
+// read the cycle counter on the board.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include "LedMath.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+static const int PIXELS = 6;
+static const uint32_t COLOR = 0xFF8020;
+static const uint32_t FRAME_MS = 20;
+
+static volatile uint32_t sink;
+
+// --- What the behaviors did before ---
+
+static uint32_t floatScaleColor(uint32_t color, uint8_t brightness) {
+    uint8_t r = (uint8_t)(((color >> 16) & 0xFF) * brightness / 255);
+    uint8_t g = (uint8_t)(((color >> 8) & 0xFF) * brightness / 255);
+    uint8_t b = (uint8_t)((color & 0xFF) * brightness / 255);
+    return ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+}
+
+static void floatBreathingFrame(uint32_t elapsed, uint32_t* frame) {
+    float sineWave = sin(elapsed * 2.0 * M_PI / 2000);
+    uint8_t brightness = (uint8_t)(((sineWave + 1.0) / 2.0) * 255.0);
+    for (int i = 0; i < PIXELS; i++) frame[i] = floatScaleColor(COLOR, brightness);
+}
+
+static void floatIndividualFrame(uint32_t elapsed, uint32_t* frame) {
+    float sineWave = sin(elapsed * 2.0 * M_PI / 2000);
+    uint8_t frameBrightness = (uint8_t)(((sineWave + 1.0) / 2.0) * 255.0);
+    for (int i = 0; i < PIXELS; i++) {
+        uint16_t combined = ((uint16_t)(200 + i) * (uint16_t)frameBrightness) / 255;
+        frame[i] = floatScaleColor(COLOR + i, (uint8_t)combined);
+    }
+}
+
+struct FloatSpring {
+    float position, velocity, target, k, damping, mass;
+    FloatSpring() : position(1), velocity(0), target(0), k(20.1f), damping(2), mass(1) {}
+    // The fixed 4 ms semi-implicit steps of FixedSpring, in float
+    uint8_t step(uint32_t dtMs) {
+        const float h = 0.004f;
+        for (uint32_t t = 0; t + 4 <= dtMs; t += 4) {
+            velocity = (velocity - h * k / mass * (position - target)) / (1.0f + h * damping / mass);
+            position += h * velocity;
+        }
+        return (uint8_t)(fabsf(position) * 255.0f);
+    }
+};
+
+static void floatSpringFrame(FloatSpring& spring, uint32_t* frame) {
+    uint8_t brightness = spring.step(FRAME_MS);
+    for (int i = 0; i < PIXELS; i++) frame[i] = floatScaleColor(COLOR, brightness);
+}
+
+// --- The same frames with LedMath.h ---
+
+static const uint32_t PHASE_STEP = ledPhaseStep(2000);
+
+static void fixedBreathingFrame(uint32_t elapsed, uint32_t* frame) {
+    uint8_t brightness = ledGamma8(ledSin8(elapsed * PHASE_STEP));
+    for (int i = 0; i < PIXELS; i++) frame[i] = ledScaleColor(COLOR, brightness);
+}
+
+static void fixedIndividualFrame(uint32_t elapsed, uint32_t* frame) {
+    uint8_t frameBrightness = ledSin8(elapsed * PHASE_STEP);
+    for (int i = 0; i < PIXELS; i++) {
+        uint8_t combined = ledScale8((uint8_t)(200 + i), frameBrightness);
+        frame[i] = ledScaleColor(COLOR + i, ledGamma8(combined));
+    }
+}
+
+static void fixedSpringFrame(FixedSpring& spring, uint32_t* frame) {
+    spring.advance(FRAME_MS);
+    uint8_t brightness = ledGamma8(spring.level());
+    for (int i = 0; i < PIXELS; i++) frame[i] = ledScaleColor(COLOR, brightness);
+}
+
+// --- Harness ---
+
+struct Cost {
+    double ns;
+    double cycles;
+};
+
+template <typename Frame>
+static Cost measure(uint32_t frames, Frame frame) {
+    uint32_t pixels[PIXELS];
+    auto start = std::chrono::steady_clock::now();
+#if HAVE_TSC
+    uint64_t tscStart = __rdtsc();
+#endif
+    for (uint32_t f = 0; f < frames; f++) {
+        frame(f * FRAME_MS, pixels);
+        sink = pixels[f % PIXELS];
+    }
+    Cost cost;
+#if HAVE_TSC
+    cost.cycles = (double)(__rdtsc() - tscStart) / frames;
+#else
+    cost.cycles = 0;
+#endif
+    cost.ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / frames;
+    return cost;
+}
+
+static void report(const char* name, Cost before, Cost after) {
+#if HAVE_TSC
+    printf("%-12s %10.1f %10.1f   %6.1fx   (%.1f / %.1f ns)\n", name, before.cycles, after.cycles,
+           after.cycles > 0 ? before.cycles / after.cycles : 0, before.ns, after.ns);
+#else
+    printf("%-12s %10.1f %10.1f   %6.1fx   (ns)\n", name, before.ns, after.ns, after.ns > 0 ? before.ns / after.ns : 0);
+#endif
+}
+
+int main(int argc, char** argv) {
+    uint32_t frames = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 1000000;
+    if (frames == 0) frames = 1;
+
+    printf("%u frames of %d pixels\n", frames, PIXELS);
+#if HAVE_TSC
+    printf("%-12s %10s %10s   %7s\n", "behavior", "float cyc", "fixed cyc", "speedup");
+#else
+    printf("%-12s %10s %10s   %7s\n", "behavior", "float", "fixed", "speedup");
+#endif
+
+    report("breathing",
+           measure(frames, floatBreathingFrame),
+           measure(frames, fixedBreathingFrame));
+    report("individual",
+           measure(frames, floatIndividualFrame),
+           measure(frames, fixedIndividualFrame));
+
+    // Springs are stateful; restart them every 200 frames so they keep moving
+    FloatSpring floatSpring;
+    FixedSpring fixedSpring;
+    fixedSpring.setParams(20.1f, 2.0f, 1.0f);
+    report("spring",
+           measure(frames, [&](uint32_t elapsed, uint32_t* frame) {
+               if (elapsed % (200 * FRAME_MS) == 0) floatSpring = FloatSpring();
+               floatSpringFrame(floatSpring, frame);
+           }),
+           measure(frames, [&](uint32_t elapsed, uint32_t* frame) {
+               if (elapsed % (200 * FRAME_MS) == 0) fixedSpring.settle(Q16_ONE);
+               fixedSpringFrame(fixedSpring, frame);
+           }));
+    return 0;
+}
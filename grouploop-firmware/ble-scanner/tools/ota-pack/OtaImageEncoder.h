@@ -0,0 +1,191 @@
+#ifndef OTA_IMAGE_ENCODER_H
+#define OTA_IMAGE_ENCODER_H
+
+// Host-side counterpart of include/OtaImageDecoder.h: builds the packed
+// images the firmware can stream into its OTA slot. Shared by the
+// ota-pack tool and the native round-trip test; never built for the device.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include "OtaImageDecoder.h"
+
+namespace OtaImageEncoder {
+
+typedef std::vector<uint8_t> Bytes;
+
+// LZSS with the decoder's token layout, using hash chains over 3 byte
+// prefixes to find matches in the 4 KB window
+inline Bytes lzssCompress(const Bytes& data, int maxChainDepth = 256) {
+    const size_t window = LzssDecoder::WINDOW_SIZE;
+    const size_t minMatch = LzssDecoder::MIN_MATCH;
+    const size_t maxMatch = LzssDecoder::MAX_MATCH;
+    const size_t hashSize = 1 << 16;
+    std::vector<int32_t> head(hashSize, -1);
+    std::vector<int32_t> prev(data.size(), -1);
+    const size_t n = data.size();
+
+    Bytes out;
+    size_t flagPos = 0;
+    int tokens = 8;
+    auto hashAt = [&](size_t i) -> size_t {
+        return ((data[i] << 8) ^ (data[i + 1] << 4) ^ data[i + 2]) & (hashSize - 1);
+    };
+    auto insert = [&](size_t i) {
+        if (i + minMatch > n) return;
+        size_t h = hashAt(i);
+        prev[i] = head[h];
+        head[h] = (int32_t)i;
+    };
+    auto startToken = [&](bool literal) {
+        if (tokens == 8) {
+            flagPos = out.size();
+            out.push_back(0);
+            tokens = 0;
+        }
+        if (literal) out[flagPos] |= (uint8_t)(1 << tokens);
+        tokens++;
+    };
+
+    size_t i = 0;
+    while (i < n) {
+        size_t bestLength = 0;
+        size_t bestDistance = 0;
+        if (i + minMatch <= n) {
+            int32_t candidate = head[hashAt(i)];
+            int depth = maxChainDepth;
+            while (candidate >= 0 && depth-- > 0 && i - (size_t)candidate <= window) {
+                size_t limit = n - i < maxMatch ? n - i : maxMatch;
+                size_t length = 0;
+                while (length < limit && data[candidate + length] == data[i + length]) length++;
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestDistance = i - (size_t)candidate;
+                    if (length == maxMatch) break;
+                }
+                candidate = prev[candidate];
+            }
+        }
+        if (bestLength >= minMatch) {
+            startToken(false);
+            size_t d = bestDistance - 1;
+            out.push_back((uint8_t)(d >> 4));
+            out.push_back((uint8_t)(((d & 0x0F) << 4) | (bestLength - minMatch)));
+            for (size_t k = 0; k < bestLength; k++) insert(i + k);
+            i += bestLength;
+        } else {
+            startToken(true);
+            out.push_back(data[i]);
+            insert(i);
+            i++;
+        }
+    }
+    return out;
+}
+
+inline void putVarint(Bytes& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+// COPY/INSERT operations that rebuild `image` from `base`. Matches are
+// found through an index of 8 byte blocks in the base; after each copy the
+// same relative position is tried first, which keeps in-place edits cheap.
+inline Bytes deltaOps(const Bytes& base, const Bytes& image, size_t minCopy = 12) {
+    const size_t block = 8;
+    const size_t hashBits = 20;
+    const int maxCandidates = 32;
+    std::vector<int32_t> head((size_t)1 << hashBits, -1);
+    std::vector<int32_t> prev(base.size(), -1);
+    auto hashAt = [&](const Bytes& bytes, size_t i) -> size_t {
+        uint64_t h = 1469598103934665603ull;
+        for (size_t k = 0; k < block; k++) h = (h ^ bytes[i + k]) * 1099511628211ull;
+        return (size_t)(h >> (64 - hashBits));
+    };
+    for (size_t i = 0; i + block <= base.size(); i++) {
+        size_t h = hashAt(base, i);
+        prev[i] = head[h];
+        head[h] = (int32_t)i;
+    }
+    auto matchLength = [&](size_t b, size_t i) -> size_t {
+        size_t length = 0;
+        while (b + length < base.size() && i + length < image.size() && base[b + length] == image[i + length]) length++;
+        return length;
+    };
+
+    Bytes ops;
+    size_t insertStart = 0;
+    auto flushInsert = [&](size_t end) {
+        if (end > insertStart) {
+            ops.push_back((uint8_t)DeltaApplier::OP_INSERT);
+            putVarint(ops, (uint32_t)(end - insertStart));
+            ops.insert(ops.end(), image.begin() + insertStart, image.begin() + end);
+        }
+    };
+
+    size_t i = 0;
+    int64_t lastShift = 0;      // base offset minus image offset of the last copy
+    while (i < image.size()) {
+        size_t bestLength = 0;
+        size_t bestOffset = 0;
+        int64_t guess = (int64_t)i + lastShift;
+        if (guess >= 0 && (size_t)guess < base.size()) {
+            bestLength = matchLength((size_t)guess, i);
+            bestOffset = (size_t)guess;
+        }
+        if (bestLength < minCopy && i + block <= image.size()) {
+            int32_t candidate = head[hashAt(image, i)];
+            for (int c = 0; candidate >= 0 && c < maxCandidates; c++) {
+                size_t length = matchLength((size_t)candidate, i);
+                if (length > bestLength) {
+                    bestLength = length;
+                    bestOffset = (size_t)candidate;
+                }
+                candidate = prev[candidate];
+            }
+        }
+        if (bestLength >= minCopy) {
+            flushInsert(i);
+            ops.push_back((uint8_t)DeltaApplier::OP_COPY);
+            putVarint(ops, (uint32_t)bestOffset);
+            putVarint(ops, (uint32_t)bestLength);
+            lastShift = (int64_t)bestOffset - (int64_t)i;
+            i += bestLength;
+            insertStart = i;
+        } else {
+            i++;
+        }
+    }
+    flushInsert(image.size());
+    return ops;
+}
+
+inline Bytes withHeader(uint8_t kind, const Bytes& image, uint32_t baseSize, const Bytes& payload) {
+    OtaImageHeader header;
+    header.kind = kind;
+    header.targetSize = (uint32_t)image.size();
+    header.baseSize = baseSize;
+    Sha256 sha;
+    sha.update(image.data(), image.size());
+    sha.finish(header.targetSha);
+
+    Bytes out(OtaImageHeader::SIZE);
+    header.serialize(out.data());
+    out.insert(out.end(), payload.begin(), payload.end());
+    return out;
+}
+
+inline Bytes packCompressed(const Bytes& image) {
+    return withHeader(OtaImageHeader::KIND_COMPRESSED, image, 0, lzssCompress(image));
+}
+
+inline Bytes packDelta(const Bytes& base, const Bytes& image) {
+    return withHeader(OtaImageHeader::KIND_DELTA, image, (uint32_t)base.size(), lzssCompress(deltaOps(base, image)));
+}
+
+} // namespace OtaImageEncoder
+
+#endif // OTA_IMAGE_ENCODER_H
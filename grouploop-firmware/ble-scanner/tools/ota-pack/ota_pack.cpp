@@ -0,0 +1,121 @@
+// ota-pack: build compressed and delta OTA images for the wristbands.
+//
+// Build: c++ -std=c++11 -O2 -Iinclude tools/ota-pack/ota_pack.cpp -o ota-pack
+//        (from grouploop-firmware/ble-scanner; build-firmware.sh does this)
+//
+//   ota-pack compress <firmware.bin> <out.glz>
+//   ota-pack delta <running.bin> <firmware.bin> <out.gld>
+//   ota-pack unpack <packed> <out.bin> [running.bin]
+//
+// `unpack` runs the firmware's own streaming decoder, so it doubles as a
+// check that an artifact will decode on the device.
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "OtaImageDecoder.h"
+#include "OtaImageEncoder.h"
+
+using OtaImageEncoder::Bytes;
+
+static bool readFile(const char* path, Bytes& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    out.clear();
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) out.insert(out.end(), buffer, buffer + n);
+    fclose(f);
+    return true;
+}
+
+static bool writeFile(const char* path, const Bytes& data) {
+    FILE* f = fopen(path, "wb");
+    if (!f || fwrite(data.data(), 1, data.size(), f) != data.size()) {
+        fprintf(stderr, "cannot write %s\n", path);
+        if (f) fclose(f);
+        return false;
+    }
+    fclose(f);
+    return true;
+}
+
+class MemoryBase : public OtaBaseReader {
+public:
+    explicit MemoryBase(const Bytes& aBytes) : bytes(aBytes) {}
+    uint32_t size() const override { return (uint32_t)bytes.size(); }
+    bool read(uint32_t offset, uint8_t* buffer, size_t length) override {
+        if ((uint64_t)offset + length > bytes.size()) return false;
+        memcpy(buffer, bytes.data() + offset, length);
+        return true;
+    }
+private:
+    const Bytes& bytes;
+};
+
+class MemoryFlash : public OtaFlashWriter {
+public:
+    Bytes data;
+    bool begin(uint32_t) override { data.clear(); return true; }
+    bool write(const uint8_t* bytes, size_t length) override {
+        data.insert(data.end(), bytes, bytes + length);
+        return true;
+    }
+    bool commit() override { return true; }
+    void abort() override { data.clear(); }
+};
+
+static int unpack(const Bytes& packed, const Bytes& base, const char* outPath) {
+    MemoryBase baseReader(base);
+    MemoryFlash flash;
+    DecodingFlashWriter<1024> decoder(flash, &baseReader, 4096);
+    bool ok = decoder.begin((uint32_t)packed.size());
+    for (size_t i = 0; ok && i < packed.size(); i += 1024) {
+        size_t n = packed.size() - i < 1024 ? packed.size() - i : 1024;
+        ok = decoder.write(packed.data() + i, n);
+        while (ok && decoder.busy()) ok = decoder.drain();
+    }
+    if (!ok || !decoder.commit()) {
+        fprintf(stderr, "decode failed (wrong base image?)\n");
+        return 1;
+    }
+    printf("%s image: %zu -> %zu bytes\n", DecodingFlashWriter<1024>::formatName(decoder.getFormat()),
+           packed.size(), flash.data.size());
+    return writeFile(outPath, flash.data) ? 0 : 1;
+}
+
+static void report(const Bytes& image, const Bytes& packed) {
+    printf("%zu -> %zu bytes (%.1f%%)\n", image.size(), packed.size(),
+           image.empty() ? 0.0 : 100.0 * packed.size() / image.size());
+}
+
+int main(int argc, char** argv) {
+    if (argc == 4 && strcmp(argv[1], "compress") == 0) {
+        Bytes image;
+        if (!readFile(argv[2], image)) return 1;
+        Bytes packed = OtaImageEncoder::packCompressed(image);
+        report(image, packed);
+        return writeFile(argv[3], packed) ? 0 : 1;
+    }
+    if (argc == 5 && strcmp(argv[1], "delta") == 0) {
+        Bytes base, image;
+        if (!readFile(argv[2], base) || !readFile(argv[3], image)) return 1;
+        Bytes packed = OtaImageEncoder::packDelta(base, image);
+        report(image, packed);
+        return writeFile(argv[4], packed) ? 0 : 1;
+    }
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "unpack") == 0) {
+        Bytes packed, base;
+        if (!readFile(argv[2], packed)) return 1;
+        if (argc == 5 && !readFile(argv[4], base)) return 1;
+        return unpack(packed, base, argv[3]);
+    }
+    fprintf(stderr,
+            "usage: ota-pack compress <firmware.bin> <out.glz>\n"
+            "       ota-pack delta <running.bin> <firmware.bin> <out.gld>\n"
+            "       ota-pack unpack <packed> <out.bin> [running.bin]\n");
+    return 2;
+}
@@ -0,0 +1,251 @@
+#ifndef PROVISION_CLIENT_H
+#define PROVISION_CLIENT_H
+
+// Host side of include/ProvisionProtocol.h: opens the wristband's serial
+// port, builds ConfigPatch bytes from name=value settings and runs the
+// HELLO and CONFIG exchanges. Shared by the provision tool and the native
+// pseudo-terminal test; never built for the device. POSIX only.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "ConfigPatch.h"
+#include "ConfigSchema.h"
+#include "ProvisionProtocol.h"
+
+namespace ProvisionClient {
+
+typedef std::vector<uint8_t> Bytes;
+
+// The largest CONFIG the firmware accepts (PROVISION_MAX_PAYLOAD)
+static const size_t MAX_PAYLOAD = 512;
+
+struct DeviceInfo {
+    uint8_t version;
+    uint8_t settings;
+    uint8_t mac[6];
+    std::string label;
+};
+
+struct Ack {
+    uint8_t status;
+    uint32_t changed;
+    uint8_t flags;
+    std::string error;
+};
+
+inline speed_t baudConstant(int baud) {
+    switch (baud) {
+    case 9600: return B9600;
+    case 57600: return B57600;
+    case 115200: return B115200;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default: return B0;
+    }
+}
+
+// Raw 8N1 at `baud`; -1 and `error` on failure. USB CDC ignores the rate.
+inline int openSerial(const char* path, int baud, std::string& error) {
+    speed_t speed = baudConstant(baud);
+    if (speed == B0) {
+        error = "unsupported baud rate";
+        return -1;
+    }
+    int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        error = std::string("cannot open ") + path + ": " + strerror(errno);
+        return -1;
+    }
+    termios tio;
+    if (tcgetattr(fd, &tio) != 0) {
+        error = std::string("not a serial port: ") + path;
+        close(fd);
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cc[VMIN] = 0;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, speed);
+    cfsetospeed(&tio, speed);
+    if (tcsetattr(fd, TCSANOW, &tio) != 0) {
+        error = std::string("cannot configure ") + path;
+        close(fd);
+        return -1;
+    }
+    tcflush(fd, TCIOFLUSH);
+    return fd;
+}
+
+// ConfigPatch bytes for `name=value` settings (JSON names, e.g.
+// beaconNE=64:e8:33:84:43:9a deviceLabel=band-017)
+inline bool buildPatch(const std::vector<std::string>& assignments, Bytes& out, std::string& error) {
+    out.assign(1, BasicConfigPatch<1>::VERSION);
+    for (const std::string& assignment : assignments) {
+        size_t equals = assignment.find('=');
+        if (equals == std::string::npos) {
+            error = "expected name=value: " + assignment;
+            return false;
+        }
+        std::string name = assignment.substr(0, equals);
+        std::string value = assignment.substr(equals + 1);
+        size_t setting = ConfigSchema::find(name.c_str());
+        if (setting == ConfigSchema::SETTING_COUNT) {
+            error = "unknown setting: " + name;
+            return false;
+        }
+        out.push_back((uint8_t)setting);
+        if (ConfigSchema::SETTINGS[setting].type == ConfigType::INT) {
+            char* end = nullptr;
+            long number = strtol(value.c_str(), &end, 0);
+            if (value.empty() || *end) {
+                error = "not a number: " + assignment;
+                return false;
+            }
+            out.push_back(4);
+            for (int i = 0; i < 4; i++) out.push_back((uint8_t)((uint32_t)number >> (8 * i)));
+        } else {
+            if (value.size() > 255) {
+                error = "value too long: " + name;
+                return false;
+            }
+            out.push_back((uint8_t)value.size());
+            out.insert(out.end(), value.begin(), value.end());
+        }
+    }
+    if (out.size() < 3) {
+        error = "no settings";
+        return false;
+    }
+    if (out.size() > MAX_PAYLOAD) {
+        error = "settings do not fit in one frame";
+        return false;
+    }
+    return true;
+}
+
+// One device on an open port. Each exchange resends its frame, same seq,
+// until a reply comes or the attempts run out.
+class Client {
+public:
+    explicit Client(int aFd, uint32_t aTimeoutMs = 500, int anAttempts = 4)
+        : fd(aFd), timeoutMs(aTimeoutMs), attempts(anAttempts), seq(0), retries(0), decoder(aTimeoutMs) {}
+
+    bool hello(DeviceInfo& info, std::string& error) {
+        Bytes reply;
+        if (!exchange(PROVISION_HELLO, Bytes(), PROVISION_INFO, reply, error)) return false;
+        if (reply.size() < 8) {
+            error = "short INFO";
+            return false;
+        }
+        info.version = reply[0];
+        info.settings = reply[1];
+        memcpy(info.mac, &reply[2], sizeof(info.mac));
+        info.label.assign(reply.begin() + 8, reply.end());
+        if (info.version != PROVISION_VERSION) {
+            error = "unsupported protocol version";
+            return false;
+        }
+        return true;
+    }
+
+    bool pushConfig(const Bytes& patch, Ack& ack, std::string& error) {
+        Bytes reply;
+        if (!exchange(PROVISION_CONFIG, patch, PROVISION_ACK, reply, error)) return false;
+        if (reply.size() < 6) {
+            error = "short ACK";
+            return false;
+        }
+        ack.status = reply[0];
+        ack.changed = (uint32_t)reply[1] | ((uint32_t)reply[2] << 8) | ((uint32_t)reply[3] << 16) |
+                      ((uint32_t)reply[4] << 24);
+        ack.flags = reply[5];
+        ack.error.assign(reply.begin() + 6, reply.end());
+        return true;
+    }
+
+    uint32_t getRetries() const { return retries; }
+
+private:
+    int fd;
+    uint32_t timeoutMs;
+    int attempts;
+    uint8_t seq;
+    uint32_t retries;
+    BasicProvisionDecoder<MAX_PAYLOAD> decoder;
+
+    static uint32_t now() {
+        using namespace std::chrono;
+        return (uint32_t)duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool exchange(uint8_t type, const Bytes& payload, uint8_t replyType, Bytes& reply, std::string& error) {
+        Bytes frame(payload.size() + PROVISION_OVERHEAD);
+        seq++;
+        if (!provisionEncode(type, seq, payload.data(), payload.size(), frame.data(), frame.size())) {
+            error = "frame too large";
+            return false;
+        }
+        for (int attempt = 0; attempt < attempts; attempt++) {
+            if (attempt) retries++;
+            if (!writeAll(frame, error)) return false;
+            uint32_t deadline = now() + timeoutMs;
+            for (int32_t left; (left = (int32_t)(deadline - now())) > 0;) {
+                pollfd pfd = { fd, POLLIN, 0 };
+                int ready = poll(&pfd, 1, left);
+                if (ready < 0 && errno != EINTR) {
+                    error = std::string("poll: ") + strerror(errno);
+                    return false;
+                }
+                if (ready <= 0) continue;
+                uint8_t buffer[256];
+                ssize_t n = read(fd, buffer, sizeof(buffer));
+                if (n <= 0) {
+                    if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                        error = std::string("read: ") + strerror(errno);
+                        return false;
+                    }
+                    continue;
+                }
+                for (ssize_t i = 0; i < n; i++) {
+                    // Log text around the frames is skipped; so are replies
+                    // to earlier frames
+                    if (decoder.feed(buffer[i], now()) != decltype(decoder)::FRAME) continue;
+                    if (decoder.seq() != seq || decoder.type() != replyType) continue;
+                    reply.assign(decoder.payload(), decoder.payload() + decoder.size());
+                    return true;
+                }
+            }
+        }
+        error = "no reply";
+        return false;
+    }
+
+    bool writeAll(const Bytes& frame, std::string& error) {
+        size_t sent = 0;
+        while (sent < frame.size()) {
+            ssize_t n = write(fd, frame.data() + sent, frame.size() - sent);
+            if (n < 0) {
+                if (errno == EINTR || errno == EAGAIN) continue;
+                error = std::string("write: ") + strerror(errno);
+                return false;
+            }
+            sent += (size_t)n;
+        }
+        return true;
+    }
+};
+
+} // namespace ProvisionClient
+
+#endif // PROVISION_CLIENT_H
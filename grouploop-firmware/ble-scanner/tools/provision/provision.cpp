@@ -0,0 +1,124 @@
+// provision: push settings to a wristband over its USB serial port, in one
+// framed exchange and without a reboot (see include/ProvisionProtocol.h).
+//
+// Build: c++ -std=c++17 -O2 -Iinclude tools/provision/provision.cpp -o provision
+//        (from grouploop-firmware/ble-scanner)
+//
+//   provision <port> info
+//   provision <port> set <name=value | @file> ...
+//
+// Names are the JSON setting names (config_get). An @file holds one
+// name=value per line; blank lines and # comments are skipped. For a
+// batch, keep the shared settings in a file and add the label per band:
+//
+//   provision /dev/ttyACM0 set @venue.txt deviceLabel=band-017
+//
+// Exits 0 once the band has acknowledged and saved everything.
+
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "ProvisionClient.h"
+
+using namespace ProvisionClient;
+
+static const int BAUD_RATE = 115200;
+
+static bool readAssignments(const char* path, std::vector<std::string>& out) {
+    std::ifstream in(path);
+    if (!in) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t start = line.find_first_not_of(" \t");
+        size_t end = line.find_last_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#') continue;
+        out.push_back(line.substr(start, end - start + 1));
+    }
+    return true;
+}
+
+static void printInfo(const DeviceInfo& info) {
+    printf("mac %02x:%02x:%02x:%02x:%02x:%02x  protocol %u  settings %u  label \"%s\"\n", info.mac[0],
+           info.mac[1], info.mac[2], info.mac[3], info.mac[4], info.mac[5], info.version, info.settings,
+           info.label.c_str());
+}
+
+static void printAck(const Ack& ack) {
+    if (ack.status != PROVISION_OK && ack.status != PROVISION_NOT_SAVED) {
+        printf("rejected (status %u): %s\n", ack.status, ack.error.c_str());
+        return;
+    }
+    // NOT_SAVED: the settings are live but will not survive a restart
+    printf("%s, changed:", ack.status == PROVISION_OK ? "ok" : "applied");
+    if (!ack.changed) printf(" nothing");
+    for (size_t setting = 0; setting < 32; setting++) {
+        if (ack.changed & (1u << setting)) printf(" %s", ConfigSchema::settingName(setting));
+    }
+    printf("%s%s\n", (ack.flags & PROVISION_ACK_SAVED) ? ", saved" : ", not saved",
+           (ack.flags & PROVISION_ACK_RESTART) ? ", restarting" : "");
+}
+
+static int usage() {
+    fprintf(stderr, "usage: provision <port> info\n"
+                    "       provision <port> set <name=value | @file> ...\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) return usage();
+    bool set = strcmp(argv[2], "set") == 0;
+    if (!set && strcmp(argv[2], "info") != 0) return usage();
+    if (set && argc < 4) return usage();
+
+    std::vector<std::string> assignments;
+    for (int i = 3; i < argc; i++) {
+        if (argv[i][0] == '@') {
+            if (!readAssignments(argv[i] + 1, assignments)) return 1;
+        } else {
+            assignments.push_back(argv[i]);
+        }
+    }
+    std::string error;
+    Bytes patch;
+    if (set && !buildPatch(assignments, patch, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+
+    int fd = openSerial(argv[1], BAUD_RATE, error);
+    if (fd < 0) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    Client client(fd);
+    DeviceInfo info;
+    if (!client.hello(info, error)) {
+        fprintf(stderr, "%s: %s\n", argv[1], error.c_str());
+        close(fd);
+        return 1;
+    }
+    printInfo(info);
+    if (info.settings != ConfigSchema::SETTING_COUNT) {
+        fprintf(stderr, "warning: firmware has %u settings, this tool knows %u\n", info.settings,
+                (unsigned)ConfigSchema::SETTING_COUNT);
+    }
+
+    int status = 0;
+    if (set) {
+        Ack ack;
+        if (!client.pushConfig(patch, ack, error)) {
+            fprintf(stderr, "%s: %s\n", argv[1], error.c_str());
+            status = 1;
+        } else {
+            printAck(ack);
+            status = ack.status == PROVISION_OK ? 0 : 1;
+        }
+    }
+    close(fd);
+    return status;
+}
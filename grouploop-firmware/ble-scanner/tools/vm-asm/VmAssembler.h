@@ -0,0 +1,223 @@
+#ifndef VM_ASSEMBLER_H
+#define VM_ASSEMBLER_H
+
+// Host-side assembler for include/ReactionVm.h programs. Shared by the
+// vm-asm tool and the native test; never built for the device.
+//
+// One instruction per line, `;` starts a comment, `name:` defines a label.
+//
+//   loop:   in tap              ; inputs: ax ay az motion tap beacon_nw
+//           jz idle             ;   beacon_ne beacon_se beacon_sw millis dt
+//           push 0xff8000       ; push picks the shortest encoding
+//           out led_color       ; outputs: led_color led_level vibrate
+//           push 255
+//           store r0            ; registers r0..rN
+//   idle:   halt
+//
+// Mnemonics are the opcode names in ReactionVm.h, lower case.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <map>
+#include "ReactionVm.h"
+
+namespace VmAssembler {
+
+typedef std::vector<uint8_t> Bytes;
+
+struct Mnemonic {
+    const char* name;
+    VmOp op;
+};
+
+static const Mnemonic MNEMONICS[] = {
+    {"halt", VmOp::HALT}, {"dup", VmOp::DUP}, {"drop", VmOp::DROP}, {"swap", VmOp::SWAP}, {"over", VmOp::OVER},
+    {"add", VmOp::ADD}, {"sub", VmOp::SUB}, {"mul", VmOp::MUL}, {"div", VmOp::DIV}, {"mod", VmOp::MOD},
+    {"neg", VmOp::NEG}, {"abs", VmOp::ABS}, {"min", VmOp::MIN}, {"max", VmOp::MAX},
+    {"and", VmOp::AND}, {"or", VmOp::OR}, {"xor", VmOp::XOR}, {"shl", VmOp::SHL}, {"shr", VmOp::SHR},
+    {"not", VmOp::NOT}, {"eq", VmOp::EQ}, {"lt", VmOp::LT}, {"gt", VmOp::GT},
+    {"clamp", VmOp::CLAMP}, {"sin", VmOp::SIN}, {"rgb", VmOp::RGB},
+    {"jmp", VmOp::JMP}, {"jz", VmOp::JZ}, {"jnz", VmOp::JNZ},
+    {"load", VmOp::LOAD}, {"store", VmOp::STORE}, {"in", VmOp::IN}, {"out", VmOp::OUT},
+    {"push", VmOp::PUSH32},     // narrowed to PUSH8/PUSH16 by value
+};
+
+static const char* const INPUT_NAMES[] = {
+    "ax", "ay", "az", "motion", "tap", "beacon_nw", "beacon_ne", "beacon_se", "beacon_sw", "millis", "dt",
+};
+
+static const char* const OUTPUT_NAMES[] = {"led_color", "led_level", "vibrate"};
+
+inline int indexOf(const char* const* names, size_t count, const std::string& name) {
+    for (size_t i = 0; i < count; i++) {
+        if (name == names[i]) return (int)i;
+    }
+    return -1;
+}
+
+inline bool parseNumber(const std::string& text, long long& value) {
+    if (text.empty()) return false;
+    char* end = nullptr;
+    value = strtoll(text.c_str(), &end, 0);
+    return *end == '\0';
+}
+
+inline std::vector<std::string> tokens(const std::string& line) {
+    std::vector<std::string> out;
+    std::string current;
+    for (size_t i = 0; i < line.size() && line[i] != ';'; i++) {
+        char c = line[i];
+        if (c == ' ' || c == '\t' || c == ',' || c == '\r') {
+            if (!current.empty()) out.push_back(current);
+            current.clear();
+        } else {
+            current += c;
+        }
+    }
+    if (!current.empty()) out.push_back(current);
+    return out;
+}
+
+// Assembles `source` into a loadable program (version byte included).
+// On failure returns false with "line N: message" in `error`.
+inline bool assemble(const std::string& source, Bytes& program, std::string& error) {
+    struct Fixup {
+        size_t at;
+        std::string label;
+        int line;
+    };
+    std::map<std::string, uint16_t> labels;
+    std::vector<Fixup> fixups;
+    Bytes code;
+
+    size_t start = 0;
+    int lineNumber = 0;
+    while (start <= source.size()) {
+        size_t end = source.find('\n', start);
+        if (end == std::string::npos) end = source.size();
+        std::string line = source.substr(start, end - start);
+        start = end + 1;
+        lineNumber++;
+        std::vector<std::string> words = tokens(line);
+
+        char prefix[32];
+        snprintf(prefix, sizeof(prefix), "line %d: ", lineNumber);
+        while (!words.empty() && words[0].size() > 1 && words[0][words[0].size() - 1] == ':') {
+            std::string label = words[0].substr(0, words[0].size() - 1);
+            if (labels.count(label)) {
+                error = prefix + std::string("label defined twice: ") + label;
+                return false;
+            }
+            labels[label] = (uint16_t)code.size();
+            words.erase(words.begin());
+        }
+        if (words.empty()) continue;
+
+        const Mnemonic* mnemonic = nullptr;
+        for (size_t i = 0; i < sizeof(MNEMONICS) / sizeof(MNEMONICS[0]); i++) {
+            if (words[0] == MNEMONICS[i].name) mnemonic = &MNEMONICS[i];
+        }
+        if (!mnemonic) {
+            error = prefix + std::string("unknown instruction: ") + words[0];
+            return false;
+        }
+        VmOp op = mnemonic->op;
+        size_t operands = BasicReactionVm<1, 1, 1>::instructionSize((uint8_t)op) > 1 ? 1 : 0;
+        if (words.size() != operands + 1) {
+            error = prefix + words[0] + (operands ? " takes one operand" : " takes no operand");
+            return false;
+        }
+        const std::string operand = operands ? words[1] : std::string();
+        long long value = 0;
+
+        switch (op) {
+            case VmOp::PUSH32:
+                if (!parseNumber(operand, value) || value < INT32_MIN || value > 0xFFFFFFFFLL) {
+                    error = prefix + std::string("bad number: ") + operand;
+                    return false;
+                }
+                if (value > INT32_MAX) value -= 0x100000000LL;     // 0xff8000ff and the like
+                if (value >= -128 && value <= 127) {
+                    code.push_back((uint8_t)VmOp::PUSH8);
+                    code.push_back((uint8_t)value);
+                } else if (value >= -32768 && value <= 32767) {
+                    code.push_back((uint8_t)VmOp::PUSH16);
+                    code.push_back((uint8_t)value);
+                    code.push_back((uint8_t)(value >> 8));
+                } else {
+                    code.push_back((uint8_t)VmOp::PUSH32);
+                    for (int shift = 0; shift < 32; shift += 8) code.push_back((uint8_t)(value >> shift));
+                }
+                break;
+            case VmOp::JMP:
+            case VmOp::JZ:
+            case VmOp::JNZ:
+                code.push_back((uint8_t)op);
+                fixups.push_back(Fixup{code.size(), operand, lineNumber});
+                code.push_back(0);
+                code.push_back(0);
+                break;
+            case VmOp::LOAD:
+            case VmOp::STORE:
+                if (operand.size() < 2 || operand[0] != 'r' || !parseNumber(operand.substr(1), value) ||
+                    value < 0 || value > 255) {
+                    error = prefix + std::string("bad register: ") + operand;
+                    return false;
+                }
+                code.push_back((uint8_t)op);
+                code.push_back((uint8_t)value);
+                break;
+            case VmOp::IN:
+            case VmOp::OUT: {
+                int id = op == VmOp::IN
+                    ? indexOf(INPUT_NAMES, sizeof(INPUT_NAMES) / sizeof(INPUT_NAMES[0]), operand)
+                    : indexOf(OUTPUT_NAMES, sizeof(OUTPUT_NAMES) / sizeof(OUTPUT_NAMES[0]), operand);
+                if (id < 0) {
+                    error = prefix + std::string(op == VmOp::IN ? "unknown input: " : "unknown output: ") + operand;
+                    return false;
+                }
+                code.push_back((uint8_t)op);
+                code.push_back((uint8_t)id);
+                break;
+            }
+            default:
+                code.push_back((uint8_t)op);
+                break;
+        }
+    }
+
+    for (size_t i = 0; i < fixups.size(); i++) {
+        std::map<std::string, uint16_t>::const_iterator label = labels.find(fixups[i].label);
+        if (label == labels.end()) {
+            char prefix[32];
+            snprintf(prefix, sizeof(prefix), "line %d: ", fixups[i].line);
+            error = prefix + std::string("unknown label: ") + fixups[i].label;
+            return false;
+        }
+        code[fixups[i].at] = (uint8_t)label->second;
+        code[fixups[i].at + 1] = (uint8_t)(label->second >> 8);
+    }
+
+    program.clear();
+    program.push_back((uint8_t)BasicReactionVm<1, 1, 1>::VERSION);
+    program.insert(program.end(), code.begin(), code.end());
+    return true;
+}
+
+inline std::string toHex(const Bytes& bytes) {
+    static const char digits[] = "0123456789abcdef";
+    std::string out;
+    for (size_t i = 0; i < bytes.size(); i++) {
+        out += digits[bytes[i] >> 4];
+        out += digits[bytes[i] & 0xF];
+    }
+    return out;
+}
+
+} // namespace VmAssembler
+
+#endif // VM_ASSEMBLER_H
@@ -0,0 +1,129 @@
+// vm-asm: assemble reaction programs for the `vm` command and try them out.
+//
+// Build: c++ -std=c++11 -O2 -Iinclude tools/vm-asm/vm_asm.cpp -o vm-asm
+//        (from grouploop-firmware/ble-scanner)
+//
+//   vm-asm asm <program.vasm>              print the hex for vm:<hex>
+//   vm-asm run <program.vasm> <inputs.csv> run it on the firmware's VM
+//
+// inputs.csv has one tick per line: ms,ax,ay,az,tap[,nw,ne,se,sw] with
+// acceleration in mg and RSSI in dBm; `#` lines are skipped. `run` prints
+// the outputs and instruction count of every tick, so a program can be
+// checked against recorded motion before it goes to a room of wristbands.
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <string>
+#include "ReactionVm.h"
+#include "VmAssembler.h"
+
+// Same sizes as the firmware (config.h)
+static const size_t CODE_SIZE = 512;
+static const size_t STACK_SIZE = 16;
+static const size_t REGISTERS = 16;
+static const uint16_t BUDGET = 256;
+
+static bool readFile(const char* path, std::string& out) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    out.clear();
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) out.append(buffer, n);
+    fclose(f);
+    return true;
+}
+
+static bool assembleFile(const char* path, VmAssembler::Bytes& program) {
+    std::string source, error;
+    if (!readFile(path, source)) return false;
+    if (!VmAssembler::assemble(source, program, error)) {
+        fprintf(stderr, "%s: %s\n", path, error.c_str());
+        return false;
+    }
+    return true;
+}
+
+static const char* statusName(VmStatus status) {
+    switch (status) {
+        case VmStatus::HALTED: return "halted";
+        case VmStatus::OUT_OF_BUDGET: return "out of budget";
+        case VmStatus::FAULT: return "fault";
+        case VmStatus::IDLE:
+        default: return "idle";
+    }
+}
+
+static int run(const VmAssembler::Bytes& program, const char* inputsPath) {
+    static BasicReactionVm<CODE_SIZE, STACK_SIZE, REGISTERS> vm(BUDGET);
+    if (!vm.load(program.data(), program.size())) {
+        fprintf(stderr, "rejected at %u: %s\n", vm.getFaultPc(), vm.getError());
+        return 1;
+    }
+    FILE* f = fopen(inputsPath, "r");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", inputsPath);
+        return 1;
+    }
+
+    VmOutputs outputs;
+    char line[256];
+    long lastMs = -1;
+    printf("%8s %8s %5s %7s %5s  %s\n", "ms", "color", "level", "vibrate", "instr", "status");
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        long ms = 0, ax = 0, ay = 0, az = 0, tap = 0, nw = -128, ne = -128, se = -128, sw = -128;
+        if (sscanf(line, "%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld", &ms, &ax, &ay, &az, &tap, &nw, &ne, &se, &sw) < 5) {
+            fprintf(stderr, "bad input line: %s", line);
+            fclose(f);
+            return 1;
+        }
+        VmInputs inputs;
+        inputs[VmInput::AX] = ax;
+        inputs[VmInput::AY] = ay;
+        inputs[VmInput::AZ] = az;
+        inputs[VmInput::MOTION] = (int32_t)sqrt((double)(ax * ax + ay * ay + az * az));
+        inputs[VmInput::TAP] = tap;
+        inputs[VmInput::BEACON_NW] = nw;
+        inputs[VmInput::BEACON_NE] = ne;
+        inputs[VmInput::BEACON_SE] = se;
+        inputs[VmInput::BEACON_SW] = sw;
+        inputs[VmInput::MILLIS] = ms;
+        inputs[VmInput::DT] = lastMs < 0 ? 0 : ms - lastMs;
+        lastMs = ms;
+
+        VmStatus status = vm.run(inputs, outputs);
+        printf("%8ld   %06x %5u %7u %5u  %s\n", ms, outputs.ledColor, outputs.ledLevel, outputs.vibrateMs,
+               vm.getStats().lastInstructions, statusName(status));
+        if (status == VmStatus::FAULT) {
+            fprintf(stderr, "fault at %u: %s\n", vm.getFaultPc(), vm.getError());
+            fclose(f);
+            return 1;
+        }
+    }
+    fclose(f);
+    printf("max %u of %u instructions per tick, %u ticks out of budget\n", vm.getStats().maxInstructions, BUDGET,
+           vm.getStats().outOfBudget);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    VmAssembler::Bytes program;
+    if (argc == 3 && strcmp(argv[1], "asm") == 0) {
+        if (!assembleFile(argv[2], program)) return 1;
+        printf("%s\n", VmAssembler::toHex(program).c_str());
+        return 0;
+    }
+    if (argc == 4 && strcmp(argv[1], "run") == 0) {
+        if (!assembleFile(argv[2], program)) return 1;
+        return run(program, argv[3]);
+    }
+    fprintf(stderr,
+            "usage: vm-asm asm <program.vasm>\n"
+            "       vm-asm run <program.vasm> <inputs.csv>\n");
+    return 2;
+}
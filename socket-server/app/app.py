@@ -1,6 +1,7 @@
 import asyncio
 import json
 import os
+import time
 from typing import Optional, Set, Dict
 import aiohttp
 
@@ -12,6 +13,19 @@ client_labels: Dict[WebSocketServerProtocol, str] = {}
 devices: Dict[str, WebSocketServerProtocol] = {}  # device_id -> websocket
 command_registry: Dict = {}  # Command definitions from CDN
 
+def shared_clock_ms() -> int:
+    """The clock devices sync to for cues: monotonic ms, wrapping like millis()"""
+    return int(time.monotonic() * 1000) & 0xFFFFFFFF
+
+def resolve_cue_time(parameters: str) -> str:
+    """Turn a relative cue "+<ms>:<command>" into an absolute shared time, so every
+    device gets the same T no matter when its copy of the broadcast is sent"""
+    if parameters.startswith("+"):
+        delay, sep, rest = parameters[1:].partition(":")
+        if sep and delay.isdigit():
+            return f"{(shared_clock_ms() + int(delay)) & 0xFFFFFFFF}:{rest}"
+    return parameters
+
 def default_label(ws: WebSocketServerProtocol) -> str:
     try:
         host, port = ws.remote_address[:2]
@@ -27,13 +41,25 @@ def _default_commands():
             "brightness":   {"parameters": ["value"],    "description": "Set LED brightness (0-255)"},
             "spring_param": {"parameters": ["params"],   "description": "Set spring parameters (6 hex chars)"},
             "vibrate":      {"parameters": ["duration"], "description": "Vibrate device (ms)"},
+            "haptic":       {"parameters": ["level", "attack", "sustain", "decay", "gap", "repeats", "priority"], "description": "Play a vibration envelope (times in ms, repeats 0 = until interrupted, priority background/normal/alert); haptic:stop stops"},
+            "haptic_wave":  {"parameters": ["id", "waveform"], "description": "Upload a haptic waveform (hex) into the device cache under an id 0-255"},
+            "hw":           {"parameters": ["id", "level"], "description": "Play a cached haptic waveform (level optional, default 255)"},
             "reset":        {"parameters": [],           "description": "Reset device"},
             "status":       {"parameters": [],           "description": "Get device status"},
-            "ota":          {"parameters": ["url"],      "description": "OTA firmware update from URL"},
-            "led_set":      {"parameters": ["index", "color"], "description": "Set individual LED on (index 0-5, color hex)"},
-            "led_off":      {"parameters": ["index"],    "description": "Turn off individual LED (index 0-5)"},
-            "led_all_off":  {"parameters": [],           "description": "Turn all 6 LEDs off"},
+            "ota":          {"parameters": ["url", "sha256"], "description": "OTA firmware update from URL, verified against its SHA-256"},
+            "led_set":      {"parameters": ["index", "color"], "description": "Set individual LED on (index 0-5, 0-23 on the ring build; color hex)"},
+            "led_off":      {"parameters": ["index"],    "description": "Turn off individual LED (index 0-5, 0-23 on the ring build)"},
+            "led_all_off":  {"parameters": [],           "description": "Turn all LEDs off"},
             "led_get_state":{"parameters": [],           "description": "Get state of all LEDs (debug)"},
+            "stats":        {"parameters": [],           "description": "Report per-process timing and loop jitter (JSON)"},
+            "config_get":   {"parameters": [],           "description": "Report the device configuration (JSON, WiFi password masked)"},
+            "config_set":   {"parameters": ["settings"], "description": "Change settings live: partial JSON or hex; only pin changes restart the device"},
+            "power":        {"parameters": ["mode"],     "description": "Set power mode (performance, balanced, saver) or 'status'"},
+            "timeline":     {"parameters": ["program"],  "description": "Upload a keyframe LED program (hex) and play it locally"},
+            "at":           {"parameters": ["time", "command"], "description": "Run a command at a shared time (ms, or +delay); all devices start in phase"},
+            "layer":        {"parameters": ["layer", "pattern", "opacity", "blend", "lifetime"], "description": "Run a pattern on an overlay layer over the base pattern"},
+            "flash":        {"parameters": ["color", "duration"], "description": "Flash a color over the current pattern, fading out (ms)"},
+            "vm":           {"parameters": ["program"],  "description": "Run a reaction program (hex from tools/vm-asm) on the device; 'off' stops it"},
         }
     }
 
@@ -129,6 +155,9 @@ async def handle_command(target: str, command: str, parameters: str = "") -> tup
     if len(expected_params) > 0 and not parameters:
         return False, f"Command {command} requires parameters: {expected_params}"
     
+    if command == "at":
+        parameters = resolve_cue_time(parameters)
+
     # Send the command
     if target == "all":
         sent_count = await send_to_all_devices(command, parameters)
@@ -156,6 +185,9 @@ async def handle_websocket_connection(websocket: WebSocketServerProtocol) -> Non
                     await websocket.send("id:ok")
                 else:
                     await websocket.send("id:error")
+            elif isinstance(message, str) and message.startswith("sync:"):
+                # Clock sync for cues: echo the device's timestamp with ours
+                await websocket.send(f"{message.strip()}:{shared_clock_ms()}")
             elif message == "s":
                 subscribers.add(websocket)
                 await websocket.send("stream:on")
@@ -184,6 +216,10 @@ async def handle_websocket_connection(websocket: WebSocketServerProtocol) -> Non
                         parts = [p for p in text.splitlines() if p]
                         for p in parts:
                             hp = p.strip()
+                            if hp.startswith("{"):
+                                # JSON report from a device (e.g. reply to "stats"); relay as-is
+                                await broadcast_to_subscribers(hp + "\n")
+                                continue
                             if len(hp) == 20 and all(c in '0123456789abcdefABCDEF' for c in hp):
                                 # Extract device ID from first 4 characters
                                 device_id = hp[:4].lower()